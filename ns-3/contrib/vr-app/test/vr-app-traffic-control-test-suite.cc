@@ -0,0 +1,359 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/bfdrr-queue-disc.h"
+#include "ns3/bursty-helper.h"
+#include "ns3/burst-sink-helper.h"
+#include "ns3/seq-ts-size-frag-header.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup vr-app
+ *
+ * This class checks that a BFDRR queue disc detecting the type of the flows
+ * from their arrivals promotes the flow of a BurstyApplication to BURSTY,
+ * without any FlowTag, while a constant bit rate flow sharing the bottleneck
+ * is not promoted, and that the bursts are no longer cut once the flow is
+ * bursty.
+ */
+class BfdrrBurstDetectionTestCase : public TestCase
+{
+public:
+  BfdrrBurstDetectionTestCase ();
+  virtual ~BfdrrBurstDetectionTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Trace sink for the FlowCreated trace source
+   * \param index the index of the flow
+   * \param bucket the hash bucket of the flow
+   */
+  void FlowCreated (uint32_t index, uint32_t bucket);
+  /**
+   * Trace sink for the FlowTypeChanged trace source
+   * \param index the index of the flow
+   * \param bucket the hash bucket of the flow
+   * \param oldType the previous type of the flow
+   * \param newType the new type of the flow
+   */
+  void FlowTypeChanged (uint32_t index, uint32_t bucket, FlowType oldType, FlowType newType);
+  /**
+   * Trace sink for the BurstTx trace source
+   * \param burst the burst
+   * \param from the source address
+   * \param to the destination address
+   * \param header the header of the burst
+   */
+  void BurstTx (Ptr<const Packet> burst, const Address &from, const Address &to,
+                const SeqTsSizeFragHeader &header);
+  /**
+   * Trace sink for the BurstRx trace source
+   * \param burst the burst
+   * \param from the source address
+   * \param to the destination address
+   * \param header the header of the burst
+   */
+  void BurstRx (Ptr<const Packet> burst, const Address &from, const Address &to,
+                const SeqTsSizeFragHeader &header);
+
+  std::vector<uint32_t> m_flows;            //!< Index of the flows, in order of creation
+  std::map<uint32_t, FlowType> m_flowTypes; //!< Last type of each flow that changed type
+  Time m_promotion;                         //!< Time the bursty flow became bursty
+  uint32_t m_burstsTx;                      //!< Number of bursts sent after the promotion
+  uint32_t m_burstsRx;                      //!< Number of bursts sent after the promotion and received
+};
+
+BfdrrBurstDetectionTestCase::BfdrrBurstDetectionTestCase ()
+  : TestCase ("Check the BFDRR burst detection with a BurstyApplication"),
+    m_promotion (Time::Max ()),
+    m_burstsTx (0),
+    m_burstsRx (0)
+{
+}
+
+BfdrrBurstDetectionTestCase::~BfdrrBurstDetectionTestCase ()
+{
+}
+
+void
+BfdrrBurstDetectionTestCase::FlowCreated (uint32_t index, uint32_t bucket)
+{
+  m_flows.push_back (index);
+}
+
+void
+BfdrrBurstDetectionTestCase::FlowTypeChanged (uint32_t index, uint32_t bucket, FlowType oldType, FlowType newType)
+{
+  m_flowTypes[index] = newType;
+  if (newType == FlowType::BURSTY && m_promotion == Time::Max ())
+    {
+      m_promotion = Simulator::Now ();
+    }
+}
+
+void
+BfdrrBurstDetectionTestCase::BurstTx (Ptr<const Packet> burst, const Address &from, const Address &to,
+                                      const SeqTsSizeFragHeader &header)
+{
+  if (Simulator::Now () > m_promotion)
+    {
+      m_burstsTx++;
+    }
+}
+
+void
+BfdrrBurstDetectionTestCase::BurstRx (Ptr<const Packet> burst, const Address &from, const Address &to,
+                                      const SeqTsSizeFragHeader &header)
+{
+  if (header.GetTs () > m_promotion)
+    {
+      m_burstsRx++;
+    }
+}
+
+void
+BfdrrBurstDetectionTestCase::DoRun (void)
+{
+  // source -- 100 Mbps -- router -- 10 Mbps (BFDRR) -- sink
+  NodeContainer nodes;
+  nodes.Create (3);
+
+  PointToPointHelper access;
+  access.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
+  access.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  NetDeviceContainer accessDevices = access.Install (nodes.Get (0), nodes.Get (1));
+
+  PointToPointHelper bottleneck;
+  bottleneck.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  bottleneck.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  bottleneck.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1p"));
+  NetDeviceContainer bottleneckDevices = bottleneck.Install (nodes.Get (1), nodes.Get (2));
+
+  InternetStackHelper stack;
+  stack.Install (nodes);
+
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc ("ns3::BFDRRQueueDisc",
+                        "SoftLimit", QueueSizeValue (QueueSize ("10p")),
+                        "BurstDetection", BooleanValue (true));
+  QueueDiscContainer queueDiscs = tch.Install (bottleneckDevices.Get (0));
+  Ptr<QueueDisc> queueDisc = queueDiscs.Get (0);
+  queueDisc->TraceConnectWithoutContext ("FlowCreated", MakeCallback (&BfdrrBurstDetectionTestCase::FlowCreated, this));
+  queueDisc->TraceConnectWithoutContext ("FlowTypeChanged", MakeCallback (&BfdrrBurstDetectionTestCase::FlowTypeChanged, this));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  address.Assign (accessDevices);
+  address.SetBase ("10.1.2.0", "255.255.255.0");
+  Ipv4InterfaceContainer sinkInterfaces = address.Assign (bottleneckDevices);
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  Ipv4Address sinkAddress = sinkInterfaces.GetAddress (1);
+
+  // bursts of 20 fragments every 100 ms
+  uint16_t burstPort = 50000;
+  BurstyHelper burstyHelper ("ns3::UdpSocketFactory", InetSocketAddress (sinkAddress, burstPort));
+  burstyHelper.SetAttribute ("FragmentSize", UintegerValue (1200));
+  burstyHelper.SetBurstGenerator ("ns3::SimpleBurstGenerator",
+                                  "PeriodRv", StringValue ("ns3::ConstantRandomVariable[Constant=0.1]"),
+                                  "BurstSizeRv", StringValue ("ns3::ConstantRandomVariable[Constant=24000]"));
+  ApplicationContainer burstyApps = burstyHelper.Install (nodes.Get (0));
+  burstyApps.Start (Seconds (0.5));
+  burstyApps.Stop (Seconds (3));
+  burstyApps.Get (0)->TraceConnectWithoutContext ("BurstTx", MakeCallback (&BfdrrBurstDetectionTestCase::BurstTx, this));
+
+  BurstSinkHelper burstSinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), burstPort));
+  ApplicationContainer burstSinkApps = burstSinkHelper.Install (nodes.Get (2));
+  burstSinkApps.Start (Seconds (0));
+  burstSinkApps.Get (0)->TraceConnectWithoutContext ("BurstRx", MakeCallback (&BfdrrBurstDetectionTestCase::BurstRx, this));
+
+  // a constant bit rate flow, one packet every 0.5 ms
+  uint16_t cbrPort = 50001;
+  OnOffHelper onOffHelper ("ns3::UdpSocketFactory", InetSocketAddress (sinkAddress, cbrPort));
+  onOffHelper.SetConstantRate (DataRate ("16Mbps"), 1000);
+  ApplicationContainer cbrApps = onOffHelper.Install (nodes.Get (0));
+  cbrApps.Start (Seconds (0.52));
+  cbrApps.Stop (Seconds (3));
+
+  PacketSinkHelper packetSinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), cbrPort));
+  packetSinkHelper.Install (nodes.Get (2)).Start (Seconds (0));
+
+  Simulator::Stop (Seconds (3.5));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_flows.size (), 2, "A flow should have been created for each application");
+  NS_TEST_EXPECT_MSG_EQ ((m_flowTypes.count (m_flows[0]) == 1 && m_flowTypes[m_flows[0]] == FlowType::BURSTY), true,
+                         "The flow of the BurstyApplication should be bursty");
+  NS_TEST_EXPECT_MSG_EQ ((m_flowTypes.count (m_flows[1]) == 0 || m_flowTypes[m_flows[1]] == FlowType::HEAVY), true,
+                         "The constant bit rate flow should be heavy");
+  NS_TEST_EXPECT_MSG_LT (m_promotion, Seconds (1), "The bursty flow should have been promoted within a few bursts");
+  NS_TEST_EXPECT_MSG_GT (m_burstsTx, 15, "Unexpected number of bursts sent");
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (m_burstsRx + 1, m_burstsTx, "The bursts of a bursty flow should not be cut");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup vr-app
+ *
+ * This class checks the deferred run mode of queue discs with the bursts of
+ * a BurstyApplication, whose fragments are all sent at the same time: the
+ * queue disc of the source is run once per burst instead of once per
+ * fragment, and the same bursts are received as with immediate runs.
+ */
+class DeferredRunBurstyTestCase : public TestCase
+{
+public:
+  DeferredRunBurstyTestCase ();
+  virtual ~DeferredRunBurstyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send bursts of 20 fragments from a source to a sink
+   * \param deferredRun whether the queue disc of the source runs in deferred run mode
+   * \param burstsTx the number of bursts sent
+   * \param burstsRx the number of bursts received
+   * \return the number of runs saved by the queue disc of the source
+   */
+  uint32_t SendBursts (bool deferredRun, uint32_t &burstsTx, uint32_t &burstsRx);
+  /**
+   * Trace sink counting the bursts
+   * \param count the number of bursts
+   * \param burst the burst
+   * \param from the source address
+   * \param to the destination address
+   * \param header the header of the burst
+   */
+  static void CountBurst (uint32_t *count, Ptr<const Packet> burst, const Address &from,
+                          const Address &to, const SeqTsSizeFragHeader &header);
+};
+
+DeferredRunBurstyTestCase::DeferredRunBurstyTestCase ()
+  : TestCase ("Check the deferred run mode of queue discs with a BurstyApplication")
+{
+}
+
+DeferredRunBurstyTestCase::~DeferredRunBurstyTestCase ()
+{
+}
+
+void
+DeferredRunBurstyTestCase::CountBurst (uint32_t *count, Ptr<const Packet> burst, const Address &from,
+                                       const Address &to, const SeqTsSizeFragHeader &header)
+{
+  (*count)++;
+}
+
+uint32_t
+DeferredRunBurstyTestCase::SendBursts (bool deferredRun, uint32_t &burstsTx, uint32_t &burstsRx)
+{
+  // source -- 100 Mbps -- sink
+  NodeContainer nodes;
+  nodes.Create (2);
+
+  PointToPointHelper link;
+  link.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
+  link.SetChannelAttribute ("Delay", StringValue ("1ms"));
+  link.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("5p"));
+  NetDeviceContainer devices = link.Install (nodes.Get (0), nodes.Get (1));
+
+  InternetStackHelper stack;
+  stack.Install (nodes);
+
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc ("ns3::FifoQueueDisc", "DeferredRun", BooleanValue (deferredRun));
+  QueueDiscContainer queueDiscs = tch.Install (devices.Get (0));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  // bursts of 20 fragments every 100 ms
+  uint16_t port = 50000;
+  BurstyHelper burstyHelper ("ns3::UdpSocketFactory", InetSocketAddress (interfaces.GetAddress (1), port));
+  burstyHelper.SetAttribute ("FragmentSize", UintegerValue (1200));
+  burstyHelper.SetBurstGenerator ("ns3::SimpleBurstGenerator",
+                                  "PeriodRv", StringValue ("ns3::ConstantRandomVariable[Constant=0.1]"),
+                                  "BurstSizeRv", StringValue ("ns3::ConstantRandomVariable[Constant=24000]"));
+  ApplicationContainer burstyApps = burstyHelper.Install (nodes.Get (0));
+  burstyApps.Start (Seconds (0.5));
+  burstyApps.Stop (Seconds (1.5));
+  burstsTx = 0;
+  burstyApps.Get (0)->TraceConnectWithoutContext ("BurstTx", MakeBoundCallback (&DeferredRunBurstyTestCase::CountBurst, &burstsTx));
+
+  BurstSinkHelper burstSinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  ApplicationContainer burstSinkApps = burstSinkHelper.Install (nodes.Get (1));
+  burstSinkApps.Start (Seconds (0));
+  burstsRx = 0;
+  burstSinkApps.Get (0)->TraceConnectWithoutContext ("BurstRx", MakeBoundCallback (&DeferredRunBurstyTestCase::CountBurst, &burstsRx));
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  uint32_t runsSaved = queueDiscs.Get (0)->GetNRunsSaved ();
+  NS_TEST_EXPECT_MSG_EQ (queueDiscs.Get (0)->GetStats ().nTotalDroppedPackets, 0, "No fragment should be dropped");
+
+  Simulator::Destroy ();
+  return runsSaved;
+}
+
+void
+DeferredRunBurstyTestCase::DoRun (void)
+{
+  uint32_t burstsTx;
+  uint32_t burstsRx;
+  uint32_t runsSaved = SendBursts (false, burstsTx, burstsRx);
+  NS_TEST_EXPECT_MSG_EQ (runsSaved, 0, "No run should be saved with immediate runs");
+  NS_TEST_EXPECT_MSG_GT (burstsTx, 5, "Unexpected number of bursts sent");
+  NS_TEST_EXPECT_MSG_EQ (burstsRx, burstsTx, "Every burst should be received with immediate runs");
+
+  uint32_t deferredBurstsTx;
+  uint32_t deferredBurstsRx;
+  runsSaved = SendBursts (true, deferredBurstsTx, deferredBurstsRx);
+  NS_TEST_EXPECT_MSG_EQ (deferredBurstsTx, burstsTx, "The same bursts should be sent with deferred runs");
+  NS_TEST_EXPECT_MSG_EQ (runsSaved, deferredBurstsTx * 19, "A single run per burst of 20 fragments should be scheduled");
+  NS_TEST_EXPECT_MSG_EQ (deferredBurstsRx, burstsRx, "The same bursts should be received with deferred runs");
+}
+
+/**
+ * \ingroup vr-app
+ *
+ * Test suite of the interaction of the vr-app applications with the
+ * traffic control queue discs
+ */
+class VrAppTrafficControlTestSuite : public TestSuite
+{
+public:
+  VrAppTrafficControlTestSuite ();
+};
+
+VrAppTrafficControlTestSuite::VrAppTrafficControlTestSuite ()
+  : TestSuite ("vr-app-traffic-control", SYSTEM)
+{
+  AddTestCase (new BfdrrBurstDetectionTestCase, TestCase::QUICK);
+  AddTestCase (new DeferredRunBurstyTestCase, TestCase::QUICK);
+}
+
+static VrAppTrafficControlTestSuite g_vrAppTrafficControlTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,213 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This example compares the delay of light (interactive) flows sharing a
+// bottleneck with bulk TCP flows when the bottleneck is managed by DRR, by
+// WF2Q+ or by STFQ.
+//
+// Network topology
+//
+//       100Mbps, 0.1ms          bandwidth, delay
+//   n1 ---------------- n2 ---------------------- n3
+//                        queueDiscType in {DRR, WF2Q, STFQ} [DRR]
+//
+// nBulk TCP flows and nLight UDP flows, sending lightPacketSize byte packets
+// at lightRate, are generated from n1 to n3. The device queue of the
+// bottleneck holds a single packet, so that the packets wait in the queue
+// disc. At the end of the simulation, the 50th, 90th and 99th percentiles
+// of the one-way delay of each flow, measured by the flow monitor, and the
+// wall-clock time of the simulation (the cost of the scheduler, all else
+// being equal) are printed.
+//
+// With many bulk flows, the delay of the light packets grows with the number
+// of flows times the quantum under DRR, as a light flow that becomes active
+// waits for a round, while WF2Q+ sends a light packet almost as soon as it
+// arrives.
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/flow-monitor-module.h"
+#include <chrono>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("FqLatencyBenchmark");
+
+/**
+ * Get a percentile of the delays of a flow
+ * \param histogram the delay histogram of the flow
+ * \param percentile the percentile, between 0 and 100
+ * \return the upper bound of the bin holding the percentile, in ms
+ */
+static double
+DelayPercentile (Histogram histogram, double percentile)
+{
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < histogram.GetNBins (); i++)
+    {
+      total += histogram.GetBinCount (i);
+    }
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < histogram.GetNBins (); i++)
+    {
+      count += histogram.GetBinCount (i);
+      if (count * 100 >= total * percentile)
+        {
+          return histogram.GetBinEnd (i) * 1000;
+        }
+    }
+  return 0;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string bandwidth = "10Mbps";
+  std::string delay = "5ms";
+  std::string queueDiscType = "DRR";
+  uint32_t queueDiscSize = 1000;
+  uint32_t nBulk = 32;
+  uint32_t nLight = 4;
+  uint32_t lightPacketSize = 100;
+  std::string lightRate = "64kbps";
+  uint32_t packetSize = 1448;
+  float simDuration = 10;
+
+  CommandLine cmd;
+  cmd.AddValue ("bandwidth", "Bottleneck bandwidth", bandwidth);
+  cmd.AddValue ("delay", "Bottleneck delay", delay);
+  cmd.AddValue ("queueDiscType", "Bottleneck queue disc type in {DRR, WF2Q, STFQ}", queueDiscType);
+  cmd.AddValue ("queueDiscSize", "Bottleneck queue disc size in packets", queueDiscSize);
+  cmd.AddValue ("nBulk", "Number of bulk TCP flows", nBulk);
+  cmd.AddValue ("nLight", "Number of light UDP flows", nLight);
+  cmd.AddValue ("lightPacketSize", "Size of the packets of the light flows", lightPacketSize);
+  cmd.AddValue ("lightRate", "Rate of each light flow", lightRate);
+  cmd.AddValue ("simDuration", "Simulation duration in seconds", simDuration);
+  cmd.Parse (argc, argv);
+
+  NodeContainer nodes;
+  nodes.Create (3);
+
+  PointToPointHelper accessLink;
+  accessLink.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
+  accessLink.SetChannelAttribute ("Delay", StringValue ("0.1ms"));
+
+  PointToPointHelper bottleneckLink;
+  bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bandwidth));
+  bottleneckLink.SetChannelAttribute ("Delay", StringValue (delay));
+  bottleneckLink.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1p"));
+
+  InternetStackHelper stack;
+  stack.InstallAll ();
+
+  TrafficControlHelper tchBottleneck;
+  if (queueDiscType.compare ("DRR") == 0)
+    {
+      tchBottleneck.SetRootQueueDisc ("ns3::DRRQueueDisc", "ByteLimit",
+                                      UintegerValue (queueDiscSize * (packetSize + 52)));
+    }
+  else if (queueDiscType.compare ("WF2Q") == 0)
+    {
+      tchBottleneck.SetRootQueueDisc ("ns3::WF2QQueueDisc", "MaxSize",
+                                      QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, queueDiscSize)));
+    }
+  else if (queueDiscType.compare ("STFQ") == 0)
+    {
+      tchBottleneck.SetRootQueueDisc ("ns3::WF2QQueueDisc", "MaxSize",
+                                      QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, queueDiscSize)),
+                                      "Scheduler", StringValue ("Stfq"));
+    }
+  else
+    {
+      NS_ABORT_MSG ("--queueDiscType not valid");
+    }
+
+  NetDeviceContainer devicesAccessLink = accessLink.Install (nodes.Get (0), nodes.Get (1));
+  NetDeviceContainer devicesBottleneckLink = bottleneckLink.Install (nodes.Get (1), nodes.Get (2));
+  QueueDiscContainer qdiscs = tchBottleneck.Install (devicesBottleneckLink.Get (0));
+
+  Ipv4AddressHelper address;
+  address.SetBase ("192.168.0.0", "255.255.255.0");
+  address.Assign (devicesAccessLink);
+  address.NewNetwork ();
+  Ipv4InterfaceContainer interfacesBottleneck = address.Assign (devicesBottleneckLink);
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (packetSize));
+
+  ApplicationContainer sinkApps, sourceApps;
+  uint16_t port = 5000;
+  for (uint32_t i = 0; i < nBulk; i++, port++)
+    {
+      PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sinkApps.Add (sink.Install (nodes.Get (2)));
+      BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (interfacesBottleneck.GetAddress (1), port));
+      sourceApps.Add (source.Install (nodes.Get (0)));
+    }
+  for (uint32_t i = 0; i < nLight; i++, port++)
+    {
+      PacketSinkHelper sink ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sinkApps.Add (sink.Install (nodes.Get (2)));
+      OnOffHelper source ("ns3::UdpSocketFactory", InetSocketAddress (interfacesBottleneck.GetAddress (1), port));
+      source.SetConstantRate (DataRate (lightRate), lightPacketSize);
+      sourceApps.Add (source.Install (nodes.Get (0)));
+    }
+  sinkApps.Start (Seconds (0));
+  sourceApps.Start (Seconds (0.1));
+  sourceApps.Stop (Seconds (simDuration));
+
+  FlowMonitorHelper flowHelper;
+  flowHelper.SetMonitorAttribute ("DelayBinWidth", DoubleValue (0.0001));
+  Ptr<FlowMonitor> flowMonitor = flowHelper.InstallAll ();
+
+  Simulator::Stop (Seconds (simDuration + 1));
+  uint64_t events = Simulator::GetEventCount ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+  events = Simulator::GetEventCount () - events;
+
+  flowMonitor->CheckForLostPackets ();
+  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ());
+  std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats ();
+
+  std::cout << queueDiscType << ": " << nBulk << " bulk flows, " << nLight << " light flows" << std::endl;
+  std::cout << "flow\ttype\tpackets\tp50 (ms)\tp90 (ms)\tp99 (ms)" << std::endl;
+  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator it = stats.begin (); it != stats.end (); it++)
+    {
+      Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (it->first);
+      if (t.destinationPort < 5000 || it->second.rxPackets == 0)
+        {
+          // the acknowledgments of the bulk flows
+          continue;
+        }
+      std::cout << it->first << "\t" << (t.protocol == 6 ? "bulk" : "light") << "\t"
+                << it->second.rxPackets << "\t"
+                << DelayPercentile (it->second.delayHistogram, 50) << "\t"
+                << DelayPercentile (it->second.delayHistogram, 90) << "\t"
+                << DelayPercentile (it->second.delayHistogram, 99) << std::endl;
+    }
+
+  std::cout << queueDiscType << ": " << elapsed.count () << " s of wall-clock time, "
+            << events << " events" << std::endl;
+  std::cout << qdiscs.Get (0)->GetStats () << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
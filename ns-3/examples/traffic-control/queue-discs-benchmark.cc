@@ -27,14 +27,26 @@
 // n1 ------------------------------------ n2 ----------------------------------- n3
 //   point-to-point (access link)                point-to-point (bottleneck link)
 //   100 Mbps, 0.1 ms                            bandwidth [10 Mbps], delay [5 ms]
-//   qdiscs PfifoFast with capacity              qdiscs queueDiscType in {PfifoFast, ARED, CoDel, FqCoDel, PIE} [PfifoFast]
+//   qdiscs PfifoFast with capacity              qdiscs queueDiscType in {PfifoFast, ARED, CoDel, FqCoDel, PIE, DRR, SFQ} [PfifoFast]
 //   of 1000 packets                             with capacity of queueDiscSize packets [1000]
 //   netdevices queues with size of 100 packets  netdevices queues with size of netdevicesQueueSize packets [100]
 //   without BQL                                 bql BQL [false]
 //   *** fixed configuration ***
 //
 // Two TCP flows are generated: one from n1 to n3 and the other from n3 to n1.
-// Additionally, n1 pings n3, so that the RTT can be measured.
+// Additionally, n1 pings n3, so that the RTT can be measured. The nFlows
+// option multiplies the TCP flows in each direction, e.g., to compare the
+// cost of the flow queueing disciplines (DRR and SFQ) with many flows: the
+// wall-clock time of the simulation and the number of events executed are
+// printed at the end.
+//
+// If perPacketBenchmark is not zero, no simulation is run: instead, batches
+// of packets of nFlows flows are enqueued into and dequeued from the
+// bottleneck queue disc until perPacketBenchmark packets have gone through
+// it, first with nothing connected to its trace sources and the Lightweight
+// attribute set, then with sinks connected to its trace sources, and the
+// wall-clock time per packet (enqueue plus dequeue) is printed for both runs.
+// Every packet is a new item, whose creation is not timed.
 //
 // The output will consist of a number of ping Rtt such as:
 //
@@ -61,6 +73,7 @@
 #include "ns3/internet-apps-module.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
+#include <chrono>
 
 using namespace ns3;
 
@@ -93,6 +106,60 @@ static void PingRtt (std::string context, Time rtt)
   std::cout << context << "=" << rtt.GetMilliSeconds () << " ms" << std::endl;
 }
 
+static void
+ItemTraceSink (Ptr<const QueueDiscItem> item)
+{
+}
+
+static void
+SojournTraceSink (Time sojourn)
+{
+}
+
+/**
+ * Measure the wall-clock time taken to enqueue a packet into a queue disc
+ * and to dequeue it
+ * \param qdisc the queue disc
+ * \param nPackets the number of packets
+ * \param nFlows the number of flows the packets belong to
+ * \param packetSize the size of the packets
+ * \return the time per packet, in ns
+ */
+static double
+PerPacketCost (Ptr<QueueDisc> qdisc, uint32_t nPackets, uint32_t nFlows, uint32_t packetSize)
+{
+  // the batches are small enough not to cause drops
+  const uint32_t batchSize = 100;
+  std::vector<Ptr<QueueDiscItem> > items (batchSize);
+  Ipv4Header hdr;
+  hdr.SetDestination (Ipv4Address ("10.0.0.1"));
+  hdr.SetProtocol (17);
+  hdr.SetPayloadSize (packetSize);
+
+  std::chrono::duration<double, std::nano> elapsed (0);
+  for (uint32_t n = 0; n < nPackets; n += batchSize)
+    {
+      // fresh items, so that the hash of their flow is computed by the queue
+      // disc as for real packets; their creation is not timed
+      for (uint32_t i = 0; i < batchSize; i++)
+        {
+          hdr.SetSource (Ipv4Address (0x0a010000 + (n + i) % nFlows));
+          items[i] = Create<Ipv4QueueDiscItem> (Create<Packet> (packetSize), Address (), 0x0800, hdr);
+        }
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      for (uint32_t i = 0; i < batchSize; i++)
+        {
+          qdisc->Enqueue (items[i]);
+        }
+      while (qdisc->Dequeue ())
+        {
+        }
+      elapsed += std::chrono::steady_clock::now () - start;
+    }
+  return elapsed.count () / nPackets;
+}
+
 int main (int argc, char *argv[])
 {
   std::string bandwidth = "10Mbps";
@@ -104,6 +171,8 @@ int main (int argc, char *argv[])
 
   std::string flowsDatarate = "20Mbps";
   uint32_t flowsPacketsSize = 1000;
+  uint32_t nFlows = 1;
+  uint32_t perPacketBenchmark = 0;
 
   float startTime = 0.1f; // in s
   float simDuration = 60;
@@ -112,12 +181,14 @@ int main (int argc, char *argv[])
   CommandLine cmd;
   cmd.AddValue ("bandwidth", "Bottleneck bandwidth", bandwidth);
   cmd.AddValue ("delay", "Bottleneck delay", delay);
-  cmd.AddValue ("queueDiscType", "Bottleneck queue disc type in {PfifoFast, ARED, CoDel, FqCoDel, PIE, prio}", queueDiscType);
+  cmd.AddValue ("queueDiscType", "Bottleneck queue disc type in {PfifoFast, ARED, CoDel, FqCoDel, PIE, prio, DRR, SFQ}", queueDiscType);
   cmd.AddValue ("queueDiscSize", "Bottleneck queue disc size in packets", queueDiscSize);
   cmd.AddValue ("netdevicesQueueSize", "Bottleneck netdevices queue size in packets", netdevicesQueueSize);
   cmd.AddValue ("bql", "Enable byte queue limits on bottleneck netdevices", bql);
   cmd.AddValue ("flowsDatarate", "Upload and download flows datarate", flowsDatarate);
   cmd.AddValue ("flowsPacketsSize", "Upload and download flows packets sizes", flowsPacketsSize);
+  cmd.AddValue ("nFlows", "Number of upload and of download flows", nFlows);
+  cmd.AddValue ("perPacketBenchmark", "Number of packets of the per-packet cost benchmark (0 to run the simulation)", perPacketBenchmark);
   cmd.AddValue ("startTime", "Simulation start time", startTime);
   cmd.AddValue ("simDuration", "Simulation duration in seconds", simDuration);
   cmd.AddValue ("samplingPeriod", "Goodput sampling period in seconds", samplingPeriod);
@@ -188,6 +259,16 @@ int main (int argc, char *argv[])
       tchBottleneck.AddChildQueueDisc (handle, cid[0], "ns3::FifoQueueDisc");
       tchBottleneck.AddChildQueueDisc (handle, cid[1], "ns3::RedQueueDisc");
     }
+  else if (queueDiscType.compare ("DRR") == 0)
+    {
+      tchBottleneck.SetRootQueueDisc ("ns3::DRRQueueDisc", "ByteLimit",
+                                      UintegerValue (queueDiscSize * flowsPacketsSize));
+    }
+  else if (queueDiscType.compare ("SFQ") == 0)
+    {
+      tchBottleneck.SetRootQueueDisc ("ns3::SFQQueueDisc", "MaxSize",
+                                      QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, queueDiscSize)));
+    }
   else
     {
       NS_ABORT_MSG ("--queueDiscType not valid");
@@ -216,6 +297,29 @@ int main (int argc, char *argv[])
   address.NewNetwork ();
   Ipv4InterfaceContainer interfacesBottleneck = address.Assign (devicesBottleneckLink);
 
+  if (perPacketBenchmark > 0)
+    {
+      Ptr<QueueDisc> qdisc = qdiscs.Get (0);
+      qdisc->Initialize ();
+
+      qdisc->SetAttribute ("Lightweight", BooleanValue (true));
+      double off = PerPacketCost (qdisc, perPacketBenchmark, nFlows, flowsPacketsSize);
+
+      qdisc->SetAttribute ("Lightweight", BooleanValue (false));
+      qdisc->TraceConnectWithoutContext ("Enqueue", MakeCallback (&ItemTraceSink));
+      qdisc->TraceConnectWithoutContext ("Dequeue", MakeCallback (&ItemTraceSink));
+      qdisc->TraceConnectWithoutContext ("Drop", MakeCallback (&ItemTraceSink));
+      qdisc->TraceConnectWithoutContext ("SojournTime", MakeCallback (&SojournTraceSink));
+      double on = PerPacketCost (qdisc, perPacketBenchmark, nFlows, flowsPacketsSize);
+
+      std::cout << queueDiscType << ": " << off << " ns per packet with tracing off, "
+                << on << " ns per packet with tracing on" << std::endl;
+      std::cout << qdisc->GetStats () << std::endl;
+
+      Simulator::Destroy ();
+      return 0;
+    }
+
   Ptr<NetDeviceQueueInterface> interface = devicesBottleneckLink.Get (0)->GetObject<NetDeviceQueueInterface> ();
   Ptr<NetDeviceQueue> queueInterface = interface->GetTxQueue (0);
   Ptr<DynamicQueueLimits> queueLimits = StaticCast<DynamicQueueLimits> (queueInterface->GetQueueLimits ());
@@ -258,7 +362,10 @@ int main (int argc, char *argv[])
   onOffHelperUp.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
   onOffHelperUp.SetAttribute ("PacketSize", UintegerValue (flowsPacketsSize));
   onOffHelperUp.SetAttribute ("DataRate", StringValue (flowsDatarate));
-  sourceApps.Add (onOffHelperUp.Install (n1));
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      sourceApps.Add (onOffHelperUp.Install (n1));
+    }
 
   port = 8;
   // Configure and install download flow
@@ -274,7 +381,10 @@ int main (int argc, char *argv[])
   onOffHelperDown.SetAttribute ("OffTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
   onOffHelperDown.SetAttribute ("PacketSize", UintegerValue (flowsPacketsSize));
   onOffHelperDown.SetAttribute ("DataRate", StringValue (flowsDatarate));
-  sourceApps.Add (onOffHelperDown.Install (n3));
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      sourceApps.Add (onOffHelperDown.Install (n3));
+    }
 
   // Configure and install ping
   V4PingHelper ping = V4PingHelper (n3Interface.GetAddress (0));
@@ -303,7 +413,15 @@ int main (int argc, char *argv[])
   flowMonitor = flowHelper.InstallAll();
 
   Simulator::Stop (Seconds (stopTime));
+  uint64_t events = Simulator::GetEventCount ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
   Simulator::Run ();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+  events = Simulator::GetEventCount () - events;
+
+  std::cout << queueDiscType << ": " << elapsed.count () << " s of wall-clock time, "
+            << events << " events" << std::endl;
+  std::cout << qdiscs.Get (0)->GetStats () << std::endl;
 
   flowMonitor->SerializeToXmlFile(queueDiscType + "-flowMonitor.xml", true, true);
 
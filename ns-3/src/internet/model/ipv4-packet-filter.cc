@@ -24,8 +24,9 @@
 #include "ns3/log.h"
 #include "ns3/enum.h"
 #include "ns3/uinteger.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
+#include "ns3/pointer.h"
+#include "ns3/flow-hash-tag.h"
+#include "ns3/hash.h"
 #include "ipv4-queue-disc-item.h"
 #include "ipv4-packet-filter.h"
 
@@ -64,6 +65,149 @@ Ipv4PacketFilter::CheckProtocol (Ptr<QueueDiscItem> item) const
 
 // ------------------------------------------------------------------------- //
 
+/**
+ * Serializes the 5-tuple of an IPv4 packet hashed by the DRR and BFDRR
+ * filters. The ports are only part of the tuple for the first fragment of
+ * TCP and UDP packets. Nothing is written but the output arguments, hence
+ * any thread holding the only reference to the packet may call it.
+ * \param ipv4Item the packet
+ * \param buf the complete serialization of the flow identifier (13 bytes)
+ * \param rss the RSS serialization of the flow identifier (12 bytes)
+ * \param key the key of the header fields the hash depends on
+ * \return the length of the RSS serialization
+ */
+static uint32_t
+DRRIpv4FlowTuple (const Ipv4QueueDiscItem *ipv4Item, uint8_t *buf, uint8_t *rss, uint32_t &key)
+{
+  const Ipv4Header &hdr = ipv4Item->GetHeader ();
+  Ipv4Address src = hdr.GetSource ();
+  Ipv4Address dest = hdr.GetDestination ();
+  uint8_t prot = hdr.GetProtocol ();
+  uint16_t fragOffset = hdr.GetFragmentOffset ();
+
+  uint16_t srcPort = 0;
+  uint16_t destPort = 0;
+  bool hasPorts = false;
+
+  if ((prot == 6 || prot == 17) && fragOffset == 0) // TCP or UDP
+    {
+      // the ports are the first four bytes of both the TCP and the UDP header:
+      // copy them rather than deserializing the whole header, so that the tag
+      // is validated without parsing the transport header
+      uint8_t ports[4] = {0, 0, 0, 0};
+      ipv4Item->GetPacket ()->CopyData (ports, 4);
+      srcPort = (ports[0] << 8) | ports[1];
+      destPort = (ports[2] << 8) | ports[3];
+      hasPorts = true;
+    }
+
+  // the key of the header fields the hash depends on (the ports are only
+  // hashed for the first fragment), so that a tag is not reused after a
+  // middlebox rewrote the addresses or the ports
+  key = src.Get () ^ (dest.Get () * 2654435761u) ^ (uint32_t (prot) << 1) ^ (fragOffset == 0);
+  key ^= ((uint32_t (srcPort) << 16) | destPort) * 40503u;
+
+  //---------------------------------------------------------------------------//
+  /* This is as per the ns2 code. Only uses the source address. Or if specified,
+   * uses the mask as well */
+
+  /*
+  if(m_mask)
+    src.CombineMask(Ipv4Mask(m_mask)); // As per ns-2 code, this is a bitwise & with the network mask
+  */
+
+  /* TODO: Can the mask be obtained from the packet itself? It feel cumbersome */
+  /* for the user to pass the network mask while initialising the filter */
+  /*
+  uint32_t source = src.Get(); // Get the host-order 32-bit IP address.
+  uint32_t hash = ((source + (source >> 8) + ~(source>>4)) % ((2<<23)-1))+1; // modulo a large prime
+  */
+
+
+  //---------------------------------------------------------------------------//
+
+  /* This is a modified version of the hash function in the fq-codel ns3 code. Probably a more robust hash function
+   * calculated using a variety of parameters */
+
+  src.Serialize (buf);
+  dest.Serialize (buf + 4);
+  buf[8] = prot;
+  buf[9] = (srcPort >> 8) & 0xff;
+  buf[10] = srcPort & 0xff;
+  buf[11] = (destPort >> 8) & 0xff;
+  buf[12] = destPort & 0xff;
+
+  /* the RSS input: addresses and, for TCP and UDP, ports */
+  src.Serialize (rss);
+  dest.Serialize (rss + 4);
+  rss[8] = buf[9];
+  rss[9] = buf[10];
+  rss[10] = buf[11];
+  rss[11] = buf[12];
+
+  return hasPorts ? 12 : 8;
+}
+
+/**
+ * Computes the hash of the 5-tuple of an IPv4 packet, as done by the DRR and
+ * BFDRR filters. The hash is computed once per packet: it is stored in the
+ * item, for the other classifiers of the item, and in a FlowHashTag, for the
+ * filters of the next hops. The tag is only reused if the network header
+ * fields the hash depends on and the configuration of the hasher are
+ * unchanged. The hash stored in the item is the one computed by the default
+ * hasher configuration.
+ * \param ipv4Item the packet
+ * \param hasher the hash engine
+ * \return the hash of the 5-tuple
+ */
+static uint32_t
+DRRIpv4FlowHash (Ptr<Ipv4QueueDiscItem> ipv4Item, Ptr<FlowHasher> hasher)
+{
+  bool cacheable = hasher->IsCacheable ();
+  uint32_t salt = hasher->GetSalt ();
+  uint32_t hash;
+  if (cacheable && salt == 0 && ipv4Item->GetFlowHash (hash))
+    {
+      return hash;
+    }
+
+  uint8_t buf[13];
+  uint8_t rss[12];
+  uint32_t key;
+  uint32_t rssLen = DRRIpv4FlowTuple (PeekPointer (ipv4Item), buf, rss, key);
+  key ^= salt;
+
+  Ptr<Packet> pkt = ipv4Item->GetPacket ();
+  FlowHashTag tag;
+  if (cacheable && pkt->PeekPacketTag (tag) && tag.GetKey () == key)
+    {
+      if (salt == 0)
+        {
+          ipv4Item->SetFlowHash (tag.GetHash ());
+        }
+      ipv4Item->SetFlowId (tag.GetFlowId ());
+      return tag.GetHash ();
+    }
+
+  /* murmur3 used in fq-codel, by default */
+  hash = hasher->GetHash (buf, 13, rss, rssLen);
+  uint64_t id = FlowHasher::GetFlowId (buf, 13);
+  ipv4Item->SetFlowId (id);
+
+  if (cacheable)
+    {
+      if (salt == 0)
+        {
+          ipv4Item->SetFlowHash (hash);
+        }
+      tag.SetHash (hash);
+      tag.SetKey (key);
+      tag.SetFlowId (id);
+      pkt->ReplacePacketTag (tag);
+    }
+  return hash;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (DRRIpv4PacketFilter);
 
 TypeId
@@ -73,6 +217,12 @@ DRRIpv4PacketFilter::GetTypeId (void)
     .SetParent<Ipv4PacketFilter> ()
     .SetGroupName ("Internet")
     .AddConstructor<DRRIpv4PacketFilter> ()
+    .AddAttribute ("FlowHasher",
+                   "The hash engine of the filter",
+                   TypeId::ATTR_GET,
+                   PointerValue (),
+                   MakePointerAccessor (&DRRIpv4PacketFilter::GetFlowHasher),
+                   MakePointerChecker<FlowHasher> ())
     ;
   return tid;
 }
@@ -80,6 +230,7 @@ DRRIpv4PacketFilter::GetTypeId (void)
 DRRIpv4PacketFilter::DRRIpv4PacketFilter ()
 {
   NS_LOG_FUNCTION (this);
+  m_hasher = CreateObject<FlowHasher> ();
 }
 
 DRRIpv4PacketFilter::~DRRIpv4PacketFilter ()
@@ -87,6 +238,39 @@ DRRIpv4PacketFilter::~DRRIpv4PacketFilter ()
   NS_LOG_FUNCTION (this);
 }
 
+Ptr<FlowHasher>
+DRRIpv4PacketFilter::GetFlowHasher (void) const
+{
+  return m_hasher;
+}
+
+bool
+DRRIpv4PacketFilter::SetDefaultFlowHash (Ptr<QueueDiscItem> item)
+{
+  // no logging, as the method may be called by a thread other than the simulator thread
+  const Ipv4QueueDiscItem *ipv4Item = dynamic_cast<const Ipv4QueueDiscItem *> (PeekPointer (item));
+  if (!ipv4Item)
+    {
+      return false;
+    }
+
+  uint8_t buf[13];
+  uint8_t rss[12];
+  uint32_t key;
+  DRRIpv4FlowTuple (ipv4Item, buf, rss, key);
+  item->SetFlowHash (FlowHasher::GetDefaultHash (buf, 13));
+  item->SetFlowId (FlowHasher::GetFlowId (buf, 13));
+  return true;
+}
+
+void
+DRRIpv4PacketFilter::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_hasher = 0;
+  Ipv4PacketFilter::DoDispose ();
+}
+
 int32_t
 DRRIpv4PacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
 {
@@ -99,69 +283,8 @@ DRRIpv4PacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
         return PacketFilter::PF_NO_MATCH;
       }
 
-  Ipv4Header hdr = ipv4Item->GetHeader ();
-  Ipv4Address src = hdr.GetSource ();
-  Ipv4Address dest = hdr.GetDestination ();
-  uint8_t prot = hdr.GetProtocol ();
-  uint16_t fragOffset = hdr.GetFragmentOffset ();
-
-  TcpHeader tcpHdr;
-  UdpHeader udpHdr;
-  uint16_t srcPort = 0;
-  uint16_t destPort = 0;
+  uint32_t hash = DRRIpv4FlowHash (ipv4Item, m_hasher);
 
-  Ptr<Packet> pkt = ipv4Item->GetPacket ();
-
-
-  if (prot == 6 && fragOffset == 0) // TCP
-    {
-        pkt->PeekHeader (tcpHdr);
-        srcPort = tcpHdr.GetSourcePort ();
-        destPort = tcpHdr.GetDestinationPort ();
-    }
-  else if (prot == 17 && fragOffset == 0) // UDP
-    {
-        pkt->PeekHeader (udpHdr);
-        srcPort = udpHdr.GetSourcePort ();
-        destPort = udpHdr.GetDestinationPort ();
-    }
-
-  //---------------------------------------------------------------------------//
-  /* This is as per the ns2 code. Only uses the source address. Or if specified,
-   * uses the mask as well */
-
-  /*
-  if(m_mask)
-    src.CombineMask(Ipv4Mask(m_mask)); // As per ns-2 code, this is a bitwise & with the network mask 
-  */
-
-  /* TODO: Can the mask be obtained from the packet itself? It feel cumbersome */
-  /* for the user to pass the network mask while initialising the filter */
-  /*
-  uint32_t source = src.Get(); // Get the host-order 32-bit IP address.
-  uint32_t hash = ((source + (source >> 8) + ~(source>>4)) % ((2<<23)-1))+1; // modulo a large prime
-  */
-
-
-  //---------------------------------------------------------------------------//
-  
-  /* This is a modified version of the hash function in the fq-codel ns3 code. Probably a more robust hash function
-   * calculated using a variety of parameters */
-
-    uint8_t buf[13];
-    src.Serialize (buf);
-    dest.Serialize (buf + 4);
-    buf[8] = prot;
-    buf[9] = (srcPort >> 8) & 0xff;
-    buf[10] = srcPort & 0xff;
-    buf[11] = (destPort >> 8) & 0xff;
-    buf[12] = destPort & 0xff;
-    
-    /* murmur3 used in fq-codel */
-    uint32_t hash = Hash32 ((char*) buf, 13);
-
-  //******************************************************************//
-  
   NS_LOG_DEBUG ("Found Ipv4 packet; hash value " << hash);
 
   return hash;
@@ -175,7 +298,7 @@ TypeId
 BFDRRIpv4PacketFilter::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::BFDRRIpv4PacketFilter")
-                          .SetParent<Ipv4PacketFilter> ()
+                          .SetParent<DRRIpv4PacketFilter> ()
                           .SetGroupName ("Internet")
                           .AddConstructor<BFDRRIpv4PacketFilter> ()
       ;
@@ -192,8 +315,39 @@ BFDRRIpv4PacketFilter::~BFDRRIpv4PacketFilter ()
   NS_LOG_FUNCTION (this);
 }
 
+// ------------------------------------------------------------------------- //
+
+NS_OBJECT_ENSURE_REGISTERED (HDRRIpv4TenantPacketFilter);
+
+TypeId
+HDRRIpv4TenantPacketFilter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HDRRIpv4TenantPacketFilter")
+    .SetParent<Ipv4PacketFilter> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<HDRRIpv4TenantPacketFilter> ()
+    .AddAttribute ("PrefixLength",
+                   "The length of the source address prefix identifying a tenant",
+                   UintegerValue (24),
+                   MakeUintegerAccessor (&HDRRIpv4TenantPacketFilter::m_prefixLength),
+                   MakeUintegerChecker<uint8_t> (0, 32))
+  ;
+  return tid;
+}
+
+HDRRIpv4TenantPacketFilter::HDRRIpv4TenantPacketFilter ()
+  : m_prefixLength (24)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+HDRRIpv4TenantPacketFilter::~HDRRIpv4TenantPacketFilter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
 int32_t
-BFDRRIpv4PacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
+HDRRIpv4TenantPacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
 {
   NS_LOG_FUNCTION (this << item);
   Ptr<Ipv4QueueDiscItem> ipv4Item = DynamicCast<Ipv4QueueDiscItem> (item);
@@ -204,70 +358,14 @@ BFDRRIpv4PacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
       return PacketFilter::PF_NO_MATCH;
     }
 
-  Ipv4Header hdr = ipv4Item->GetHeader ();
-  Ipv4Address src = hdr.GetSource ();
-  Ipv4Address dest = hdr.GetDestination ();
-  uint8_t prot = hdr.GetProtocol ();
-  uint16_t fragOffset = hdr.GetFragmentOffset ();
+  uint32_t mask = m_prefixLength ? ~0U << (32 - m_prefixLength) : 0;
+  uint32_t prefix = ipv4Item->GetHeader ().GetSource ().Get () & mask;
+  uint8_t buf[5] = { (uint8_t) (prefix >> 24), (uint8_t) (prefix >> 16), (uint8_t) (prefix >> 8),
+                     (uint8_t) prefix, m_prefixLength };
+  uint32_t hash = Hash32 ((const char*) buf, sizeof (buf));
 
-  TcpHeader tcpHdr;
-  UdpHeader udpHdr;
-  uint16_t srcPort = 0;
-  uint16_t destPort = 0;
-
-  Ptr<Packet> pkt = ipv4Item->GetPacket ();
-
-
-  if (prot == 6 && fragOffset == 0) // TCP
-    {
-      pkt->PeekHeader (tcpHdr);
-      srcPort = tcpHdr.GetSourcePort ();
-      destPort = tcpHdr.GetDestinationPort ();
-    }
-  else if (prot == 17 && fragOffset == 0) // UDP
-    {
-      pkt->PeekHeader (udpHdr);
-      srcPort = udpHdr.GetSourcePort ();
-      destPort = udpHdr.GetDestinationPort ();
-    }
-
-  //---------------------------------------------------------------------------//
-  /* This is as per the ns2 code. Only uses the source address. Or if specified,
-   * uses the mask as well */
-
-  /*
-  if(m_mask)
-    src.CombineMask(Ipv4Mask(m_mask)); // As per ns-2 code, this is a bitwise & with the network mask
-  */
-
-  /* TODO: Can the mask be obtained from the packet itself? It feel cumbersome */
-  /* for the user to pass the network mask while initialising the filter */
-  /*
-  uint32_t source = src.Get(); // Get the host-order 32-bit IP address.
-  uint32_t hash = ((source + (source >> 8) + ~(source>>4)) % ((2<<23)-1))+1; // modulo a large prime
-  */
-
-
-  //---------------------------------------------------------------------------//
-
-  /* This is a modified version of the hash function in the fq-codel ns3 code. Probably a more robust hash function
-   * calculated using a variety of parameters */
-
-  uint8_t buf[13];
-  src.Serialize (buf);
-  dest.Serialize (buf + 4);
-  buf[8] = prot;
-  buf[9] = (srcPort >> 8) & 0xff;
-  buf[10] = srcPort & 0xff;
-  buf[11] = (destPort >> 8) & 0xff;
-  buf[12] = destPort & 0xff;
-
-  /* murmur3 used in fq-codel */
-  uint32_t hash = Hash32 ((char*) buf, 13);
-
-  //******************************************************************//
-
-  NS_LOG_DEBUG ("Found Ipv4 packet; hash value " << hash);
+  NS_LOG_DEBUG ("Found Ipv4 packet of tenant " << Ipv4Address (prefix) << "/" << (uint32_t) m_prefixLength
+                << "; hash " << hash);
 
   return hash;
 }
@@ -26,6 +26,7 @@
 
 #include "ns3/object.h"
 #include "ns3/packet-filter.h"
+#include "ns3/flow-hasher.h"
 
 namespace ns3 {
 
@@ -55,8 +56,9 @@ private:
  * \ingroup internet
  *
  * DRRIpv4PacketFilter is the filter to be added to the DRRQueueDisc
- * to simulate the behavior of the DRR Linux queue disc.
- *       */
+ * to simulate the behavior of the DRR Linux queue disc. The 5-tuple of the
+ * packets is hashed by the FlowHasher of the filter.
+ */
 class DRRIpv4PacketFilter : public Ipv4PacketFilter {
 public:
   /**
@@ -68,19 +70,44 @@ public:
   DRRIpv4PacketFilter ();
   virtual ~DRRIpv4PacketFilter ();
 
+  /**
+   * \brief Get the hash engine of the filter
+   * \return the hash engine
+   */
+  Ptr<FlowHasher> GetFlowHasher (void) const;
+
+  /**
+   * \brief Store in an IPv4 item the flow hash of the default configuration
+   *        of the hash engine and the flow identifier
+   *
+   * The filters configured with the default hash engine reuse the hash
+   * stored in the item instead of computing it. This method does not use
+   * any filter or any state shared with other threads, hence it may be
+   * called by a thread holding the only reference to the item, e.g., before
+   * handing the item over to DRRQueueDisc::ProducerEnqueue.
+   *
+   * \param item the item
+   * \return false if the item is not an IPv4 item
+   */
+  static bool SetDefaultFlowHash (Ptr<QueueDiscItem> item);
+
+protected:
+  virtual void DoDispose (void);
+
 private:
   virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
 
+  Ptr<FlowHasher> m_hasher;     //!< Hash engine
 };
 
 
 /**
  * \ingroup internet
  *
- * DRRIpv4PacketFilter is the filter to be added to the DRRQueueDisc
- * to simulate the behavior of the DRR Linux queue disc.
- *       */
-class BFDRRIpv4PacketFilter : public Ipv4PacketFilter {
+ * BFDRRIpv4PacketFilter is the filter to be added to the BFDRRQueueDisc.
+ * It classifies packets as the DRRIpv4PacketFilter.
+ */
+class BFDRRIpv4PacketFilter : public DRRIpv4PacketFilter {
 public:
   /**
    * \brief Get the type ID.
@@ -90,10 +117,32 @@ public:
 
   BFDRRIpv4PacketFilter ();
   virtual ~BFDRRIpv4PacketFilter ();
+};
+
+
+/**
+ * \ingroup internet
+ *
+ * HDRRIpv4TenantPacketFilter is the first-level filter of the
+ * HDRRQueueDisc. It classifies IPv4 packets by the prefix of their source
+ * address, so that the hosts of a subnet form a tenant. The prefix is hashed
+ * with the murmur3 hash.
+ */
+class HDRRIpv4TenantPacketFilter : public Ipv4PacketFilter {
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  HDRRIpv4TenantPacketFilter ();
+  virtual ~HDRRIpv4TenantPacketFilter ();
 
 private:
   virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
 
+  uint8_t m_prefixLength;       //!< Length of the prefix identifying a tenant
 };
 
 } // namespace ns3
@@ -24,10 +24,13 @@
 #include "ns3/log.h"
 #include "ns3/enum.h"
 #include "ns3/uinteger.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
+#include "ns3/pointer.h"
+#include "ns3/flow-hash-tag.h"
+#include "ns3/hash.h"
 #include "ipv6-queue-disc-item.h"
 #include "ipv6-packet-filter.h"
+#include <algorithm>
+#include <cstring>
 
 namespace ns3 {
 
@@ -64,6 +67,126 @@ Ipv6PacketFilter::CheckProtocol (Ptr<QueueDiscItem> item) const
 
 // ------------------------------------------------------------------------- //
 
+/**
+ * Serializes the flow label and the 5-tuple of an IPv6 packet hashed by the
+ * DRR and BFDRR filters. Nothing is written but the output arguments, hence
+ * any thread holding the only reference to the packet may call it.
+ * \param ipv6Item the packet
+ * \param buf the complete serialization of the flow identifier (40 bytes)
+ * \param key the key of the header fields the hash depends on
+ * \return true if the ports are part of the flow identifier
+ */
+static bool
+DRRIpv6FlowTuple (const Ipv6QueueDiscItem *ipv6Item, uint8_t *buf, uint32_t &key)
+{
+  const Ipv6Header &hdr = ipv6Item->GetHeader ();
+  Ipv6Address src = hdr.GetSourceAddress ();
+  Ipv6Address dest = hdr.GetDestinationAddress ();
+  uint8_t prot = hdr.GetNextHeader ();
+  uint32_t flowLabel = hdr.GetFlowLabel () & 0xfffff;
+
+  /* serialize the flow label and the 5-tuple in buf */
+  src.Serialize (buf);
+  dest.Serialize (buf + 16);
+  buf[32] = prot;
+  buf[37] = (flowLabel >> 16) & 0xff;
+  buf[38] = (flowLabel >> 8) & 0xff;
+  buf[39] = flowLabel & 0xff;
+
+  uint16_t srcPort = 0;
+  uint16_t destPort = 0;
+  bool hasPorts = false;
+
+  if (prot == 6 || prot == 17) // TCP or UDP
+    {
+      // the ports are the first four bytes of both the TCP and the UDP header:
+      // copy them rather than deserializing the whole header, so that the tag
+      // is validated without parsing the transport header
+      uint8_t ports[4] = {0, 0, 0, 0};
+      ipv6Item->GetPacket ()->CopyData (ports, 4);
+      srcPort = (ports[0] << 8) | ports[1];
+      destPort = (ports[2] << 8) | ports[3];
+      hasPorts = true;
+    }
+
+  buf[33] = (srcPort >> 8) & 0xff;
+  buf[34] = srcPort & 0xff;
+  buf[35] = (destPort >> 8) & 0xff;
+  buf[36] = destPort & 0xff;
+
+  // the key of the header fields the hash depends on
+  key = (uint32_t (prot) << 1) ^ (flowLabel * 40503u);
+  for (uint32_t i = 0; i < 32; i += 4)
+    {
+      uint32_t word = (buf[i] << 24) | (buf[i + 1] << 16) | (buf[i + 2] << 8) | buf[i + 3];
+      key = (key ^ word) * 2654435761u;
+    }
+  key ^= ((uint32_t (srcPort) << 16) | destPort) * 40503u;
+
+  return hasPorts;
+}
+
+/**
+ * Computes the hash of the flow label and of the 5-tuple of an IPv6 packet,
+ * as done by the DRR and BFDRR filters. Like the hash of IPv4 packets, the
+ * hash is cached in the item and in a FlowHashTag.
+ * \param ipv6Item the packet
+ * \param hasher the hash engine
+ * \return the hash
+ */
+static uint32_t
+DRRIpv6FlowHash (Ptr<Ipv6QueueDiscItem> ipv6Item, Ptr<FlowHasher> hasher)
+{
+  bool cacheable = hasher->IsCacheable ();
+  uint32_t salt = hasher->GetSalt ();
+  uint32_t hash;
+  if (cacheable && salt == 0 && ipv6Item->GetFlowHash (hash))
+    {
+      return hash;
+    }
+
+  uint8_t buf[40];
+  uint32_t key;
+  bool hasPorts = DRRIpv6FlowTuple (PeekPointer (ipv6Item), buf, key);
+  key ^= salt;
+
+  Ptr<Packet> pkt = ipv6Item->GetPacket ();
+  FlowHashTag tag;
+  if (cacheable && pkt->PeekPacketTag (tag) && tag.GetKey () == key)
+    {
+      if (salt == 0)
+        {
+          ipv6Item->SetFlowHash (tag.GetHash ());
+        }
+      ipv6Item->SetFlowId (tag.GetFlowId ());
+      return tag.GetHash ();
+    }
+
+  /* the RSS input: addresses and, for TCP and UDP, ports. The flow label is
+   * not part of it, as for the NICs */
+  uint8_t rss[36];
+  memcpy (rss, buf, 32);
+  memcpy (rss + 32, buf + 33, 4);
+
+  /* Linux calculates the jhash2 (jenkins hash), we calculate the murmur3 by default */
+  hash = hasher->GetHash (buf, 40, rss, hasPorts ? 36 : 32);
+  uint64_t id = FlowHasher::GetFlowId (buf, 40);
+  ipv6Item->SetFlowId (id);
+
+  if (cacheable)
+    {
+      if (salt == 0)
+        {
+          ipv6Item->SetFlowHash (hash);
+        }
+      tag.SetHash (hash);
+      tag.SetKey (key);
+      tag.SetFlowId (id);
+      pkt->ReplacePacketTag (tag);
+    }
+  return hash;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (DRRIpv6PacketFilter);
 
 TypeId
@@ -73,6 +196,12 @@ DRRIpv6PacketFilter::GetTypeId (void)
     .SetParent<Ipv6PacketFilter> ()
     .SetGroupName ("Internet")
     .AddConstructor<DRRIpv6PacketFilter> ()
+    .AddAttribute ("FlowHasher",
+                   "The hash engine of the filter",
+                   TypeId::ATTR_GET,
+                   PointerValue (),
+                   MakePointerAccessor (&DRRIpv6PacketFilter::GetFlowHasher),
+                   MakePointerChecker<FlowHasher> ())
   ;
   return tid;
 }
@@ -80,6 +209,7 @@ DRRIpv6PacketFilter::GetTypeId (void)
 DRRIpv6PacketFilter::DRRIpv6PacketFilter ()
 {
   NS_LOG_FUNCTION (this);
+  m_hasher = CreateObject<FlowHasher> ();
 }
 
 DRRIpv6PacketFilter::~DRRIpv6PacketFilter ()
@@ -87,6 +217,38 @@ DRRIpv6PacketFilter::~DRRIpv6PacketFilter ()
   NS_LOG_FUNCTION (this);
 }
 
+Ptr<FlowHasher>
+DRRIpv6PacketFilter::GetFlowHasher (void) const
+{
+  return m_hasher;
+}
+
+bool
+DRRIpv6PacketFilter::SetDefaultFlowHash (Ptr<QueueDiscItem> item)
+{
+  // no logging, as the method may be called by a thread other than the simulator thread
+  const Ipv6QueueDiscItem *ipv6Item = dynamic_cast<const Ipv6QueueDiscItem *> (PeekPointer (item));
+  if (!ipv6Item)
+    {
+      return false;
+    }
+
+  uint8_t buf[40];
+  uint32_t key;
+  DRRIpv6FlowTuple (ipv6Item, buf, key);
+  item->SetFlowHash (FlowHasher::GetDefaultHash (buf, 40));
+  item->SetFlowId (FlowHasher::GetFlowId (buf, 40));
+  return true;
+}
+
+void
+DRRIpv6PacketFilter::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_hasher = 0;
+  Ipv6PacketFilter::DoDispose ();
+}
+
 int32_t
 DRRIpv6PacketFilter::DoClassify (Ptr< QueueDiscItem > item) const
 {
@@ -99,46 +261,93 @@ DRRIpv6PacketFilter::DoClassify (Ptr< QueueDiscItem > item) const
       return PacketFilter::PF_NO_MATCH;
     }
 
-  Ipv6Header hdr = ipv6Item->GetHeader ();
-  Ipv6Address src = hdr.GetSourceAddress ();
-  Ipv6Address dest = hdr.GetDestinationAddress ();
-  uint8_t prot = hdr.GetNextHeader ();
+  uint32_t hash = DRRIpv6FlowHash (ipv6Item, m_hasher);
 
-  TcpHeader tcpHdr;
-  UdpHeader udpHdr;
-  uint16_t srcPort = 0;
-  uint16_t destPort = 0;
+  NS_LOG_DEBUG ("Found Ipv6 packet; hash " << hash);
 
-  Ptr<Packet> pkt = ipv6Item->GetPacket ();
+  return hash;
+}
+
+// ------------------------------------------------------------------------- //
+
+NS_OBJECT_ENSURE_REGISTERED (BFDRRIpv6PacketFilter);
+
+TypeId
+BFDRRIpv6PacketFilter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BFDRRIpv6PacketFilter")
+    .SetParent<DRRIpv6PacketFilter> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<BFDRRIpv6PacketFilter> ()
+  ;
+  return tid;
+}
+
+BFDRRIpv6PacketFilter::BFDRRIpv6PacketFilter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+BFDRRIpv6PacketFilter::~BFDRRIpv6PacketFilter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+// ------------------------------------------------------------------------- //
+
+NS_OBJECT_ENSURE_REGISTERED (HDRRIpv6TenantPacketFilter);
+
+TypeId
+HDRRIpv6TenantPacketFilter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HDRRIpv6TenantPacketFilter")
+    .SetParent<Ipv6PacketFilter> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<HDRRIpv6TenantPacketFilter> ()
+    .AddAttribute ("PrefixLength",
+                   "The length of the source address prefix identifying a tenant",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&HDRRIpv6TenantPacketFilter::m_prefixLength),
+                   MakeUintegerChecker<uint8_t> (0, 128))
+  ;
+  return tid;
+}
+
+HDRRIpv6TenantPacketFilter::HDRRIpv6TenantPacketFilter ()
+  : m_prefixLength (64)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+HDRRIpv6TenantPacketFilter::~HDRRIpv6TenantPacketFilter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+int32_t
+HDRRIpv6TenantPacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
+{
+  NS_LOG_FUNCTION (this << item);
+  Ptr<Ipv6QueueDiscItem> ipv6Item = DynamicCast<Ipv6QueueDiscItem> (item);
 
-  if (prot == 6) // TCP
+  if (!ipv6Item)
     {
-      pkt->PeekHeader (tcpHdr);
-      srcPort = tcpHdr.GetSourcePort ();
-      destPort = tcpHdr.GetDestinationPort ();
+      NS_LOG_DEBUG ("No match");
+      return PacketFilter::PF_NO_MATCH;
     }
-  else if (prot == 17) // UDP
+
+  // the prefix of the source address followed by its length
+  uint8_t buf[17];
+  ipv6Item->GetHeader ().GetSourceAddress ().GetBytes (buf);
+  for (uint32_t i = 0; i < 16; i++)
     {
-      pkt->PeekHeader (udpHdr);
-      srcPort = udpHdr.GetSourcePort ();
-      destPort = udpHdr.GetDestinationPort ();
+      uint32_t bits = std::min<uint32_t> (8, m_prefixLength > 8 * i ? m_prefixLength - 8 * i : 0);
+      buf[i] &= (uint8_t) (0xff00 >> bits);
     }
+  buf[16] = m_prefixLength;
+  uint32_t hash = Hash32 ((const char*) buf, sizeof (buf));
 
-  /* serialize the 5-tuple and the perturbation in buf */
-  uint8_t buf[37];
-  src.Serialize (buf);
-  dest.Serialize (buf + 16);
-  buf[32] = prot;
-  buf[33] = (srcPort >> 8) & 0xff;
-  buf[34] = srcPort & 0xff;
-  buf[35] = (destPort >> 8) & 0xff;
-  buf[36] = destPort & 0xff;
-
-
-  /* Linux calculates the jhash2 (jenkins hash), we calculate the murmur3 */
-  uint32_t hash = Hash32 ((char*) buf, 37);
-
-  NS_LOG_DEBUG ("Found Ipv6 packet; hash " << hash);
+  NS_LOG_DEBUG ("Found Ipv6 packet; tenant hash " << hash);
 
   return hash;
 }
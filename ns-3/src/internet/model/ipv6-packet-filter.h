@@ -26,6 +26,7 @@
 
 #include "ns3/object.h"
 #include "ns3/packet-filter.h"
+#include "ns3/flow-hasher.h"
 
 namespace ns3 {
 
@@ -54,9 +55,9 @@ private:
 /**
  * \ingroup internet
  *
- * DRRIpv6PacketFilter is the filter to be added to the DRR
- * queue disc to simulate the behavior of the fq-codel Linux queue disc.
- *
+ * DRRIpv6PacketFilter is the filter to be added to the DRRQueueDisc to
+ * classify IPv6 packets. The flow label and the 5-tuple of the packets are
+ * hashed by the FlowHasher of the filter.
  */
 class DRRIpv6PacketFilter : public Ipv6PacketFilter {
 public:
@@ -69,9 +70,78 @@ public:
   DRRIpv6PacketFilter ();
   virtual ~DRRIpv6PacketFilter ();
 
+  /**
+   * \brief Get the hash engine of the filter
+   * \return the hash engine
+   */
+  Ptr<FlowHasher> GetFlowHasher (void) const;
+
+  /**
+   * \brief Store in an IPv6 item the flow hash of the default configuration
+   *        of the hash engine and the flow identifier
+   *
+   * The filters configured with the default hash engine reuse the hash
+   * stored in the item instead of computing it. This method does not use
+   * any filter or any state shared with other threads, hence it may be
+   * called by a thread holding the only reference to the item, e.g., before
+   * handing the item over to DRRQueueDisc::ProducerEnqueue.
+   *
+   * \param item the item
+   * \return false if the item is not an IPv6 item
+   */
+  static bool SetDefaultFlowHash (Ptr<QueueDiscItem> item);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
+
+  Ptr<FlowHasher> m_hasher;     //!< Hash engine
+};
+
+/**
+ * \ingroup internet
+ *
+ * BFDRRIpv6PacketFilter is the filter to be added to the BFDRRQueueDisc.
+ * It classifies packets as the DRRIpv6PacketFilter.
+ */
+class BFDRRIpv6PacketFilter : public DRRIpv6PacketFilter {
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  BFDRRIpv6PacketFilter ();
+  virtual ~BFDRRIpv6PacketFilter ();
+};
+
+
+/**
+ * \ingroup internet
+ *
+ * HDRRIpv6TenantPacketFilter is the first-level filter of the
+ * HDRRQueueDisc. It classifies IPv6 packets by the prefix of their source
+ * address, so that the hosts of a subnet form a tenant. The prefix is hashed
+ * with the murmur3 hash.
+ */
+class HDRRIpv6TenantPacketFilter : public Ipv6PacketFilter {
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  HDRRIpv6TenantPacketFilter ();
+  virtual ~HDRRIpv6TenantPacketFilter ();
+
 private:
   virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
 
+  uint8_t m_prefixLength;       //!< Length of the prefix identifying a tenant
 };
 
 } // namespace ns3
@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "flow-hash-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (FlowHashTag);
+
+TypeId
+FlowHashTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FlowHashTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Network")
+    .AddConstructor<FlowHashTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+FlowHashTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+FlowHashTag::FlowHashTag ()
+  : m_hash (0),
+    m_key (0),
+    m_flowId (0)
+{
+}
+
+FlowHashTag::FlowHashTag (uint32_t hash, uint32_t key)
+  : m_hash (hash),
+    m_key (key),
+    m_flowId (0)
+{
+}
+
+void
+FlowHashTag::SetHash (uint32_t hash)
+{
+  m_hash = hash;
+}
+
+uint32_t
+FlowHashTag::GetHash (void) const
+{
+  return m_hash;
+}
+
+void
+FlowHashTag::SetKey (uint32_t key)
+{
+  m_key = key;
+}
+
+uint32_t
+FlowHashTag::GetKey (void) const
+{
+  return m_key;
+}
+
+void
+FlowHashTag::SetFlowId (uint64_t id)
+{
+  m_flowId = id;
+}
+
+uint64_t
+FlowHashTag::GetFlowId (void) const
+{
+  return m_flowId;
+}
+
+uint32_t
+FlowHashTag::GetSerializedSize (void) const
+{
+  return 2 * sizeof (uint32_t) + sizeof (uint64_t);
+}
+
+void
+FlowHashTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_hash);
+  i.WriteU32 (m_key);
+  i.WriteU64 (m_flowId);
+}
+
+void
+FlowHashTag::Deserialize (TagBuffer i)
+{
+  m_hash = i.ReadU32 ();
+  m_key = i.ReadU32 ();
+  m_flowId = i.ReadU64 ();
+}
+
+void
+FlowHashTag::Print (std::ostream &os) const
+{
+  os << "FlowHash=" << m_hash << " Key=" << m_key << " FlowId=" << m_flowId;
+}
+
+} // namespace ns3
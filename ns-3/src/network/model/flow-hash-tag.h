@@ -0,0 +1,106 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_HASH_TAG_H
+#define FLOW_HASH_TAG_H
+
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Packet tag carrying the flow hash computed by the first packet
+ * filter that classified the packet, so that the filters of the next hops
+ * do not have to parse the transport header and hash the 5-tuple again.
+ *
+ * Along with the hash, the tag stores a key derived from the network header
+ * fields (e.g., addresses and protocol) the hash was computed from. A filter
+ * only reuses the hash if the key still matches the packet, which is not the
+ * case if the packet has been encapsulated or its addresses rewritten.
+ * The tag also carries the flow identifier (a 64-bit fingerprint of the
+ * fields identifying the flow) computed along with the hash.
+ */
+class FlowHashTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  FlowHashTag ();
+
+  /**
+   * \brief Constructor
+   * \param hash the flow hash
+   * \param key the key of the header fields the hash was computed from
+   */
+  FlowHashTag (uint32_t hash, uint32_t key);
+
+  /**
+   * \brief Set the flow hash
+   * \param hash the flow hash
+   */
+  void SetHash (uint32_t hash);
+
+  /**
+   * \brief Get the flow hash
+   * \return the flow hash
+   */
+  uint32_t GetHash (void) const;
+
+  /**
+   * \brief Set the key of the header fields the hash was computed from
+   * \param key the key
+   */
+  void SetKey (uint32_t key);
+
+  /**
+   * \brief Get the key of the header fields the hash was computed from
+   * \return the key
+   */
+  uint32_t GetKey (void) const;
+
+  /**
+   * \brief Set the flow identifier
+   * \param id the flow identifier
+   */
+  void SetFlowId (uint64_t id);
+
+  /**
+   * \brief Get the flow identifier
+   * \return the flow identifier
+   */
+  uint64_t GetFlowId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint32_t m_hash; //!< the flow hash
+  uint32_t m_key;  //!< the key of the header fields the hash was computed from
+  uint64_t m_flowId; //!< the flow identifier
+};
+
+} // namespace ns3
+
+#endif /* FLOW_HASH_TAG_H */
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/ring-buffer.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/string.h"
+#include <iterator>
+#include <list>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * RingBuffer unit tests: the ring buffer must behave as a std::list when
+ * elements are inserted and erased at any position, across wrap-arounds
+ * and growths of the array.
+ */
+class RingBufferTestCase : public TestCase
+{
+public:
+  RingBufferTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * Check that the ring buffer holds the same elements as the list
+   * \param ring the ring buffer
+   * \param list the list
+   */
+  void CheckEqual (const RingBuffer<uint32_t> &ring, const std::list<uint32_t> &list);
+};
+
+RingBufferTestCase::RingBufferTestCase ()
+  : TestCase ("Sanity check on the ring buffer implementation")
+{
+}
+
+void
+RingBufferTestCase::CheckEqual (const RingBuffer<uint32_t> &ring, const std::list<uint32_t> &list)
+{
+  NS_TEST_ASSERT_MSG_EQ (ring.size (), list.size (), "The ring buffer has not the expected size");
+  std::list<uint32_t>::const_iterator l = list.cbegin ();
+  for (RingBuffer<uint32_t>::const_iterator r = ring.cbegin (); r != ring.cend (); r++, l++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (*r, *l, "The ring buffer has not the expected elements");
+    }
+}
+
+void
+RingBufferTestCase::DoRun (void)
+{
+  RingBuffer<uint32_t> ring;
+  std::list<uint32_t> list;
+
+  // FIFO use, wrapping around the array without growing it
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      ring.push_back (i);
+      list.push_back (i);
+    }
+  uint32_t capacity = ring.capacity ();
+  for (uint32_t i = 3; i < 100; i++)
+    {
+      ring.push_back (i);
+      list.push_back (i);
+      ring.pop_front ();
+      list.pop_front ();
+      CheckEqual (ring, list);
+    }
+  NS_TEST_EXPECT_MSG_EQ (ring.capacity (), capacity, "A FIFO use should not grow the ring buffer");
+
+  // insertions and removals at any position, growing the array
+  uint32_t value = 100;
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      uint32_t pos = (i * 7) % (ring.size () + 1);
+      RingBuffer<uint32_t>::const_iterator r = ring.insert (std::next (ring.cbegin (), pos), value);
+      list.insert (std::next (list.cbegin (), pos), value);
+      NS_TEST_EXPECT_MSG_EQ (*r, value, "The iterator returned by insert should refer to the element");
+      value++;
+      if (i % 3 == 0)
+        {
+          pos = (i * 5) % ring.size ();
+          r = ring.erase (std::next (ring.cbegin (), pos));
+          std::list<uint32_t>::const_iterator l = list.erase (std::next (list.cbegin (), pos));
+          NS_TEST_EXPECT_MSG_EQ ((r == ring.cend ()), (l == list.cend ()),
+                                 "The iterator returned by erase should refer to the next element");
+          if (l != list.cend ())
+            {
+              NS_TEST_EXPECT_MSG_EQ (*r, *l, "The iterator returned by erase should refer to the next element");
+            }
+        }
+      CheckEqual (ring, list);
+    }
+  NS_TEST_EXPECT_MSG_EQ (ring.front (), list.front (), "Verify the first element");
+  NS_TEST_EXPECT_MSG_EQ (ring.back (), list.back (), "Verify the last element");
+
+  ring.clear ();
+  NS_TEST_EXPECT_MSG_EQ (ring.empty (), true, "The ring buffer should be empty");
+  list.clear ();
+
+  // a burst grows the array, which is shrunk as the burst is drained
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      ring.push_back (i);
+      list.push_back (i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (ring.capacity (), 1024, "The ring buffer should have grown to hold the burst");
+  while (ring.size () > 1)
+    {
+      ring.pop_front ();
+      list.pop_front ();
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (ring.capacity (), ring.size (), "The ring buffer cannot hold its elements");
+    }
+  CheckEqual (ring, list);
+  uint32_t minCapacity = RingBuffer<uint32_t>::MIN_SHRINK_CAPACITY;
+  NS_TEST_EXPECT_MSG_EQ (ring.capacity (), minCapacity, "The ring buffer should have been shrunk");
+
+  // the slots of the removed items do not keep a reference to them
+  Ptr<DropTailQueue<Packet> > queue = CreateObject<DropTailQueue<Packet> > ();
+  queue->SetAttribute ("MaxSize", StringValue ("100p"));
+  Ptr<Packet> p = Create<Packet> ();
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      queue->Enqueue (p);
+    }
+  NS_TEST_EXPECT_MSG_EQ (p->GetReferenceCount (), 11, "Every enqueued item should be referenced");
+  queue->Dequeue ();
+  queue->Remove ();
+  NS_TEST_EXPECT_MSG_EQ (p->GetReferenceCount (), 9, "The dequeued items should not be referenced");
+  queue->Flush ();
+  NS_TEST_EXPECT_MSG_EQ (p->GetReferenceCount (), 1, "The flushed items should not be referenced");
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief RingBuffer TestSuite
+ */
+static class RingBufferTestSuite : public TestSuite
+{
+public:
+  RingBufferTestSuite ()
+    : TestSuite ("ring-buffer", UNIT)
+  {
+    AddTestCase (new RingBufferTestCase (), TestCase::QUICK);
+  }
+} g_ringBufferTestSuite; ///< the test suite
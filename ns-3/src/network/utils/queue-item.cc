@@ -77,7 +77,11 @@ QueueDiscItem::QueueDiscItem (Ptr<Packet> p, const Address& addr, uint16_t proto
   : QueueItem (p),
     m_address (addr),
     m_protocol (protocol),
-    m_txq (0)
+    m_txq (0),
+    m_flowHash (0),
+    m_flowHashSet (false),
+    m_flowId (0),
+    m_flowIdSet (false)
 {
   NS_LOG_FUNCTION (this << p << addr << protocol);
 }
@@ -146,4 +150,34 @@ QueueDiscItem::Hash (uint32_t perturbation) const
   return 0;
 }
 
+void
+QueueDiscItem::SetFlowHash (uint32_t hash)
+{
+  NS_LOG_FUNCTION (this << hash);
+  m_flowHash = hash;
+  m_flowHashSet = true;
+}
+
+bool
+QueueDiscItem::GetFlowHash (uint32_t &hash) const
+{
+  hash = m_flowHash;
+  return m_flowHashSet;
+}
+
+void
+QueueDiscItem::SetFlowId (uint64_t id)
+{
+  NS_LOG_FUNCTION (this << id);
+  m_flowId = id;
+  m_flowIdSet = true;
+}
+
+bool
+QueueDiscItem::GetFlowId (uint64_t &id) const
+{
+  id = m_flowId;
+  return m_flowIdSet;
+}
+
 } // namespace ns3
@@ -226,6 +226,41 @@ public:
    */
   virtual uint32_t Hash (uint32_t perturbation = 0) const;
 
+  /**
+   * \brief Store the flow hash computed by a packet filter
+   *
+   * Packet filters that hash the same fields store the hash in the item, so
+   * that other classifiers of the same item (e.g., nested queue discs) reuse it.
+   *
+   * \param hash the flow hash
+   */
+  void SetFlowHash (uint32_t hash);
+
+  /**
+   * \brief Get the flow hash stored by a packet filter, if any
+   * \param hash the flow hash, if stored
+   * \return true if a flow hash has been stored in this item
+   */
+  bool GetFlowHash (uint32_t &hash) const;
+
+  /**
+   * \brief Store the identifier of the flow computed by a packet filter
+   *
+   * The flow identifier is a 64-bit fingerprint of all the fields that
+   * identify the flow (e.g., the 5-tuple), which queue discs can use to
+   * tell apart the flows whose hashes collide.
+   *
+   * \param id the flow identifier
+   */
+  void SetFlowId (uint64_t id);
+
+  /**
+   * \brief Get the identifier of the flow stored by a packet filter, if any
+   * \param id the flow identifier, if stored
+   * \return true if a flow identifier has been stored in this item
+   */
+  bool GetFlowId (uint64_t &id) const;
+
 private:
   /**
    * \brief Default constructor
@@ -251,6 +286,10 @@ private:
   uint16_t m_protocol;    //!< L3 Protocol number
   uint8_t m_txq;          //!< Transmission queue index
   Time m_tstamp;          //!< timestamp when the packet was enqueued
+  uint32_t m_flowHash;    //!< flow hash stored by a packet filter
+  bool m_flowHashSet;     //!< whether a flow hash has been stored
+  uint64_t m_flowId;      //!< flow identifier stored by a packet filter
+  bool m_flowIdSet;       //!< whether a flow identifier has been stored
 };
 
 } // namespace ns3
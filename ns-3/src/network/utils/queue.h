@@ -31,6 +31,7 @@
 #include "ns3/log.h"
 #include "ns3/queue-size.h"
 #include "ns3/queue-item.h"
+#include "ns3/ring-buffer.h"
 #include <string>
 #include <sstream>
 #include <list>
@@ -223,6 +224,44 @@ private:
 };
 
 
+/**
+ * \ingroup queue
+ * \brief The container storing the items of a Queue
+ *
+ * The items of a queue are stored in a std::list by default, whose iterators
+ * stay valid when other items are inserted or removed. The queues of packets
+ * and of queue disc items, which are FIFO queues on the hot path of every
+ * simulation, store their items in a RingBuffer instead, so that enqueuing
+ * and dequeuing do not allocate memory. The storage of the queues of another
+ * item type is selected by specializing this class before the Queue class of
+ * that item type is instantiated.
+ */
+template <typename Item>
+struct QueueStorage
+{
+  typedef std::list<Ptr<Item> > Container;  //!< The container of the items
+};
+
+/**
+ * \ingroup queue
+ * \brief The queues of packets store their items in a ring buffer
+ */
+template <>
+struct QueueStorage<Packet>
+{
+  typedef RingBuffer<Ptr<Packet> > Container;  //!< The container of the items
+};
+
+/**
+ * \ingroup queue
+ * \brief The queues of queue disc items store their items in a ring buffer
+ */
+template <>
+struct QueueStorage<QueueDiscItem>
+{
+  typedef RingBuffer<Ptr<QueueDiscItem> > Container;  //!< The container of the items
+};
+
 /**
  * \ingroup queue
  * \brief Template class for packet Queues
@@ -236,7 +275,10 @@ private:
  * implement the Enqueue, Dequeue, Remove and Peek methods, and are
  * encouraged to leverage the DoEnqueue, DoDequeue, DoRemove, and DoPeek
  * methods in doing so, to ensure that appropriate trace sources are called
- * and statistics are maintained.
+ * and statistics are maintained. The items are stored in the container
+ * selected by QueueStorage; as the iterators of a RingBuffer are invalidated
+ * when an item is inserted or removed, subclasses should not keep iterators
+ * across calls to DoEnqueue, DoDequeue and DoRemove.
  *
  * Users of the Queue template class usually hold a queue through a smart pointer,
  * hence forward declaration is recommended to avoid pulling the implementation
@@ -300,8 +342,11 @@ public:
 
 protected:
 
+  /// The container of the items
+  typedef typename QueueStorage<Item>::Container Container;
+
   /// Const iterator.
-  typedef typename std::list<Ptr<Item> >::const_iterator ConstIterator;
+  typedef typename Container::const_iterator ConstIterator;
 
   /**
    * \brief Get a const iterator which refers to the first item in the queue.
@@ -385,7 +430,7 @@ protected:
   void DropAfterDequeue (Ptr<Item> item);
 
 private:
-  std::list<Ptr<Item> > m_packets;          //!< the items in the queue
+  Container m_packets;                      //!< the items in the queue
   NS_LOG_TEMPLATE_DECLARE;                  //!< the log component
 
   /// Traced callback: fired when a packet is enqueued
@@ -0,0 +1,409 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "ns3/assert.h"
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup queue
+ *
+ * \brief A growable ring buffer, storing its elements in a contiguous array
+ *
+ * The ring buffer provides the subset of the interface of std::list used by
+ * the Queue class (const iterators, insert and erase at a given position), so
+ * that it can be used as the container of a queue. Inserting at the tail and
+ * erasing from the head take constant (amortized) time and do not allocate
+ * memory unless the capacity (a power of two) has to be doubled, or halved
+ * because the elements take less than a quarter of it once it exceeds
+ * MIN_SHRINK_CAPACITY. Hence, a queue drained after a burst gives its memory
+ * back. Inserting or erasing elsewhere moves the elements between the
+ * position and the closest end.
+ *
+ * Unlike with std::list, inserting or erasing an element invalidates all the
+ * iterators; the iterators returned by insert and erase are valid.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+  /// Type of the elements
+  typedef T value_type;
+  /// Type of the number of elements
+  typedef uint32_t size_type;
+
+  /// Capacity below which the ring buffer is never shrunk
+  static const uint32_t MIN_SHRINK_CAPACITY = 64;
+
+  /**
+   * \brief A bidirectional iterator to the elements of a ring buffer
+   */
+  class const_iterator
+  {
+public:
+    /// Iterator category
+    typedef std::bidirectional_iterator_tag iterator_category;
+    /// Type of the elements
+    typedef T value_type;
+    /// Type of the distance between iterators
+    typedef std::ptrdiff_t difference_type;
+    /// Pointer to an element
+    typedef const T* pointer;
+    /// Reference to an element
+    typedef const T& reference;
+
+    const_iterator ()
+      : m_ring (0),
+        m_index (0)
+    {
+    }
+
+    /**
+     * \brief Get the element
+     * \return a reference to the element
+     */
+    reference operator* () const
+    {
+      return m_ring->Slot (m_index);
+    }
+
+    /**
+     * \brief Access a member of the element
+     * \return a pointer to the element
+     */
+    pointer operator-> () const
+    {
+      return &m_ring->Slot (m_index);
+    }
+
+    /**
+     * \brief Move to the next element
+     * \return the iterator
+     */
+    const_iterator& operator++ ()
+    {
+      m_index++;
+      return *this;
+    }
+
+    /**
+     * \brief Move to the next element
+     * \return the iterator before the move
+     */
+    const_iterator operator++ (int)
+    {
+      const_iterator it = *this;
+      m_index++;
+      return it;
+    }
+
+    /**
+     * \brief Move to the previous element
+     * \return the iterator
+     */
+    const_iterator& operator-- ()
+    {
+      m_index--;
+      return *this;
+    }
+
+    /**
+     * \brief Move to the previous element
+     * \return the iterator before the move
+     */
+    const_iterator operator-- (int)
+    {
+      const_iterator it = *this;
+      m_index--;
+      return it;
+    }
+
+    /**
+     * \brief Compare two iterators
+     * \param other the other iterator
+     * \return true if the iterators refer to the same position
+     */
+    bool operator== (const const_iterator &other) const
+    {
+      return m_ring == other.m_ring && m_index == other.m_index;
+    }
+
+    /**
+     * \brief Compare two iterators
+     * \param other the other iterator
+     * \return true if the iterators refer to different positions
+     */
+    bool operator!= (const const_iterator &other) const
+    {
+      return !(*this == other);
+    }
+
+private:
+    friend class RingBuffer;
+
+    /**
+     * \brief Constructor
+     * \param ring the ring buffer
+     * \param index the position of the element, counted from the head
+     */
+    const_iterator (const RingBuffer *ring, uint32_t index)
+      : m_ring (ring),
+        m_index (index)
+    {
+    }
+
+    const RingBuffer *m_ring;   //!< The ring buffer
+    uint32_t m_index;           //!< Position of the element, counted from the head
+  };
+
+  RingBuffer ()
+    : m_mask (0),
+      m_head (0),
+      m_size (0)
+  {
+  }
+
+  /**
+   * \return an iterator to the first element
+   */
+  const_iterator begin (void) const
+  {
+    return const_iterator (this, 0);
+  }
+
+  /**
+   * \return an iterator past the last element
+   */
+  const_iterator end (void) const
+  {
+    return const_iterator (this, m_size);
+  }
+
+  /**
+   * \return an iterator to the first element
+   */
+  const_iterator cbegin (void) const
+  {
+    return begin ();
+  }
+
+  /**
+   * \return an iterator past the last element
+   */
+  const_iterator cend (void) const
+  {
+    return end ();
+  }
+
+  /**
+   * \return the number of elements
+   */
+  size_type size (void) const
+  {
+    return m_size;
+  }
+
+  /**
+   * \return true if there are no elements
+   */
+  bool empty (void) const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * \return the number of elements that can be stored without growing
+   */
+  size_type capacity (void) const
+  {
+    return m_slots.size ();
+  }
+
+  /**
+   * \return the first element
+   */
+  const T& front (void) const
+  {
+    NS_ASSERT (m_size > 0);
+    return Slot (0);
+  }
+
+  /**
+   * \return the last element
+   */
+  const T& back (void) const
+  {
+    NS_ASSERT (m_size > 0);
+    return Slot (m_size - 1);
+  }
+
+  /**
+   * \brief Append an element
+   * \param value the element
+   */
+  void push_back (const T &value)
+  {
+    insert (end (), value);
+  }
+
+  /**
+   * \brief Remove the first element
+   */
+  void pop_front (void)
+  {
+    erase (begin ());
+  }
+
+  /**
+   * \brief Insert an element before the given position
+   * \param pos the position
+   * \param value the element
+   * \return an iterator to the inserted element
+   */
+  const_iterator insert (const_iterator pos, const T &value)
+  {
+    NS_ASSERT (pos.m_ring == this && pos.m_index <= m_size);
+    if (m_size == m_slots.size ())
+      {
+        Resize (m_slots.empty () ? 4 : 2 * m_slots.size ());
+      }
+    uint32_t index = pos.m_index;
+    if (index < m_size - index)
+      {
+        // move the elements before the position one slot towards the head
+        m_head = (m_head + m_mask) & m_mask;
+        for (uint32_t i = 0; i < index; i++)
+          {
+            Slot (i) = std::move (Slot (i + 1));
+          }
+      }
+    else
+      {
+        // move the elements from the position one slot towards the tail
+        for (uint32_t i = m_size; i > index; i--)
+          {
+            Slot (i) = std::move (Slot (i - 1));
+          }
+      }
+    Slot (index) = value;
+    m_size++;
+    return const_iterator (this, index);
+  }
+
+  /**
+   * \brief Erase the element at the given position
+   * \param pos the position
+   * \return an iterator to the element following the erased one
+   */
+  const_iterator erase (const_iterator pos)
+  {
+    NS_ASSERT (pos.m_ring == this && pos.m_index < m_size);
+    uint32_t index = pos.m_index;
+    if (index < m_size - 1 - index)
+      {
+        // move the elements before the position one slot towards the tail
+        for (uint32_t i = index; i > 0; i--)
+          {
+            Slot (i) = std::move (Slot (i - 1));
+          }
+        Slot (0) = T ();
+        m_head = (m_head + 1) & m_mask;
+      }
+    else
+      {
+        // move the elements after the position one slot towards the head
+        for (uint32_t i = index; i + 1 < m_size; i++)
+          {
+            Slot (i) = std::move (Slot (i + 1));
+          }
+        Slot (m_size - 1) = T ();
+      }
+    m_size--;
+    if (m_slots.size () > MIN_SHRINK_CAPACITY && m_size < m_slots.size () / 4)
+      {
+        Resize (m_slots.size () / 2);
+      }
+    return const_iterator (this, index);
+  }
+
+  /**
+   * \brief Erase all the elements, keeping the capacity
+   */
+  void clear (void)
+  {
+    for (uint32_t i = 0; i < m_size; i++)
+      {
+        Slot (i) = T ();
+      }
+    m_head = 0;
+    m_size = 0;
+  }
+
+private:
+  /**
+   * \brief Get the slot of an element
+   * \param index the position of the element, counted from the head
+   * \return the slot
+   */
+  T& Slot (uint32_t index)
+  {
+    return m_slots[(m_head + index) & m_mask];
+  }
+
+  /**
+   * \brief Get the slot of an element
+   * \param index the position of the element, counted from the head
+   * \return the slot
+   */
+  const T& Slot (uint32_t index) const
+  {
+    return m_slots[(m_head + index) & m_mask];
+  }
+
+  /**
+   * \brief Change the capacity, moving the elements to the start of the array
+   * \param capacity the new capacity, a power of two not less than the size
+   */
+  void Resize (uint32_t capacity)
+  {
+    NS_ASSERT (capacity >= m_size && (capacity & (capacity - 1)) == 0);
+    std::vector<T> slots (capacity);
+    for (uint32_t i = 0; i < m_size; i++)
+      {
+        slots[i] = std::move (Slot (i));
+      }
+    m_slots.swap (slots);
+    m_mask = m_slots.size () - 1;
+    m_head = 0;
+  }
+
+  std::vector<T> m_slots;   //!< The slots, whose number is a power of two
+  uint32_t m_mask;          //!< Number of slots minus one
+  uint32_t m_head;          //!< Slot of the first element
+  uint32_t m_size;          //!< Number of elements
+};
+
+} // namespace ns3
+
+#endif /* RING_BUFFER_H */
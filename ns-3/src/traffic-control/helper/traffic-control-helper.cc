@@ -26,6 +26,7 @@
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
 #include "ns3/traffic-control-layer.h"
+#include "ns3/drr-queue-disc.h"
 #include "traffic-control-helper.h"
 
 namespace ns3 {
@@ -104,6 +105,7 @@ QueueDiscFactory::CreateQueueDisc (const std::vector<Ptr<QueueDisc> > & queueDis
 
 
 TrafficControlHelper::TrafficControlHelper ()
+  : m_flowHashTxQueueSelection (false)
 {
 }
 
@@ -352,6 +354,12 @@ TrafficControlHelper::SetQueueLimits (std::string type,
   m_queueLimitsFactory.Set (n08, v08);
 }
 
+void
+TrafficControlHelper::SetFlowHashTxQueueSelection (void)
+{
+  m_flowHashTxQueueSelection = true;
+}
+
 QueueDiscContainer
 TrafficControlHelper::Install (Ptr<NetDevice> d)
 {
@@ -394,6 +402,17 @@ TrafficControlHelper::Install (Ptr<NetDevice> d)
         }
     }
 
+  if (m_flowHashTxQueueSelection)
+    {
+      Ptr<NetDeviceQueueInterface> ndqi = d->GetObject<NetDeviceQueueInterface> ();
+      NS_ABORT_MSG_IF (!ndqi, "A NetDeviceQueueInterface object has not been "
+                              "aggregated to the NetDevice");
+      if (ndqi->GetNTxQueues () > 1)
+        {
+          ndqi->SetSelectQueueCallback (DRRQueueDisc::MakeFlowHashSelectQueueCallback (ndqi->GetNTxQueues ()));
+        }
+    }
+
   return container;
 }
 
@@ -446,6 +446,18 @@ public:
                        std::string n07 = "", const AttributeValue &v07 = EmptyAttributeValue (),
                        std::string n08 = "", const AttributeValue &v08 = EmptyAttributeValue ());
 
+  /**
+   * Helper function used to have the Traffic Control layer select the
+   * transmission queue of multi-queue devices by hashing the flow of the
+   * packets (see DRRQueueDisc::MakeFlowHashSelectQueueCallback), as Linux does
+   * for devices not providing their own queue selection. The select queue
+   * callback is set on the NetDeviceQueueInterface of the devices having more
+   * than one transmission queue, replacing the one set by the device, if any.
+   * Together with an MqQueueDisc having a DRRQueueDisc child per transmission
+   * queue, this models a multi-queue NIC with fair queuing on every queue.
+   */
+  void SetFlowHashTxQueueSelection (void);
+
   /**
    * \param c set of devices
    * \returns a QueueDisc container with the root queue discs installed on the devices
@@ -497,6 +509,8 @@ private:
   std::vector<Ptr<QueueDisc> > m_queueDiscs;
   /// Factory to create a queue limits object
   ObjectFactory m_queueLimitsFactory;
+  /// Whether the transmission queue is selected by hashing the flow of the packets
+  bool m_flowHashTxQueueSelection;
 };
 
 } // namespace ns3
@@ -22,13 +22,21 @@
 
 #include "ns3/log.h"
 #include "ns3/string.h"
+#include "ns3/enum.h"
 #include "ns3/queue.h"
 #include "ns3/bfdrr-queue-disc.h"
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/ipv4-packet-filter.h"
+#include "ns3/ipv6-packet-filter.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
 #include <algorithm>
-#include <list>
+#include <cmath>
+#include <limits>
 #include "ns3/bfdrrflow.h"
+#include "ns3/flow-ring.h"
 
 namespace ns3 {
 
@@ -36,6 +44,15 @@ NS_LOG_COMPONENT_DEFINE ("BFDRRQueueDisc");
 
 NS_OBJECT_ENSURE_REGISTERED (BFDRRQueueDisc);
 
+/**
+ * Estimates the memory of a flow, excluding its packets. The internal queue
+ * of a flow is never released, so it is counted as part of the flow.
+ * \return the estimated memory of a flow, in bytes
+ */
+static uint64_t FlowFootprint (void)
+{
+  return sizeof (Flow) + sizeof (DropTailQueue<QueueDiscItem>);
+}
 
 TypeId
 BFDRRQueueDisc::GetTypeId (void)
@@ -59,18 +76,139 @@ BFDRRQueueDisc::GetTypeId (void)
                                          UintegerValue (1024),
                                          MakeUintegerAccessor (&BFDRRQueueDisc::m_flows),
                                          MakeUintegerChecker<uint32_t> ())
+                          .AddAttribute ("WeightKey",
+                                         "The key used to look up the weight of a flow in the Weights map",
+                                         EnumValue (DRRQueueDisc::WEIGHT_NONE),
+                                         MakeEnumAccessor (&BFDRRQueueDisc::m_weightKey),
+                                         MakeEnumChecker (DRRQueueDisc::WEIGHT_NONE, "None",
+                                                          DRRQueueDisc::WEIGHT_BY_CLASS, "Class",
+                                                          DRRQueueDisc::WEIGHT_BY_FLOW_TYPE, "FlowType",
+                                                          DRRQueueDisc::WEIGHT_BY_DSCP, "Dscp"))
+                          .AddAttribute ("Weights",
+                                         "The weights of the flows, as a list of key:weight pairs. "
+                                         "A flow of weight w is credited w quanta per round.",
+                                         DRRWeightMapValue (DRRWeightMap ()),
+                                         MakeDRRWeightMapAccessor (&BFDRRQueueDisc::m_weights),
+                                         MakeDRRWeightMapChecker ())
+                          .AddAttribute ("FlowIdleTimeout",
+                                         "The time after which an inactive flow can be recycled for another "
+                                         "hash bucket. Zero means that flows are never recycled.",
+                                         TimeValue (Seconds (0)),
+                                         MakeTimeAccessor (&BFDRRQueueDisc::m_flowIdleTimeout),
+                                         MakeTimeChecker ())
+                          .AddAttribute ("MaxFlowMemory",
+                                         "The maximum estimated memory of the flows (excluding their packets), "
+                                         "in bytes. When it is reached, the flow idle for the longest time is "
+                                         "recycled instead of creating a new flow. Zero means unbounded.",
+                                         UintegerValue (0),
+                                         MakeUintegerAccessor (&BFDRRQueueDisc::m_maxFlowMemory),
+                                         MakeUintegerChecker<uint64_t> ())
+                          .AddAttribute ("MaxOverflow",
+                                         "The maximum total backlog of the bursty flows above SoftLimit, "
+                                         "in the unit of the limits. Zero means unbounded.",
+                                         UintegerValue (0),
+                                         MakeUintegerAccessor (&BFDRRQueueDisc::m_maxOverflow),
+                                         MakeUintegerChecker<uint32_t> ())
+                          .AddAttribute ("AdaptiveLimit",
+                                         "Whether the limit of the bursty flows adapts to their bursts "
+                                         "and to the drain rate of the link, starting from HardLimit",
+                                         BooleanValue (false),
+                                         MakeBooleanAccessor (&BFDRRQueueDisc::m_adaptiveLimit),
+                                         MakeBooleanChecker ())
+                          .AddAttribute ("AdaptiveLimitWeight",
+                                         "The weight of a sample in the averages of the burst size and of "
+                                         "the drain rate",
+                                         DoubleValue (0.125),
+                                         MakeDoubleAccessor (&BFDRRQueueDisc::m_adaptiveWeight),
+                                         MakeDoubleChecker<double> (0, 1))
+                          .AddAttribute ("BurstHeadroom",
+                                         "The ratio of the adaptive limit of the bursty flows to their "
+                                         "average burst size",
+                                         DoubleValue (1.25),
+                                         MakeDoubleAccessor (&BFDRRQueueDisc::m_burstHeadroom),
+                                         MakeDoubleChecker<double> (1))
+                          .AddAttribute ("MaxBurstDelay",
+                                         "The adaptive limit of the bursty flows never exceeds the backlog "
+                                         "the link drains within this time, which is also the duration of a "
+                                         "sample of the drain rate",
+                                         TimeValue (MilliSeconds (50)),
+                                         MakeTimeAccessor (&BFDRRQueueDisc::m_maxBurstDelay),
+                                         MakeTimeChecker ())
+                          .AddAttribute ("BurstDetection",
+                                         "Whether the type of the flows is detected from the arrivals of "
+                                         "their packets rather than read from the FlowTag of their first packet",
+                                         BooleanValue (false),
+                                         MakeBooleanAccessor (&BFDRRQueueDisc::m_burstDetection),
+                                         MakeBooleanChecker ())
+                          .AddAttribute ("BurstGap",
+                                         "The maximum inter-arrival time of the packets of a burst of arrivals",
+                                         TimeValue (MilliSeconds (1)),
+                                         MakeTimeAccessor (&BFDRRQueueDisc::m_burstGap),
+                                         MakeTimeChecker ())
+                          .AddAttribute ("BurstThreshold",
+                                         "The size of a burst of arrivals, in the unit of the limits, "
+                                         "counting towards the bursty type",
+                                         UintegerValue (10),
+                                         MakeUintegerAccessor (&BFDRRQueueDisc::m_burstThreshold),
+                                         MakeUintegerChecker<uint32_t> (1))
+                          .AddAttribute ("StreamDuration",
+                                         "The duration of a burst of arrivals making a flow heavy",
+                                         TimeValue (MilliSeconds (50)),
+                                         MakeTimeAccessor (&BFDRRQueueDisc::m_streamDuration),
+                                         MakeTimeChecker ())
+                          .AddAttribute ("BurstScoreWeight",
+                                         "The weight of a burst of arrivals in the burst score of a flow",
+                                         DoubleValue (0.25),
+                                         MakeDoubleAccessor (&BFDRRQueueDisc::m_burstScoreWeight),
+                                         MakeDoubleChecker<double> (0, 1))
+                          .AddTraceSource ("BurstyLimit",
+                                           "The limit of the bursty flows",
+                                           MakeTraceSourceAccessor (&BFDRRQueueDisc::m_burstyLimit),
+                                           "ns3::TracedValueCallback::Uint32")
+                          .AddTraceSource ("FlowCreated",
+                                           "A flow has been created",
+                                           MakeTraceSourceAccessor (&BFDRRQueueDisc::m_flowCreatedTrace),
+                                           "ns3::DRRQueueDisc::FlowTracedCallback")
+                          .AddTraceSource ("FlowReclaimed",
+                                           "An idle flow has been detached from its hash bucket",
+                                           MakeTraceSourceAccessor (&BFDRRQueueDisc::m_flowReclaimedTrace),
+                                           "ns3::DRRQueueDisc::FlowTracedCallback")
+                          .AddTraceSource ("FlowTypeChanged",
+                                           "The type of a flow changed",
+                                           MakeTraceSourceAccessor (&BFDRRQueueDisc::m_flowTypeChangedTrace),
+                                           "ns3::BFDRRQueueDisc::FlowTypeTracedCallback")
       ;
   return tid;
 }
 
 BFDRRQueueDisc::BFDRRQueueDisc ()
-    : m_quantum (0)
+    : m_quantum (0),
+      m_weightKey (DRRQueueDisc::WEIGHT_NONE),
+      m_maxFlowMemory (0),
+      m_adaptiveLimit (false),
+      m_adaptiveWeight (0.125),
+      m_burstHeadroom (1.25),
+      m_avgBurst (0),
+      m_avgDrainRate (0),
+      m_drainSample (0),
+      m_burstyLimit (0),
+      m_maxOverflow (0),
+      m_overflow (0),
+      m_burstDetection (false),
+      m_burstThreshold (10),
+      m_burstScoreWeight (0.25),
+      m_activeFlow (0),
+      m_idleFlows (0),
+      m_activeFlowCredited (false),
+      m_nFlows (0)
 {
   NS_LOG_FUNCTION (this);
   m_flowFactory.SetTypeId ("ns3::DropTailQueue<QueueDiscItem>");
   // Change max size to soft or hard limit based on type of flow
   m_flowFactory.Set ("MaxSize", QueueSizeValue (m_hard_limit));
   AddPacketFilter(CreateObject<BFDRRIpv4PacketFilter>());
+  AddPacketFilter(CreateObject<BFDRRIpv6PacketFilter>());
+  AddPacketFilter(CreateObject<DRRNonIpPacketFilter>());
 }
 
 BFDRRQueueDisc::~BFDRRQueueDisc ()
@@ -78,6 +216,29 @@ BFDRRQueueDisc::~BFDRRQueueDisc ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+BFDRRQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  // every flow is either assigned to a hash bucket or in the free list
+  for (std::vector<Flow*>::iterator it = m_flowTable.begin (); it != m_flowTable.end (); it++)
+    {
+      delete *it;
+    }
+  for (std::vector<Flow*>::iterator it = m_freeFlows.begin (); it != m_freeFlows.end (); it++)
+    {
+      delete *it;
+    }
+  m_flowTable.clear ();
+  m_freeFlows.clear ();
+  m_overflow = 0;
+  m_activeFlow = 0;
+  m_idleFlows = 0;
+  m_activeFlowCredited = false;
+  m_nFlows = 0;
+  QueueDisc::DoDispose ();
+}
+
 void
 BFDRRQueueDisc::SetQuantum (uint32_t quantum)
 {
@@ -91,6 +252,24 @@ BFDRRQueueDisc::GetQuantum (void) const
   return m_quantum;
 }
 
+uint64_t
+BFDRRQueueDisc::GetFlowMemory (void) const
+{
+  return static_cast<uint64_t> (m_nFlows) * FlowFootprint ();
+}
+
+QueueSize
+BFDRRQueueDisc::GetBurstyLimit (void) const
+{
+  return QueueSize (m_hard_limit.GetUnit (), m_burstyLimit);
+}
+
+QueueSize
+BFDRRQueueDisc::GetOverflowBacklog (void) const
+{
+  return QueueSize (m_soft_limit.GetUnit (), m_overflow);
+}
+
 bool
 BFDRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
 {
@@ -114,31 +293,42 @@ BFDRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
 
   // Add check for more than m_flows but that isn't necessary rn.
 
+  NS_ASSERT (h < m_flowTable.size ());
   Ptr<Queue<QueueDiscItem> > flowQ;
-  Flow *flow;
-  if (m_flowsIndices.find (h) == m_flowsIndices.end ())
+  Flow *flow = m_flowTable[h];
+  if (flow == 0)
     {
-      NS_LOG_INFO ("Creating a new flow queue with index " << h);
-      flowQ = m_flowFactory.Create<DropTailQueue<QueueDiscItem>> ();
+      NS_LOG_INFO ("Assigning a flow queue to hash bucket " << h);
+      flow = GetFreeFlow (h);
+      if (flow == 0)
+        {
+          NS_LOG_LOGIC ("No flow available within the flow memory limit -- dropping pkt");
+          DropBeforeEnqueue (item, FLOW_MEMORY_DROP);
+          return false;
+        }
 
-      flow = new Flow();
-      // Set flow type from packet tag
-      Ptr<Packet> packet = item->GetPacket();
+      // Set flow type from packet tag, unless it is detected from the arrivals
       FlowTag packetTag;
-      packet->PeekPacketTag (packetTag);
-      flow->SetFlowType(packetTag.GetFlowType());
-      flow->idx = GetNInternalQueues () - 1;
-      flow->selfQ = flowQ;
-
-      NS_LOG_INFO ("max q size " << flowQ->GetMaxSize());
-
-      m_flowsIndices[h] = flow;
-      AddInternalQueue (flowQ);
+      if (!m_burstDetection && item->GetPacket ()->PeekPacketTag (packetTag))
+        {
+          flow->SetFlowType(packetTag.GetFlowType());
+        }
+      else
+        {
+          flow->SetFlowType (FlowType::HEAVY);
+        }
+      flow->lastArrival = Simulator::Now ();
+      flow->burstStart = Simulator::Now ();
+      flow->arrivalBurst = 0;
+      flow->burstScore = 0;
+      flow->bucket = h;
+      m_flowTable[h] = flow;
     }
-  else
+  flowQ = flow->selfQ;
+
+  if (m_burstDetection)
     {
-      flow = m_flowsIndices[h];
-      flowQ = m_flowsIndices[h]->selfQ;
+      DetectBurst (flow, item);
     }
 
   NS_LOG_INFO ("current q size " << flowQ->GetNPackets());
@@ -147,7 +337,14 @@ BFDRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
   QueueSize limit = m_soft_limit;
   if (flow->GetFlowType ()== FlowType::BURSTY)
     {
-      limit = m_hard_limit;
+      limit = GetBurstyLimit ();
+    }
+
+  if (m_adaptiveLimit && GetNPackets () == 0)
+    {
+      // the link was idle: the drain rate is only sampled while it is busy
+      m_drainSample = 0;
+      m_drainSampleStart = Simulator::Now ();
     }
 
   if ((flowQ->GetCurrentSize() + item) > limit)
@@ -157,24 +354,48 @@ BFDRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
       return false;
     }
 
-  // Indicates a bursty flow is overflowing its bursty limit
-  // fix cond what if there already
-  if (flowQ->GetCurrentSize() + item > m_soft_limit)
+  // the backlog above the soft limit is only admitted within the total
+  // allowance of the overflowing flows
+  uint32_t overflow = GetOverflow (flowQ->GetCurrentSize () + item);
+  if (overflow > flow->overflow)
     {
-      NS_LOG_LOGIC ("Overflowing bursty flow detected. Increasing the limit temporarily");
-      m_overflowingBurstyFlows.push_back(flow);
+      if (m_maxOverflow > 0 && m_overflow + overflow - flow->overflow > m_maxOverflow)
+        {
+          NS_LOG_LOGIC ("Overflow allowance exhausted -- dropping pkt");
+          DropBeforeEnqueue (item, OVERFLOW_LIMIT_DROP);
+          return false;
+        }
+      if (flow->overflow == 0)
+        {
+          NS_LOG_LOGIC ("Overflowing bursty flow detected");
+        }
+      m_overflow += overflow - flow->overflow;
+      flow->overflow = overflow;
     }
 
   flowQ->Enqueue (item);
 
-  NS_LOG_DEBUG ("Packet enqueued into flow " << h << "; flow index " << m_flowsIndices[h]->idx);
+  if (flow->GetFlowType () == FlowType::BURSTY)
+    {
+      // only the admitted packets count in the size of the burst, the packets
+      // dropped at the limit would make the limit grow because it was hit
+      flow->burstPeak = std::max (flow->burstPeak, flowQ->GetCurrentSize ().GetValue ());
+    }
+
+  NS_LOG_DEBUG ("Packet enqueued into flow " << h << "; flow index " << flow->idx);
 
   // are inactive queues in the internal queue?
   if (flow->GetStatus () == FlowStatus::INACTIVE)
     {
       NS_LOG_DEBUG ("Setting flow as ACTIVE");
+      if (flow->next)
+        {
+          // the flow is in the ring of idle flows
+          RingRemove (m_idleFlows, flow);
+        }
       flow->SetStatus (FlowStatus::ACTIVE);
-      m_flowList.push_back (flow);
+      flow->SetQuantum (m_quantum * DRRQueueDisc::GetWeight (m_weights, m_weightKey, item, h));
+      AddActiveFlow (flow);
     }
 
   return true;
@@ -185,65 +406,86 @@ BFDRRQueueDisc::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  Ptr<Queue<QueueDiscItem> > flowQ;
-  Ptr<QueueDiscItem> item;
+  ReclaimIdleFlows ();
+  return DequeueFromActiveFlows (1, std::numeric_limits<uint32_t>::max (), 0);
+}
 
-  if (m_flowList.empty ())
-    {
-      NS_LOG_DEBUG ("No active flows found");
-      return 0;
-    }
+void
+BFDRRQueueDisc::DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items)
+{
+  NS_LOG_FUNCTION (this << n << maxBytes);
+
+  ReclaimIdleFlows ();
+  DequeueFromActiveFlows (n, maxBytes, &items);
+}
+
+Ptr<QueueDiscItem>
+BFDRRQueueDisc::DequeueFromActiveFlows (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > *items)
+{
+  Ptr<QueueDiscItem> item;
+  uint32_t bytes = 0;
 
-  Flow *flow;
-  do
+  while (m_activeFlow)
     {
-      flow = m_flowList.front ();
-      flowQ = flow->selfQ;
-      m_flowList.pop_front ();
-      flow->IncreaseDeficit (m_quantum);
-      Ptr<const QueueDiscItem> t_item = flowQ->Peek ();
+      Flow *flow = m_activeFlow;
+      if (!m_activeFlowCredited)
+        {
+          flow->IncreaseDeficit (flow->GetQuantum ());
+          m_activeFlowCredited = true;
+        }
+      Ptr<const QueueDiscItem> t_item = flow->selfQ->Peek ();
 
       if ( (uint32_t) flow->GetDeficit () >= t_item->GetSize ())
         {
-          item = flowQ->Dequeue ();
+          item = flow->selfQ->Dequeue ();
           flow->IncreaseDeficit (-item->GetSize ());
           NS_LOG_DEBUG ("Dequeued packet " << item->GetPacket ());
 
-          if (flowQ->GetNPackets () == 0)
+          if (m_adaptiveLimit)
+            {
+              RecordDrain (item);
+            }
+
+          if (flow->selfQ->GetNPackets () == 0)
             {
               NS_LOG_DEBUG ("Empty Flow, Setting it to INACTIVE");
-              flow->SetDeficit (0);
-              flow->SetStatus (FlowStatus::INACTIVE);
+              if (m_adaptiveLimit && flow->GetFlowType () == FlowType::BURSTY)
+                {
+                  RecordBurst (flow);
+                }
+              flow->burstPeak = 0;
+              DeactivateFlow (flow);
             }
 
           else
             {
-              NS_LOG_DEBUG ("Flow still active, pushing back to active list");
-              m_flowList.push_back (flow);
+              NS_LOG_DEBUG ("Flow still active, keeping the round robin pointer on it");
             }
 
-          // If this was an overflowing bursty flow, and now it is under soft limit, remove it from the list
-          if (std::find(m_overflowingBurstyFlows.begin(), m_overflowingBurstyFlows.end(), flow) != m_overflowingBurstyFlows.end () &&
-              (flow->selfQ->GetCurrentSize()) <= m_soft_limit)
+          if (flow->overflow > 0)
             {
-              m_overflowingBurstyFlows.remove (flow);
-//              m_overflowingBurstyFlows.erase (std::remove (m_overflowingBurstyFlows.begin (),
-//                                                           m_overflowingBurstyFlows.end (), flow),
-//                                              m_overflowingBurstyFlows.end ());
+              UpdateOverflow (flow);
             }
 
-          return item;
+          if (items)
+            {
+              items->push_back (item);
+            }
+          bytes += item->GetSize ();
+          if (--n == 0 || bytes >= maxBytes)
+            {
+              return item;
+            }
+          continue;
         }                   //End if(flow->GetDeficit ...)
 
-      else
-        {
-          NS_LOG_DEBUG ("Packet size greater than deficit, pushing flow back to end of list");
-          m_flowList.push_back (flow);
-          item = 0;
-        }
-    } while (item == 0);
+      NS_LOG_DEBUG ("Packet size greater than deficit, moving the round robin pointer to the next flow");
+      m_activeFlow = flow->next;
+      m_activeFlowCredited = false;
+    }
 
-  return 0; //never reached
+  NS_LOG_DEBUG ("No active flows found");
+  return 0;
 }
 
 Ptr<const QueueDiscItem>
@@ -251,18 +493,231 @@ BFDRRQueueDisc::DoPeek (void)
 {
   NS_LOG_FUNCTION (this);
 
-  Flow *flow;
+  if (!m_activeFlow)
+    {
+      return 0;
+    }
+
+  return m_activeFlow->selfQ->Peek ();
+}
+
+void
+BFDRRQueueDisc::AddActiveFlow (Flow *flow)
+{
+  NS_LOG_FUNCTION (this << flow);
+  RingAppend (m_activeFlow, flow);
+}
+
+void
+BFDRRQueueDisc::RemoveActiveFlow (Flow *flow)
+{
+  NS_LOG_FUNCTION (this << flow);
+
+  if (m_activeFlow == flow)
+    {
+      m_activeFlowCredited = false;
+    }
+  RingRemove (m_activeFlow, flow);
+}
+
+void
+BFDRRQueueDisc::DeactivateFlow (Flow *flow)
+{
+  NS_LOG_FUNCTION (this << flow);
+
+  flow->SetDeficit (0);
+  flow->SetStatus (FlowStatus::INACTIVE);
+  RemoveActiveFlow (flow);
 
-  if (!m_flowList.empty ())
+  if (!m_flowIdleTimeout.IsZero () || m_maxFlowMemory)
     {
-      flow = m_flowList.front ();
+      // flows become idle in time order, so the oldest is at the head
+      flow->idleSince = Simulator::Now ();
+      RingAppend (m_idleFlows, flow);
+    }
+}
+
+void
+BFDRRQueueDisc::DetectBurst (Flow *flow, Ptr<const QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << flow << item);
+
+  Time now = Simulator::Now ();
+  if (flow->arrivalBurst > 0 && now - flow->lastArrival > m_burstGap)
+    {
+      // the burst of arrivals is over: fold it into the burst score, unless
+      // it was a stream
+      if (flow->lastArrival - flow->burstStart <= m_streamDuration)
+        {
+          double sample = flow->arrivalBurst >= m_burstThreshold ? 1 : 0;
+          flow->burstScore += m_burstScoreWeight * (sample - flow->burstScore);
+          SetFlowType (flow, flow->burstScore >= 0.5 ? FlowType::BURSTY : FlowType::LIGHT);
+        }
+      flow->arrivalBurst = 0;
+    }
+
+  if (flow->arrivalBurst == 0)
+    {
+      flow->burstStart = now;
+    }
+  flow->arrivalBurst += (m_soft_limit.GetUnit () == QueueSizeUnit::PACKETS ? 1 : item->GetSize ());
+  flow->lastArrival = now;
+
+  if (now - flow->burstStart > m_streamDuration)
+    {
+      // a flow sending without pauses is not bursty
+      flow->burstScore = 0;
+      SetFlowType (flow, FlowType::HEAVY);
+    }
+}
+
+void
+BFDRRQueueDisc::SetFlowType (Flow *flow, FlowType type)
+{
+  if (flow->GetFlowType () != type)
+    {
+      NS_LOG_DEBUG ("Flow " << flow->idx << " changes type from " << flow->GetFlowType () << " to " << type);
+      m_flowTypeChangedTrace (flow->idx, flow->bucket, flow->GetFlowType (), type);
+      flow->SetFlowType (type);
+    }
+}
+
+uint32_t
+BFDRRQueueDisc::GetOverflow (QueueSize size) const
+{
+  return size > m_soft_limit ? size.GetValue () - m_soft_limit.GetValue () : 0;
+}
+
+void
+BFDRRQueueDisc::UpdateOverflow (Flow *flow)
+{
+  uint32_t overflow = GetOverflow (flow->selfQ->GetCurrentSize ());
+  NS_ASSERT (overflow <= flow->overflow && flow->overflow <= m_overflow);
+  m_overflow -= flow->overflow - overflow;
+  flow->overflow = overflow;
+}
+
+void
+BFDRRQueueDisc::RecordBurst (Flow *flow)
+{
+  NS_LOG_FUNCTION (this << flow);
+
+  if (m_avgBurst == 0)
+    {
+      m_avgBurst = flow->burstPeak;
     }
   else
     {
-      return 0;
+      m_avgBurst += m_adaptiveWeight * (flow->burstPeak - m_avgBurst);
     }
+  UpdateBurstyLimit ();
+}
+
+void
+BFDRRQueueDisc::RecordDrain (Ptr<const QueueDiscItem> item)
+{
+  m_drainSample += (m_hard_limit.GetUnit () == QueueSizeUnit::PACKETS ? 1 : item->GetSize ());
 
-  return flow->selfQ->Peek ();
+  Time elapsed = Simulator::Now () - m_drainSampleStart;
+  if (elapsed < m_maxBurstDelay || elapsed.IsZero ())
+    {
+      return;
+    }
+
+  double rate = m_drainSample / elapsed.GetSeconds ();
+  if (m_avgDrainRate == 0)
+    {
+      m_avgDrainRate = rate;
+    }
+  else
+    {
+      m_avgDrainRate += m_adaptiveWeight * (rate - m_avgDrainRate);
+    }
+  m_drainSample = 0;
+  m_drainSampleStart = Simulator::Now ();
+  UpdateBurstyLimit ();
+}
+
+void
+BFDRRQueueDisc::UpdateBurstyLimit (void)
+{
+  double limit = m_avgBurst > 0 ? m_burstHeadroom * m_avgBurst : m_hard_limit.GetValue ();
+  if (m_avgDrainRate > 0)
+    {
+      limit = std::min (limit, m_avgDrainRate * m_maxBurstDelay.GetSeconds ());
+    }
+  limit = std::max (limit, static_cast<double> (m_soft_limit.GetValue ()));
+  limit = std::min (limit, static_cast<double> (m_hard_limit.GetValue ()));
+
+  uint32_t burstyLimit = std::ceil (limit);
+  if (burstyLimit != m_burstyLimit)
+    {
+      NS_LOG_DEBUG ("Limit of the bursty flows set to " << burstyLimit);
+      m_burstyLimit = burstyLimit;
+    }
+}
+
+Flow*
+BFDRRQueueDisc::GetFreeFlow (uint32_t bucket)
+{
+  NS_LOG_FUNCTION (this << bucket);
+
+  if (!m_freeFlows.empty ())
+    {
+      Flow *flow = m_freeFlows.back ();
+      m_freeFlows.pop_back ();
+      return flow;
+    }
+
+  if (m_idleFlows && !m_flowIdleTimeout.IsZero ()
+      && Simulator::Now () - m_idleFlows->idleSince >= m_flowIdleTimeout)
+    {
+      NS_LOG_DEBUG ("Recycling the flow of hash bucket " << m_idleFlows->bucket);
+      return ReclaimFlow (m_idleFlows);
+    }
+
+  if (m_maxFlowMemory && GetFlowMemory () + FlowFootprint () > m_maxFlowMemory)
+    {
+      if (!m_idleFlows)
+        {
+          return 0;
+        }
+      NS_LOG_DEBUG ("Flow memory limit reached, recycling the flow of hash bucket "
+                    << m_idleFlows->bucket);
+      return ReclaimFlow (m_idleFlows);
+    }
+
+  Flow *flow = new Flow ();
+  flow->selfQ = m_flowFactory.Create<DropTailQueue<QueueDiscItem> > ();
+  flow->idx = GetNInternalQueues ();
+  AddInternalQueue (flow->selfQ);
+  m_nFlows++;
+  NS_LOG_INFO ("max q size " << flow->selfQ->GetMaxSize ());
+  m_flowCreatedTrace (flow->idx, bucket);
+  return flow;
+}
+
+Flow*
+BFDRRQueueDisc::ReclaimFlow (Flow *flow)
+{
+  NS_LOG_FUNCTION (this << flow);
+
+  NS_ASSERT (flow->GetStatus () == FlowStatus::INACTIVE);
+  RingRemove (m_idleFlows, flow);
+  m_flowTable[flow->bucket] = 0;
+  m_flowReclaimedTrace (flow->idx, flow->bucket);
+  return flow;
+}
+
+void
+BFDRRQueueDisc::ReclaimIdleFlows (void)
+{
+  if (m_idleFlows && !m_flowIdleTimeout.IsZero ()
+      && Simulator::Now () - m_idleFlows->idleSince >= m_flowIdleTimeout)
+    {
+      NS_LOG_DEBUG ("Releasing the flow of hash bucket " << m_idleFlows->bucket);
+      m_freeFlows.push_back (ReclaimFlow (m_idleFlows));
+    }
 }
 
 bool
@@ -275,17 +730,16 @@ BFDRRQueueDisc::CheckConfig (void)
       return false;
     }
 
-  if (GetNPacketFilters () == 0)
+  if (GetNInternalQueues () > 0)
     {
-      Ptr<BFDRRIpv4PacketFilter> ipv4Filter = CreateObject<BFDRRIpv4PacketFilter> ();
-      AddPacketFilter (ipv4Filter);
-      //      NS_LOG_ERROR ("BFDRRQueueDisc needs at least a packet filter");
-      //      return false;
+      NS_LOG_ERROR ("BFDRRQueueDisc cannot have internal queues");
+      return false;
     }
 
-  if (GetNInternalQueues () > 0)
+  if ((m_adaptiveLimit || m_maxOverflow > 0) && m_soft_limit.GetUnit () != m_hard_limit.GetUnit ())
     {
-      NS_LOG_ERROR ("BFDRRQueueDisc cannot have internal queues");
+      NS_LOG_ERROR ("The soft and hard limits must have the same unit for the adaptive limit "
+                    "and the overflow limit");
       return false;
     }
 
@@ -308,6 +762,12 @@ BFDRRQueueDisc::InitializeParams (void)
       NS_LOG_DEBUG ("Setting the quantum to: " << m_quantum);
     }
 
+  // one slot per hash bucket, plus one for the packets no filter could classify
+  m_flowTable.assign (m_flows + 1, 0);
+
+  m_burstyLimit = m_hard_limit.GetValue ();
+  m_flowFactory.Set ("MaxSize", QueueSizeValue (m_hard_limit));
+
 //  m_flowFactory.SetTypeId ("ns3::BFDRRFlow");
 
 //  m_queueDiscFactory.SetTypeId ("ns3::CoDelQueueDisc");
@@ -27,10 +27,13 @@
 #include "ns3/object-factory.h"
 #include "ns3/drop-tail-queue.h"
 //#include "ns3/bfdrr-flow-queue.h"
-#include <list>
-#include <map>
+#include <vector>
 #include "ns3/queue.h"
 #include "ns3/bfdrrflow.h"
+#include "ns3/drr-queue-disc.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 
 namespace ns3 {
 
@@ -74,35 +77,216 @@ public:
  */
   uint32_t GetQuantum (void) const;
 
+  /**
+   * \brief Get the estimated memory used by the flows, excluding the packets
+   * \return the number of flows times the estimated footprint of a flow, in bytes
+   */
+  uint64_t GetFlowMemory (void) const;
+
+  /**
+   * \brief Get the limit of the bursty flows. If the AdaptiveLimit attribute
+   *        is set, the limit follows the bursts of the bursty flows and the
+   *        drain rate of the link; otherwise it is the HardLimit attribute.
+   * \return the limit of the bursty flows
+   */
+  QueueSize GetBurstyLimit (void) const;
+
+  /**
+   * \brief Get the total backlog of the flows above the soft limit
+   * \return the sum of the backlogs of the overflowing flows above the soft limit
+   */
+  QueueSize GetOverflowBacklog (void) const;
+
+  /**
+   * TracedCallback signature for flow type transitions.
+   *
+   * \param [in] index The index of the flow.
+   * \param [in] bucket The hash bucket of the flow.
+   * \param [in] oldType The previous type of the flow.
+   * \param [in] newType The new type of the flow.
+   */
+  typedef void (* FlowTypeTracedCallback)(uint32_t index, uint32_t bucket, FlowType oldType, FlowType newType);
+
   // Reasons for dropping packets
   static constexpr const char* UNCLASSIFIED_DROP = "Unclassified drop";  //!< No packet filter able to classify packet
   static constexpr const char* OVERLIMIT_DROP = "Overlimit drop";        //!< Overlimit dropped packets
+  static constexpr const char* FLOW_MEMORY_DROP = "Flow memory limit drop";  //!< No flow available within the flow memory limit
+  static constexpr const char* OVERFLOW_LIMIT_DROP = "Overflow limit drop";  //!< Total backlog above the soft limit exceeded
+
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
 
 
 private:
   virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
   virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual void DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items);
   virtual Ptr<const QueueDiscItem> DoPeek (void);
   virtual bool CheckConfig (void);
   virtual void InitializeParams (void);
 
+  /**
+   * \brief Serve the active flows in deficit round robin order until the given
+   *        number of packets or bytes is dequeued or no flow is active, in a
+   *        single walk of the ring of the active flows
+   * \param n the maximum number of packets to dequeue
+   * \param maxBytes the number of bytes after which no more packets are dequeued
+   * \param items the vector the dequeued packets are appended to, if not null
+   * \return the last dequeued packet, if the number of packets or bytes was
+   *         reached, or 0
+   */
+  Ptr<QueueDiscItem> DequeueFromActiveFlows (uint32_t n, uint32_t maxBytes,
+                                             std::vector<Ptr<QueueDiscItem> > *items);
+
   /**
    * \brief Drop a packet from the tail of the queue with the largest current byte count (Packet Stealing)
    * \return the index of the queue with the largest current byte count
    */
   uint32_t BFDRRDrop (void);
 
+  /**
+   * \brief Append a flow to the tail of the ring of active flows, i.e., just
+   *        before the flow the round robin pointer is at
+   * \param flow the flow to append
+   */
+  void AddActiveFlow (Flow *flow);
+
+  /**
+   * \brief Unlink a flow from the ring of active flows. If the round robin
+   *        pointer is at this flow, it moves to the next flow.
+   * \param flow the flow to unlink
+   */
+  void RemoveActiveFlow (Flow *flow);
+
+  /**
+   * \brief Set a flow that has no more packets as INACTIVE. If flows are
+   *        recycled or their memory is bounded, the flow is appended to the
+   *        ring of idle flows.
+   * \param flow the flow
+   */
+  void DeactivateFlow (Flow *flow);
+
+  /**
+   * \brief Account the arrival of a packet in the statistics of its flow and
+   *        set the type of the flow accordingly: a flow whose bursts of
+   *        arrivals mostly reach the burst threshold is BURSTY, a flow whose
+   *        burst of arrivals lasts longer than the stream duration is HEAVY
+   *        and any other flow is LIGHT
+   * \param flow the flow
+   * \param item the arriving packet
+   */
+  void DetectBurst (Flow *flow, Ptr<const QueueDiscItem> item);
+
+  /**
+   * \brief Set the type of a flow, tracing the transition
+   * \param flow the flow
+   * \param type the new type of the flow
+   */
+  void SetFlowType (Flow *flow, FlowType type);
+
+  /**
+   * \brief Compute the backlog of a flow above the soft limit
+   * \param size the backlog of the flow
+   * \return the part of the backlog exceeding the soft limit
+   */
+  uint32_t GetOverflow (QueueSize size) const;
+
+  /**
+   * \brief Update the backlog of a flow above the soft limit, and the total
+   *        backlog above the soft limit, after a packet of the flow is dequeued
+   * \param flow the flow
+   */
+  void UpdateOverflow (Flow *flow);
+
+  /**
+   * \brief Fold the burst of a bursty flow that has no more packets into the
+   *        average burst size and update the limit of the bursty flows
+   * \param flow the flow
+   */
+  void RecordBurst (Flow *flow);
+
+  /**
+   * \brief Account a dequeued packet in the sample of the drain rate and, at
+   *        the end of the sample, update the average drain rate and the limit
+   *        of the bursty flows
+   * \param item the dequeued packet
+   */
+  void RecordDrain (Ptr<const QueueDiscItem> item);
+
+  /**
+   * \brief Set the limit of the bursty flows to the average burst size times
+   *        the headroom, bounded by the backlog the link drains within the
+   *        maximum burst delay and by the soft limit
+   */
+  void UpdateBurstyLimit (void);
+
+  /**
+   * \brief Get a flow for a hash bucket that has none. The flow is taken from
+   *        the free list, or recycled from the flows idle for longer than the
+   *        idle timeout, or created. If creating a flow would exceed the flow
+   *        memory limit, the flow idle for the longest time is recycled.
+   * \param bucket the hash bucket that needs a flow
+   * \return the flow, or 0 if no flow is available within the flow memory limit
+   */
+  Flow* GetFreeFlow (uint32_t bucket);
+
+  /**
+   * \brief Detach an idle flow from its hash bucket and unlink it from the
+   *        ring of idle flows
+   * \param flow the flow
+   * \return the flow, ready to be assigned to another hash bucket
+   */
+  Flow* ReclaimFlow (Flow *flow);
+
+  /**
+   * \brief Move the flow idle for the longest time to the free list, if it
+   *        has been idle for longer than the idle timeout
+   */
+  void ReclaimIdleFlows (void);
+
   uint32_t m_packets;      //!< cumulative sum of packets across all flows
   QueueSize m_soft_limit;              //!< Maximum number of bytes in the queue disc
   QueueSize m_hard_limit;              //!< Maximum number of bytes in the queue disc
   uint32_t m_quantum;        //!< total number of bytes that a flow can send
   uint32_t m_flows;          //!< Number of flow queues
+  DRRQueueDisc::WeightKey m_weightKey; //!< Key of the weight of a flow
+  DRRWeightMap m_weights;    //!< Weights of the flows, in quanta
+  Time m_flowIdleTimeout;    //!< Time after which an idle flow can be recycled (0 disables recycling)
+  uint64_t m_maxFlowMemory;  //!< Maximum estimated memory of the flows, in bytes (0 means unbounded)
+  bool m_adaptiveLimit;      //!< Whether the limit of the bursty flows is adaptive
+  double m_adaptiveWeight;   //!< Weight of the samples in the averages of the adaptive limit
+  double m_burstHeadroom;    //!< Ratio of the limit of the bursty flows to the average burst size
+  Time m_maxBurstDelay;      //!< Time within which the link must drain the backlog of a bursty flow
+  double m_avgBurst;         //!< Average burst size of the bursty flows (0 until the first burst)
+  double m_avgDrainRate;     //!< Average drain rate of the link, per second (0 until the first sample)
+  uint64_t m_drainSample;    //!< Packets or bytes dequeued since the start of the drain rate sample
+  Time m_drainSampleStart;   //!< Start time of the drain rate sample
+  TracedValue<uint32_t> m_burstyLimit; //!< Limit of the bursty flows, in the unit of the limits
+
+  uint32_t m_maxOverflow;    //!< Maximum total backlog of the flows above the soft limit (0 means unbounded)
+  uint64_t m_overflow;       //!< Total backlog of the flows above the soft limit, in the unit of the limits
+
+  bool m_burstDetection;     //!< Whether the type of the flows is detected from their arrivals
+  Time m_burstGap;           //!< Maximum inter-arrival time within a burst of arrivals
+  uint32_t m_burstThreshold; //!< Size of a burst of arrivals making a flow bursty, in the unit of the limits
+  Time m_streamDuration;     //!< Duration of a burst of arrivals making a flow heavy
+  double m_burstScoreWeight; //!< Weight of a burst of arrivals in the burst score of a flow
 
-  std::list<Flow*> m_overflowingBurstyFlows;
+  Flow *m_activeFlow;    //!< The flow the round robin pointer is at, in the ring of active flows
+  Flow *m_idleFlows;     //!< The flow idle for the longest time, in the ring of idle flows
+  bool m_activeFlowCredited; //!< Whether the flow the round robin pointer is at got its quantum for this visit
 
-  std::list<Flow*> m_flowList;    //!< The list of flows
+  std::vector<Flow*> m_flowTable;    //!< Flow of each hash bucket (null until the first packet)
+  std::vector<Flow*> m_freeFlows;    //!< Flows not assigned to any hash bucket
+  uint32_t m_nFlows;                 //!< Number of flows created, which this queue disc owns
 
-  std::map<uint32_t, Flow*> m_flowsIndices;    //!< Map with the index of class for each flow
+  TracedCallback<uint32_t, uint32_t> m_flowCreatedTrace;   //!< Traced callback for flow creation
+  TracedCallback<uint32_t, uint32_t> m_flowReclaimedTrace; //!< Traced callback for flow reclamation
+  /// Traced callback for flow type transitions
+  TracedCallback<uint32_t, uint32_t, FlowType, FlowType> m_flowTypeChangedTrace;
 
   ObjectFactory m_flowFactory;         //!< Factory to create a new flow
   ObjectFactory m_queueDiscFactory; //!< Factory to create a new queue
@@ -8,6 +8,7 @@
 #include <list>
 #include "ns3/flow-tag.h"
 #include "ns3/enum.h"
+#include "ns3/nstime.h"
 
 namespace ns3 {
 
@@ -54,14 +55,63 @@ public:
    */
   FlowStatus GetStatus (void) const;
 
+  /**
+   * \brief Set the quantum of this flow, i.e., the bytes credited on each visit
+   * \param quantum the quantum of this flow
+   */
+  void SetQuantum (uint32_t quantum);
+
+
+  /**
+   * \brief Get the quantum of this flow
+   * \return the quantum of this flow
+   */
+  uint32_t GetQuantum (void) const;
+
   FlowType GetFlowType(void) const;
 
   void SetFlowType(FlowType flowType);
+
+  /**
+   * \brief Set the next flow in the ring of active (or idle) flows
+   * \param next the next flow
+   */
+  void SetNext (Flow *next);
+
+  /**
+   * \brief Get the next flow in the ring of active (or idle) flows
+   * \return the next flow
+   */
+  Flow* GetNext (void) const;
+
+  /**
+   * \brief Set the previous flow in the ring of active (or idle) flows
+   * \param prev the previous flow
+   */
+  void SetPrev (Flow *prev);
+
+  /**
+   * \brief Get the previous flow in the ring of active (or idle) flows
+   * \return the previous flow
+   */
+  Flow* GetPrev (void) const;
+
   uint32_t idx;
   Ptr<Queue<QueueDiscItem> > selfQ;
+  Flow *next;   //!< the next flow in the ring of active (or idle) flows
+  Flow *prev;   //!< the previous flow in the ring of active (or idle) flows
+  uint32_t bucket;  //!< the hash bucket this flow is assigned to
+  Time idleSince;   //!< the time this flow became inactive
+  uint32_t burstPeak; //!< the largest backlog reached by this flow since it became active
+  uint32_t overflow;  //!< the backlog of this flow above the soft limit (non-zero if the flow is overflowing)
+  Time lastArrival;   //!< the arrival time of the last packet of this flow
+  Time burstStart;    //!< the arrival time of the first packet of the current burst of arrivals
+  uint32_t arrivalBurst; //!< the packets (or bytes) arrived in the current burst of arrivals
+  double burstScore;  //!< the average fraction of the bursts of arrivals reaching the burst threshold
 private:
   uint32_t m_deficit;   //!< the deficit for this flow
   FlowStatus m_status; //!< the status of this flow
+  uint32_t m_quantum;   //!< the quantum of this flow
   FlowType m_flowType;
 };
 
@@ -97,6 +147,18 @@ Flow::GetStatus (void) const
   return m_status;
 }
 
+void
+Flow::SetQuantum (uint32_t quantum)
+{
+  m_quantum = quantum;
+}
+
+uint32_t
+Flow::GetQuantum (void) const
+{
+  return m_quantum;
+}
+
 FlowType
 Flow::GetFlowType (void) const
 {
@@ -109,6 +171,30 @@ Flow::SetFlowType (FlowType flowType)
   m_flowType = flowType;
 }
 
+void
+Flow::SetNext (Flow *next)
+{
+  this->next = next;
+}
+
+Flow*
+Flow::GetNext (void) const
+{
+  return next;
+}
+
+void
+Flow::SetPrev (Flow *prev)
+{
+  this->prev = prev;
+}
+
+Flow*
+Flow::GetPrev (void) const
+{
+  return prev;
+}
+
 } // namespace ns3
 
 #endif //NS_3_BFDRRFLOW_H
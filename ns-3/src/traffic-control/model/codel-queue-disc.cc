@@ -427,6 +427,13 @@ void
 CoDelQueueDisc::InitializeParams (void)
 {
   NS_LOG_FUNCTION (this);
+  // the queue disc may be reset to be reused for other traffic
+  m_count = 0;
+  m_lastCount = 0;
+  m_dropping = false;
+  m_recInvSqrt = ~0U >> REC_INV_SQRT_SHIFT;
+  m_firstAboveTime = 0;
+  m_dropNext = 0;
 }
 
 } // namespace ns3
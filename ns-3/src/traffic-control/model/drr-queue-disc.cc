@@ -26,12 +26,120 @@
 #include "drr-queue-disc.h"
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/ipv4-packet-filter.h"
+#include "ns3/ipv6-packet-filter.h"
+#include "ns3/pointer.h"
 #include "codel-queue-disc.h"
+#include "fifo-queue-disc.h"
+#include "pie-queue-disc.h"
+#include "red-queue-disc.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/flow-tag.h"
+#include "ns3/flow-ring.h"
+#include <algorithm>
+#include <limits>
+#include <sstream>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("DRRQueueDisc");
 
+// The logging of the functions run for every packet is compiled out if the
+// module is configured with --enable-tc-lightweight
+#ifdef NS3_TC_LIGHTWEIGHT
+#define DRR_PACKET_LOG_FUNCTION(parameters)
+#define DRR_PACKET_LOG_LOGIC(msg)
+#define DRR_PACKET_LOG_DEBUG(msg)
+#define DRR_PACKET_LOG_INFO(msg)
+#else
+#define DRR_PACKET_LOG_FUNCTION(parameters) NS_LOG_FUNCTION (parameters)
+#define DRR_PACKET_LOG_LOGIC(msg) NS_LOG_LOGIC (msg)
+#define DRR_PACKET_LOG_DEBUG(msg) NS_LOG_DEBUG (msg)
+#define DRR_PACKET_LOG_INFO(msg) NS_LOG_INFO (msg)
+#endif
+
+/**
+ * Performs a reciprocal divide, similar to the
+ * Linux kernel reciprocal_divide function
+ * \param A numerator
+ * \param R reciprocal of the denominator B
+ * \return the value of A/B
+ */
+static inline uint32_t ReciprocalDivide (uint32_t A, uint32_t R)
+{
+  return (uint32_t)(((uint64_t)A * R) >> 32);
+}
+
+/**
+ * Translates a time in CoDel time representation
+ * \param t the time
+ * \return the time in CoDel time units
+ */
+static uint32_t Time2CoDel (Time t)
+{
+  return static_cast<uint32_t>(t.GetNanoSeconds () >> CODEL_SHIFT);
+}
+
+/**
+ * \param a the first CoDel time
+ * \param b the second CoDel time
+ * \return true if a is after b
+ */
+static bool CoDelTimeAfter (uint32_t a, uint32_t b)
+{
+  return  ((int)(a) - (int)(b) > 0);
+}
+
+/**
+ * \param a the first CoDel time
+ * \param b the second CoDel time
+ * \return true if a is after or equal to b
+ */
+static bool CoDelTimeAfterEq (uint32_t a, uint32_t b)
+{
+  return ((int)(a) - (int)(b) >= 0);
+}
+
+/**
+ * \param a the first CoDel time
+ * \param b the second CoDel time
+ * \return true if a is before b
+ */
+static bool CoDelTimeBefore (uint32_t a, uint32_t b)
+{
+  return  ((int)(a) - (int)(b) < 0);
+}
+
+/**
+ * Updates the reciprocal inverse square root of the CoDel count
+ * (see CoDelQueueDisc::NewtonStep)
+ * \param codel the CoDel state
+ */
+static void NewtonStep (DRRFlow::CoDelState &codel)
+{
+  uint32_t invsqrt = ((uint32_t) codel.recInvSqrt) << REC_INV_SQRT_SHIFT;
+  uint32_t invsqrt2 = ((uint64_t) invsqrt * invsqrt) >> 32;
+  uint64_t val = (3ll << 32) - ((uint64_t) codel.count * invsqrt2);
+
+  val >>= 2; /* avoid overflow */
+  val = (val * invsqrt) >> (32 - 2 + 1);
+  codel.recInvSqrt = static_cast<uint16_t>(val >> REC_INV_SQRT_SHIFT);
+}
+
+/**
+ * Determines the time of the next drop (see CoDelQueueDisc::ControlLaw)
+ * \param codel the CoDel state
+ * \param t the current next drop time
+ * \param interval the CoDel interval, in CoDel time units
+ * \return the next drop time
+ */
+static uint32_t ControlLaw (const DRRFlow::CoDelState &codel, uint32_t t, uint32_t interval)
+{
+  return t + ReciprocalDivide (interval, codel.recInvSqrt << REC_INV_SQRT_SHIFT);
+}
+
 NS_OBJECT_ENSURE_REGISTERED (DRRFlow);
 
 TypeId DRRFlow::GetTypeId (void)
@@ -46,9 +154,20 @@ TypeId DRRFlow::GetTypeId (void)
 
 DRRFlow::DRRFlow ()
   : m_deficit (0),
-    m_status (INACTIVE)
+    m_status (INACTIVE),
+    m_quantum (0),
+    m_index (0),
+    m_backlog (0),
+    m_backlogPosition (0),
+    m_next (0),
+    m_prev (0),
+    m_bucket (0),
+    m_head (0),
+    m_nPackets (0),
+    m_nBytes (0)
 {
   NS_LOG_FUNCTION (this);
+  ResetCoDelState ();
 }
 
 DRRFlow::~DRRFlow ()
@@ -59,303 +178,1574 @@ DRRFlow::~DRRFlow ()
 void
 DRRFlow::SetDeficit (uint32_t deficit)
 {
-  NS_LOG_FUNCTION (this << deficit);
+  DRR_PACKET_LOG_FUNCTION (this << deficit);
   m_deficit = deficit;
 }
 
 int32_t
 DRRFlow::GetDeficit (void) const
 {
-  NS_LOG_FUNCTION (this);
+  DRR_PACKET_LOG_FUNCTION (this);
   return m_deficit;
 }
 
 void
 DRRFlow::IncreaseDeficit (int32_t deficit)
 {
-  NS_LOG_FUNCTION (this << deficit);
+  DRR_PACKET_LOG_FUNCTION (this << deficit);
   m_deficit += deficit;
 }
 
 void
 DRRFlow::SetStatus (FlowStatus status)
 {
-  NS_LOG_FUNCTION (this);
+  DRR_PACKET_LOG_FUNCTION (this);
   m_status = status;
 }
 
 DRRFlow::FlowStatus
 DRRFlow::GetStatus (void) const
 {
-  NS_LOG_FUNCTION (this);
+  DRR_PACKET_LOG_FUNCTION (this);
   return m_status;
 }
 
+void
+DRRFlow::SetQuantum (uint32_t quantum)
+{
+  NS_LOG_FUNCTION (this << quantum);
+  m_quantum = quantum;
+}
 
-NS_OBJECT_ENSURE_REGISTERED (DRRQueueDisc);
+uint32_t
+DRRFlow::GetQuantum (void) const
+{
+  return m_quantum;
+}
 
-TypeId DRRQueueDisc::GetTypeId (void)
+void
+DRRFlow::SetIndex (uint32_t index)
 {
-  static TypeId tid = TypeId ("ns3::DRRQueueDisc")
-    .SetParent<QueueDisc> ()
-    .SetGroupName ("TrafficControl")
-    .AddConstructor<DRRQueueDisc> ()
-    .AddAttribute ("ByteLimit",
-                   "The hard limit on the real queue size, measured in bytes",
-                   UintegerValue (100 * 1024),
-                   MakeUintegerAccessor (&DRRQueueDisc::m_limit),
-                   MakeUintegerChecker<uint32_t> ())
-    .AddAttribute ("Flows",
-                   "The number of queues into which the incoming packets are classified",
-                   UintegerValue (1024),
-                   MakeUintegerAccessor (&DRRQueueDisc::m_flows),
-                   MakeUintegerChecker<uint32_t> ())
-  ;
-  return tid;
+  NS_LOG_FUNCTION (this << index);
+  m_index = index;
 }
 
-DRRQueueDisc::DRRQueueDisc ()
-  : m_quantum (0)
+uint32_t
+DRRFlow::GetIndex (void) const
 {
-  NS_LOG_FUNCTION (this);
+  return m_index;
 }
 
-DRRQueueDisc::~DRRQueueDisc ()
+void
+DRRFlow::SetBacklog (uint32_t backlog)
 {
-  NS_LOG_FUNCTION (this);
+  m_backlog = backlog;
+}
+
+uint32_t
+DRRFlow::GetBacklog (void) const
+{
+  return m_backlog;
 }
 
 void
-DRRQueueDisc::SetQuantum (uint32_t quantum)
+DRRFlow::SetBacklogPosition (uint32_t position)
 {
-  NS_LOG_FUNCTION (this << quantum);
-  m_quantum = quantum;
+  m_backlogPosition = position;
 }
 
 uint32_t
-DRRQueueDisc::GetQuantum (void) const
+DRRFlow::GetBacklogPosition (void) const
 {
-  return m_quantum;
+  return m_backlogPosition;
 }
 
-bool
-DRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+void
+DRRFlow::SetNext (DRRFlow *next)
 {
-  NS_LOG_FUNCTION (this << item);
+  m_next = next;
+}
 
-  int32_t ret = Classify (item);
-  uint32_t h;
+DRRFlow*
+DRRFlow::GetNext (void) const
+{
+  return m_next;
+}
 
-  if (ret == PacketFilter::PF_NO_MATCH)
-    {
-      NS_LOG_WARN ("No filter has been able to classify this packet.");
-      h = m_flows; // place all unfiltered packets into a separate flow queue
-    }
+void
+DRRFlow::SetPrev (DRRFlow *prev)
+{
+  m_prev = prev;
+}
 
-  else
-    {
-      h = ret % m_flows;
-    }
+DRRFlow*
+DRRFlow::GetPrev (void) const
+{
+  return m_prev;
+}
 
-  Ptr<DRRFlow> flow;
-  if (m_flowsIndices.find (h) == m_flowsIndices.end ())
-    {
-      NS_LOG_DEBUG ("Creating a new flow queue with index " << h);
-      flow = m_flowFactory.Create<DRRFlow> ();
-      Ptr<QueueDisc> qd = m_queueDiscFactory.Create<QueueDisc> ();
-      qd->Initialize ();
-      flow->SetQueueDisc (qd);
-      AddQueueDiscClass (flow);
+void
+DRRFlow::InlineEnqueue (Ptr<QueueDiscItem> item)
+{
+  DRR_PACKET_LOG_FUNCTION (this << item);
 
-      m_flowsIndices[h] = GetNQueueDiscClasses () - 1;
-    }
-  else
+  if (m_nPackets == m_items.size ())
     {
-      flow = StaticCast<DRRFlow> (GetQueueDiscClass (m_flowsIndices[h]));
+      InlineGrow ();
     }
 
+  m_items[(m_head + m_nPackets) % m_items.size ()] = item;
+  m_nPackets++;
+  m_nBytes += item->GetSize ();
+}
+
+Ptr<QueueDiscItem>
+DRRFlow::InlineDequeue (void)
+{
+  DRR_PACKET_LOG_FUNCTION (this);
 
-  flow->GetQueueDisc ()->Enqueue (item);
+  if (m_nPackets == 0)
+    {
+      return 0;
+    }
 
-  NS_LOG_DEBUG ("Packet enqueued into flow " << h << "; flow index " << m_flowsIndices[h]);
+  Ptr<QueueDiscItem> item = m_items[m_head];
+  m_items[m_head] = 0;
+  m_head = (m_head + 1) % m_items.size ();
+  m_nPackets--;
+  m_nBytes -= item->GetSize ();
 
-  if (flow->GetStatus () == DRRFlow::INACTIVE)
+  // give back the memory of large buffers when the flow empties
+  if (m_nPackets == 0 && m_items.size () > 16)
     {
-      NS_LOG_DEBUG ("Setting flow as ACTIVE");
-      flow->SetStatus (DRRFlow::ACTIVE);
-      m_flowList.push_back (flow);
+      std::vector<Ptr<QueueDiscItem> > ().swap (m_items);
+      m_head = 0;
     }
+  return item;
+}
 
-  while (GetNBytes () > m_limit)
+void
+DRRFlow::InlineRequeue (Ptr<QueueDiscItem> item)
+{
+  DRR_PACKET_LOG_FUNCTION (this << item);
+
+  if (m_nPackets == m_items.size ())
     {
-      DRRDrop ();
+      InlineGrow ();
     }
 
-  return true;
+  m_head = (m_head + m_items.size () - 1) % m_items.size ();
+  m_items[m_head] = item;
+  m_nPackets++;
+  m_nBytes += item->GetSize ();
 }
 
 Ptr<QueueDiscItem>
-DRRQueueDisc::DoDequeue (void)
+DRRFlow::InlinePeek (void) const
 {
-  NS_LOG_FUNCTION (this);
-
-  Ptr<DRRFlow> flow;
-  Ptr<QueueDiscItem> item;
-
-  if (m_flowList.empty ())
+  if (m_nPackets == 0)
     {
-      NS_LOG_DEBUG ("No active flows found");
       return 0;
     }
+  return m_items[m_head];
+}
 
-  do
-    {
-      if (!m_flowList.empty ())   // unnecessary ?
-        {
-          flow = m_flowList.front ();
-          m_flowList.pop_front ();
-          flow->IncreaseDeficit (m_quantum);
-          Ptr<const QueueDiscItem> t_item = flow->GetQueueDisc ()->Peek ();
-
-          if ( (uint32_t) flow->GetDeficit () >= t_item->GetSize ())
-            {
-              item = flow->GetQueueDisc ()->Dequeue ();
-              flow->IncreaseDeficit (-item->GetSize ());
-              NS_LOG_DEBUG ("Dequeued packet " << item->GetPacket ());
+uint32_t
+DRRFlow::GetInlineNPackets (void) const
+{
+  return m_nPackets;
+}
 
-              if (flow->GetQueueDisc ()->GetNPackets () == 0)
-                {
-                  NS_LOG_DEBUG ("Empty Flow, Setting it to INACTIVE");
-                  flow->SetDeficit (0);
-                  flow->SetStatus (DRRFlow::INACTIVE);
-                }
+uint32_t
+DRRFlow::GetInlineNBytes (void) const
+{
+  return m_nBytes;
+}
 
-              else
-                {
-                  NS_LOG_DEBUG ("Flow still active, pushing back to active list");
-                  m_flowList.push_back (flow);
-                }
+DRRFlow::CoDelState&
+DRRFlow::GetCoDelState (void)
+{
+  return m_codel;
+}
 
-              return item;
-            }                   //End if(flow->GetDeficit ...)
+void
+DRRFlow::ResetCoDelState (void)
+{
+  m_codel.count = 0;
+  m_codel.lastCount = 0;
+  m_codel.dropping = false;
+  m_codel.recInvSqrt = ~0U >> REC_INV_SQRT_SHIFT;
+  m_codel.firstAboveTime = 0;
+  m_codel.dropNext = 0;
+  m_codel.headChecked = false;
+}
 
-          else
-            {
-              NS_LOG_DEBUG ("Packet size greater than deficit, pushing flow back to end of list");
-              m_flowList.push_back (flow);
-              item = 0;
-            }
-        }
-      else
-        {
-          NS_LOG_DEBUG ("No active flows found");
-          return 0;
-        }
-    }
-  while (item == 0);
+void
+DRRFlow::SetBucket (uint32_t bucket)
+{
+  m_bucket = bucket;
+}
 
-  return 0; //never reached
+uint32_t
+DRRFlow::GetBucket (void) const
+{
+  return m_bucket;
 }
 
-Ptr<const QueueDiscItem>
-DRRQueueDisc::DoPeek (void) const
+void
+DRRFlow::SetIdleSince (Time time)
 {
-  NS_LOG_FUNCTION (this);
+  m_idleSince = time;
+}
 
-  Ptr<DRRFlow> flow;
+Time
+DRRFlow::GetIdleSince (void) const
+{
+  return m_idleSince;
+}
 
-  if (!m_flowList.empty ())
-    {
-      flow = m_flowList.front ();
-    }
-  else
+void
+DRRFlow::InlineGrow (void)
+{
+  // double the circular buffer, moving the packets to its beginning
+  std::vector<Ptr<QueueDiscItem> > items (std::max<std::size_t> (4, 2 * m_items.size ()));
+  for (uint32_t i = 0; i < m_nPackets; i++)
     {
-      return 0;
+      items[i] = m_items[(m_head + i) % m_items.size ()];
     }
+  m_items.swap (items);
+  m_head = 0;
+}
+
 
-  return flow->GetQueueDisc ()->Peek ();
+NS_OBJECT_ENSURE_REGISTERED (DRRNonIpPacketFilter);
+
+TypeId DRRNonIpPacketFilter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DRRNonIpPacketFilter")
+    .SetParent<PacketFilter> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<DRRNonIpPacketFilter> ()
+    .AddAttribute ("FlowHasher",
+                   "The hash engine of the filter",
+                   TypeId::ATTR_GET,
+                   PointerValue (),
+                   MakePointerAccessor (&DRRNonIpPacketFilter::GetFlowHasher),
+                   MakePointerChecker<FlowHasher> ())
+  ;
+  return tid;
 }
 
-bool
-DRRQueueDisc::CheckConfig (void)
+DRRNonIpPacketFilter::DRRNonIpPacketFilter ()
 {
   NS_LOG_FUNCTION (this);
-  if (GetNQueueDiscClasses () > 0)
-    {
-      NS_LOG_ERROR ("DRRQueueDisc cannot have classes");
-      return false;
-    }
-
-  if (GetNPacketFilters () == 0)
-    {
-       Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
-      AddPacketFilter (ipv4Filter);
-//      NS_LOG_ERROR ("DRRQueueDisc needs at least a packet filter");
-//      return false;
-    }
+  m_hasher = CreateObject<FlowHasher> ();
+}
 
-  if (GetNInternalQueues () > 0)
-    {
-      NS_LOG_ERROR ("DRRQueueDisc cannot have internal queues");
-      return false;
-    }
+DRRNonIpPacketFilter::~DRRNonIpPacketFilter ()
+{
+  NS_LOG_FUNCTION (this);
+}
 
-  return true;
+Ptr<FlowHasher>
+DRRNonIpPacketFilter::GetFlowHasher (void) const
+{
+  return m_hasher;
 }
 
 void
-DRRQueueDisc::InitializeParams (void)
+DRRNonIpPacketFilter::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  m_hasher = 0;
+  PacketFilter::DoDispose ();
+}
 
-  // we are at initialization time. If the user has not set a quantum value,
-  // set the quantum to the MTU of the device
-  if (!m_quantum)
-    {
-      //Ptr<NetDevice> device = GetNetDevice ();
-      //NS_ASSERT_MSG (device, "Device not set for the queue disc");
-      //m_quantum = device->GetMtu ();
-      m_quantum = 600;
-      NS_LOG_DEBUG ("Setting the quantum to: " << m_quantum);
-    }
+bool
+DRRNonIpPacketFilter::CheckProtocol (Ptr<QueueDiscItem> item) const
+{
+  DRR_PACKET_LOG_FUNCTION (this << item);
+  return true;
+}
 
-  m_flowFactory.SetTypeId ("ns3::DRRFlow");
+int32_t
+DRRNonIpPacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
+{
+  DRR_PACKET_LOG_FUNCTION (this << item);
 
-  m_queueDiscFactory.SetTypeId ("ns3::CoDelQueueDisc");
+  // the protocol number followed by the type, length and value of the address
+  uint8_t buf[2 + Address::MAX_SIZE + 2];
+  buf[0] = (item->GetProtocol () >> 8) & 0xff;
+  buf[1] = item->GetProtocol () & 0xff;
+  uint32_t len = 2 + item->GetAddress ().CopyAllTo (buf + 2, Address::MAX_SIZE + 2);
 
-  //m_queueDiscFactory.Set ("Mode", EnumValue (QueueBase::QUEUE_MODE_BYTES));
-  //m_queueDiscFactory.Set ("MaxPackets", UintegerValue (m_soft_limit + 1));
-  // m_queueDiscFactory.Set ("Interval", StringValue (m_interval));
-  //m_queueDiscFactory.Set ("Target", StringValue (m_target));
+  uint32_t hash = m_hasher->GetHash (buf, len, buf, std::min<uint32_t> (len, 36));
+  item->SetFlowId (FlowHasher::GetFlowId (buf, len));
+
+  DRR_PACKET_LOG_DEBUG ("Found packet of protocol " << item->GetProtocol () << "; hash " << hash);
+
+  return hash;
 }
 
-uint32_t
-DRRQueueDisc::DRRDrop (void)
-{
-  NS_LOG_FUNCTION (this);
 
-  uint32_t maxBacklog = 0, index = 0;
-  Ptr<QueueDisc> qd;
+NS_OBJECT_ENSURE_REGISTERED (DRRQueueDisc);
+
+ATTRIBUTE_HELPER_CPP (DRRWeightMap);
 
-  /* Queue is full! Find the fat flow and drop one packet from it */
-  for (uint32_t i = 0; i < GetNQueueDiscClasses (); i++)
+std::ostream &
+operator << (std::ostream &os, const DRRWeightMap &weights)
+{
+  for (DRRWeightMap::const_iterator it = weights.begin (); it != weights.end (); it++)
+    {
+      os << (it == weights.begin () ? "" : " ") << it->first << ":" << it->second;
+    }
+  return os;
+}
+
+std::istream &operator >> (std::istream &is, DRRWeightMap &weights)
+{
+  weights.clear ();
+  std::string entry;
+  while (is >> entry)
     {
-      qd = GetQueueDiscClass (i)->GetQueueDisc ();
-      uint32_t bytes = qd->GetNBytes ();
-      if (bytes > maxBacklog)
+      std::istringstream iss (entry);
+      uint32_t key;
+      uint32_t weight;
+      char separator;
+      if (!(iss >> key >> separator >> weight) || separator != ':' || !iss.eof () || weight == 0)
         {
-          maxBacklog = bytes;
-          index = i;
+          NS_FATAL_ERROR ("Invalid weight specification \"" << entry << "\" (key:weight expected, weight > 0)");
         }
+      weights[key] = weight;
     }
+  // running out of entries is not an error
+  is.clear (std::ios::eofbit);
+  return is;
+}
 
-  /* Now we drop one packet from the fat flow */
-  qd = GetQueueDiscClass (index)->GetQueueDisc ();
-  Ptr<QueueDiscItem> item;
-  item = qd->GetInternalQueue (0)->Dequeue ();
-  DropAfterDequeue (item, OVERLIMIT_DROP);
-  NS_LOG_INFO("Dropped item from queue " << index );
-  return index;
+TypeId DRRQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DRRQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<DRRQueueDisc> ()
+    .AddAttribute ("ByteLimit",
+                   "The hard limit on the real queue size, measured in bytes",
+                   UintegerValue (100 * 1024),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_limit),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Flows",
+                   "The number of queues into which the incoming packets are classified",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_flows),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FlowTableWays",
+                   "The number of ways of each set of the flow table. With one way, "
+                   "the flow table is direct-mapped and colliding flows share a queue; "
+                   "with more ways, the Flows queues are grouped into sets and the "
+                   "flows of a set are told apart by their flow identifier.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_flowTableWays),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("WeightKey",
+                   "The key used to look up the weight of a flow in the Weights map",
+                   EnumValue (WEIGHT_NONE),
+                   MakeEnumAccessor (&DRRQueueDisc::m_weightKey),
+                   MakeEnumChecker (WEIGHT_NONE, "None",
+                                    WEIGHT_BY_CLASS, "Class",
+                                    WEIGHT_BY_FLOW_TYPE, "FlowType",
+                                    WEIGHT_BY_DSCP, "Dscp"))
+    .AddAttribute ("Weights",
+                   "The weights of the flows, as a list of key:weight pairs. "
+                   "A flow of weight w is credited w quanta per round.",
+                   DRRWeightMapValue (DRRWeightMap ()),
+                   MakeDRRWeightMapAccessor (&DRRQueueDisc::m_weights),
+                   MakeDRRWeightMapChecker ())
+    .AddAttribute ("InlineFlows",
+                   "Whether each flow stores its packets in a compact FIFO embedded "
+                   "in the flow rather than in a child CoDel queue disc",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DRRQueueDisc::m_inlineFlows),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FlowQueueDiscType",
+                   "The type of the queue disc of each flow (unless flows use inline FIFOs)",
+                   EnumValue (FLOW_CODEL),
+                   MakeEnumAccessor (&DRRQueueDisc::m_flowQueueDiscType),
+                   MakeEnumChecker (FLOW_FIFO, "Fifo",
+                                    FLOW_CODEL, "CoDel",
+                                    FLOW_PIE, "Pie",
+                                    FLOW_RED, "Red"))
+    .AddAttribute ("FlowPoolSize",
+                   "The number of flows created and initialized at initialization time",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_flowPoolSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("FlowIdleTimeout",
+                   "The time after which an inactive flow can be recycled for another "
+                   "hash bucket. Zero means that flows are never recycled.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&DRRQueueDisc::m_flowIdleTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxFlowMemory",
+                   "The maximum estimated memory of the flows (excluding their packets), "
+                   "in bytes. When it is reached, the flow idle for the longest time is "
+                   "recycled instead of creating a new flow. Zero means unbounded.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_maxFlowMemory),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("EnqueueRingSize",
+                   "The capacity of the lock-free ring through which ProducerEnqueue "
+                   "hands packets over from another thread. Zero disables the ring.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_enqueueRingSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("InlineCoDel",
+                   "Whether the CoDel algorithm is applied to the inline FIFOs",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&DRRQueueDisc::m_inlineCoDel),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Interval",
+                   "The CoDel algorithm interval for each flow",
+                   StringValue ("100ms"),
+                   MakeStringAccessor (&DRRQueueDisc::m_interval),
+                   MakeStringChecker ())
+    .AddAttribute ("Target",
+                   "The CoDel algorithm target queue delay for each flow",
+                   StringValue ("5ms"),
+                   MakeStringAccessor (&DRRQueueDisc::m_target),
+                   MakeStringChecker ())
+    .AddAttribute ("Rate",
+                   "The rate at which the packets are sent, enforced by a token bucket. "
+                   "Zero disables shaping.",
+                   DataRateValue (DataRate ("0bps")),
+                   MakeDataRateAccessor (&DRRQueueDisc::m_rate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("Burst",
+                   "The size of the token bucket, in bytes. Zero means the quantum.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DRRQueueDisc::m_burst),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ("FlowCreated",
+                     "A flow has been created",
+                     MakeTraceSourceAccessor (&DRRQueueDisc::m_flowCreatedTrace),
+                     "ns3::DRRQueueDisc::FlowTracedCallback")
+    .AddTraceSource ("FlowReclaimed",
+                     "An idle flow has been detached from its hash bucket",
+                     MakeTraceSourceAccessor (&DRRQueueDisc::m_flowReclaimedTrace),
+                     "ns3::DRRQueueDisc::FlowTracedCallback")
+  ;
+  return tid;
+}
+
+DRRQueueDisc::DRRQueueDisc ()
+  : m_quantum (0),
+    m_flowTableWays (1),
+    m_weightKey (WEIGHT_NONE),
+    m_inlineFlows (false),
+    m_flowQueueDiscType (FLOW_CODEL),
+    m_flowPoolSize (0),
+    m_maxFlowMemory (0),
+    m_flowFootprint (0),
+    m_enqueueRingSize (0),
+    m_enqueueRing (0),
+    m_drainPending (false),
+    m_inlineCoDel (true),
+    m_codelInterval (0),
+    m_codelTarget (0),
+    m_burst (0),
+    m_nWakeEvents (0),
+    m_activeFlow (0),
+    m_idleFlows (0),
+    m_activeFlowCredited (false),
+    m_nCollisionsAvoided (0),
+    m_nFlowEvictions (0),
+    m_nFlowMerges (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DRRQueueDisc::~DRRQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DRRQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the ring and the backlog index point to the flows owned by the classes
+  m_activeFlow = 0;
+  m_idleFlows = 0;
+  m_activeFlowCredited = false;
+  m_backlogIndex.clear ();
+  m_flowPool.clear ();
+  m_flowTable.clear ();
+  m_flowTags.clear ();
+  m_mergedFlows.clear ();
+  // release the packets still in the enqueue ring
+  QueueDiscItem *raw;
+  while (m_enqueueRing && m_enqueueRing->Pop (raw))
+    {
+      raw->Unref ();
+    }
+  delete m_enqueueRing;
+  m_enqueueRing = 0;
+  Simulator::Cancel (m_wakeEvent);
+  QueueDisc::DoDispose ();
+}
+
+void
+DRRQueueDisc::SetQuantum (uint32_t quantum)
+{
+  NS_LOG_FUNCTION (this << quantum);
+  m_quantum = quantum;
+}
+
+uint32_t
+DRRQueueDisc::GetQuantum (void) const
+{
+  return m_quantum;
+}
+
+bool
+DRRQueueDisc::ProducerEnqueue (Ptr<QueueDiscItem> &item)
+{
+  NS_ASSERT_MSG (m_enqueueRing, "The enqueue ring is disabled or the queue disc is not initialized");
+
+  // hash the IP packets here, so that the filters of the simulator thread
+  // find the hash in the item
+  if (!DRRIpv4PacketFilter::SetDefaultFlowHash (item))
+    {
+      DRRIpv6PacketFilter::SetDefaultFlowHash (item);
+    }
+
+  // the reference of the caller is moved to the ring before the packet is
+  // published, so that this thread does not touch the reference count once
+  // the simulator thread may have adopted the packet
+  QueueDiscItem *raw = PeekPointer (item);
+  raw->Ref ();
+  item = 0;
+  if (!m_enqueueRing->Push (raw))
+    {
+      item = Ptr<QueueDiscItem> (raw, false);
+      return false;
+    }
+
+  // the packets pushed before the drain clears the flag are drained by it
+  if (!m_drainPending.exchange (true))
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                      &DRRQueueDisc::DrainEnqueueRing, this);
+    }
+  return true;
+}
+
+void
+DRRQueueDisc::DrainEnqueueRing (void)
+{
+  DRR_PACKET_LOG_FUNCTION (this);
+
+  m_drainPending.store (false);
+
+  // the packets are classified here, as the packet filters and the packets
+  // they tag must only be used by the simulator thread. The hash of the IP
+  // packets has been computed by the producer thread, hence the filters only
+  // read it from the item
+  QueueDiscItem *raw;
+  while (m_enqueueRing && m_enqueueRing->Pop (raw))
+    {
+      Enqueue (Ptr<QueueDiscItem> (raw, false));
+    }
+
+  // as the traffic control layer does after enqueuing a packet
+  if (GetSendCallback ())
+    {
+      Run ();
+    }
+}
+
+uint64_t
+DRRQueueDisc::GetFlowMemory (void) const
+{
+  return static_cast<uint64_t> (m_backlogIndex.size ()) * m_flowFootprint;
+}
+
+uint64_t
+DRRQueueDisc::GetNCollisionsAvoided (void) const
+{
+  return m_nCollisionsAvoided;
+}
+
+uint64_t
+DRRQueueDisc::GetNFlowEvictions (void) const
+{
+  return m_nFlowEvictions;
+}
+
+uint64_t
+DRRQueueDisc::GetNFlowMerges (void) const
+{
+  return m_nFlowMerges;
+}
+
+uint64_t
+DRRQueueDisc::GetNWakeEvents (void) const
+{
+  return m_nWakeEvents;
+}
+
+uint32_t
+DRRQueueDisc::GetWeight (const DRRWeightMap &weights, WeightKey key,
+                         Ptr<const QueueDiscItem> item, uint32_t index)
+{
+  uint32_t k = index;
+  if (key == WEIGHT_NONE || weights.empty ())
+    {
+      return 1;
+    }
+  else if (key == WEIGHT_BY_FLOW_TYPE)
+    {
+      FlowTag tag;
+      if (!item->GetPacket ()->PeekPacketTag (tag))
+        {
+          return 1;
+        }
+      k = tag.GetFlowType ();
+    }
+  else if (key == WEIGHT_BY_DSCP)
+    {
+      uint8_t tos;
+      if (!item->GetUint8Value (QueueItem::IP_DSFIELD, tos))
+        {
+          return 1;
+        }
+      k = tos >> 2;
+    }
+
+  DRRWeightMap::const_iterator it = weights.find (k);
+  return it != weights.end () ? it->second : 1;
+}
+
+NetDeviceQueueInterface::SelectQueueCallback
+DRRQueueDisc::MakeFlowHashSelectQueueCallback (std::size_t nTxQueues)
+{
+  NS_LOG_FUNCTION (nTxQueues);
+  NS_ABORT_MSG_IF (nTxQueues == 0, "The number of transmission queues must be positive");
+
+  std::vector<Ptr<PacketFilter> > filters;
+  filters.push_back (CreateObject<DRRIpv4PacketFilter> ());
+  filters.push_back (CreateObject<DRRIpv6PacketFilter> ());
+  filters.push_back (CreateObject<DRRNonIpPacketFilter> ());
+
+  return [filters, nTxQueues] (Ptr<QueueItem> item) -> std::size_t
+    {
+      Ptr<QueueDiscItem> qdItem = DynamicCast<QueueDiscItem> (item);
+      if (!qdItem)
+        {
+          return 0;
+        }
+      for (auto& f : filters)
+        {
+          int32_t ret = f->Classify (qdItem);
+          if (ret != PacketFilter::PF_NO_MATCH)
+            {
+              // use the high order bits of the hash (as reciprocal_scale does in
+              // Linux), because the low order bits select the flow queue of the
+              // DRR queue disc installed on the transmission queue
+              return (static_cast<uint64_t> (static_cast<uint32_t> (ret)) * nTxQueues) >> 32;
+            }
+        }
+      return 0;
+    };
+}
+
+bool
+DRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  DRR_PACKET_LOG_FUNCTION (this << item);
+
+  int32_t ret = Classify (item);
+  uint32_t h;
+  // the class of the packet, i.e., the flow queue of a direct-mapped table
+  uint32_t bucket;
+
+  if (ret == PacketFilter::PF_NO_MATCH)
+    {
+      NS_LOG_WARN ("No filter has been able to classify this packet.");
+      h = m_flows; // place all unfiltered packets into a separate flow queue
+      bucket = h;
+    }
+
+  else if (m_flowTableWays > 1)
+    {
+      h = LookupFlowWay (item, ret);
+      bucket = ret % m_flows;
+    }
+  else
+    {
+      h = ret % m_flows;
+      bucket = h;
+    }
+
+  NS_ASSERT (h < m_flowTable.size ());
+  Ptr<DRRFlow> flow = m_flowTable[h];
+  if (!flow)
+    {
+      DRR_PACKET_LOG_DEBUG ("Assigning a flow queue to hash bucket " << h);
+      flow = GetFreeFlow (h);
+      if (!flow)
+        {
+          DRR_PACKET_LOG_LOGIC ("No flow available within the flow memory limit -- dropping pkt");
+          DropBeforeEnqueue (item, FLOW_MEMORY_DROP);
+          return false;
+        }
+      flow->SetBucket (h);
+      m_flowTable[h] = flow;
+    }
+
+  if (m_inlineFlows)
+    {
+      flow->InlineEnqueue (item);
+      PacketEnqueued (item);
+    }
+  else
+    {
+      flow->GetQueueDisc ()->Enqueue (item);
+    }
+  UpdateBacklog (PeekPointer (flow));
+
+  DRR_PACKET_LOG_DEBUG ("Packet enqueued into flow " << h << "; flow index " << flow->GetIndex ());
+
+  if (flow->GetStatus () == DRRFlow::INACTIVE)
+    {
+      DRR_PACKET_LOG_DEBUG ("Setting flow as ACTIVE");
+      if (flow->GetNext ())
+        {
+          // the flow is in the ring of idle flows
+          RingRemove (m_idleFlows, PeekPointer (flow));
+        }
+      flow->SetStatus (DRRFlow::ACTIVE);
+      flow->SetQuantum (m_quantum * GetWeight (m_weights, m_weightKey, item, bucket));
+      AddActiveFlow (PeekPointer (flow));
+    }
+
+  while (GetNBytes () > m_limit)
+    {
+      DRRDrop ();
+    }
+
+  return true;
+}
+
+Ptr<QueueDiscItem>
+DRRQueueDisc::DoDequeue (void)
+{
+  DRR_PACKET_LOG_FUNCTION (this);
+
+  ReclaimIdleFlows ();
+  return DequeueFromActiveFlows (1, std::numeric_limits<uint32_t>::max (), 0);
+}
+
+void
+DRRQueueDisc::DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items)
+{
+  DRR_PACKET_LOG_FUNCTION (this << n << maxBytes);
+
+  ReclaimIdleFlows ();
+  DequeueFromActiveFlows (n, maxBytes, &items);
+}
+
+Ptr<QueueDiscItem>
+DRRQueueDisc::DequeueFromActiveFlows (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > *items)
+{
+  Ptr<QueueDiscItem> item;
+  uint32_t bytes = 0;
+  // the first flow visited in the current round and whether the round
+  // has started, to detect a whole round in which no packet was served
+  DRRFlow *roundStart = m_activeFlow;
+  bool inRound = false;
+
+  while (m_activeFlow)
+    {
+      DRRFlow *flow = m_activeFlow;
+      if (!m_activeFlowCredited)
+        {
+          if (flow == roundStart && inRound)
+            {
+              CatchUpRounds ();
+            }
+          flow->IncreaseDeficit (flow->GetQuantum ());
+          m_activeFlowCredited = true;
+        }
+      inRound = true;
+      Ptr<const QueueDiscItem> t_item = FlowPeek (flow);
+      // the AQM of the flow may drop packets while peeking
+      UpdateBacklog (flow);
+
+      if (t_item == 0)
+        {
+          DRR_PACKET_LOG_DEBUG ("Flow emptied by its AQM, Setting it to INACTIVE");
+          DeactivateFlow (flow);
+          roundStart = m_activeFlow;
+          inRound = false;
+          continue;
+        }
+
+      if ( (uint32_t) flow->GetDeficit () >= t_item->GetSize ())
+        {
+          // the round robin pointer and the credit stay on the flow, so the
+          // same packet is selected again when the queue disc is woken up
+          if (m_rate.GetBitRate () && !ShaperConforms (t_item->GetSize ()))
+            {
+              return 0;
+            }
+          item = FlowDequeue (flow);
+          UpdateBacklog (flow);
+          flow->IncreaseDeficit (-item->GetSize ());
+          if (m_rate.GetBitRate ())
+            {
+              ShaperConsume (item->GetSize ());
+            }
+          DRR_PACKET_LOG_DEBUG ("Dequeued packet " << item->GetPacket ());
+
+          if (GetFlowNPackets (flow) == 0)
+            {
+              DRR_PACKET_LOG_DEBUG ("Empty Flow, Setting it to INACTIVE");
+              DeactivateFlow (flow);
+            }
+          else
+            {
+              DRR_PACKET_LOG_DEBUG ("Flow still active, keeping the round robin pointer on it");
+            }
+
+          if (items)
+            {
+              items->push_back (item);
+            }
+          bytes += item->GetSize ();
+          if (--n == 0 || bytes >= maxBytes)
+            {
+              return item;
+            }
+          // carry on walking the ring from where the packet left it, as the
+          // next call would do
+          roundStart = m_activeFlow;
+          inRound = false;
+          continue;
+        }
+
+      DRR_PACKET_LOG_DEBUG ("Packet size greater than deficit, moving the round robin pointer to the next flow");
+      m_activeFlow = flow->GetNext ();
+      m_activeFlowCredited = false;
+    }
+
+  DRR_PACKET_LOG_DEBUG ("No active flows found");
+  return 0;
+}
+
+bool
+DRRQueueDisc::ShaperConforms (uint32_t size)
+{
+  DRR_PACKET_LOG_FUNCTION (this << size);
+
+  // the bucket holds the tokens earned since m_bucketEmpty, up to m_burst.
+  // A packet larger than the bucket is sent when the bucket is full and
+  // leaves it in debt
+  Time now = Simulator::Now ();
+  Time empty = std::max (m_bucketEmpty, now - m_rate.CalculateBytesTxTime (m_burst));
+  Time eligible = empty + m_rate.CalculateBytesTxTime (std::min (size, m_burst));
+
+  if (eligible <= now)
+    {
+      return true;
+    }
+
+  // a single event per idle period: packets enqueued meanwhile find it pending
+  if (!m_wakeEvent.IsRunning ())
+    {
+      DRR_PACKET_LOG_LOGIC ("Waking the queue disc up in " << eligible - now);
+      m_wakeEvent = Simulator::Schedule (eligible - now, &QueueDisc::Run, this);
+      m_nWakeEvents++;
+    }
+  return false;
+}
+
+void
+DRRQueueDisc::ShaperConsume (uint32_t size)
+{
+  DRR_PACKET_LOG_FUNCTION (this << size);
+
+  Time now = Simulator::Now ();
+  m_bucketEmpty = std::max (m_bucketEmpty, now - m_rate.CalculateBytesTxTime (m_burst))
+                  + m_rate.CalculateBytesTxTime (size);
+}
+
+Ptr<const QueueDiscItem>
+DRRQueueDisc::DoPeek (void) const
+{
+  DRR_PACKET_LOG_FUNCTION (this);
+
+  if (!m_activeFlow)
+    {
+      return 0;
+    }
+
+  if (m_inlineFlows)
+    {
+      return m_activeFlow->InlinePeek ();
+    }
+  return m_activeFlow->GetQueueDisc ()->Peek ();
+}
+
+bool
+DRRQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (GetNQueueDiscClasses () > 0)
+    {
+      NS_LOG_ERROR ("DRRQueueDisc cannot have classes");
+      return false;
+    }
+
+  if (GetNPacketFilters () == 0)
+    {
+      AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRIpv6PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRNonIpPacketFilter> ());
+//      NS_LOG_ERROR ("DRRQueueDisc needs at least a packet filter");
+//      return false;
+    }
+
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("DRRQueueDisc cannot have internal queues");
+      return false;
+    }
+
+  if (m_flows % m_flowTableWays)
+    {
+      NS_LOG_ERROR ("The number of flows must be a multiple of the number of ways of the flow table");
+      return false;
+    }
+
+  return true;
+}
+
+void
+DRRQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // we are at initialization time. If the user has not set a quantum value,
+  // set the quantum to the MTU of the device
+  if (!m_quantum)
+    {
+      //Ptr<NetDevice> device = GetNetDevice ();
+      //NS_ASSERT_MSG (device, "Device not set for the queue disc");
+      //m_quantum = device->GetMtu ();
+      m_quantum = 600;
+      NS_LOG_DEBUG ("Setting the quantum to: " << m_quantum);
+    }
+
+  if (!m_burst)
+    {
+      m_burst = m_quantum;
+    }
+  // the token bucket is full at the beginning
+  if (m_rate.GetBitRate ())
+    {
+      m_bucketEmpty = Simulator::Now () - m_rate.CalculateBytesTxTime (m_burst);
+    }
+  m_wakeEvent = EventId ();
+
+  // one slot per hash bucket, plus one for the packets no filter could classify
+  m_flowTable.assign (m_flows + 1, 0);
+  if (m_flowTableWays > 1)
+    {
+      m_flowTags.assign (m_flows, 0);
+      m_mergedFlows.assign (m_flows, std::vector<uint64_t> ());
+    }
+
+  m_flowFactory.SetTypeId ("ns3::DRRFlow");
+
+  switch (m_flowQueueDiscType)
+    {
+    case FLOW_FIFO:
+      m_queueDiscFactory.SetTypeId ("ns3::FifoQueueDisc");
+      break;
+    case FLOW_PIE:
+      m_queueDiscFactory.SetTypeId ("ns3::PieQueueDisc");
+      break;
+    case FLOW_RED:
+      m_queueDiscFactory.SetTypeId ("ns3::RedQueueDisc");
+      break;
+    default:
+      m_queueDiscFactory.SetTypeId ("ns3::CoDelQueueDisc");
+      m_queueDiscFactory.Set ("Interval", StringValue (m_interval));
+      m_queueDiscFactory.Set ("Target", StringValue (m_target));
+    }
+
+  m_codelInterval = Time2CoDel (Time (m_interval));
+  m_codelTarget = Time2CoDel (Time (m_target));
+
+  // the footprint of a flow is estimated from the size of the objects it is
+  // made of; the buffers they allocate (e.g., to store packets) are not counted
+  m_flowFootprint = sizeof (DRRFlow);
+  if (!m_inlineFlows)
+    {
+      m_flowFootprint += sizeof (DropTailQueue<QueueDiscItem>);
+      switch (m_flowQueueDiscType)
+        {
+        case FLOW_FIFO:
+          m_flowFootprint += sizeof (FifoQueueDisc);
+          break;
+        case FLOW_PIE:
+          m_flowFootprint += sizeof (PieQueueDisc);
+          break;
+        case FLOW_RED:
+          m_flowFootprint += sizeof (RedQueueDisc);
+          break;
+        default:
+          m_flowFootprint += sizeof (CoDelQueueDisc);
+        }
+    }
+
+  if (m_enqueueRingSize)
+    {
+      m_enqueueRing = new SpscRing<QueueDiscItem*> (m_enqueueRingSize);
+    }
+
+  // pre-initialize the pool of flows, which hands them out in creation order
+  for (uint32_t i = 0; i < m_flowPoolSize; i++)
+    {
+      Ptr<DRRFlow> flow = CreateFlow (m_flowTable.size ());
+      if (!m_inlineFlows)
+        {
+          flow->GetQueueDisc ()->Suspend ();
+        }
+      m_flowPool.push_back (flow);
+    }
+  std::reverse (m_flowPool.begin (), m_flowPool.end ());
+}
+
+uint32_t
+DRRQueueDisc::DRRDrop (void)
+{
+  DRR_PACKET_LOG_FUNCTION (this);
+
+  /* Queue is full! The fat flow is at the root of the backlog index */
+  NS_ASSERT (!m_backlogIndex.empty ());
+  DRRFlow *flow = m_backlogIndex.front ();
+
+  /* Now we drop one packet from the fat flow */
+  if (m_inlineFlows)
+    {
+      // the head packet has to go through CoDel again, if it is dropped
+      flow->GetCoDelState ().headChecked = false;
+      InlineDrop (flow->InlineDequeue (), OVERLIMIT_DROP);
+    }
+  else
+    {
+      Ptr<QueueDisc> qd = flow->GetQueueDisc ();
+      Ptr<QueueDiscItem> item;
+      item = qd->GetInternalQueue (0)->Dequeue ();
+      DropAfterDequeue (item, OVERLIMIT_DROP);
+    }
+  UpdateBacklog (flow);
+  DRR_PACKET_LOG_INFO ("Dropped item from queue " << flow->GetIndex ());
+  return flow->GetIndex ();
+}
+
+void
+DRRQueueDisc::CatchUpRounds (void)
+{
+  DRR_PACKET_LOG_FUNCTION (this);
+  NS_ASSERT (m_activeFlow);
+
+  // Each flow needs ceil ((size - deficit) / quantum) more visits to send its
+  // head packet. The first flow (in round robin order) needing the fewest
+  // visits, say r, is served in the r-th round from now. Crediting every flow
+  // with r - 1 of its quanta leaves the deficits exactly as if those rounds
+  // were run.
+  uint32_t rounds = std::numeric_limits<uint32_t>::max ();
+  DRRFlow *flow = m_activeFlow;
+  do
+    {
+      // the head packet was peeked in the round just completed
+      Ptr<const QueueDiscItem> item = FlowPeek (flow);
+      NS_ASSERT (item && item->GetSize () > (uint32_t) flow->GetDeficit ());
+      uint32_t missing = item->GetSize () - flow->GetDeficit ();
+      uint32_t quantum = flow->GetQuantum ();
+      NS_ASSERT (quantum > 0);
+      rounds = std::min (rounds, (missing + quantum - 1) / quantum);
+      flow = flow->GetNext ();
+    }
+  while (flow != m_activeFlow && rounds > 1);
+
+  if (rounds <= 1)
+    {
+      return;
+    }
+
+  DRR_PACKET_LOG_DEBUG ("Crediting the active flows with " << rounds - 1 << " rounds");
+  do
+    {
+      flow->IncreaseDeficit ((rounds - 1) * flow->GetQuantum ());
+      flow = flow->GetNext ();
+    }
+  while (flow != m_activeFlow);
+}
+
+Ptr<const QueueDiscItem>
+DRRQueueDisc::FlowPeek (DRRFlow *flow)
+{
+  if (!m_inlineFlows)
+    {
+      return flow->GetQueueDisc ()->Peek ();
+    }
+
+  if (m_inlineCoDel && !flow->GetCoDelState ().headChecked)
+    {
+      InlineCoDel (flow);
+    }
+  return flow->InlinePeek ();
+}
+
+Ptr<QueueDiscItem>
+DRRQueueDisc::FlowDequeue (DRRFlow *flow)
+{
+  if (!m_inlineFlows)
+    {
+      return flow->GetQueueDisc ()->Dequeue ();
+    }
+
+  if (m_inlineCoDel && !flow->GetCoDelState ().headChecked)
+    {
+      InlineCoDel (flow);
+    }
+  flow->GetCoDelState ().headChecked = false;
+  Ptr<QueueDiscItem> item = flow->InlineDequeue ();
+  if (item)
+    {
+      PacketDequeued (item);
+    }
+  return item;
+}
+
+uint32_t
+DRRQueueDisc::GetFlowNPackets (DRRFlow *flow) const
+{
+  return m_inlineFlows ? flow->GetInlineNPackets () : flow->GetQueueDisc ()->GetNPackets ();
+}
+
+uint32_t
+DRRQueueDisc::GetFlowNBytes (DRRFlow *flow) const
+{
+  return m_inlineFlows ? flow->GetInlineNBytes () : flow->GetQueueDisc ()->GetNBytes ();
+}
+
+void
+DRRQueueDisc::InlineDrop (Ptr<QueueDiscItem> item, const char* reason)
+{
+  // the packet left the inline FIFO, as if dequeued from an internal queue
+  PacketDequeued (item);
+  DropAfterDequeue (item, reason);
+}
+
+bool
+DRRQueueDisc::InlineCoDelOkToDrop (DRRFlow *flow, Ptr<QueueDiscItem> item, uint32_t now)
+{
+  DRRFlow::CoDelState &codel = flow->GetCoDelState ();
+
+  if (!item)
+    {
+      codel.firstAboveTime = 0;
+      return false;
+    }
+
+  uint32_t sojournTime = Time2CoDel (Simulator::Now () - item->GetTimeStamp ());
+
+  // minbytes as in the CoDel queue disc
+  if (CoDelTimeBefore (sojournTime, m_codelTarget) || flow->GetInlineNBytes () < 1500)
+    {
+      // went below so we'll stay below for at least interval
+      codel.firstAboveTime = 0;
+      return false;
+    }
+  bool okToDrop = false;
+  if (codel.firstAboveTime == 0)
+    {
+      codel.firstAboveTime = now + m_codelInterval;
+    }
+  else if (CoDelTimeAfter (now, codel.firstAboveTime))
+    {
+      okToDrop = true;
+    }
+  return okToDrop;
+}
+
+void
+DRRQueueDisc::InlineCoDel (DRRFlow *flow)
+{
+  DRR_PACKET_LOG_FUNCTION (this << flow);
+
+  DRRFlow::CoDelState &codel = flow->GetCoDelState ();
+  Ptr<QueueDiscItem> item = flow->InlineDequeue ();
+  if (!item)
+    {
+      // Leave dropping state when queue is empty
+      codel.dropping = false;
+      return;
+    }
+  uint32_t now = Time2CoDel (Simulator::Now ());
+
+  // This follows CoDelQueueDisc::DoDequeue, except that the surviving packet
+  // is put back at the head of the FIFO until the flow is allowed to send it
+  bool okToDrop = InlineCoDelOkToDrop (flow, item, now);
+
+  if (codel.dropping)
+    {
+      if (!okToDrop)
+        {
+          /* sojourn time fell below target - leave dropping state */
+          codel.dropping = false;
+        }
+      else if (CoDelTimeAfterEq (now, codel.dropNext))
+        {
+          while (codel.dropping && CoDelTimeAfterEq (now, codel.dropNext))
+            {
+              DRR_PACKET_LOG_LOGIC ("Sojourn time is still above target and it's time for next drop; dropping " << item);
+              InlineDrop (item, TARGET_EXCEEDED_DROP);
+
+              ++codel.count;
+              NewtonStep (codel);
+              item = flow->InlineDequeue ();
+
+              if (!InlineCoDelOkToDrop (flow, item, now))
+                {
+                  /* leave dropping state */
+                  codel.dropping = false;
+                }
+              else
+                {
+                  /* schedule the next drop */
+                  codel.dropNext = ControlLaw (codel, codel.dropNext, m_codelInterval);
+                }
+            }
+        }
+    }
+  else if (okToDrop)
+    {
+      // Drop the first packet and enter dropping state unless the queue is empty
+      DRR_PACKET_LOG_LOGIC ("Sojourn time goes above target, dropping the first packet " << item << " and entering the dropping state");
+      InlineDrop (item, TARGET_EXCEEDED_DROP);
+
+      item = flow->InlineDequeue ();
+
+      InlineCoDelOkToDrop (flow, item, now);
+      codel.dropping = true;
+      /*
+       * if min went above target close to when we last went below it
+       * assume that the drop rate that controlled the queue on the
+       * last cycle is a good starting point to control it now.
+       */
+      int delta = codel.count - codel.lastCount;
+      if (delta > 1 && CoDelTimeBefore (now - codel.dropNext, 16 * m_codelInterval))
+        {
+          codel.count = delta;
+          NewtonStep (codel);
+        }
+      else
+        {
+          codel.count = 1;
+          codel.recInvSqrt = ~0U >> REC_INV_SQRT_SHIFT;
+        }
+      codel.lastCount = codel.count;
+      codel.dropNext = ControlLaw (codel, now, m_codelInterval);
+    }
+
+  if (item)
+    {
+      flow->InlineRequeue (item);
+      codel.headChecked = true;
+    }
+}
+
+void
+DRRQueueDisc::AddActiveFlow (DRRFlow *flow)
+{
+  DRR_PACKET_LOG_FUNCTION (this << flow);
+  RingAppend (m_activeFlow, flow);
+}
+
+void
+DRRQueueDisc::RemoveActiveFlow (DRRFlow *flow)
+{
+  DRR_PACKET_LOG_FUNCTION (this << flow);
+
+  if (m_activeFlow == flow)
+    {
+      m_activeFlowCredited = false;
+    }
+  RingRemove (m_activeFlow, flow);
+}
+
+void
+DRRQueueDisc::DeactivateFlow (DRRFlow *flow)
+{
+  DRR_PACKET_LOG_FUNCTION (this << flow);
+
+  flow->SetDeficit (0);
+  flow->SetStatus (DRRFlow::INACTIVE);
+  flow->SetIdleSince (Simulator::Now ());
+  RemoveActiveFlow (flow);
+
+  // the flows merged into the way have no packets left, they may now take
+  // a way of their own
+  if (m_flowTableWays > 1 && flow->GetBucket () < m_flows)
+    {
+      m_mergedFlows[flow->GetBucket ()].clear ();
+    }
+
+  if (!m_flowIdleTimeout.IsZero () || m_maxFlowMemory)
+    {
+      // flows become idle in time order, so the oldest is at the head
+      RingAppend (m_idleFlows, flow);
+    }
+}
+
+Ptr<DRRFlow>
+DRRQueueDisc::CreateFlow (uint32_t bucket)
+{
+  NS_LOG_FUNCTION (this << bucket);
+
+  Ptr<DRRFlow> flow = m_flowFactory.Create<DRRFlow> ();
+  if (!m_inlineFlows)
+    {
+      Ptr<QueueDisc> qd = m_queueDiscFactory.Create<QueueDisc> ();
+      qd->Initialize ();
+      flow->SetQueueDisc (qd);
+      AddQueueDiscClass (flow);
+    }
+  flow->SetIndex (m_backlogIndex.size ());
+
+  // new flows enter the backlog index as leaves with no backlog
+  flow->SetBacklogPosition (m_backlogIndex.size ());
+  m_backlogIndex.push_back (PeekPointer (flow));
+  m_flowCreatedTrace (flow->GetIndex (), bucket);
+  return flow;
+}
+
+uint32_t
+DRRQueueDisc::LookupFlowWay (Ptr<const QueueDiscItem> item, uint32_t hash)
+{
+  DRR_PACKET_LOG_FUNCTION (this << item << hash);
+
+  // flows classified by filters that do not identify them are told apart by their hash
+  uint64_t id;
+  if (!item->GetFlowId (id))
+    {
+      id = hash;
+    }
+
+  uint32_t first = (hash % (m_flows / m_flowTableWays)) * m_flowTableWays;
+  uint32_t empty = m_flows;
+  uint32_t victim = m_flows;
+  bool shared = false;
+  for (uint32_t way = first; way < first + m_flowTableWays; way++)
+    {
+      DRRFlow *flow = PeekPointer (m_flowTable[way]);
+      if (!flow)
+        {
+          empty = std::min (empty, way);
+          continue;
+        }
+      if (m_flowTags[way] == id)
+        {
+          return way;
+        }
+      // a merged flow stays in the way it shares until the way drains, so
+      // that its packets are not reordered
+      const std::vector<uint64_t> &merged = m_mergedFlows[way];
+      if (!merged.empty () && std::find (merged.begin (), merged.end (), id) != merged.end ())
+        {
+          return way;
+        }
+      shared = true;
+      if (flow->GetStatus () == DRRFlow::INACTIVE
+          && (victim == m_flows || flow->GetIdleSince () < m_flowTable[victim]->GetIdleSince ()))
+        {
+          victim = way;
+        }
+    }
+
+  if (empty < m_flows)
+    {
+      if (shared)
+        {
+          DRR_PACKET_LOG_DEBUG ("Collision avoided in the set of way " << empty);
+          m_nCollisionsAvoided++;
+        }
+      m_flowTags[empty] = id;
+      return empty;
+    }
+
+  if (victim < m_flows)
+    {
+      DRR_PACKET_LOG_DEBUG ("Evicting the inactive flow of way " << victim);
+      m_nFlowEvictions++;
+      m_flowTable[victim]->ResetCoDelState ();
+      if (!m_inlineFlows)
+        {
+          m_flowTable[victim]->GetQueueDisc ()->Reset ();
+        }
+      m_flowTags[victim] = id;
+      return victim;
+    }
+
+  DRR_PACKET_LOG_DEBUG ("All the ways are backlogged, sharing a way");
+  m_nFlowMerges++;
+  uint32_t way = first + id % m_flowTableWays;
+  m_mergedFlows[way].push_back (id);
+  return way;
+}
+
+Ptr<DRRFlow>
+DRRQueueDisc::GetFreeFlow (uint32_t bucket)
+{
+  DRR_PACKET_LOG_FUNCTION (this << bucket);
+
+  Ptr<DRRFlow> flow;
+  if (!m_flowPool.empty ())
+    {
+      flow = m_flowPool.back ();
+      m_flowPool.pop_back ();
+    }
+  else if (m_idleFlows && !m_flowIdleTimeout.IsZero ()
+           && Simulator::Now () - m_idleFlows->GetIdleSince () >= m_flowIdleTimeout)
+    {
+      DRR_PACKET_LOG_DEBUG ("Recycling the flow of hash bucket " << m_idleFlows->GetBucket ());
+      flow = ReclaimFlow (m_idleFlows);
+    }
+  else if (m_maxFlowMemory && GetFlowMemory () + m_flowFootprint > m_maxFlowMemory)
+    {
+      if (!m_idleFlows)
+        {
+          return 0;
+        }
+      DRR_PACKET_LOG_DEBUG ("Flow memory limit reached, recycling the flow of hash bucket "
+                            << m_idleFlows->GetBucket ());
+      flow = ReclaimFlow (m_idleFlows);
+    }
+  else
+    {
+      return CreateFlow (bucket);
+    }
+
+  // the queue disc of a reused flow forgets the AQM state of the previous
+  // flow and restarts the periodic events cancelled while it was pooled
+  if (!m_inlineFlows)
+    {
+      flow->GetQueueDisc ()->Reset ();
+    }
+  return flow;
+}
+
+Ptr<DRRFlow>
+DRRQueueDisc::ReclaimFlow (DRRFlow *flow)
+{
+  DRR_PACKET_LOG_FUNCTION (this << flow);
+
+  NS_ASSERT (flow->GetStatus () == DRRFlow::INACTIVE);
+  // the hash bucket may be the last owner of the flow if it is inline
+  Ptr<DRRFlow> reclaimed = flow;
+  RingRemove (m_idleFlows, flow);
+  m_flowTable[flow->GetBucket ()] = 0;
+  flow->ResetCoDelState ();
+  m_flowReclaimedTrace (flow->GetIndex (), flow->GetBucket ());
+  return reclaimed;
+}
+
+void
+DRRQueueDisc::ReclaimIdleFlows (void)
+{
+  if (m_idleFlows && !m_flowIdleTimeout.IsZero ()
+      && Simulator::Now () - m_idleFlows->GetIdleSince () >= m_flowIdleTimeout)
+    {
+      DRR_PACKET_LOG_DEBUG ("Releasing the flow of hash bucket " << m_idleFlows->GetBucket ());
+      Ptr<DRRFlow> flow = ReclaimFlow (m_idleFlows);
+      if (!m_inlineFlows)
+        {
+          flow->GetQueueDisc ()->Suspend ();
+        }
+      m_flowPool.push_back (flow);
+    }
+}
+
+void
+DRRQueueDisc::UpdateBacklog (DRRFlow *flow)
+{
+  uint32_t backlog = GetFlowNBytes (flow);
+  uint32_t previous = flow->GetBacklog ();
+  flow->SetBacklog (backlog);
+
+  if (backlog > previous)
+    {
+      BacklogSiftUp (flow->GetBacklogPosition ());
+    }
+  else if (backlog < previous)
+    {
+      BacklogSiftDown (flow->GetBacklogPosition ());
+    }
+}
+
+void
+DRRQueueDisc::BacklogSiftUp (uint32_t position)
+{
+  while (position > 0)
+    {
+      uint32_t parent = (position - 1) / 2;
+      if (m_backlogIndex[parent]->GetBacklog () >= m_backlogIndex[position]->GetBacklog ())
+        {
+          break;
+        }
+      BacklogSwap (parent, position);
+      position = parent;
+    }
+}
+
+void
+DRRQueueDisc::BacklogSiftDown (uint32_t position)
+{
+  uint32_t size = m_backlogIndex.size ();
+  while (true)
+    {
+      uint32_t largest = position;
+      uint32_t left = 2 * position + 1;
+      uint32_t right = left + 1;
+      if (left < size && m_backlogIndex[left]->GetBacklog () > m_backlogIndex[largest]->GetBacklog ())
+        {
+          largest = left;
+        }
+      if (right < size && m_backlogIndex[right]->GetBacklog () > m_backlogIndex[largest]->GetBacklog ())
+        {
+          largest = right;
+        }
+      if (largest == position)
+        {
+          break;
+        }
+      BacklogSwap (position, largest);
+      position = largest;
+    }
+}
+
+void
+DRRQueueDisc::BacklogSwap (uint32_t i, uint32_t j)
+{
+  std::swap (m_backlogIndex[i], m_backlogIndex[j]);
+  m_backlogIndex[i]->SetBacklogPosition (i);
+  m_backlogIndex[j]->SetBacklogPosition (j);
 }
 
 } // namespace ns3
@@ -24,12 +24,30 @@
 #define DRR_QUEUE_DISC
 
 #include "ns3/queue-disc.h"
+#include "ns3/packet-filter.h"
+#include "ns3/flow-hasher.h"
 #include "ns3/object-factory.h"
-#include <list>
+#include "ns3/attribute-helper.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "ns3/spsc-ring.h"
+#include "ns3/net-device-queue-interface.h"
+#include <atomic>
 #include <map>
+#include <string>
+#include <vector>
 
 namespace ns3 {
 
+/**
+ * Weights of the flows of a weighted DRR queue disc, indexed by the key
+ * selected through the WeightKey attribute (flow queue index, FlowTag flow
+ * type or DSCP). A flow whose key is not in the map has weight 1.
+ */
+typedef std::map<uint32_t, uint32_t> DRRWeightMap;
+
 /**
 * \ingroup traffic-control
 *
@@ -100,9 +118,248 @@ public:
   FlowStatus GetStatus (void) const;
 
 
+  /**
+   * \brief Set the quantum of this flow, i.e., the bytes credited on each visit
+   * \param quantum the quantum of this flow
+   */
+  void SetQuantum (uint32_t quantum);
+
+
+  /**
+   * \brief Get the quantum of this flow
+   * \return the quantum of this flow
+   */
+  uint32_t GetQuantum (void) const;
+
+
+  /**
+   * \brief Set the index of this flow among the queue disc classes
+   * \param index the index of this flow
+   */
+  void SetIndex (uint32_t index);
+
+
+  /**
+   * \brief Get the index of this flow among the queue disc classes
+   * \return the index of this flow
+   */
+  uint32_t GetIndex (void) const;
+
+
+  /**
+   * \brief Set the backlog (in bytes) recorded for this flow in the backlog index
+   * \param backlog the backlog of this flow
+   */
+  void SetBacklog (uint32_t backlog);
+
+
+  /**
+   * \brief Get the backlog (in bytes) recorded for this flow in the backlog index
+   * \return the backlog of this flow
+   */
+  uint32_t GetBacklog (void) const;
+
+
+  /**
+   * \brief Set the position of this flow in the backlog index
+   * \param position the position of this flow in the backlog index
+   */
+  void SetBacklogPosition (uint32_t position);
+
+
+  /**
+   * \brief Get the position of this flow in the backlog index
+   * \return the position of this flow in the backlog index
+   */
+  uint32_t GetBacklogPosition (void) const;
+
+
+  /**
+   * \brief Set the flow following this one in the ring of active flows
+   * \param next the next flow
+   */
+  void SetNext (DRRFlow *next);
+
+
+  /**
+   * \brief Get the flow following this one in the ring of active flows
+   * \return the next flow
+   */
+  DRRFlow* GetNext (void) const;
+
+
+  /**
+   * \brief Set the flow preceding this one in the ring of active flows
+   * \param prev the previous flow
+   */
+  void SetPrev (DRRFlow *prev);
+
+
+  /**
+   * \brief Get the flow preceding this one in the ring of active flows
+   * \return the previous flow
+   */
+  DRRFlow* GetPrev (void) const;
+
+
+  /**
+   * \brief Set the hash bucket this flow is assigned to
+   * \param bucket the hash bucket
+   */
+  void SetBucket (uint32_t bucket);
+
+
+  /**
+   * \brief Get the hash bucket this flow is assigned to
+   * \return the hash bucket
+   */
+  uint32_t GetBucket (void) const;
+
+
+  /**
+   * \brief Set the time this flow became inactive
+   * \param time the time this flow became inactive
+   */
+  void SetIdleSince (Time time);
+
+
+  /**
+   * \brief Get the time this flow became inactive
+   * \return the time this flow became inactive
+   */
+  Time GetIdleSince (void) const;
+
+
+  /**
+   * \brief State of the CoDel algorithm applied to the inline FIFO of a flow
+   */
+  struct CoDelState
+  {
+    uint32_t count;          //!< Number of packets dropped since entering the dropping state
+    uint32_t lastCount;      //!< Number of packets dropped when the dropping state was last entered
+    bool dropping;           //!< Whether the flow is in the dropping state
+    uint16_t recInvSqrt;     //!< Reciprocal inverse square root of count
+    uint32_t firstAboveTime; //!< Time to declare the sojourn time above target
+    uint32_t dropNext;       //!< Time to drop the next packet
+    bool headChecked;        //!< Whether the head packet already went through CoDel
+  };
+
+
+  /**
+   * \brief Append a packet to the inline FIFO of this flow
+   * \param item the packet to append
+   */
+  void InlineEnqueue (Ptr<QueueDiscItem> item);
+
+
+  /**
+   * \brief Remove the packet at the head of the inline FIFO of this flow
+   * \return the removed packet, or 0 if the FIFO is empty
+   */
+  Ptr<QueueDiscItem> InlineDequeue (void);
+
+
+  /**
+   * \brief Put a packet back at the head of the inline FIFO of this flow
+   * \param item the packet to put back
+   */
+  void InlineRequeue (Ptr<QueueDiscItem> item);
+
+
+  /**
+   * \brief Get the packet at the head of the inline FIFO of this flow
+   * \return the head packet, or 0 if the FIFO is empty
+   */
+  Ptr<QueueDiscItem> InlinePeek (void) const;
+
+
+  /**
+   * \brief Get the number of packets in the inline FIFO of this flow
+   * \return the number of packets
+   */
+  uint32_t GetInlineNPackets (void) const;
+
+
+  /**
+   * \brief Get the number of bytes in the inline FIFO of this flow
+   * \return the number of bytes
+   */
+  uint32_t GetInlineNBytes (void) const;
+
+
+  /**
+   * \brief Get the state of the CoDel algorithm applied to the inline FIFO
+   * \return the CoDel state
+   */
+  CoDelState& GetCoDelState (void);
+
+
+  /**
+   * \brief Reset the state of the CoDel algorithm applied to the inline FIFO
+   */
+  void ResetCoDelState (void);
+
+
 private:
+  /**
+   * \brief Double the capacity of the circular buffer storing the inline FIFO
+   */
+  void InlineGrow (void);
+
   uint32_t m_deficit;   //!< the deficit for this flow
   FlowStatus m_status; //!< the status of this flow
+  uint32_t m_quantum;   //!< the quantum of this flow
+  uint32_t m_index;     //!< the index of this flow among the queue disc classes
+  uint32_t m_backlog;   //!< the backlog of this flow, as recorded in the backlog index
+  uint32_t m_backlogPosition; //!< the position of this flow in the backlog index
+  DRRFlow *m_next;      //!< the next flow in the ring of active (or idle) flows
+  DRRFlow *m_prev;      //!< the previous flow in the ring of active (or idle) flows
+  uint32_t m_bucket;    //!< the hash bucket this flow is assigned to
+  Time m_idleSince;     //!< the time this flow became inactive
+  std::vector<Ptr<QueueDiscItem> > m_items; //!< Circular buffer storing the inline FIFO
+  uint32_t m_head;      //!< the position of the head packet in the circular buffer
+  uint32_t m_nPackets;  //!< the number of packets in the inline FIFO
+  uint32_t m_nBytes;    //!< the number of bytes in the inline FIFO
+  CoDelState m_codel;   //!< the CoDel state of the inline FIFO
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief The filter of the DRR and BFDRR queue discs for non-IP packets
+ *
+ * The filter hashes the L3 protocol number and the destination address of
+ * any item (e.g., ARP packets) by means of its FlowHasher, so that the
+ * non-IP traffic is not merged into the bucket of the unclassified packets.
+ * As it matches any item, it has to be added after the IP filters.
+ */
+class DRRNonIpPacketFilter : public PacketFilter
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  DRRNonIpPacketFilter ();
+  virtual ~DRRNonIpPacketFilter ();
+
+  /**
+   * \brief Get the hash engine of the filter
+   * \return the hash engine
+   */
+  Ptr<FlowHasher> GetFlowHasher (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual bool CheckProtocol (Ptr<QueueDiscItem> item) const;
+  virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
+
+  Ptr<FlowHasher> m_hasher;     //!< Hash engine
 };
 
 
@@ -143,38 +400,406 @@ public:
  */
   uint32_t GetQuantum (void) const;
 
+  /**
+   * \enum FlowQueueDiscType
+   * \brief Used to determine the type of the queue disc of each flow
+   */
+  enum FlowQueueDiscType
+  {
+    FLOW_FIFO,         //!< FifoQueueDisc
+    FLOW_CODEL,        //!< CoDelQueueDisc
+    FLOW_PIE,          //!< PieQueueDisc
+    FLOW_RED           //!< RedQueueDisc
+  };
+
+  /**
+   * \enum WeightKey
+   * \brief Used to determine the key of the weight of a flow
+   */
+  enum WeightKey
+  {
+    WEIGHT_NONE,       //!< All the flows get the same quantum
+    WEIGHT_BY_CLASS,   //!< Flow queue index, i.e., the packet filter result modulo the number of flows
+    WEIGHT_BY_FLOW_TYPE, //!< Flow type carried by the FlowTag of the packet
+    WEIGHT_BY_DSCP     //!< DSCP of the packet
+  };
+
+  /**
+   * \brief Get the weight of the flow a packet belongs to
+   * \param weights the weights of the flows
+   * \param key the key used to look up the weight
+   * \param item the packet that activates the flow
+   * \param index the class of the packet, i.e., the index of the flow queue
+   *        of a direct-mapped flow table (not the way of a set-associative one)
+   * \return the weight of the flow, 1 if not found in the weights
+   */
+  static uint32_t GetWeight (const DRRWeightMap &weights, WeightKey key,
+                             Ptr<const QueueDiscItem> item, uint32_t index);
+
+  /**
+   * \brief Create a select queue callback steering the packets of a flow to
+   *        the same transmission queue of a multi-queue device
+   *
+   * The callback classifies the packets with the DRR packet filters and maps
+   * the flow hash to a transmission queue. The hash is cached in the packet,
+   * so that a DRRQueueDisc installed (e.g., as a child of an MqQueueDisc) on
+   * the selected transmission queue does not compute it again. Packets not
+   * classified by any filter are sent to the first transmission queue.
+   *
+   * \param nTxQueues the number of transmission queues of the device
+   * \return the select queue callback
+   */
+  static NetDeviceQueueInterface::SelectQueueCallback MakeFlowHashSelectQueueCallback (std::size_t nTxQueues);
+
+  /**
+   * \brief Hand a packet over to the queue disc from a thread other than the
+   *        simulator thread, e.g., the reader thread of an emulated device.
+   *
+   * The packet is stored in a lock-free single-producer/single-consumer ring,
+   * which the simulator thread drains in batches (the first packet pushed after
+   * a drain schedules the next drain). The flow hash of IP packets is computed
+   * by the calling thread (see DRRIpv4PacketFilter::SetDefaultFlowHash), so
+   * that, when the simulator thread drains the ring, the filters configured
+   * with the default hash engine just read it from the item before the packet
+   * is enqueued into its flow. The reference counts are
+   * not thread safe, hence the ring takes over the reference held by \p item
+   * and the calling thread must not hold any other reference to the packet.
+   * Only one thread may call this method. Requires EnqueueRingSize > 0.
+   *
+   * \param item the packet, set to null if it has been taken
+   * \return false if the ring is full, in which case the packet is not taken
+   */
+  bool ProducerEnqueue (Ptr<QueueDiscItem> &item);
+
+  /**
+   * \brief Get the estimated memory used by the flows, excluding the packets
+   * \return the number of flows times the estimated footprint of a flow, in bytes
+   */
+  uint64_t GetFlowMemory (void) const;
+
+  /**
+   * \brief Get the number of new flows given a way of a set of the flow table
+   *        that already held other flows (i.e., the collisions a direct-mapped
+   *        table would have had)
+   * \return the number of collisions avoided
+   */
+  uint64_t GetNCollisionsAvoided (void) const;
+
+  /**
+   * \brief Get the number of inactive flows of the flow table reassigned to a
+   *        new flow because all the ways of its set were taken
+   * \return the number of evictions
+   */
+  uint64_t GetNFlowEvictions (void) const;
+
+  /**
+   * \brief Get the number of new flows that shared a way with another flow
+   *        because all the ways of its set were taken by backlogged flows
+   * \return the number of merges
+   */
+  uint64_t GetNFlowMerges (void) const;
+
+  /**
+   * \brief Get the number of events scheduled to wake the queue disc up when
+   *        the token bucket allows the next packet to be sent
+   * \return the number of wake events
+   */
+  uint64_t GetNWakeEvents (void) const;
+
+  /**
+   * TracedCallback signature for flow creation and reclamation events.
+   *
+   * \param [in] index The index of the flow.
+   * \param [in] bucket The hash bucket the flow is created for or reclaimed
+   *             from, or a value larger than the number of flows if none.
+   */
+  typedef void (* FlowTracedCallback)(uint32_t index, uint32_t bucket);
+
   // Reasons for dropping packets
   static constexpr const char* UNCLASSIFIED_DROP = "Unclassified drop";  //!< No packet filter able to classify packet
   static constexpr const char* OVERLIMIT_DROP = "Overlimit drop";        //!< Overlimit dropped packets
+  static constexpr const char* TARGET_EXCEEDED_DROP = "Target exceeded drop";  //!< Sojourn time above target (inline CoDel)
+  static constexpr const char* FLOW_MEMORY_DROP = "Flow memory limit drop";  //!< No flow available within the flow memory limit
+
 
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
 
 private:
   virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
   virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual void DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items);
   virtual Ptr<const QueueDiscItem> DoPeek (void) const;
   virtual bool CheckConfig (void);
   virtual void InitializeParams (void);
 
+  /**
+   * \brief Enqueue all the packets in the enqueue ring and run the queue disc
+   */
+  void DrainEnqueueRing (void);
+
+  /**
+   * \brief Serve the active flows in deficit round robin order until the given
+   *        number of packets or bytes is dequeued or no flow is active, in a
+   *        single walk of the ring of the active flows
+   * \param n the maximum number of packets to dequeue
+   * \param maxBytes the number of bytes after which no more packets are dequeued
+   * \param items the vector the dequeued packets are appended to, if not null
+   * \return the last dequeued packet, if the number of packets or bytes was
+   *         reached, or 0
+   */
+  Ptr<QueueDiscItem> DequeueFromActiveFlows (uint32_t n, uint32_t maxBytes,
+                                             std::vector<Ptr<QueueDiscItem> > *items);
+
+  /**
+   * \brief Check whether the token bucket allows a packet to be sent now and,
+   *        if it does not, schedule the queue disc to be run when it does,
+   *        unless a wake event is pending already
+   * \param size the size of the packet, in bytes
+   * \return true if the packet can be sent now
+   */
+  bool ShaperConforms (uint32_t size);
+
+  /**
+   * \brief Take the tokens of a packet that is sent from the token bucket
+   * \param size the size of the packet, in bytes
+   */
+  void ShaperConsume (uint32_t size);
+
   /**
    * \brief Drop a packet from the tail of the queue with the largest current byte count (Packet Stealing)
    * \return the index of the queue with the largest current byte count
    */
   uint32_t DRRDrop (void);
 
+  /**
+   * \brief Refresh the backlog of the given flow and restore the backlog index order
+   * \param flow the flow whose backlog may have changed
+   *
+   * Must be called after every operation that may change the number of bytes
+   * stored in the flow queue (enqueue, dequeue, peek or drop).
+   */
+  void UpdateBacklog (DRRFlow *flow);
+
+  /**
+   * \brief Get the packet at the head of a flow, without removing it. The
+   *        AQM of the flow may drop packets to find the head packet.
+   * \param flow the flow
+   * \return the head packet, or 0 if the flow is empty
+   */
+  Ptr<const QueueDiscItem> FlowPeek (DRRFlow *flow);
+
+  /**
+   * \brief Remove the packet at the head of a flow
+   * \param flow the flow
+   * \return the head packet, or 0 if the flow is empty
+   */
+  Ptr<QueueDiscItem> FlowDequeue (DRRFlow *flow);
+
+  /**
+   * \brief Get the number of packets stored by a flow
+   * \param flow the flow
+   * \return the number of packets
+   */
+  uint32_t GetFlowNPackets (DRRFlow *flow) const;
+
+  /**
+   * \brief Get the number of bytes stored by a flow
+   * \param flow the flow
+   * \return the number of bytes
+   */
+  uint32_t GetFlowNBytes (DRRFlow *flow) const;
+
+  /**
+   * \brief Run CoDel on the head of the inline FIFO of a flow, as the CoDel
+   *        queue disc does on dequeue, and leave the surviving packet at the head
+   * \param flow the flow
+   */
+  void InlineCoDel (DRRFlow *flow);
+
+  /**
+   * \brief Check whether CoDel may drop a packet of an inline FIFO
+   * \param flow the flow the packet was removed from
+   * \param item the packet
+   * \param now the current time, in CoDel time units
+   * \return true if the packet may be dropped
+   */
+  bool InlineCoDelOkToDrop (DRRFlow *flow, Ptr<QueueDiscItem> item, uint32_t now);
+
+  /**
+   * \brief Drop a packet removed from an inline FIFO
+   * \param item the packet
+   * \param reason the reason why the packet is dropped
+   */
+  void InlineDrop (Ptr<QueueDiscItem> item, const char* reason);
+
+  /**
+   * \brief Credit the active flows with all the rounds that would be completed
+   *        before the next packet can be served. Called after a whole round in
+   *        which no active flow had enough deficit to send its head packet.
+   */
+  void CatchUpRounds (void);
+
+  /**
+   * \brief Append a flow to the tail of the ring of active flows, i.e., just
+   *        before the flow the round robin pointer is at
+   * \param flow the flow to append
+   */
+  void AddActiveFlow (DRRFlow *flow);
+
+  /**
+   * \brief Unlink a flow from the ring of active flows. If the round robin
+   *        pointer is at this flow, it moves to the next flow.
+   * \param flow the flow to unlink
+   */
+  void RemoveActiveFlow (DRRFlow *flow);
+
+  /**
+   * \brief Set a flow that has no more packets as INACTIVE. If flows are
+   *        recycled or their memory is bounded, the flow is appended to the
+   *        ring of idle flows.
+   * \param flow the flow
+   */
+  void DeactivateFlow (DRRFlow *flow);
+
+  /**
+   * \brief Create a flow, along with its queue disc if flows do not use
+   *        inline FIFOs
+   * \param bucket the hash bucket the flow is created for
+   * \return the new flow
+   */
+  Ptr<DRRFlow> CreateFlow (uint32_t bucket);
+
+  /**
+   * \brief Look up the way of the set-associative flow table holding the flow
+   *        of a packet. A new flow takes an empty way, or else the way of the
+   *        flow inactive for the longest time, or else shares a way, which it
+   *        keeps until the way has no packets left.
+   * \param item the packet
+   * \param hash the classification of the packet
+   * \return the hash bucket of the flow, i.e., the index of the way
+   */
+  uint32_t LookupFlowWay (Ptr<const QueueDiscItem> item, uint32_t hash);
+
+  /**
+   * \brief Get a flow for a hash bucket that has none. The flow is taken from
+   *        the free list, or recycled from the flows idle for longer than the
+   *        idle timeout, or created. If creating a flow would exceed the flow
+   *        memory limit, the flow idle for the longest time is recycled.
+   * \param bucket the hash bucket that needs a flow
+   * \return the flow, or 0 if no flow is available within the flow memory limit
+   */
+  Ptr<DRRFlow> GetFreeFlow (uint32_t bucket);
+
+  /**
+   * \brief Detach an idle flow from its hash bucket and unlink it from the
+   *        ring of idle flows
+   * \param flow the flow
+   * \return the flow, ready to be assigned to another hash bucket
+   */
+  Ptr<DRRFlow> ReclaimFlow (DRRFlow *flow);
+
+  /**
+   * \brief Move the flow idle for the longest time to the free list, if it
+   *        has been idle for longer than the idle timeout. Called on every
+   *        dequeue, so that idle flows are released at the rate they appear.
+   */
+  void ReclaimIdleFlows (void);
+
+  /**
+   * \brief Move the flow at the given position towards the root of the backlog index
+   * \param position the position of the flow in the backlog index
+   */
+  void BacklogSiftUp (uint32_t position);
+
+  /**
+   * \brief Move the flow at the given position towards the leaves of the backlog index
+   * \param position the position of the flow in the backlog index
+   */
+  void BacklogSiftDown (uint32_t position);
+
+  /**
+   * \brief Swap the flows at the given positions of the backlog index
+   * \param i the position of the first flow
+   * \param j the position of the second flow
+   */
+  void BacklogSwap (uint32_t i, uint32_t j);
+
   uint32_t m_packets;      //!< cumulative sum of packets across all flows
   uint32_t m_limit;              //!< Maximum number of bytes in the queue disc
   uint32_t m_quantum;        //!< total number of bytes that a flow can send
   uint32_t m_flows;          //!< Number of flow queues
-
-
-  std::list<Ptr<DRRFlow> > m_flowList;    //!< The list of flows
-
-  std::map<uint32_t, uint32_t> m_flowsIndices;    //!< Map with the index of class for each flow
+  uint32_t m_flowTableWays;  //!< Number of ways of each set of the flow table (1 means direct-mapped)
+  WeightKey m_weightKey;     //!< Key of the weight of a flow
+  bool m_inlineFlows;        //!< Whether the flows store their packets in an inline FIFO
+  FlowQueueDiscType m_flowQueueDiscType; //!< Type of the queue disc of each flow
+  uint32_t m_flowPoolSize;   //!< Number of flows created at initialization time
+  Time m_flowIdleTimeout;    //!< Time after which an idle flow can be recycled (0 disables recycling)
+  uint64_t m_maxFlowMemory;  //!< Maximum estimated memory of the flows, in bytes (0 means unbounded)
+  uint32_t m_flowFootprint;  //!< Estimated memory of a flow, excluding its packets, in bytes
+  uint32_t m_enqueueRingSize; //!< Capacity of the enqueue ring (0 disables it)
+  SpscRing<QueueDiscItem*> *m_enqueueRing; //!< Packets handed over by the producer thread, with one reference each
+  std::atomic<bool> m_drainPending;   //!< Whether a drain of the enqueue ring is scheduled
+  bool m_inlineCoDel;        //!< Whether CoDel is applied to the inline FIFOs
+  std::string m_interval;    //!< CoDel interval attribute
+  std::string m_target;      //!< CoDel target attribute
+  uint32_t m_codelInterval;  //!< CoDel interval of the inline FIFOs, in CoDel time units
+  uint32_t m_codelTarget;    //!< CoDel target of the inline FIFOs, in CoDel time units
+  DRRWeightMap m_weights;    //!< Weights of the flows, in quanta
+  DataRate m_rate;           //!< Rate at which tokens enter the bucket (0 disables shaping)
+  uint32_t m_burst;          //!< Size of the token bucket, in bytes
+  Time m_bucketEmpty;        //!< Time at which the token bucket had, or will have, no tokens
+  EventId m_wakeEvent;       //!< Event waking the queue disc up when the next packet conforms
+  uint64_t m_nWakeEvents;    //!< Number of wake events scheduled
+
+
+  DRRFlow *m_activeFlow;   //!< The flow the round robin pointer is at, in the ring of active flows
+  DRRFlow *m_idleFlows;    //!< The flow idle for the longest time, in the ring of idle flows
+  bool m_activeFlowCredited; //!< Whether the flow the round robin pointer is at got its quantum for this visit
+
+  std::vector<Ptr<DRRFlow> > m_flowTable;    //!< Flow queue of each hash bucket (null until the first packet)
+  std::vector<uint64_t> m_flowTags;          //!< Identifier of the flow of each way of the set-associative flow table
+  std::vector<std::vector<uint64_t> > m_mergedFlows; //!< Identifiers of the flows sharing each way, until the way drains
+  uint64_t m_nCollisionsAvoided;  //!< Number of new flows given a way of a set holding other flows
+  uint64_t m_nFlowEvictions;      //!< Number of inactive flows reassigned to a new flow
+  uint64_t m_nFlowMerges;         //!< Number of new flows sharing a way with a backlogged flow
+
+  std::vector<DRRFlow*> m_backlogIndex;    //!< Max-heap of the flows, keyed by their backlog in bytes
+
+  std::vector<Ptr<DRRFlow> > m_flowPool;    //!< Free list of the flows not assigned to any hash bucket
+
+  TracedCallback<uint32_t, uint32_t> m_flowCreatedTrace;   //!< Traced callback for flow creation
+  TracedCallback<uint32_t, uint32_t> m_flowReclaimedTrace; //!< Traced callback for flow reclamation
 
   ObjectFactory m_flowFactory;         //!< Factory to create a new flow
   ObjectFactory m_queueDiscFactory; //!< Factory to create a new queue
 };
 
+/**
+ * Serialize the weight map to the given ostream
+ *
+ * \param os
+ * \param weights
+ *
+ * \return std::ostream
+ */
+std::ostream &operator << (std::ostream &os, const DRRWeightMap &weights);
+
+/**
+ * Serialize from the given istream to this weight map.
+ *
+ * \param is
+ * \param weights
+ *
+ * \return std::istream
+ */
+std::istream &operator >> (std::istream &is, DRRWeightMap &weights);
+
+ATTRIBUTE_HELPER_HEADER (DRRWeightMap);
+
 } // namespace ns3
 
 #endif /* DRR_QUEUE_DISC */
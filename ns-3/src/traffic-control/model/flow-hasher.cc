@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/hash.h"
+#include "flow-hasher.h"
+#include <unordered_set>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FlowHasher");
+
+NS_OBJECT_ENSURE_REGISTERED (FlowHasher);
+
+TypeId
+FlowHasher::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FlowHasher")
+    .SetParent<Object> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<FlowHasher> ()
+    .AddAttribute ("Engine",
+                   "The hash engine",
+                   EnumValue (MURMUR3),
+                   MakeEnumAccessor (&FlowHasher::m_engine),
+                   MakeEnumChecker (MURMUR3, "Murmur3",
+                                    FNV1A, "Fnv1a",
+                                    SIPHASH, "SipHash",
+                                    TOEPLITZ, "Toeplitz"))
+    .AddAttribute ("Key",
+                   "The key of the SipHash engine",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FlowHasher::m_key),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("TrackCollisions",
+                   "Whether to record the hashes of the flows to compute the collision rate",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FlowHasher::m_trackCollisions),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+FlowHasher::FlowHasher ()
+  : m_engine (MURMUR3),
+    m_key (0),
+    m_trackCollisions (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+FlowHasher::~FlowHasher ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+FlowHasher::GetHash (const uint8_t *tuple, uint32_t tupleLen,
+                     const uint8_t *rss, uint32_t rssLen)
+{
+  NS_LOG_FUNCTION (this << tupleLen << rssLen);
+
+  uint32_t hash = 0;
+  switch (m_engine)
+    {
+    case MURMUR3:
+      hash = GetDefaultHash (tuple, tupleLen);
+      break;
+    case FNV1A:
+      m_fnv.clear ();
+      hash = m_fnv.GetHash32 ((const char*) tuple, tupleLen);
+      break;
+    case SIPHASH:
+      {
+        uint64_t h = SipHash24 (tuple, tupleLen, m_key, m_key ^ 0x736f6d6570736575ULL);
+        hash = (uint32_t) (h ^ (h >> 32));
+      }
+      break;
+    case TOEPLITZ:
+      hash = Toeplitz (rss, rssLen);
+      break;
+    }
+
+  if (m_trackCollisions)
+    {
+      m_flowHashes[GetFlowId (tuple, tupleLen)] = hash;
+    }
+
+  return hash;
+}
+
+uint32_t
+FlowHasher::GetSalt (void) const
+{
+  if (m_engine == MURMUR3)
+    {
+      return 0;
+    }
+  uint64_t conf[2] = { (uint64_t) m_engine, m_engine == SIPHASH ? m_key : 0 };
+  return Hash32 ((const char*) conf, sizeof (conf)) | 1;
+}
+
+bool
+FlowHasher::IsCacheable (void) const
+{
+  return !m_trackCollisions;
+}
+
+uint32_t
+FlowHasher::GetNTrackedFlows (void) const
+{
+  return m_flowHashes.size ();
+}
+
+uint32_t
+FlowHasher::GetNCollisions (uint32_t buckets) const
+{
+  NS_LOG_FUNCTION (this << buckets);
+  NS_ASSERT (buckets > 0);
+
+  std::unordered_set<uint32_t> occupied;
+  for (auto &flow : m_flowHashes)
+    {
+      occupied.insert (flow.second % buckets);
+    }
+  return m_flowHashes.size () - occupied.size ();
+}
+
+double
+FlowHasher::GetCollisionRate (uint32_t buckets) const
+{
+  NS_LOG_FUNCTION (this << buckets);
+
+  if (m_flowHashes.empty ())
+    {
+      return 0;
+    }
+  return static_cast<double> (GetNCollisions (buckets)) / m_flowHashes.size ();
+}
+
+void
+FlowHasher::ResetCollisionStats (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_flowHashes.clear ();
+}
+
+uint64_t
+FlowHasher::GetFlowId (const uint8_t *tuple, uint32_t tupleLen)
+{
+  // a local hash function rather than the one shared by Hash64, which is
+  // not thread safe (same value, as Hash64 uses Murmur3 as well)
+  Hash::Function::Murmur3 murmur3;
+  return murmur3.GetHash64 ((const char*) tuple, tupleLen);
+}
+
+uint32_t
+FlowHasher::GetDefaultHash (const uint8_t *tuple, uint32_t tupleLen)
+{
+  Hash::Function::Murmur3 murmur3;
+  return murmur3.GetHash32 ((const char*) tuple, tupleLen);
+}
+
+/**
+ * Rotate a 64-bit word to the left
+ * \param x the word
+ * \param b the number of bits
+ * \return the rotated word
+ */
+static inline uint64_t
+SipRotl (uint64_t x, uint32_t b)
+{
+  return (x << b) | (x >> (64 - b));
+}
+
+/**
+ * Perform a SipHash round on the internal state
+ * \param v the internal state
+ */
+static inline void
+SipRound (uint64_t v[4])
+{
+  v[0] += v[1]; v[1] = SipRotl (v[1], 13); v[1] ^= v[0]; v[0] = SipRotl (v[0], 32);
+  v[2] += v[3]; v[3] = SipRotl (v[3], 16); v[3] ^= v[2];
+  v[0] += v[3]; v[3] = SipRotl (v[3], 21); v[3] ^= v[0];
+  v[2] += v[1]; v[1] = SipRotl (v[1], 17); v[1] ^= v[2]; v[2] = SipRotl (v[2], 32);
+}
+
+uint64_t
+FlowHasher::SipHash24 (const uint8_t *buf, uint32_t len, uint64_t k0, uint64_t k1)
+{
+  uint64_t v[4] = { 0x736f6d6570736575ULL ^ k0, 0x646f72616e646f6dULL ^ k1,
+                    0x6c7967656e657261ULL ^ k0, 0x7465646279746573ULL ^ k1 };
+
+  uint32_t i = 0;
+  for (; i + 8 <= len; i += 8)
+    {
+      uint64_t m = 0;
+      for (uint32_t j = 0; j < 8; j++)
+        {
+          m |= (uint64_t) buf[i + j] << (8 * j);
+        }
+      v[3] ^= m;
+      SipRound (v);
+      SipRound (v);
+      v[0] ^= m;
+    }
+
+  // the last word holds the remaining bytes and the length of the buffer
+  uint64_t m = (uint64_t) (len & 0xff) << 56;
+  for (uint32_t j = 0; i + j < len; j++)
+    {
+      m |= (uint64_t) buf[i + j] << (8 * j);
+    }
+  v[3] ^= m;
+  SipRound (v);
+  SipRound (v);
+  v[0] ^= m;
+
+  v[2] ^= 0xff;
+  for (uint32_t r = 0; r < 4; r++)
+    {
+      SipRound (v);
+    }
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+/// The maximum length of the input of the Toeplitz hash (IPv6 addresses and ports)
+static const uint32_t TOEPLITZ_MAX_INPUT = 36;
+
+/**
+ * Get the tables of the Toeplitz hash with the default RSS key. Entry
+ * [i][b] is the contribution to the hash of byte value b at position i
+ * of the input, i.e., the XOR of the 32-bit windows of the key starting at
+ * the bits of the input set in b.
+ * \return the tables, computed on the first call
+ */
+static const std::vector<uint32_t> &
+GetToeplitzTables (void)
+{
+  static std::vector<uint32_t> tables;
+  if (tables.empty ())
+    {
+      // the default RSS key of the Microsoft specification
+      static const uint8_t key[TOEPLITZ_MAX_INPUT + 4] = {
+        0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+        0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+        0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+        0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+        0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+      };
+
+      tables.resize (TOEPLITZ_MAX_INPUT * 256);
+      for (uint32_t i = 0; i < TOEPLITZ_MAX_INPUT; i++)
+        {
+          // the 32-bit windows of the key starting at the 8 bits of byte i
+          uint64_t bits = ((uint64_t) key[i] << 32) | ((uint64_t) key[i + 1] << 24)
+            | ((uint64_t) key[i + 2] << 16) | ((uint64_t) key[i + 3] << 8) | key[i + 4];
+          uint32_t window[8];
+          for (uint32_t j = 0; j < 8; j++)
+            {
+              window[j] = (uint32_t) (bits >> (8 - j));
+            }
+          for (uint32_t b = 0; b < 256; b++)
+            {
+              uint32_t value = 0;
+              for (uint32_t j = 0; j < 8; j++)
+                {
+                  if (b & (0x80 >> j))
+                    {
+                      value ^= window[j];
+                    }
+                }
+              tables[i * 256 + b] = value;
+            }
+        }
+    }
+  return tables;
+}
+
+uint32_t
+FlowHasher::Toeplitz (const uint8_t *buf, uint32_t len)
+{
+  NS_ASSERT_MSG (len <= TOEPLITZ_MAX_INPUT, "The input of the Toeplitz hash is too long");
+
+  const std::vector<uint32_t> &tables = GetToeplitzTables ();
+  uint32_t hash = 0;
+  for (uint32_t i = 0; i < len; i++)
+    {
+      hash ^= tables[i * 256 + buf[i]];
+    }
+  return hash;
+}
+
+} // namespace ns3
@@ -0,0 +1,191 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_HASHER_H
+#define FLOW_HASHER_H
+
+#include "ns3/object.h"
+#include "ns3/hash-fnv.h"
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief The hash engine of the flow queue disc packet filters
+ *
+ * A FlowHasher computes the hash of the flow identifier (e.g., the 5-tuple)
+ * serialized by a packet filter, with one of the following engines:
+ *
+ * - MURMUR3: the murmur3 hash, as computed by ns3::Hash32 (default)
+ * - FNV1A: the 32-bit Fowler-Noll-Vo hash
+ * - SIPHASH: the SipHash-2-4 keyed hash, folded to 32 bits. The key is set
+ *   by the Key attribute, so that the mapping of flows to buckets cannot be
+ *   predicted by the sources
+ * - TOEPLITZ: the Toeplitz hash with the default RSS key, i.e., the hash
+ *   computed by the NICs supporting Receive Side Scaling. The hash is
+ *   computed by means of tables precomputed for each byte of the input
+ *
+ * The filters pass two serializations of the flow identifier: the complete
+ * one, hashed by all the engines but TOEPLITZ, and the RSS one (addresses
+ * and ports, in this order), hashed by TOEPLITZ.
+ *
+ * If the TrackCollisions attribute is set, the hasher also records the hash
+ * of every distinct flow identifier it is passed, so that the fraction of
+ * flows sharing a bucket with another flow can be computed for any number of
+ * buckets (see GetCollisionRate). The memory used grows with the number of
+ * flows, hence tracking is disabled by default.
+ */
+class FlowHasher : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief The hash engines
+   */
+  enum Engine
+  {
+    MURMUR3,
+    FNV1A,
+    SIPHASH,
+    TOEPLITZ
+  };
+
+  FlowHasher ();
+  virtual ~FlowHasher ();
+
+  /**
+   * \brief Compute the hash of a flow identifier
+   * \param tuple the complete serialization of the flow identifier
+   * \param tupleLen the length of tuple
+   * \param rss the RSS serialization of the flow identifier
+   * \param rssLen the length of rss (at most 36 bytes)
+   * \return the hash
+   */
+  uint32_t GetHash (const uint8_t *tuple, uint32_t tupleLen,
+                    const uint8_t *rss, uint32_t rssLen);
+
+  /**
+   * \brief Get the salt of the configuration of the hasher
+   *
+   * The salt is zero for the default configuration (MURMUR3) and differs
+   * among configurations producing different hashes. The filters combine it
+   * with the key of the hashes they cache, so that a hash is only reused by
+   * a filter configured in the same way.
+   *
+   * \return the salt
+   */
+  uint32_t GetSalt (void) const;
+
+  /**
+   * \brief Check whether the hashes computed by this hasher may be cached
+   *
+   * Hashes are not cached while collisions are tracked, as every flow
+   * identifier needs to be seen by the hasher.
+   *
+   * \return true if the filters may reuse the hashes cached in the packets
+   */
+  bool IsCacheable (void) const;
+
+  /**
+   * \brief Get the number of distinct flows tracked
+   * \return the number of distinct flow identifiers hashed since tracking started
+   */
+  uint32_t GetNTrackedFlows (void) const;
+
+  /**
+   * \brief Get the number of tracked flows colliding with another one
+   * \param buckets the number of buckets (e.g., the Flows attribute of DRR)
+   * \return the number of tracked flows minus the number of buckets they occupy
+   */
+  uint32_t GetNCollisions (uint32_t buckets) const;
+
+  /**
+   * \brief Get the collision rate of the tracked flows
+   * \param buckets the number of buckets (e.g., the Flows attribute of DRR)
+   * \return the fraction of the tracked flows sharing a bucket with another flow
+   */
+  double GetCollisionRate (uint32_t buckets) const;
+
+  /**
+   * \brief Forget the tracked flows
+   */
+  void ResetCollisionStats (void);
+
+  /**
+   * \brief Compute the identifier of a flow
+   *
+   * The identifier is a 64-bit fingerprint of the complete serialization of
+   * the flow identifier, which does not depend on the engine. Distinct flows
+   * have the same identifier with negligible probability. Like
+   * GetDefaultHash, it may be called by any thread.
+   *
+   * \param tuple the complete serialization of the flow identifier
+   * \param tupleLen the length of tuple
+   * \return the flow identifier
+   */
+  static uint64_t GetFlowId (const uint8_t *tuple, uint32_t tupleLen);
+
+  /**
+   * \brief Compute the hash of a flow identifier with the default
+   *        configuration (MURMUR3), i.e., the hash the filters cache in the items
+   *
+   * Unlike GetHash, no state is shared with other callers, hence this method
+   * may be called by threads other than the simulator thread (e.g., to hash
+   * the packets handed over to DRRQueueDisc::ProducerEnqueue).
+   *
+   * \param tuple the complete serialization of the flow identifier
+   * \param tupleLen the length of tuple
+   * \return the hash
+   */
+  static uint32_t GetDefaultHash (const uint8_t *tuple, uint32_t tupleLen);
+
+  /**
+   * \brief Compute the SipHash-2-4 of a buffer
+   * \param buf the buffer
+   * \param len the length of the buffer
+   * \param k0 the first half of the key
+   * \param k1 the second half of the key
+   * \return the 64-bit hash
+   */
+  static uint64_t SipHash24 (const uint8_t *buf, uint32_t len, uint64_t k0, uint64_t k1);
+
+  /**
+   * \brief Compute the Toeplitz hash of a buffer with the default RSS key
+   * \param buf the buffer
+   * \param len the length of the buffer (at most 36 bytes)
+   * \return the hash
+   */
+  static uint32_t Toeplitz (const uint8_t *buf, uint32_t len);
+
+private:
+  Engine m_engine;                 //!< Hash engine
+  uint64_t m_key;                  //!< Key of the keyed engines
+  bool m_trackCollisions;          //!< True if the hashes of the flows are recorded
+  Hash::Function::Fnv1a m_fnv;     //!< FNV-1a implementation
+  /// Hash of each tracked flow, indexed by its flow identifier
+  std::unordered_map<uint64_t, uint32_t> m_flowHashes;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_HASHER_H */
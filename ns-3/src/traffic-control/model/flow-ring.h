@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_RING_H
+#define FLOW_RING_H
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * The rings of flows (or tenants) served in round robin order by the DRR
+ * queue discs are circular doubly linked lists threaded through the flows,
+ * which provide the GetNext, SetNext, GetPrev and SetPrev methods. A flow
+ * is in no ring if its next pointer is null.
+ */
+
+/**
+ * \ingroup traffic-control
+ *
+ * Appends a flow to the tail of a ring of flows, i.e., just before its head
+ * \param head the head of the ring (0 if the ring is empty)
+ * \param flow the flow to append
+ */
+template <typename T>
+void
+RingAppend (T *&head, T *flow)
+{
+  if (!head)
+    {
+      flow->SetNext (flow);
+      flow->SetPrev (flow);
+      head = flow;
+      return;
+    }
+
+  T *tail = head->GetPrev ();
+  flow->SetPrev (tail);
+  flow->SetNext (head);
+  tail->SetNext (flow);
+  head->SetPrev (flow);
+}
+
+/**
+ * \ingroup traffic-control
+ *
+ * Unlinks a flow from a ring of flows. If the flow is the head of the ring,
+ * the next flow becomes the head.
+ * \param head the head of the ring
+ * \param flow the flow to unlink
+ */
+template <typename T>
+void
+RingRemove (T *&head, T *flow)
+{
+  if (flow->GetNext () == flow)
+    {
+      head = 0;
+    }
+  else
+    {
+      flow->GetPrev ()->SetNext (flow->GetNext ());
+      flow->GetNext ()->SetPrev (flow->GetPrev ());
+      if (head == flow)
+        {
+          head = flow->GetNext ();
+        }
+    }
+  flow->SetNext (0);
+  flow->SetPrev (0);
+}
+
+} // namespace ns3
+
+#endif /* FLOW_RING_H */
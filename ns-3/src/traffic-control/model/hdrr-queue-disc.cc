@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-packet-filter.h"
+#include "ns3/ipv6-packet-filter.h"
+#include "ns3/flow-ring.h"
+#include "hdrr-queue-disc.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("HDRRQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED (HDRRQueueDisc);
+
+TypeId HDRRQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HDRRQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<HDRRQueueDisc> ()
+    .AddAttribute ("MaxSize",
+                   "The maximum number of bytes accepted by this queue disc.",
+                   QueueSizeValue (QueueSize ("400KiB")),
+                   MakeQueueSizeAccessor (&QueueDisc::SetMaxSize,
+                                          &QueueDisc::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Tenants",
+                   "The number of hash buckets into which the tenants are classified",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&HDRRQueueDisc::m_tenants),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TenantQuantum",
+                   "The number of bytes credited to a tenant in each round",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&HDRRQueueDisc::m_tenantQuantum),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TenantShare",
+                   "The fraction of MaxSize the packets of a tenant can take",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&HDRRQueueDisc::m_tenantShare),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("TenantScheduler",
+                   "The scheduler of the flows of a tenant",
+                   EnumValue (TENANT_DRR),
+                   MakeEnumAccessor (&HDRRQueueDisc::m_tenantScheduler),
+                   MakeEnumChecker (TENANT_DRR, "Drr",
+                                    TENANT_FQ_CODEL, "FqCoDel"))
+    .AddAttribute ("FlowsPerTenant",
+                   "The number of queues into which the packets of a tenant are classified",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&HDRRQueueDisc::m_flowsPerTenant),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("FlowQuantum",
+                   "The number of bytes credited to a flow in each round of its tenant. "
+                   "Zero means the default quantum of DRR.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&HDRRQueueDisc::m_flowQuantum),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+HDRRQueueDisc::HDRRQueueDisc ()
+  : QueueDisc (QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::BYTES),
+    m_tenants (64),
+    m_tenantQuantum (1500),
+    m_flowsPerTenant (64),
+    m_flowQuantum (0),
+    m_tenantShare (1.0),
+    m_tenantScheduler (TENANT_DRR),
+    m_activeTenant (0),
+    m_activeTenantCredited (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+HDRRQueueDisc::~HDRRQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+HDRRQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the ring and the tenant table point to the tenants owned by the classes
+  m_activeTenant = 0;
+  m_activeTenantCredited = false;
+  m_tenantTable.clear ();
+  QueueDisc::DoDispose ();
+}
+
+uint32_t
+HDRRQueueDisc::GetNTenants (void) const
+{
+  return GetNQueueDiscClasses ();
+}
+
+Ptr<DRRFlow>
+HDRRQueueDisc::GetTenant (uint32_t bucket) const
+{
+  NS_ASSERT (bucket < m_tenantTable.size ());
+  return m_tenantTable[bucket];
+}
+
+bool
+HDRRQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+
+  int32_t ret = Classify (item);
+  uint32_t h;
+
+  if (ret == PacketFilter::PF_NO_MATCH)
+    {
+      NS_LOG_WARN ("No filter has been able to classify this packet.");
+      h = m_tenants; // place all unfiltered packets into a separate tenant
+    }
+  else
+    {
+      h = static_cast<uint32_t> (ret) % m_tenants;
+    }
+
+  if (GetCurrentSize () + item > GetMaxSize ())
+    {
+      NS_LOG_LOGIC ("Queue disc full -- dropping pkt");
+      DropBeforeEnqueue (item, LIMIT_EXCEEDED_DROP);
+      return false;
+    }
+
+  DRRFlow *tenant = m_tenantTable[h];
+  if (!tenant)
+    {
+      NS_LOG_INFO ("Creating a tenant class for hash bucket " << h);
+      tenant = PeekPointer (CreateTenant (h));
+      m_tenantTable[h] = tenant;
+    }
+
+  // the child may drop the packet, or a packet of its fattest flow, to stay
+  // within the share of the tenant
+  Ptr<QueueDisc> qd = tenant->GetQueueDisc ();
+  bool retval = qd->Enqueue (item);
+
+  if (tenant->GetStatus () == DRRFlow::INACTIVE && qd->GetNPackets () > 0)
+    {
+      NS_LOG_DEBUG ("Setting tenant " << h << " as ACTIVE");
+      tenant->SetStatus (DRRFlow::ACTIVE);
+      RingAppend (m_activeTenant, tenant);
+    }
+
+  return retval;
+}
+
+Ptr<QueueDiscItem>
+HDRRQueueDisc::DoDequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (m_activeTenant)
+    {
+      DRRFlow *tenant = m_activeTenant;
+      if (!m_activeTenantCredited)
+        {
+          tenant->IncreaseDeficit (tenant->GetQuantum ());
+          m_activeTenantCredited = true;
+        }
+
+      Ptr<QueueDisc> qd = tenant->GetQueueDisc ();
+      // the child holds the peeked packet until it is dequeued
+      Ptr<const QueueDiscItem> head = qd->Peek ();
+
+      if (!head)
+        {
+          NS_LOG_DEBUG ("Tenant emptied by the AQM of its flows, Setting it to INACTIVE");
+          DeactivateTenant (tenant);
+          continue;
+        }
+
+      if ((uint32_t) tenant->GetDeficit () >= head->GetSize ())
+        {
+          Ptr<QueueDiscItem> item = qd->Dequeue ();
+          tenant->IncreaseDeficit (-item->GetSize ());
+          NS_LOG_DEBUG ("Dequeued packet " << item->GetPacket () << " from tenant " << tenant->GetIndex ());
+
+          if (qd->GetNPackets () == 0)
+            {
+              NS_LOG_DEBUG ("Empty tenant, Setting it to INACTIVE");
+              DeactivateTenant (tenant);
+            }
+          return item;
+        }
+
+      NS_LOG_DEBUG ("Packet size greater than deficit, moving the round robin pointer to the next tenant");
+      m_activeTenant = tenant->GetNext ();
+      m_activeTenantCredited = false;
+    }
+
+  NS_LOG_DEBUG ("No active tenants found");
+  return 0;
+}
+
+bool
+HDRRQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (GetNQueueDiscClasses () > 0)
+    {
+      NS_LOG_ERROR ("HDRRQueueDisc cannot have classes");
+      return false;
+    }
+
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("HDRRQueueDisc cannot have internal queues");
+      return false;
+    }
+
+  if (GetMaxSize ().GetUnit () != QueueSizeUnit::BYTES)
+    {
+      NS_LOG_ERROR ("The maximum size of HDRRQueueDisc must be in bytes");
+      return false;
+    }
+
+  if (m_tenantShare <= 0)
+    {
+      NS_LOG_ERROR ("The share of a tenant must be positive");
+      return false;
+    }
+
+  if (GetNPacketFilters () == 0)
+    {
+      AddPacketFilter (CreateObject<HDRRIpv4TenantPacketFilter> ());
+      AddPacketFilter (CreateObject<HDRRIpv6TenantPacketFilter> ());
+    }
+
+  return true;
+}
+
+void
+HDRRQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // one slot per hash bucket, plus one for the packets no filter could classify
+  m_tenantTable.assign (m_tenants + 1, 0);
+
+  m_tenantFactory.SetTypeId ("ns3::DRRFlow");
+
+  m_queueDiscFactory.SetTypeId ("ns3::DRRQueueDisc");
+  m_queueDiscFactory.Set ("Flows", UintegerValue (m_flowsPerTenant));
+  m_queueDiscFactory.Set ("ByteLimit", UintegerValue (m_tenantShare * GetMaxSize ().GetValue ()));
+  switch (m_tenantScheduler)
+    {
+    case TENANT_DRR:
+      m_queueDiscFactory.Set ("FlowQueueDiscType", EnumValue (DRRQueueDisc::FLOW_FIFO));
+      break;
+    case TENANT_FQ_CODEL:
+      m_queueDiscFactory.Set ("InlineFlows", BooleanValue (true));
+      m_queueDiscFactory.Set ("InlineCoDel", BooleanValue (true));
+      break;
+    }
+}
+
+Ptr<DRRFlow>
+HDRRQueueDisc::CreateTenant (uint32_t bucket)
+{
+  NS_LOG_FUNCTION (this << bucket);
+
+  Ptr<DRRFlow> tenant = m_tenantFactory.Create<DRRFlow> ();
+  Ptr<DRRQueueDisc> qd = m_queueDiscFactory.Create<DRRQueueDisc> ();
+  if (m_flowQuantum)
+    {
+      qd->SetQuantum (m_flowQuantum);
+    }
+  qd->Initialize ();
+  tenant->SetQueueDisc (qd);
+  tenant->SetQuantum (m_tenantQuantum);
+  tenant->SetIndex (GetNQueueDiscClasses ());
+  tenant->SetBucket (bucket);
+  AddQueueDiscClass (tenant);
+  return tenant;
+}
+
+void
+HDRRQueueDisc::DeactivateTenant (DRRFlow *tenant)
+{
+  NS_LOG_FUNCTION (this << tenant);
+
+  tenant->SetDeficit (0);
+  tenant->SetStatus (DRRFlow::INACTIVE);
+  if (m_activeTenant == tenant)
+    {
+      m_activeTenantCredited = false;
+    }
+  RingRemove (m_activeTenant, tenant);
+}
+
+} // namespace ns3
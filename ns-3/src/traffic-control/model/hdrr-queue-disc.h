@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef HDRR_QUEUE_DISC
+#define HDRR_QUEUE_DISC
+
+#include "ns3/queue-disc.h"
+#include "ns3/drr-queue-disc.h"
+#include "ns3/object-factory.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief A hierarchical DRR packet queue disc
+ *
+ * HDRR schedules packets at two levels. The packet filters of the queue
+ * disc (by default, HDRRIpv4TenantPacketFilter and HDRRIpv6TenantPacketFilter,
+ * which classify packets by the prefix of their source address) select the
+ * tenant of a packet. Each tenant is a DRRFlow class whose child queue disc is
+ * a DRRQueueDisc, which in turn schedules the flows of the tenant. HDRR serves
+ * the active tenants in deficit round robin order with the TenantQuantum,
+ * and the child of the tenant being served picks the packet of one of its
+ * flows in deficit round robin order with the FlowQuantum.
+ *
+ * Each level keeps its own ring of active classes, so a dequeue costs a
+ * constant number of steps per level, regardless of the number of tenants
+ * and flows.
+ *
+ * The queue disc holds at most MaxSize bytes, and each tenant at most
+ * TenantShare times MaxSize, enforced by the byte limit of its child (which
+ * drops from the head of its fattest flow).
+ */
+class HDRRQueueDisc : public QueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief HDRRQueueDisc constructor
+   */
+  HDRRQueueDisc ();
+
+  virtual ~HDRRQueueDisc ();
+
+  /**
+   * \brief The scheduler of the flows of a tenant
+   */
+  enum TenantScheduler
+  {
+    TENANT_DRR,       //!< DRR across flows with a FIFO per flow
+    TENANT_FQ_CODEL   //!< DRR across flows with a CoDel FIFO per flow, as FQ-CoDel
+  };
+
+  /**
+   * \brief Get the number of tenants that have a class
+   * \return the number of tenant classes created
+   */
+  uint32_t GetNTenants (void) const;
+
+  /**
+   * \brief Get the class of the tenant of a hash bucket
+   * \param bucket the hash bucket of the tenant
+   * \return the class of the tenant, or 0 if no packet of the tenant was received
+   */
+  Ptr<DRRFlow> GetTenant (uint32_t bucket) const;
+
+  // Reasons for dropping packets
+  static constexpr const char* LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded";  //!< Packet dropped due to queue disc limit exceeded
+
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
+
+private:
+  virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual bool CheckConfig (void);
+  virtual void InitializeParams (void);
+
+  /**
+   * \brief Create the class of a tenant, along with its child queue disc
+   * \param bucket the hash bucket of the tenant
+   * \return the new tenant
+   */
+  Ptr<DRRFlow> CreateTenant (uint32_t bucket);
+
+  /**
+   * \brief Set a tenant that has no more packets as INACTIVE and unlink it
+   *        from the ring of active tenants
+   * \param tenant the tenant
+   */
+  void DeactivateTenant (DRRFlow *tenant);
+
+  uint32_t m_tenants;            //!< Number of tenant hash buckets
+  uint32_t m_tenantQuantum;      //!< Bytes credited to a tenant in each round
+  uint32_t m_flowsPerTenant;     //!< Number of flow hash buckets of each tenant
+  uint32_t m_flowQuantum;        //!< Bytes credited to a flow in each round of its tenant
+  double m_tenantShare;          //!< Fraction of MaxSize a tenant can hold
+  TenantScheduler m_tenantScheduler; //!< Scheduler of the flows of a tenant
+
+  std::vector<DRRFlow*> m_tenantTable; //!< Tenant of each hash bucket (null until the first packet)
+  DRRFlow *m_activeTenant;       //!< The tenant the round robin pointer is at, in the ring of active tenants
+  bool m_activeTenantCredited;   //!< Whether the tenant the round robin pointer is at got its quantum for this visit
+  ObjectFactory m_tenantFactory;     //!< Factory to create the tenant classes
+  ObjectFactory m_queueDiscFactory;  //!< Factory to create the child queue disc of a tenant
+};
+
+} // namespace ns3
+
+#endif /* HDRR_QUEUE_DISC */
@@ -230,6 +230,24 @@ bool PieQueueDisc::DropEarly (Ptr<QueueDiscItem> item, uint32_t qSize)
   return true;
 }
 
+void
+PieQueueDisc::DoReset (void)
+{
+  NS_LOG_FUNCTION (this);
+  InitializeParams ();
+  m_qDelay = Time (Seconds (0));
+  m_burstAllowance = Time (Seconds (0));
+  Simulator::Cancel (m_rtrsEvent);
+  m_rtrsEvent = Simulator::Schedule (m_sUpdate, &PieQueueDisc::CalculateP, this);
+}
+
+void
+PieQueueDisc::DoSuspend (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_rtrsEvent);
+}
+
 void PieQueueDisc::CalculateP ()
 {
   NS_LOG_FUNCTION (this);
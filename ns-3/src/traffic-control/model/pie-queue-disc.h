@@ -114,6 +114,16 @@ private:
    */
   virtual void InitializeParams (void);
 
+  /**
+   * \brief Initialize the queue parameters again and restart the update timer
+   */
+  virtual void DoReset (void);
+
+  /**
+   * \brief Cancel the update timer
+   */
+  virtual void DoSuspend (void);
+
   /**
    * \brief Check if a packet needs to be dropped due to probability drop
    * \param item queue item
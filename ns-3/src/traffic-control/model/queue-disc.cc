@@ -20,6 +20,7 @@
 #include "ns3/log.h"
 #include "ns3/abort.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/pointer.h"
 #include "ns3/object-vector.h"
 #include "ns3/packet.h"
@@ -29,11 +30,48 @@
 #include "queue-disc.h"
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/queue.h"
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <unordered_map>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("QueueDisc");
 
+#ifdef NS3_TC_LIGHTWEIGHT
+/// Default value of the Lightweight attribute (set by --enable-tc-lightweight)
+static const bool QUEUE_DISC_LIGHTWEIGHT_DEFAULT = true;
+#else
+/// Default value of the Lightweight attribute (set by --enable-tc-lightweight)
+static const bool QUEUE_DISC_LIGHTWEIGHT_DEFAULT = false;
+#endif
+
+/// The reason identifier of a child queue disc reason not seen yet
+static const uint32_t NO_REASON = std::numeric_limits<uint32_t>::max ();
+
+/**
+ * \ingroup traffic-control
+ *
+ * The registry of the drop and mark reasons, shared by all the queue discs
+ */
+struct QueueDiscReasonRegistry
+{
+  std::deque<std::string> names;                      //!< Name of each reason (a deque, so that names never move)
+  std::unordered_map<std::string, uint32_t> ids;      //!< Identifier of each name
+  std::unordered_map<const char*, uint32_t> pointers; //!< Identifier of the reason last seen at each address
+};
+
+/**
+ * \return the registry of the drop and mark reasons
+ */
+static QueueDiscReasonRegistry&
+GetQueueDiscReasonRegistry (void)
+{
+  static QueueDiscReasonRegistry registry;
+  return registry;
+}
+
 
 NS_OBJECT_ENSURE_REGISTERED (QueueDiscClass);
 
@@ -270,6 +308,27 @@ TypeId QueueDisc::GetTypeId (void)
                    MakeUintegerAccessor (&QueueDisc::SetQuota,
                                          &QueueDisc::GetQuota),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BulkDequeue",
+                   "The maximum number of packets extracted at once from the queue disc "
+                   "by a qdisc run when the device has a single transmission queue "
+                   "(1 extracts a packet at a time)",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&QueueDisc::m_bulkDequeue),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Lightweight",
+                   "Whether to only keep the packet counters: the byte counters and the "
+                   "per-reason counters are not updated and the SojournTime, Mark and "
+                   "Requeue traces are not fired",
+                   BooleanValue (QUEUE_DISC_LIGHTWEIGHT_DEFAULT),
+                   MakeBooleanAccessor (&QueueDisc::SetLightweight,
+                                        &QueueDisc::GetLightweight),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DeferredRun",
+                   "Whether the packets enqueued at the same time are dequeued by a "
+                   "single zero-delay run of the queue disc, instead of a run per packet",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&QueueDisc::m_deferredRun),
+                   MakeBooleanChecker ())
     .AddAttribute ("InternalQueueList", "The list of internal queues.",
                    ObjectVectorValue (),
                    MakeObjectVectorAccessor (&QueueDisc::m_queues),
@@ -315,6 +374,10 @@ TypeId QueueDisc::GetTypeId (void)
                      "Sojourn time of the last packet dequeued from the queue disc",
                      MakeTraceSourceAccessor (&QueueDisc::m_sojourn),
                      "ns3::Time::TracedCallback")
+    .AddTraceSource ("RunsSaved",
+                     "Number of packets enqueued while a deferred run was already scheduled",
+                     MakeTraceSourceAccessor (&QueueDisc::m_nRunsSaved),
+                     "ns3::TracedValueCallback::Uint32")
   ;
   return tid;
 }
@@ -325,6 +388,11 @@ QueueDisc::QueueDisc (QueueDiscSizePolicy policy)
      m_maxSize (QueueSize ("1p")),         // to avoid that setting the mode at construction time is ignored
      m_running (false),
      m_peeked (false),
+     m_bulkDequeue (1),
+     m_bulkNext (0),
+     m_lightweight (QUEUE_DISC_LIGHTWEIGHT_DEFAULT),
+     m_deferredRun (false),
+     m_nRunsSaved (0),
      m_sizePolicy (policy),
      m_prohibitChangeMode (false)
 {
@@ -352,13 +420,13 @@ QueueDisc::QueueDisc (QueueDiscSizePolicy policy)
   // the packet is dropped.
   m_childQueueDiscDbeFunctor = [this] (Ptr<const QueueDiscItem> item, const char* r)
     {
-      return DropBeforeEnqueue (item,
-                                m_childQueueDiscDropMsg.assign (CHILD_QUEUE_DISC_DROP).append (r).data ());
+      uint32_t id = GetChildReasonId (r);
+      return DoDropBeforeEnqueue (item, id, GetReasonName (id).c_str ());
     };
   m_childQueueDiscDadFunctor = [this] (Ptr<const QueueDiscItem> item, const char* r)
     {
-      return DropAfterDequeue (item,
-                               m_childQueueDiscDropMsg.assign (CHILD_QUEUE_DISC_DROP).append (r).data ());
+      uint32_t id = GetChildReasonId (r);
+      return DoDropAfterDequeue (item, id, GetReasonName (id).c_str ());
     };
 }
 
@@ -384,6 +452,9 @@ QueueDisc::DoDispose (void)
   m_devQueueIface = 0;
   m_send = nullptr;
   m_requeued = 0;
+  m_bulk.clear ();
+  m_bulkNext = 0;
+  m_runEvent.Cancel ();
   m_internalQueueDbeFunctor = nullptr;
   m_internalQueueDadFunctor = nullptr;
   m_childQueueDiscDbeFunctor = nullptr;
@@ -420,17 +491,159 @@ QueueDisc::GetStats (void)
   NS_ASSERT (m_stats.nTotalDroppedBytes == m_stats.nTotalDroppedBytesBeforeEnqueue
              + m_stats.nTotalDroppedBytesAfterDequeue);
 
+  // bring the received counters up to date, if in lightweight mode
+  SetLightweight (m_lightweight);
+
   // the total number of sent packets is only updated here to avoid to increase it
   // after a dequeue and then having to decrease it if the packet is dropped after
-  // dequeue or requeued
+  // dequeue or requeued (the packets extracted by a bulk dequeue and not
+  // transmitted yet are not sent either)
   m_stats.nTotalSentPackets = m_stats.nTotalDequeuedPackets - (m_requeued ? 1 : 0)
+                              - (m_bulk.size () - m_bulkNext)
                               - m_stats.nTotalDroppedPacketsAfterDequeue;
-  m_stats.nTotalSentBytes = m_stats.nTotalDequeuedBytes - (m_requeued ? m_requeued->GetSize () : 0)
-                            - m_stats.nTotalDroppedBytesAfterDequeue;
+  if (!m_lightweight)
+    {
+      uint64_t bulkBytes = 0;
+      for (std::size_t i = m_bulkNext; i < m_bulk.size (); i++)
+        {
+          bulkBytes += m_bulk[i]->GetSize ();
+        }
+      m_stats.nTotalSentBytes = m_stats.nTotalDequeuedBytes - (m_requeued ? m_requeued->GetSize () : 0)
+                                - bulkBytes - m_stats.nTotalDroppedBytesAfterDequeue;
+    }
+
+  // the per-reason counters are only turned into string-keyed maps here
+  m_stats.nDroppedPacketsBeforeEnqueue.clear ();
+  m_stats.nDroppedBytesBeforeEnqueue.clear ();
+  m_stats.nDroppedPacketsAfterDequeue.clear ();
+  m_stats.nDroppedBytesAfterDequeue.clear ();
+  m_stats.nMarkedPackets.clear ();
+  m_stats.nMarkedBytes.clear ();
+  for (uint32_t id = 0; id < m_reasonCounters.size (); id++)
+    {
+      const ReasonCounters &counters = m_reasonCounters[id];
+      const std::string &name = GetReasonName (id);
+      if (counters.nDroppedPacketsBeforeEnqueue)
+        {
+          m_stats.nDroppedPacketsBeforeEnqueue[name] = counters.nDroppedPacketsBeforeEnqueue;
+          m_stats.nDroppedBytesBeforeEnqueue[name] = counters.nDroppedBytesBeforeEnqueue;
+        }
+      if (counters.nDroppedPacketsAfterDequeue)
+        {
+          m_stats.nDroppedPacketsAfterDequeue[name] = counters.nDroppedPacketsAfterDequeue;
+          m_stats.nDroppedBytesAfterDequeue[name] = counters.nDroppedBytesAfterDequeue;
+        }
+      if (counters.nMarkedPackets)
+        {
+          m_stats.nMarkedPackets[name] = counters.nMarkedPackets;
+          m_stats.nMarkedBytes[name] = counters.nMarkedBytes;
+        }
+    }
 
   return m_stats;
 }
 
+uint32_t
+QueueDisc::GetReasonId (const char* reason)
+{
+  QueueDiscReasonRegistry &registry = GetQueueDiscReasonRegistry ();
+  std::unordered_map<const char*, uint32_t>::const_iterator it = registry.pointers.find (reason);
+  if (it != registry.pointers.end () && std::strcmp (registry.names[it->second].c_str (), reason) == 0)
+    {
+      return it->second;
+    }
+
+  uint32_t id = InternReason (reason);
+  registry.pointers[reason] = id;
+  return id;
+}
+
+uint32_t
+QueueDisc::InternReason (const std::string &reason)
+{
+  QueueDiscReasonRegistry &registry = GetQueueDiscReasonRegistry ();
+  std::unordered_map<std::string, uint32_t>::const_iterator it = registry.ids.find (reason);
+  if (it != registry.ids.end ())
+    {
+      return it->second;
+    }
+
+  uint32_t id = registry.names.size ();
+  registry.names.push_back (reason);
+  registry.ids[reason] = id;
+  return id;
+}
+
+const std::string&
+QueueDisc::GetReasonName (uint32_t id)
+{
+  QueueDiscReasonRegistry &registry = GetQueueDiscReasonRegistry ();
+  NS_ASSERT (id < registry.names.size ());
+  return registry.names[id];
+}
+
+uint32_t
+QueueDisc::GetChildReasonId (const char* reason)
+{
+  uint32_t childId = GetReasonId (reason);
+  if (childId >= m_childReasonIds.size ())
+    {
+      m_childReasonIds.resize (childId + 1, NO_REASON);
+    }
+  if (m_childReasonIds[childId] == NO_REASON)
+    {
+      m_childReasonIds[childId] = InternReason (std::string (CHILD_QUEUE_DISC_DROP).append (reason));
+    }
+  return m_childReasonIds[childId];
+}
+
+void
+QueueDisc::SetLightweight (bool lightweight)
+{
+  NS_LOG_FUNCTION (this << lightweight);
+
+  if (m_lightweight && !lightweight)
+    {
+      // the bytes enqueued and dequeued in lightweight mode were not counted:
+      // the counter lagging behind absorbs the change of the backlog, so that
+      // the counters keep growing and their difference is the backlog again
+      uint64_t backlog = m_stats.nTotalEnqueuedBytes - m_stats.nTotalDequeuedBytes;
+      if (m_nBytes > backlog)
+        {
+          m_stats.nTotalEnqueuedBytes += m_nBytes - backlog;
+        }
+      else
+        {
+          m_stats.nTotalDequeuedBytes += backlog - m_nBytes;
+        }
+    }
+  if (m_lightweight)
+    {
+      // received = dropped before enqueue + enqueued
+      m_stats.nTotalReceivedPackets = m_stats.nTotalDroppedPacketsBeforeEnqueue
+                                      + m_stats.nTotalEnqueuedPackets;
+      m_stats.nTotalReceivedBytes = m_stats.nTotalDroppedBytesBeforeEnqueue
+                                    + m_stats.nTotalEnqueuedBytes;
+    }
+  m_lightweight = lightweight;
+}
+
+bool
+QueueDisc::GetLightweight (void) const
+{
+  return m_lightweight;
+}
+
+QueueDisc::ReasonCounters&
+QueueDisc::GetReasonCounters (uint32_t id)
+{
+  if (id >= m_reasonCounters.size ())
+    {
+      m_reasonCounters.resize (id + 1, ReasonCounters ());
+    }
+  return m_reasonCounters[id];
+}
+
 uint32_t
 QueueDisc::GetNPackets () const
 {
@@ -689,10 +902,19 @@ QueueDisc::PacketEnqueued (Ptr<const QueueDiscItem> item)
   m_nPackets++;
   m_nBytes += item->GetSize ();
   m_stats.nTotalEnqueuedPackets++;
-  m_stats.nTotalEnqueuedBytes += item->GetSize ();
 
-  NS_LOG_LOGIC ("m_traceEnqueue (p)");
-  m_traceEnqueue (item);
+  if (!m_lightweight)
+    {
+      m_stats.nTotalEnqueuedBytes += item->GetSize ();
+    }
+
+  // the parent of a queue disc counts its packets through this trace, hence
+  // it is fired even in lightweight mode
+  if (!m_traceEnqueue.IsEmpty ())
+    {
+      NS_LOG_LOGIC ("m_traceEnqueue (p)");
+      m_traceEnqueue (item);
+    }
 }
 
 void
@@ -708,12 +930,25 @@ QueueDisc::PacketDequeued (Ptr<const QueueDiscItem> item)
       m_nPackets--;
       m_nBytes -= item->GetSize ();
       m_stats.nTotalDequeuedPackets++;
-      m_stats.nTotalDequeuedBytes += item->GetSize ();
 
-      m_sojourn (Simulator::Now () - item->GetTimeStamp ());
+      if (!m_lightweight)
+        {
+          m_stats.nTotalDequeuedBytes += item->GetSize ();
+        }
 
-      NS_LOG_LOGIC ("m_traceDequeue (p)");
-      m_traceDequeue (item);
+      // the traces are only fired if connected, as this is the fast path of
+      // every queue disc (parents connect to the traces of their children);
+      // the sojourn time is not even computed in lightweight mode
+      if (!m_lightweight && !m_sojourn.IsEmpty ())
+        {
+          m_sojourn (Simulator::Now () - item->GetTimeStamp ());
+        }
+
+      if (!m_traceDequeue.IsEmpty ())
+        {
+          NS_LOG_LOGIC ("m_traceDequeue (p)");
+          m_traceDequeue (item);
+        }
     }
 }
 
@@ -721,70 +956,64 @@ void
 QueueDisc::DropBeforeEnqueue (Ptr<const QueueDiscItem> item, const char* reason)
 {
   NS_LOG_FUNCTION (this << item << reason);
+  DoDropBeforeEnqueue (item, m_lightweight ? NO_REASON : GetReasonId (reason), reason);
+}
 
+void
+QueueDisc::DoDropBeforeEnqueue (Ptr<const QueueDiscItem> item, uint32_t id, const char* reason)
+{
   m_stats.nTotalDroppedPackets++;
-  m_stats.nTotalDroppedBytes += item->GetSize ();
   m_stats.nTotalDroppedPacketsBeforeEnqueue++;
-  m_stats.nTotalDroppedBytesBeforeEnqueue += item->GetSize ();
 
-  // update the number of packets dropped for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nDroppedPacketsBeforeEnqueue.find (reason);
-  if (itp != m_stats.nDroppedPacketsBeforeEnqueue.end ())
+  if (!m_lightweight)
     {
-      itp->second++;
-    }
-  else
-    {
-      m_stats.nDroppedPacketsBeforeEnqueue[reason] = 1;
-    }
-  // update the amount of bytes dropped for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nDroppedBytesBeforeEnqueue.find (reason);
-  if (itb != m_stats.nDroppedBytesBeforeEnqueue.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
-    {
-      m_stats.nDroppedBytesBeforeEnqueue[reason] = item->GetSize ();
+      m_stats.nTotalDroppedBytes += item->GetSize ();
+      m_stats.nTotalDroppedBytesBeforeEnqueue += item->GetSize ();
+
+      // update the number of packets and the amount of bytes dropped for the given reason
+      ReasonCounters &counters = GetReasonCounters (id);
+      counters.nDroppedPacketsBeforeEnqueue++;
+      counters.nDroppedBytesBeforeEnqueue += item->GetSize ();
     }
 
   NS_LOG_DEBUG ("Total packets/bytes dropped before enqueue: "
                 << m_stats.nTotalDroppedPacketsBeforeEnqueue << " / "
                 << m_stats.nTotalDroppedBytesBeforeEnqueue);
   NS_LOG_LOGIC ("m_traceDropBeforeEnqueue (p)");
-  m_traceDrop (item);
-  m_traceDropBeforeEnqueue (item, reason);
+  // the parent of a queue disc counts its drops through this trace, hence it
+  // is fired even in lightweight mode
+  if (!m_traceDrop.IsEmpty ())
+    {
+      m_traceDrop (item);
+    }
+  if (!m_traceDropBeforeEnqueue.IsEmpty ())
+    {
+      m_traceDropBeforeEnqueue (item, reason);
+    }
 }
 
 void
 QueueDisc::DropAfterDequeue (Ptr<const QueueDiscItem> item, const char* reason)
 {
   NS_LOG_FUNCTION (this << item << reason);
+  DoDropAfterDequeue (item, m_lightweight ? NO_REASON : GetReasonId (reason), reason);
+}
 
+void
+QueueDisc::DoDropAfterDequeue (Ptr<const QueueDiscItem> item, uint32_t id, const char* reason)
+{
   m_stats.nTotalDroppedPackets++;
-  m_stats.nTotalDroppedBytes += item->GetSize ();
   m_stats.nTotalDroppedPacketsAfterDequeue++;
-  m_stats.nTotalDroppedBytesAfterDequeue += item->GetSize ();
 
-  // update the number of packets dropped for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nDroppedPacketsAfterDequeue.find (reason);
-  if (itp != m_stats.nDroppedPacketsAfterDequeue.end ())
-    {
-      itp->second++;
-    }
-  else
+  if (!m_lightweight)
     {
-      m_stats.nDroppedPacketsAfterDequeue[reason] = 1;
-    }
-  // update the amount of bytes dropped for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nDroppedBytesAfterDequeue.find (reason);
-  if (itb != m_stats.nDroppedBytesAfterDequeue.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
-    {
-      m_stats.nDroppedBytesAfterDequeue[reason] = item->GetSize ();
+      m_stats.nTotalDroppedBytes += item->GetSize ();
+      m_stats.nTotalDroppedBytesAfterDequeue += item->GetSize ();
+
+      // update the number of packets and the amount of bytes dropped for the given reason
+      ReasonCounters &counters = GetReasonCounters (id);
+      counters.nDroppedPacketsAfterDequeue++;
+      counters.nDroppedBytesAfterDequeue += item->GetSize ();
     }
 
   // if in the context of a peek request a dequeued packet is dropped, we need
@@ -802,8 +1031,14 @@ QueueDisc::DropAfterDequeue (Ptr<const QueueDiscItem> item, const char* reason)
                 << m_stats.nTotalDroppedPacketsAfterDequeue << " / "
                 << m_stats.nTotalDroppedBytesAfterDequeue);
   NS_LOG_LOGIC ("m_traceDropAfterDequeue (p)");
-  m_traceDrop (item);
-  m_traceDropAfterDequeue (item, reason);
+  if (!m_traceDrop.IsEmpty ())
+    {
+      m_traceDrop (item);
+    }
+  if (!m_traceDropAfterDequeue.IsEmpty ())
+    {
+      m_traceDropAfterDequeue (item, reason);
+    }
 }
 
 bool
@@ -819,29 +1054,19 @@ QueueDisc::Mark (Ptr<QueueDiscItem> item, const char* reason)
     }
 
   m_stats.nTotalMarkedPackets++;
-  m_stats.nTotalMarkedBytes += item->GetSize ();
 
-  // update the number of packets marked for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nMarkedPackets.find (reason);
-  if (itp != m_stats.nMarkedPackets.end ())
-    {
-      itp->second++;
-    }
-  else
-    {
-      m_stats.nMarkedPackets[reason] = 1;
-    }
-  // update the amount of bytes marked for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nMarkedBytes.find (reason);
-  if (itb != m_stats.nMarkedBytes.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
+  if (m_lightweight)
     {
-      m_stats.nMarkedBytes[reason] = item->GetSize ();
+      return true;
     }
 
+  m_stats.nTotalMarkedBytes += item->GetSize ();
+
+  // update the number of packets and the amount of bytes marked for the given reason
+  ReasonCounters &counters = GetReasonCounters (GetReasonId (reason));
+  counters.nMarkedPackets++;
+  counters.nMarkedBytes += item->GetSize ();
+
   NS_LOG_DEBUG ("Total packets/bytes marked: "
                 << m_stats.nTotalMarkedPackets << " / "
                 << m_stats.nTotalMarkedBytes);
@@ -854,8 +1079,12 @@ QueueDisc::Enqueue (Ptr<QueueDiscItem> item)
 {
   NS_LOG_FUNCTION (this << item);
 
-  m_stats.nTotalReceivedPackets++;
-  m_stats.nTotalReceivedBytes += item->GetSize ();
+  // in lightweight mode, the received counters are derived by GetStats
+  if (!m_lightweight)
+    {
+      m_stats.nTotalReceivedPackets++;
+      m_stats.nTotalReceivedBytes += item->GetSize ();
+    }
 
   bool retval = DoEnqueue (item);
 
@@ -876,9 +1105,11 @@ QueueDisc::Enqueue (Ptr<QueueDiscItem> item)
   // Thus, we do not have to call DropBeforeEnqueue here.
 
   // check that the received packet was either enqueued or dropped
-  NS_ASSERT (m_stats.nTotalReceivedPackets == m_stats.nTotalDroppedPacketsBeforeEnqueue +
+  NS_ASSERT (m_lightweight
+             || m_stats.nTotalReceivedPackets == m_stats.nTotalDroppedPacketsBeforeEnqueue +
              m_stats.nTotalEnqueuedPackets);
-  NS_ASSERT (m_stats.nTotalReceivedBytes == m_stats.nTotalDroppedBytesBeforeEnqueue +
+  NS_ASSERT (m_lightweight
+             || m_stats.nTotalReceivedBytes == m_stats.nTotalDroppedBytesBeforeEnqueue +
              m_stats.nTotalEnqueuedBytes);
 
   return retval;
@@ -907,21 +1138,79 @@ QueueDisc::Dequeue (void)
           PacketDequeued (item);
         }
     }
+  else if (m_bulkNext < m_bulk.size ())
+    {
+      // the packets extracted by a bulk dequeue are already accounted as dequeued
+      item = m_bulk[m_bulkNext];
+      m_bulk[m_bulkNext++] = 0;
+    }
   else
     {
       item = DoDequeue ();
     }
 
   NS_ASSERT (m_nPackets == m_stats.nTotalEnqueuedPackets - m_stats.nTotalDequeuedPackets);
-  NS_ASSERT (m_nBytes == m_stats.nTotalEnqueuedBytes - m_stats.nTotalDequeuedBytes);
+  NS_ASSERT (m_lightweight || m_nBytes == m_stats.nTotalEnqueuedBytes - m_stats.nTotalDequeuedBytes);
 
   return item;
 }
 
+uint32_t
+QueueDisc::DequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items)
+{
+  NS_LOG_FUNCTION (this << n << maxBytes);
+
+  std::size_t first = items.size ();
+  uint32_t bytes = 0;
+
+  // a peeked packet and the packets left by a bulk dequeue are extracted
+  // first, as done by Dequeue
+  while (n > 0 && bytes < maxBytes && (m_requeued || m_bulkNext < m_bulk.size ()))
+    {
+      Ptr<QueueDiscItem> item = Dequeue ();
+      bytes += item->GetSize ();
+      items.push_back (item);
+      n--;
+    }
+
+  if (n > 0 && bytes < maxBytes)
+    {
+      DoDequeueBatch (n, maxBytes - bytes, items);
+    }
+
+  NS_ASSERT (m_nPackets == m_stats.nTotalEnqueuedPackets - m_stats.nTotalDequeuedPackets);
+  NS_ASSERT (m_lightweight || m_nBytes == m_stats.nTotalEnqueuedBytes - m_stats.nTotalDequeuedBytes);
+
+  return items.size () - first;
+}
+
+void
+QueueDisc::DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items)
+{
+  NS_LOG_FUNCTION (this << n << maxBytes);
+
+  uint32_t bytes = 0;
+  while (n > 0 && bytes < maxBytes)
+    {
+      Ptr<QueueDiscItem> item = DoDequeue ();
+      if (!item)
+        {
+          break;
+        }
+      bytes += item->GetSize ();
+      items.push_back (item);
+      n--;
+    }
+}
+
 Ptr<const QueueDiscItem>
 QueueDisc::Peek (void)
 {
   NS_LOG_FUNCTION (this);
+  if (!m_requeued && m_bulkNext < m_bulk.size ())
+    {
+      return m_bulk[m_bulkNext];
+    }
   return DoPeek ();
 }
 
@@ -943,6 +1232,35 @@ QueueDisc::DoPeek (void)
   return m_requeued;
 }
 
+void
+QueueDisc::Reset (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (GetNPackets () == 0, "Only an empty queue disc can be reset");
+  DoReset ();
+}
+
+void
+QueueDisc::DoReset (void)
+{
+  NS_LOG_FUNCTION (this);
+  InitializeParams ();
+}
+
+void
+QueueDisc::Suspend (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (GetNPackets () == 0, "Only an empty queue disc can be suspended");
+  DoSuspend ();
+}
+
+void
+QueueDisc::DoSuspend (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
 void
 QueueDisc::Run (void)
 {
@@ -964,6 +1282,33 @@ QueueDisc::Run (void)
     }
 }
 
+void
+QueueDisc::ScheduleRun (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_deferredRun)
+    {
+      Run ();
+      return;
+    }
+
+  if (m_runEvent.IsRunning ())
+    {
+      // the scheduled run will also dequeue the packet that has just been enqueued
+      m_nRunsSaved++;
+      return;
+    }
+
+  m_runEvent = Simulator::ScheduleNow (&QueueDisc::Run, this);
+}
+
+uint32_t
+QueueDisc::GetNRunsSaved (void) const
+{
+  return m_nRunsSaved;
+}
+
 bool
 QueueDisc::RunBegin (void)
 {
@@ -1035,13 +1380,22 @@ QueueDisc::DequeuePacket ()
       if (!m_devQueueIface ||
           m_devQueueIface->GetNTxQueues ()>1 || !m_devQueueIface->GetTxQueue (0)->IsStopped ())
         {
+          // Like Linux (try_bulk_dequeue_skb), extract several packets at once
+          // if the device has a single transmission queue. The packets are then
+          // transmitted one at a time by the following restarts
+          if (m_bulkDequeue > 1 && m_bulkNext == m_bulk.size ()
+              && (!m_devQueueIface || m_devQueueIface->GetNTxQueues () == 1))
+            {
+              m_bulk.clear ();
+              m_bulkNext = 0;
+              DequeueBatch (m_bulkDequeue, std::numeric_limits<uint32_t>::max (), m_bulk);
+            }
           item = Dequeue ();
           // If the item is not null, add the header to the packet.
           if (item != 0)
             {
               item->AddHeader ();
             }
-          // Here, Linux tries bulk dequeues
         }
     }
   return item;
@@ -1055,6 +1409,12 @@ QueueDisc::Requeue (Ptr<QueueDiscItem> item)
   /// \todo netif_schedule (q);
 
   m_stats.nTotalRequeuedPackets++;
+
+  if (m_lightweight)
+    {
+      return;
+    }
+
   m_stats.nTotalRequeuedBytes += item->GetSize ();
 
   NS_LOG_LOGIC ("m_traceRequeue (p)");
@@ -1099,9 +1459,10 @@ QueueDisc::Transmit (Ptr<QueueDiscItem> item)
   // of the value returned by NetDevice::Send does not match that of the value
   // returned by ndo_start_xmit.
 
-  // if the queue disc is empty or the device queue is now stopped, return false so
-  // that the Run method does not attempt to dequeue other packets and exits
-  if (GetNPackets () == 0 ||
+  // if the queue disc is empty (and no packet extracted by a bulk dequeue is left)
+  // or the device queue is now stopped, return false so that the Run method does
+  // not attempt to dequeue other packets and exits
+  if ((GetNPackets () == 0 && m_bulkNext == m_bulk.size ()) ||
       (m_devQueueIface && m_devQueueIface->GetTxQueue (item->GetTxQueueIndex ())->IsStopped ()))
     {
       return false;
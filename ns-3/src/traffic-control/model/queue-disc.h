@@ -23,6 +23,7 @@
 #include "ns3/object.h"
 #include "ns3/traced-value.h"
 #include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
 #include "ns3/queue-item.h"
 #include "ns3/queue-size.h"
 #include <vector>
@@ -175,6 +176,31 @@ enum QueueDiscSizePolicy
  * the additional time the packet is retained within the traffic control
  * infrastructure in case it is requeued.
  *
+ * The trace sources are only fired if a sink is connected to them (the
+ * parent of a queue disc connects to its traces, hence they are always fired
+ * for a child queue disc). If the Lightweight attribute is set (the default
+ * if the module is configured with --enable-tc-lightweight), only the packet
+ * counters are kept: the byte counters and the per-reason counters are not
+ * updated, the received counters are derived by GetStats from the identity
+ * above, which is not checked at every enqueue, and the SojournTime, Mark and
+ * Requeue traces are not fired (the parent of a queue disc relies on the
+ * others).
+ *
+ * The traffic control layer calls ScheduleRun after enqueuing a packet. By
+ * default, the queue disc is run right away. If the DeferredRun attribute is
+ * set, the first packet enqueued at a given simulation time schedules a
+ * zero-delay event running the queue disc, and the packets enqueued at the
+ * same time before such event expires do not trigger any other run (as if the
+ * run were deferred to the NET_TX softirq in Linux). The RunsSaved trace
+ * source counts such packets.
+ *
+ * A qdisc run extracts a packet at a time. If the BulkDequeue attribute is
+ * greater than one and the device has a single transmission queue, a qdisc
+ * run extracts up to BulkDequeue packets at once through DequeueBatch (as
+ * Linux does in try_bulk_dequeue_skb), and transmits them one at a time. The
+ * packets not transmitted because the device queue was stopped are sent
+ * first by the next run.
+ *
  * The design and implementation of this class is heavily inspired by Linux.
  * For more details, see the traffic-control model page.
  */
@@ -204,21 +230,21 @@ public:
     uint32_t nTotalDroppedPackets;
     /// Total packets dropped before enqueue
     uint32_t nTotalDroppedPacketsBeforeEnqueue;
-    /// Packets dropped before enqueue, for each reason
+    /// Packets dropped before enqueue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nDroppedPacketsBeforeEnqueue;
     /// Total packets dropped after dequeue
     uint32_t nTotalDroppedPacketsAfterDequeue;
-    /// Packets dropped after dequeue, for each reason
+    /// Packets dropped after dequeue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nDroppedPacketsAfterDequeue;
     /// Total dropped bytes
     uint64_t nTotalDroppedBytes;
     /// Total bytes dropped before enqueue
     uint64_t nTotalDroppedBytesBeforeEnqueue;
-    /// Bytes dropped before enqueue, for each reason
+    /// Bytes dropped before enqueue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nDroppedBytesBeforeEnqueue;
     /// Total bytes dropped after dequeue
     uint64_t nTotalDroppedBytesAfterDequeue;
-    /// Bytes dropped after dequeue, for each reason
+    /// Bytes dropped after dequeue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nDroppedBytesAfterDequeue;
     /// Total requeued packets
     uint32_t nTotalRequeuedPackets;
@@ -226,11 +252,11 @@ public:
     uint64_t nTotalRequeuedBytes;
     /// Total marked packets
     uint32_t nTotalMarkedPackets;
-    /// Marked packets, for each reason
+    /// Marked packets, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nMarkedPackets;
     /// Total marked bytes
     uint32_t nTotalMarkedBytes;
-    /// Marked bytes, for each reason
+    /// Marked bytes, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nMarkedBytes;
 
     /// constructor
@@ -334,9 +360,36 @@ public:
   /**
    * \brief Retrieve all the collected statistics.
    * \return the collected statistics.
+   *
+   * The counters of the drop and mark reasons are kept in flat arrays indexed
+   * by the identifier of the reason, and the maps keyed by the name of the
+   * reasons are only built here.
    */
   const Stats& GetStats (void);
 
+  /**
+   * \brief Get the identifier of a drop or mark reason, registering the reason
+   *        the first time it is seen
+   *
+   * Reasons are interned in a registry shared by all the queue discs, so
+   * that the reasons of a queue disc type are registered once. A reason is
+   * looked up by the address of its string (usually a static constant of the
+   * queue disc), whose contents are checked against the registered name, so
+   * a reason built in a buffer reused for other reasons is still counted
+   * correctly.
+   *
+   * \param reason the reason
+   * \return the identifier of the reason
+   */
+  static uint32_t GetReasonId (const char* reason);
+
+  /**
+   * \brief Get the name of a registered drop or mark reason
+   * \param id the identifier of the reason
+   * \return the name of the reason
+   */
+  static const std::string& GetReasonName (uint32_t id);
+
   /**
    * \param ndqi the NetDeviceQueueInterface aggregated to the receiving object.
    *
@@ -402,6 +455,23 @@ public:
    */
   Ptr<QueueDiscItem> Dequeue (void);
 
+  /**
+   * Extract up to the given number of packets from the queue disc, stopping as
+   * soon as the given number of bytes has been reached (the last packet may
+   * exceed it), as Linux does when bulk dequeuing. The packet that has been
+   * dequeued by calling Peek and the packets left by a bulk dequeue of a qdisc
+   * run, if any, are extracted first. The packets are
+   * extracted in the same order and with the same statistics and traces as
+   * with the same number of calls to Dequeue, but queue discs may implement
+   * DoDequeueBatch to save the per-packet overhead of DoDequeue.
+   *
+   * \param n the maximum number of packets to extract
+   * \param maxBytes the number of bytes after which no more packets are extracted
+   * \param items the vector the extracted packets are appended to
+   * \return the number of packets extracted
+   */
+  uint32_t DequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items);
+
   /**
    * Get a copy of the next packet the queue discipline will extract. This
    * function only calls the (private) DoPeek function. This base class provides
@@ -411,6 +481,23 @@ public:
    */
   Ptr<const QueueDiscItem> Peek (void);
 
+  /**
+   * Bring the state of an empty queue disc (e.g., the state of its AQM
+   * algorithm) back to the state it had after initialization, so that it can
+   * be reused for other traffic, and restart its periodic events, if any.
+   * This function only calls the (private) DoReset function, which
+   * initializes the parameters again by default.
+   */
+  void Reset (void);
+
+  /**
+   * Cancel the periodic events, if any, of an empty queue disc that is not
+   * used until it is reset, e.g., the queue disc of a flow kept in a pool
+   * of free flows. This function only calls the (private) DoSuspend
+   * function, which does nothing by default.
+   */
+  void Suspend (void);
+
   /**
    * Modelled after the Linux function __qdisc_run (net/sched/sch_generic.c)
    * Dequeues multiple packets, until a quota is exceeded or sending a packet
@@ -418,6 +505,20 @@ public:
    */
   void Run (void);
 
+  /**
+   * Run the queue disc after a packet has been enqueued: immediately or, if
+   * the DeferredRun attribute is set, through a zero-delay event shared by all
+   * the packets enqueued at the current time (the queue disc is then marked
+   * as scheduled, as the Linux function __netif_schedule does).
+   */
+  void ScheduleRun (void);
+
+  /**
+   * \brief Get the number of runs saved by the deferred run mode
+   * \return the number of packets enqueued while a run was already scheduled
+   */
+  uint32_t GetNRunsSaved (void) const;
+
   /// Internal queues store QueueDiscItem objects
   typedef Queue<QueueDiscItem> InternalQueue;
 
@@ -560,6 +661,26 @@ protected:
    */
   bool Mark (Ptr<QueueDiscItem> item, const char* reason);
 
+  /**
+   *  \brief Perform the actions required when the queue disc is notified of
+   *         a packet enqueue
+   *  \param item item that was enqueued
+   *  This method is called by the internal queues and the child queue discs.
+   *  Subclasses that store packets in their own data structures must call it
+   *  when they store a packet
+   */
+  void PacketEnqueued (Ptr<const QueueDiscItem> item);
+
+  /**
+   *  \brief Perform the actions required when the queue disc is notified of
+   *         a packet dequeue
+   *  \param item item that was dequeued
+   *  This method is called by the internal queues and the child queue discs.
+   *  Subclasses that store packets in their own data structures must call it
+   *  when they remove a packet, also before dropping it after dequeue
+   */
+  void PacketDequeued (Ptr<const QueueDiscItem> item);
+
 private:
   /**
    * \brief Copy constructor
@@ -591,6 +712,16 @@ private:
    */
   virtual Ptr<QueueDiscItem> DoDequeue (void) = 0;
 
+  /**
+   * This function actually extracts multiple packets from the queue disc. The
+   * default implementation calls DoDequeue until the given number of packets
+   * or bytes is reached or no packet is returned.
+   * \param n the maximum number of packets to extract
+   * \param maxBytes the number of bytes after which no more packets are extracted
+   * \param items the vector the extracted packets are appended to
+   */
+  virtual void DoDequeueBatch (uint32_t n, uint32_t maxBytes, std::vector<Ptr<QueueDiscItem> > &items);
+
   /**
    * \brief Return a copy of the next packet the queue disc will extract.
    *
@@ -612,6 +743,19 @@ private:
    */
   virtual Ptr<const QueueDiscItem> DoPeek (void);
 
+  /**
+   * Reset the state of the queue disc. The default implementation calls
+   * InitializeParams. Queue discs whose state is not (entirely) set by
+   * InitializeParams or that have periodic events have to redefine it.
+   */
+  virtual void DoReset (void);
+
+  /**
+   * Cancel the periodic events of the queue disc. The default implementation
+   * does nothing.
+   */
+  virtual void DoSuspend (void);
+
   /**
    * Check whether the current configuration is correct. Default objects (such
    * as internal queues) might be created by this method to ensure the
@@ -667,18 +811,69 @@ private:
   bool Transmit (Ptr<QueueDiscItem> item);
 
   /**
-   *  \brief Perform the actions required when the queue disc is notified of
-   *         a packet enqueue
-   *  \param item item that was enqueued
+   * \brief Get the identifier of a reason, registering it the first time it
+   *        is seen, without caching the address of its string
+   * \param reason the reason
+   * \return the identifier of the reason
    */
-  void PacketEnqueued (Ptr<const QueueDiscItem> item);
+  static uint32_t InternReason (const std::string &reason);
 
   /**
-   *  \brief Perform the actions required when the queue disc is notified of
-   *         a packet dequeue
-   *  \param item item that was dequeued
+   * \brief Get the identifier of the reason recorded by this queue disc for
+   *        a packet dropped by a child queue disc
+   * \param reason the reason given by the child queue disc
+   * \return the identifier of CHILD_QUEUE_DISC_DROP followed by the reason
    */
-  void PacketDequeued (Ptr<const QueueDiscItem> item);
+  uint32_t GetChildReasonId (const char* reason);
+
+  /// Counters of the packets dropped or marked for a reason
+  struct ReasonCounters
+  {
+    uint32_t nDroppedPacketsBeforeEnqueue; //!< Packets dropped before enqueue
+    uint64_t nDroppedBytesBeforeEnqueue;   //!< Bytes dropped before enqueue
+    uint32_t nDroppedPacketsAfterDequeue;  //!< Packets dropped after dequeue
+    uint64_t nDroppedBytesAfterDequeue;    //!< Bytes dropped after dequeue
+    uint32_t nMarkedPackets;               //!< Packets marked
+    uint64_t nMarkedBytes;                 //!< Bytes marked
+  };
+
+  /**
+   * \brief Get the counters of a reason
+   * \param id the identifier of the reason
+   * \return the counters
+   */
+  ReasonCounters& GetReasonCounters (uint32_t id);
+
+  /**
+   * \brief Set the lightweight mode, bringing the received counters up to
+   *        date when leaving it
+   * \param lightweight whether to enable the lightweight mode
+   */
+  void SetLightweight (bool lightweight);
+
+  /**
+   * \brief Get whether the lightweight mode is enabled
+   * \return true if the lightweight mode is enabled
+   */
+  bool GetLightweight (void) const;
+
+  /**
+   * \brief Update the statistics and fire the traces of a packet dropped
+   *        before enqueue
+   * \param item the dropped packet
+   * \param id the identifier of the reason
+   * \param reason the name of the reason
+   */
+  void DoDropBeforeEnqueue (Ptr<const QueueDiscItem> item, uint32_t id, const char* reason);
+
+  /**
+   * \brief Update the statistics and fire the traces of a packet dropped
+   *        after dequeue
+   * \param item the dropped packet
+   * \param id the identifier of the reason
+   * \param reason the name of the reason
+   */
+  void DoDropAfterDequeue (Ptr<const QueueDiscItem> item, uint32_t id, const char* reason);
 
   static const uint32_t DEFAULT_QUOTA = 64; //!< Default quota (as in /proc/sys/net/core/dev_weight)
 
@@ -692,13 +887,21 @@ private:
   QueueSize m_maxSize;              //!< max queue size
 
   Stats m_stats;                    //!< The collected statistics
+  std::vector<ReasonCounters> m_reasonCounters;  //!< Counters of each reason, indexed by its identifier
+  std::vector<uint32_t> m_childReasonIds;        //!< Identifier recorded for each reason of the child queue discs
   uint32_t m_quota;                 //!< Maximum number of packets dequeued in a qdisc run
   Ptr<NetDeviceQueueInterface> m_devQueueIface;   //!< NetDevice queue interface
   SendCallback m_send;              //!< Callback used to send a packet to the receiving object
   bool m_running;                   //!< The queue disc is performing multiple dequeue operations
   Ptr<QueueDiscItem> m_requeued;    //!< The last packet that failed to be transmitted
   bool m_peeked;                    //!< A packet was dequeued because Peek was called
-  std::string m_childQueueDiscDropMsg;  //!< Reason why a packet was dropped by a child queue disc
+  uint32_t m_bulkDequeue;           //!< Maximum number of packets extracted at once by a qdisc run
+  std::vector<Ptr<QueueDiscItem> > m_bulk;  //!< Packets extracted by the last bulk dequeue
+  std::size_t m_bulkNext;           //!< Index of the first packet of m_bulk not transmitted yet
+  bool m_lightweight;               //!< Only keep the packet counters and the traces parents rely on
+  bool m_deferredRun;               //!< Run the queue disc through a zero-delay event after an enqueue
+  EventId m_runEvent;               //!< The event running the queue disc in deferred run mode
+  TracedValue<uint32_t> m_nRunsSaved;  //!< Number of runs saved by the deferred run mode
   QueueDiscSizePolicy m_sizePolicy;     //!< The queue disc size policy
   bool m_prohibitChangeMode;            //!< True if changing mode is prohibited
 
@@ -0,0 +1,590 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/hash.h"
+#include "ns3/net-device.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/ipv4-packet-filter.h"
+#include "ns3/ipv6-packet-filter.h"
+#include "drr-queue-disc.h"
+#include "sfq-queue-disc.h"
+#include <cstring>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SFQQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED (SFQQueueDisc);
+
+/// The index of no slot and of no node
+static const uint32_t SFQ_EMPTY = std::numeric_limits<uint32_t>::max ();
+
+TypeId SFQQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SFQQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<SFQQueueDisc> ()
+    .AddAttribute ("MaxSize",
+                   "The maximum number of packets accepted by this queue disc",
+                   QueueSizeValue (QueueSize ("127p")),
+                   MakeQueueSizeAccessor (&QueueDisc::SetMaxSize,
+                                          &QueueDisc::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Flows",
+                   "The number of slots in which the packets are stored",
+                   UintegerValue (128),
+                   MakeUintegerAccessor (&SFQQueueDisc::m_flows),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Divisor",
+                   "The number of hash buckets mapped to the slots",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&SFQQueueDisc::m_divisor),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Depth",
+                   "The maximum number of packets of a slot",
+                   UintegerValue (127),
+                   MakeUintegerAccessor (&SFQQueueDisc::m_depth),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Quantum",
+                   "The number of bytes credited to a slot in each round. Zero means "
+                   "the MTU of the device, or 1500 bytes if the queue disc has no device.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SFQQueueDisc::m_quantum),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("PerturbPeriod",
+                   "The period after which the seed of the hash is replaced. "
+                   "Zero disables the perturbation.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&SFQQueueDisc::m_perturbPeriod),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+SFQQueueDisc::SFQQueueDisc ()
+  : QueueDisc (QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::PACKETS),
+    m_flows (128),
+    m_divisor (1024),
+    m_depth (127),
+    m_quantum (0),
+    m_freeNode (SFQ_EMPTY),
+    m_tail (SFQ_EMPTY),
+    m_maxDepth (0),
+    m_nActiveSlots (0),
+    m_perturbation (0),
+    m_nPerturbations (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_uv = CreateObject<UniformRandomVariable> ();
+}
+
+SFQQueueDisc::~SFQQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SFQQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_slots.clear ();
+  m_nodes.clear ();
+  m_depLinks.clear ();
+  m_hashTable.clear ();
+  m_uv = 0;
+  QueueDisc::DoDispose ();
+}
+
+int64_t
+SFQQueueDisc::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_uv->SetStream (stream);
+  return 1;
+}
+
+uint32_t
+SFQQueueDisc::GetNActiveSlots (void) const
+{
+  return m_nActiveSlots;
+}
+
+uint32_t
+SFQQueueDisc::GetBucketNPackets (uint32_t bucket) const
+{
+  NS_ASSERT (bucket < m_hashTable.size ());
+  uint32_t x = m_hashTable[bucket];
+  return x == SFQ_EMPTY ? 0 : m_slots[x].qlen;
+}
+
+uint32_t
+SFQQueueDisc::GetBucket (int32_t classification) const
+{
+  if (!m_perturbPeriod.IsStrictlyPositive ())
+    {
+      return static_cast<uint32_t> (classification) % m_divisor;
+    }
+
+  // the perturbation has to change the bucket of the flows, not just the
+  // value of the hash, so the seed is mixed with the hash rather than added
+  char buf[8];
+  std::memcpy (buf, &classification, 4);
+  std::memcpy (buf + 4, &m_perturbation, 4);
+  return Hash32 (buf, 8) % m_divisor;
+}
+
+uint64_t
+SFQQueueDisc::GetNPerturbations (void) const
+{
+  return m_nPerturbations;
+}
+
+bool
+SFQQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+
+  if (m_perturbPeriod.IsStrictlyPositive () && Simulator::Now () >= m_nextPerturbation)
+    {
+      Perturb ();
+      m_nextPerturbation = Simulator::Now () + m_perturbPeriod;
+    }
+
+  int32_t ret = Classify (item);
+  if (ret == PacketFilter::PF_NO_MATCH)
+    {
+      NS_LOG_WARN ("No filter has been able to classify this packet.");
+    }
+
+  const char* reason = Insert (item, ret);
+  if (reason)
+    {
+      NS_LOG_LOGIC ("Dropping pkt: " << reason);
+      DropBeforeEnqueue (item, reason);
+      return false;
+    }
+  PacketEnqueued (item);
+
+  if (GetNPackets () > GetMaxSize ().GetValue ())
+    {
+      NS_LOG_LOGIC ("Queue disc full -- dropping pkt from the longest slot");
+      InlineDrop (DropFromLongestSlot (), OVERLIMIT_DROP);
+    }
+
+  return true;
+}
+
+const char*
+SFQQueueDisc::Insert (Ptr<QueueDiscItem> item, int32_t classification)
+{
+  NS_LOG_FUNCTION (this << item << classification);
+
+  // the packets no filter could classify are placed in a separate bucket
+  uint32_t bucket = classification == PacketFilter::PF_NO_MATCH ? m_divisor : GetBucket (classification);
+  uint32_t x = m_hashTable[bucket];
+
+  if (x == SFQ_EMPTY)
+    {
+      // the free slots are the slots of depth 0
+      x = m_depLinks[m_flows].next;
+      if (x >= m_flows)
+        {
+          return NO_FREE_SLOT_DROP;
+        }
+      m_hashTable[bucket] = x;
+      m_slots[x].bucket = bucket;
+    }
+
+  Slot &slot = m_slots[x];
+  if (slot.qlen >= m_depth)
+    {
+      return DEPTH_EXCEEDED_DROP;
+    }
+
+  NS_ASSERT (m_freeNode != SFQ_EMPTY);
+  uint32_t n = m_freeNode;
+  m_freeNode = m_nodes[n].next;
+  m_nodes[n].item = item;
+  m_nodes[n].classification = classification;
+  m_nodes[n].next = SFQ_EMPTY;
+  m_nodes[n].prev = slot.tail;
+  if (slot.tail == SFQ_EMPTY)
+    {
+      slot.head = n;
+    }
+  else
+    {
+      m_nodes[slot.tail].next = n;
+    }
+  slot.tail = n;
+  IncreaseDepth (x);
+
+  if (slot.qlen == 1)
+    {
+      // a new active slot is served after the slots already active
+      if (m_tail == SFQ_EMPTY)
+        {
+          slot.next = x;
+        }
+      else
+        {
+          slot.next = m_slots[m_tail].next;
+          m_slots[m_tail].next = x;
+        }
+      m_tail = x;
+      slot.allot = m_quantum;
+      m_nActiveSlots++;
+    }
+
+  return 0;
+}
+
+Ptr<QueueDiscItem>
+SFQQueueDisc::DoDequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_tail == SFQ_EMPTY)
+    {
+      NS_LOG_LOGIC ("No active slots");
+      return 0;
+    }
+
+  while (true)
+    {
+      uint32_t a = m_slots[m_tail].next;
+      Slot &slot = m_slots[a];
+      if (slot.allot <= 0)
+        {
+          NS_LOG_LOGIC ("Slot " << a << " out of deficit, moving to the next slot");
+          m_tail = a;
+          slot.allot += m_quantum;
+          continue;
+        }
+
+      Ptr<QueueDiscItem> item = PopHead (a);
+      PacketDequeued (item);
+      slot.allot -= item->GetSize ();
+      NS_LOG_LOGIC ("Dequeued packet " << item->GetPacket () << " from slot " << a);
+
+      if (slot.qlen == 0)
+        {
+          UnlinkSlot (a, m_tail);
+        }
+      return item;
+    }
+}
+
+Ptr<QueueDiscItem>
+SFQQueueDisc::DropFromLongestSlot (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_maxDepth > 1)
+    {
+      return PopTail (m_depLinks[m_flows + m_maxDepth].next);
+    }
+
+  // every slot holds a single packet: drop the packet of the next slot to serve
+  uint32_t x = m_slots[m_tail].next;
+  Ptr<QueueDiscItem> item = PopHead (x);
+  UnlinkSlot (x, m_tail);
+  return item;
+}
+
+void
+SFQQueueDisc::UnlinkSlot (uint32_t x, uint32_t prev)
+{
+  NS_LOG_FUNCTION (this << x << prev);
+
+  Slot &slot = m_slots[x];
+  m_hashTable[slot.bucket] = SFQ_EMPTY;
+  m_nActiveSlots--;
+
+  if (slot.next == x)
+    {
+      m_tail = SFQ_EMPTY;
+      return;
+    }
+  m_slots[prev].next = slot.next;
+  if (m_tail == x)
+    {
+      m_tail = prev;
+    }
+}
+
+void
+SFQQueueDisc::Perturb (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_perturbation = m_uv->GetInteger (0, std::numeric_limits<uint32_t>::max ());
+  m_nPerturbations++;
+  NS_LOG_DEBUG ("New seed of the hash: " << m_perturbation);
+
+  if (m_tail == SFQ_EMPTY)
+    {
+      return;
+    }
+
+  // take the packets out of the slots, in round robin order, and store them
+  // again in the slots of their new hash bucket. The packets of a flow are all
+  // in the same slot, hence their order is preserved
+  std::vector<std::pair<Ptr<QueueDiscItem>, int32_t> > packets;
+  packets.reserve (GetNPackets ());
+  uint32_t x = m_slots[m_tail].next;
+  for (uint32_t i = 0; i < m_nActiveSlots; i++)
+    {
+      for (uint32_t n = m_slots[x].head; n != SFQ_EMPTY; n = m_nodes[n].next)
+        {
+          packets.push_back (std::make_pair (m_nodes[n].item, m_nodes[n].classification));
+        }
+      x = m_slots[x].next;
+    }
+
+  ResetSlots ();
+  for (auto &p : packets)
+    {
+      const char* reason = Insert (p.first, p.second);
+      if (reason)
+        {
+          InlineDrop (p.first, reason);
+        }
+    }
+}
+
+void
+SFQQueueDisc::ResetSlots (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (uint32_t n = 0; n < m_nodes.size (); n++)
+    {
+      m_nodes[n].item = 0;
+      m_nodes[n].next = n + 1 < m_nodes.size () ? n + 1 : SFQ_EMPTY;
+      m_nodes[n].prev = SFQ_EMPTY;
+    }
+  m_freeNode = m_nodes.empty () ? SFQ_EMPTY : 0;
+
+  // the heads of the depth lists follow the links of the slots
+  for (uint32_t d = 0; d <= m_depth; d++)
+    {
+      m_depLinks[m_flows + d].next = m_flows + d;
+      m_depLinks[m_flows + d].prev = m_flows + d;
+    }
+  for (uint32_t x = 0; x < m_flows; x++)
+    {
+      Slot &slot = m_slots[x];
+      slot.head = SFQ_EMPTY;
+      slot.tail = SFQ_EMPTY;
+      slot.qlen = 0;
+      slot.bucket = SFQ_EMPTY;
+      slot.allot = 0;
+      slot.next = SFQ_EMPTY;
+      DepLinkSlot (x, 0);
+    }
+
+  m_hashTable.assign (m_divisor + 1, SFQ_EMPTY);
+  m_tail = SFQ_EMPTY;
+  m_maxDepth = 0;
+  m_nActiveSlots = 0;
+}
+
+void
+SFQQueueDisc::InlineDrop (Ptr<QueueDiscItem> item, const char* reason)
+{
+  // the packet left the inline FIFO, as if dequeued from an internal queue
+  PacketDequeued (item);
+  DropAfterDequeue (item, reason);
+}
+
+void
+SFQQueueDisc::DepLinkSlot (uint32_t x, uint32_t depth)
+{
+  uint32_t h = m_flows + depth;
+  uint32_t n = m_depLinks[h].next;
+  m_depLinks[x].next = n;
+  m_depLinks[x].prev = h;
+  m_depLinks[n].prev = x;
+  m_depLinks[h].next = x;
+}
+
+void
+SFQQueueDisc::DepUnlinkSlot (uint32_t x)
+{
+  uint32_t p = m_depLinks[x].prev;
+  uint32_t n = m_depLinks[x].next;
+  m_depLinks[p].next = n;
+  m_depLinks[n].prev = p;
+}
+
+void
+SFQQueueDisc::IncreaseDepth (uint32_t x)
+{
+  Slot &slot = m_slots[x];
+  DepUnlinkSlot (x);
+  slot.qlen++;
+  if (slot.qlen > m_maxDepth)
+    {
+      m_maxDepth = slot.qlen;
+    }
+  DepLinkSlot (x, slot.qlen);
+}
+
+void
+SFQQueueDisc::DecreaseDepth (uint32_t x)
+{
+  Slot &slot = m_slots[x];
+  DepUnlinkSlot (x);
+  uint32_t h = m_flows + slot.qlen;
+  if (slot.qlen == m_maxDepth && m_depLinks[h].next == h)
+    {
+      m_maxDepth--;
+    }
+  slot.qlen--;
+  DepLinkSlot (x, slot.qlen);
+}
+
+Ptr<QueueDiscItem>
+SFQQueueDisc::PopHead (uint32_t x)
+{
+  Slot &slot = m_slots[x];
+  uint32_t n = slot.head;
+  NS_ASSERT (n != SFQ_EMPTY);
+  Ptr<QueueDiscItem> item = m_nodes[n].item;
+
+  slot.head = m_nodes[n].next;
+  if (slot.head == SFQ_EMPTY)
+    {
+      slot.tail = SFQ_EMPTY;
+    }
+  else
+    {
+      m_nodes[slot.head].prev = SFQ_EMPTY;
+    }
+
+  m_nodes[n].item = 0;
+  m_nodes[n].next = m_freeNode;
+  m_freeNode = n;
+  DecreaseDepth (x);
+  return item;
+}
+
+Ptr<QueueDiscItem>
+SFQQueueDisc::PopTail (uint32_t x)
+{
+  Slot &slot = m_slots[x];
+  uint32_t n = slot.tail;
+  NS_ASSERT (n != SFQ_EMPTY);
+  Ptr<QueueDiscItem> item = m_nodes[n].item;
+
+  slot.tail = m_nodes[n].prev;
+  if (slot.tail == SFQ_EMPTY)
+    {
+      slot.head = SFQ_EMPTY;
+    }
+  else
+    {
+      m_nodes[slot.tail].next = SFQ_EMPTY;
+    }
+
+  m_nodes[n].item = 0;
+  m_nodes[n].next = m_freeNode;
+  m_freeNode = n;
+  DecreaseDepth (x);
+  return item;
+}
+
+bool
+SFQQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (GetNQueueDiscClasses () > 0)
+    {
+      NS_LOG_ERROR ("SFQQueueDisc cannot have classes");
+      return false;
+    }
+
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("SFQQueueDisc cannot have internal queues");
+      return false;
+    }
+
+  if (GetMaxSize ().GetUnit () != QueueSizeUnit::PACKETS)
+    {
+      NS_LOG_ERROR ("The maximum size of SFQQueueDisc must be in packets");
+      return false;
+    }
+
+  if (m_flows >= SFQ_EMPTY - m_depth)
+    {
+      NS_LOG_ERROR ("Too many slots");
+      return false;
+    }
+
+  if (GetNPacketFilters () == 0)
+    {
+      AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRIpv6PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRNonIpPacketFilter> ());
+    }
+
+  if (m_quantum == 0)
+    {
+      Ptr<NetDeviceQueueInterface> ndqi = GetNetDeviceQueueInterface ();
+      Ptr<NetDevice> dev;
+      // if the NetDeviceQueueInterface object is aggregated to a
+      // NetDevice, get the MTU of such NetDevice
+      if (ndqi && (dev = ndqi->GetObject<NetDevice> ()))
+        {
+          m_quantum = dev->GetMtu ();
+        }
+      else
+        {
+          m_quantum = 1500;
+        }
+      NS_LOG_DEBUG ("Setting the quantum to: " << m_quantum);
+    }
+
+  return true;
+}
+
+void
+SFQQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // a packet in excess of the limit is stored before one is dropped
+  m_nodes.resize (GetMaxSize ().GetValue () + 1);
+  m_slots.resize (m_flows);
+  m_depLinks.resize (m_flows + m_depth + 1);
+  ResetSlots ();
+
+  if (m_perturbPeriod.IsStrictlyPositive ())
+    {
+      m_perturbation = m_uv->GetInteger (0, std::numeric_limits<uint32_t>::max ());
+      m_nextPerturbation = Simulator::Now () + m_perturbPeriod;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,249 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SFQ_QUEUE_DISC
+#define SFQ_QUEUE_DISC
+
+#include "ns3/queue-disc.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief A Stochastic Fairness Queueing packet queue disc
+ *
+ * SFQ, as the Linux sfq queue disc, serves a fixed array of Flows slots in
+ * deficit round robin order. The packet filters (by default, the DRR filters)
+ * hash a packet, and the hash, perturbed by a random seed, selects one of
+ * Divisor hash buckets, which is mapped to a slot while the slot holds
+ * packets. The packets of a slot are stored in an inline FIFO, whose nodes
+ * are taken from a pool of MaxSize nodes shared by the slots, so the memory
+ * of the queue disc is bounded by the number of slots and MaxSize and no
+ * child queue disc is created.
+ *
+ * The slots are linked in lists indexed by their depth (the number of packets
+ * they hold), so the enqueue, the dequeue and the drop from the longest slot
+ * when the queue disc is full all take constant time.
+ *
+ * Flows whose hashes collide share a slot. The seed is replaced every
+ * PerturbPeriod, on the first enqueue after the period elapses (so an idle
+ * queue disc schedules no event), and the packets are then moved to the
+ * slots of their new hash, so that colliding flows are not penalized for
+ * long.
+ */
+class SFQQueueDisc : public QueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief SFQQueueDisc constructor
+   */
+  SFQQueueDisc ();
+
+  virtual ~SFQQueueDisc ();
+
+  /**
+   * \brief Get the number of slots holding packets
+   * \return the number of active slots
+   */
+  uint32_t GetNActiveSlots (void) const;
+
+  /**
+   * \brief Get the number of packets held by the slot of a hash bucket
+   * \param bucket the hash bucket
+   * \return the number of packets, 0 if no slot is mapped to the bucket
+   */
+  uint32_t GetBucketNPackets (uint32_t bucket) const;
+
+  /**
+   * \brief Get the hash bucket of a classification, with the current seed
+   * \param classification the result of the packet filters
+   * \return the hash bucket
+   */
+  uint32_t GetBucket (int32_t classification) const;
+
+  /**
+   * \brief Get the number of times the seed of the hash has been replaced
+   * \return the number of perturbations
+   */
+  uint64_t GetNPerturbations (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.  Return the number of streams (possibly zero) that
+   * have been assigned.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  // Reasons for dropping packets
+  static constexpr const char* OVERLIMIT_DROP = "Overlimit drop";          //!< Dropped from the longest slot when the queue disc is full
+  static constexpr const char* DEPTH_EXCEEDED_DROP = "Depth limit exceeded";  //!< The slot of the packet holds Depth packets
+  static constexpr const char* NO_FREE_SLOT_DROP = "No free slot";         //!< All the slots hold packets of other buckets
+
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
+
+private:
+  /// A slot, with its inline FIFO and its links
+  struct Slot
+  {
+    uint32_t head;     //!< Node of the packet at the head of the FIFO
+    uint32_t tail;     //!< Node of the packet at the tail of the FIFO
+    uint32_t qlen;     //!< Number of packets
+    uint32_t bucket;   //!< Hash bucket mapped to the slot
+    int32_t allot;     //!< Deficit, in bytes
+    uint32_t next;     //!< Next slot in the ring of active slots
+  };
+
+  /// A packet in the inline FIFO of a slot
+  struct Node
+  {
+    Ptr<QueueDiscItem> item;  //!< The packet
+    int32_t classification;   //!< The result of the packet filters
+    uint32_t next;            //!< Next node in the FIFO, or in the free list
+    uint32_t prev;            //!< Previous node in the FIFO
+  };
+
+  /// The links of a slot in the list of the slots of its depth
+  struct DepLink
+  {
+    uint32_t next;  //!< Next element of the list
+    uint32_t prev;  //!< Previous element of the list
+  };
+
+  virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual bool CheckConfig (void);
+  virtual void InitializeParams (void);
+
+  /**
+   * \brief Store a packet in the slot of its hash bucket
+   * \param item the packet
+   * \param classification the result of the packet filters
+   * \return the reason why the packet must be dropped, or 0 if it is stored
+   */
+  const char* Insert (Ptr<QueueDiscItem> item, int32_t classification);
+
+  /**
+   * \brief Drop a packet from the tail of the longest slot or, if every
+   *        slot holds a single packet, the packet of the next slot to serve
+   * \return the dropped packet
+   */
+  Ptr<QueueDiscItem> DropFromLongestSlot (void);
+
+  /**
+   * \brief Unlink an empty slot from the ring of active slots and free its
+   *        hash bucket
+   * \param x the slot
+   * \param prev the slot before it in the ring
+   */
+  void UnlinkSlot (uint32_t x, uint32_t prev);
+
+  /**
+   * \brief Replace the seed of the hash and move the packets to the slots of
+   *        their new hash bucket
+   */
+  void Perturb (void);
+
+  /**
+   * \brief Empty all the slots, the hash table and the inline FIFOs
+   */
+  void ResetSlots (void);
+
+  /**
+   * \brief Drop a packet removed from an inline FIFO
+   * \param item the packet
+   * \param reason the reason why the packet is dropped
+   */
+  void InlineDrop (Ptr<QueueDiscItem> item, const char* reason);
+
+  /**
+   * \brief Insert a slot at the head of the list of a depth
+   * \param x the slot
+   * \param depth the depth
+   */
+  void DepLinkSlot (uint32_t x, uint32_t depth);
+
+  /**
+   * \brief Unlink a slot from the list of its depth
+   * \param x the slot
+   */
+  void DepUnlinkSlot (uint32_t x);
+
+  /**
+   * \brief Move a slot whose FIFO has grown by one packet to the next depth
+   * \param x the slot
+   */
+  void IncreaseDepth (uint32_t x);
+
+  /**
+   * \brief Move a slot whose FIFO has shrunk by one packet to the previous depth
+   * \param x the slot
+   */
+  void DecreaseDepth (uint32_t x);
+
+  /**
+   * \brief Remove the packet at the head of the FIFO of a slot
+   * \param x the slot
+   * \return the packet
+   */
+  Ptr<QueueDiscItem> PopHead (uint32_t x);
+
+  /**
+   * \brief Remove the packet at the tail of the FIFO of a slot
+   * \param x the slot
+   * \return the packet
+   */
+  Ptr<QueueDiscItem> PopTail (uint32_t x);
+
+  uint32_t m_flows;          //!< Number of slots
+  uint32_t m_divisor;        //!< Number of hash buckets
+  uint32_t m_depth;          //!< Maximum number of packets of a slot
+  uint32_t m_quantum;        //!< Bytes credited to a slot in each round
+  Time m_perturbPeriod;      //!< Period of the perturbation of the hash (0 disables it)
+
+  std::vector<Slot> m_slots;       //!< The slots
+  std::vector<Node> m_nodes;       //!< The nodes of the inline FIFOs
+  std::vector<DepLink> m_depLinks; //!< The links of the slots, followed by the heads of the depth lists
+  std::vector<uint32_t> m_hashTable; //!< Slot mapped to each hash bucket
+  uint32_t m_freeNode;       //!< Head of the free list of nodes
+  uint32_t m_tail;           //!< Slot served last, whose next slot is served next
+  uint32_t m_maxDepth;       //!< Depth of the longest slot
+  uint32_t m_nActiveSlots;   //!< Number of slots holding packets
+  uint32_t m_perturbation;   //!< Seed of the hash
+  Time m_nextPerturbation;   //!< Time after which the seed is replaced
+  uint64_t m_nPerturbations; //!< Number of perturbations
+  Ptr<UniformRandomVariable> m_uv;  //!< Random variable for the seed
+};
+
+} // namespace ns3
+
+#endif /* SFQ_QUEUE_DISC */
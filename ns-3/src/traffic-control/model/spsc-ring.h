@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief A bounded lock-free ring with a single producer and a single consumer
+ *
+ * Push must only be called by the producer thread and Pop only by the
+ * consumer thread. The slot of an element is written before the element is
+ * published (release store of the tail) and read after it has been observed
+ * (acquire load of the tail), so an element is only ever accessed by one
+ * thread at a time. Likewise, the producer reuses a slot only after the
+ * consumer has released it. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+  /**
+   * \brief Constructor
+   * \param capacity the minimum number of elements the ring can hold
+   */
+  explicit SpscRing (uint32_t capacity)
+    : m_head (0),
+      m_tail (0)
+  {
+    uint32_t size = 1;
+    while (size < capacity)
+      {
+        size <<= 1;
+      }
+    m_slots.resize (size);
+    m_mask = size - 1;
+  }
+
+  /**
+   * \brief Append an element to the ring (producer thread only)
+   * \param element the element
+   * \return false if the ring is full
+   */
+  bool Push (const T &element)
+  {
+    uint32_t tail = m_tail.load (std::memory_order_relaxed);
+    if (tail - m_head.load (std::memory_order_acquire) > m_mask)
+      {
+        return false;
+      }
+    m_slots[tail & m_mask] = element;
+    m_tail.store (tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Remove the element at the head of the ring (consumer thread only)
+   * \param element the element removed, if any
+   * \return false if the ring is empty
+   */
+  bool Pop (T &element)
+  {
+    uint32_t head = m_head.load (std::memory_order_relaxed);
+    if (head == m_tail.load (std::memory_order_acquire))
+      {
+        return false;
+      }
+    element = m_slots[head & m_mask];
+    // release the resources held by the slot before handing it back
+    m_slots[head & m_mask] = T ();
+    m_head.store (head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Get the capacity of the ring
+   * \return the maximum number of elements the ring can hold
+   */
+  uint32_t GetCapacity (void) const
+  {
+    return m_mask + 1;
+  }
+
+private:
+  std::vector<T> m_slots;           //!< Storage of the elements
+  uint32_t m_mask;                  //!< Capacity minus one
+  // the indices are kept on separate cache lines, so that publishing a change
+  // of one index does not invalidate the line of the other one
+  std::atomic<uint32_t> m_head;     //!< Index of the next element to pop, written by the consumer
+  char m_pad[64];                   //!< Padding between the indices
+  std::atomic<uint32_t> m_tail;     //!< Index of the next slot to push, written by the producer
+};
+
+} // namespace ns3
+
+#endif /* SPSC_RING_H */
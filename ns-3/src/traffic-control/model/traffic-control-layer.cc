@@ -72,6 +72,7 @@ TrafficControlLayer::DoDispose (void)
   m_node = 0;
   m_handlers.clear ();
   m_netDevices.clear ();
+  m_otherNetDevices.clear ();
   Object::DoDispose ();
 }
 
@@ -84,6 +85,13 @@ TrafficControlLayer::DoInitialize (void)
 
   // initialize the root queue discs
   for (auto& ndi : m_netDevices)
+    {
+      if (ndi.m_rootQueueDisc)
+        {
+          ndi.m_rootQueueDisc->Initialize ();
+        }
+    }
+  for (auto& ndi : m_otherNetDevices)
     {
       if (ndi.second.m_rootQueueDisc)
         {
@@ -126,11 +134,11 @@ TrafficControlLayer::ScanDevices (void)
       // note: there may be no NetDeviceQueueInterface aggregated to the device
       Ptr<NetDeviceQueueInterface> ndqi = dev->GetObject<NetDeviceQueueInterface> ();
 
-      std::map<Ptr<NetDevice>, NetDeviceInfo>::iterator ndi = m_netDevices.find (dev);
+      NetDeviceInfo* ndi = GetNetDeviceInfo (dev);
 
-      if (ndi != m_netDevices.end ())
+      if (ndi)
         {
-          ndi->second.m_ndqi = ndqi;
+          ndi->m_ndqi = ndqi;
         }
       else if (ndqi)
       // if no entry for the device is found, it means that no queue disc has been
@@ -139,14 +147,14 @@ TrafficControlLayer::ScanDevices (void)
       // the Traffic Control layer checks whether the device queue is stopped even
       // when there is no queue disc.
         {
-          m_netDevices[dev] = {nullptr, ndqi, QueueDiscVector ()};
-          ndi = m_netDevices.find (dev);
+          ndi = AddNetDeviceInfo (dev);
+          ndi->m_ndqi = ndqi;
         }
 
       // if a queue disc is installed, set the wake callbacks on netdevice queues
-      if (ndi != m_netDevices.end () && ndi->second.m_rootQueueDisc)
+      if (ndi && ndi->m_rootQueueDisc)
         {
-          ndi->second.m_queueDiscsToWake.clear ();
+          ndi->m_queueDiscsToWake.clear ();
 
           if (ndqi)
             {
@@ -154,16 +162,16 @@ TrafficControlLayer::ScanDevices (void)
                 {
                   Ptr<QueueDisc> qd;
 
-                  if (ndi->second.m_rootQueueDisc->GetWakeMode () == QueueDisc::WAKE_ROOT)
+                  if (ndi->m_rootQueueDisc->GetWakeMode () == QueueDisc::WAKE_ROOT)
                     {
-                      qd = ndi->second.m_rootQueueDisc;
+                      qd = ndi->m_rootQueueDisc;
                     }
-                  else if (ndi->second.m_rootQueueDisc->GetWakeMode () == QueueDisc::WAKE_CHILD)
+                  else if (ndi->m_rootQueueDisc->GetWakeMode () == QueueDisc::WAKE_CHILD)
                     {
-                      NS_ABORT_MSG_IF (ndi->second.m_rootQueueDisc->GetNQueueDiscClasses () != ndqi->GetNTxQueues (),
+                      NS_ABORT_MSG_IF (ndi->m_rootQueueDisc->GetNQueueDiscClasses () != ndqi->GetNTxQueues (),
                                       "The number of child queue discs does not match the number of netdevice queues");
 
-                      qd = ndi->second.m_rootQueueDisc->GetQueueDiscClass (i)->GetQueueDisc ();
+                      qd = ndi->m_rootQueueDisc->GetQueueDiscClass (i)->GetQueueDisc ();
                     }
                   else
                     {
@@ -171,17 +179,17 @@ TrafficControlLayer::ScanDevices (void)
                     }
 
                   ndqi->GetTxQueue (i)->SetWakeCallback (MakeCallback (&QueueDisc::Run, qd));
-                  ndi->second.m_queueDiscsToWake.push_back (qd);
+                  ndi->m_queueDiscsToWake.push_back (qd);
                 }
             }
           else
             {
-              ndi->second.m_queueDiscsToWake.push_back (ndi->second.m_rootQueueDisc);
+              ndi->m_queueDiscsToWake.push_back (ndi->m_rootQueueDisc);
             }
 
           // set the NetDeviceQueueInterface object and the SendCallback on the queue discs
           // into which packets are enqueued and dequeued by calling Run
-          for (auto& q : ndi->second.m_queueDiscsToWake)
+          for (auto& q : ndi->m_queueDiscsToWake)
             {
               q->SetNetDeviceQueueInterface (ndqi);
               q->SetSendCallback ([dev] (Ptr<QueueDiscItem> item)
@@ -196,21 +204,21 @@ TrafficControlLayer::SetRootQueueDiscOnDevice (Ptr<NetDevice> device, Ptr<QueueD
 {
   NS_LOG_FUNCTION (this << device << qDisc);
 
-  std::map<Ptr<NetDevice>, NetDeviceInfo>::iterator ndi = m_netDevices.find (device);
+  NetDeviceInfo* ndi = GetNetDeviceInfo (device);
 
-  if (ndi == m_netDevices.end ())
+  if (!ndi)
     {
       // No entry found for this device. Create one.
-      m_netDevices[device] = {qDisc, nullptr, QueueDiscVector ()};
+      ndi = AddNetDeviceInfo (device);
     }
   else
     {
-      NS_ABORT_MSG_IF (ndi->second.m_rootQueueDisc,
+      NS_ABORT_MSG_IF (ndi->m_rootQueueDisc,
                        "Cannot install a root queue disc on a device already having one. "
                        "Delete the existing queue disc first.");
-
-      ndi->second.m_rootQueueDisc = qDisc;
     }
+
+  ndi->m_rootQueueDisc = qDisc;
 }
 
 Ptr<QueueDisc>
@@ -218,13 +226,13 @@ TrafficControlLayer::GetRootQueueDiscOnDevice (Ptr<NetDevice> device) const
 {
   NS_LOG_FUNCTION (this << device);
 
-  std::map<Ptr<NetDevice>, NetDeviceInfo>::const_iterator ndi = m_netDevices.find (device);
+  const NetDeviceInfo* ndi = GetNetDeviceInfo (device);
 
-  if (ndi == m_netDevices.end ())
+  if (!ndi)
     {
       return 0;
     }
-  return ndi->second.m_rootQueueDisc;
+  return ndi->m_rootQueueDisc;
 }
 
 Ptr<QueueDisc>
@@ -234,26 +242,110 @@ TrafficControlLayer::GetRootQueueDiscOnDeviceByIndex (uint32_t index) const
   return GetRootQueueDiscOnDevice (m_node->GetDevice (index));
 }
 
+bool
+TrafficControlLayer::IsIndexed (Ptr<NetDevice> device) const
+{
+  uint32_t index = device->GetIfIndex ();
+  return m_node && index < m_node->GetNDevices () && m_node->GetDevice (index) == device;
+}
+
+TrafficControlLayer::NetDeviceInfo*
+TrafficControlLayer::GetNetDeviceInfo (Ptr<NetDevice> device)
+{
+  uint32_t index = device->GetIfIndex ();
+  if (index < m_netDevices.size () && m_netDevices[index].m_device == device)
+    {
+      return &m_netDevices[index];
+    }
+  if (m_otherNetDevices.empty ())
+    {
+      return 0;
+    }
+
+  std::map<Ptr<NetDevice>, NetDeviceInfo>::iterator it = m_otherNetDevices.find (device);
+  if (it == m_otherNetDevices.end ())
+    {
+      return 0;
+    }
+  if (!IsIndexed (device))
+    {
+      return &it->second;
+    }
+
+  // the device has been added to the node since its entry was created: move
+  // the entry to the slot of the interface index of the device
+  NetDeviceInfo info = it->second;
+  m_otherNetDevices.erase (it);
+  NetDeviceInfo* ndi = AddNetDeviceInfo (device);
+  *ndi = info;
+  return ndi;
+}
+
+const TrafficControlLayer::NetDeviceInfo*
+TrafficControlLayer::GetNetDeviceInfo (Ptr<NetDevice> device) const
+{
+  uint32_t index = device->GetIfIndex ();
+  if (index < m_netDevices.size () && m_netDevices[index].m_device == device)
+    {
+      return &m_netDevices[index];
+    }
+
+  std::map<Ptr<NetDevice>, NetDeviceInfo>::const_iterator it = m_otherNetDevices.find (device);
+  if (it != m_otherNetDevices.end ())
+    {
+      return &it->second;
+    }
+  return 0;
+}
+
+TrafficControlLayer::NetDeviceInfo*
+TrafficControlLayer::AddNetDeviceInfo (Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (this << device);
+
+  if (!IsIndexed (device))
+    {
+      // the interface index of a device is only meaningful once the device is
+      // added to the node, hence keep the entry in the map until then
+      NS_LOG_DEBUG ("Device " << device << " not installed on node " << m_node);
+      NetDeviceInfo* ndi = &m_otherNetDevices[device];
+      ndi->m_device = device;
+      return ndi;
+    }
+
+  uint32_t index = device->GetIfIndex ();
+  if (index >= m_netDevices.size ())
+    {
+      m_netDevices.resize (index + 1);
+    }
+  NS_ABORT_MSG_IF (m_netDevices[index].m_device,
+                   "Interface index " << index << " is already used by device "
+                   << m_netDevices[index].m_device << ": is device " << device
+                   << " installed on the node of this Traffic Control layer?");
+  m_netDevices[index].m_device = device;
+  return &m_netDevices[index];
+}
+
 void
 TrafficControlLayer::DeleteRootQueueDiscOnDevice (Ptr<NetDevice> device)
 {
   NS_LOG_FUNCTION (this << device);
 
-  std::map<Ptr<NetDevice>, NetDeviceInfo>::iterator ndi = m_netDevices.find (device);
+  NetDeviceInfo* ndi = GetNetDeviceInfo (device);
 
-  NS_ASSERT_MSG (ndi != m_netDevices.end () && ndi->second.m_rootQueueDisc != 0,
+  NS_ASSERT_MSG (ndi && ndi->m_rootQueueDisc != 0,
                  "No root queue disc installed on device " << device);
 
   // remove the root queue disc
-  ndi->second.m_rootQueueDisc = 0;
-  for (auto& q : ndi->second.m_queueDiscsToWake)
+  ndi->m_rootQueueDisc = 0;
+  for (auto& q : ndi->m_queueDiscsToWake)
     {
       q->SetNetDeviceQueueInterface (nullptr);
       q->SetSendCallback (nullptr);
     }
-  ndi->second.m_queueDiscsToWake.clear ();
+  ndi->m_queueDiscsToWake.clear ();
 
-  Ptr<NetDeviceQueueInterface> ndqi = ndi->second.m_ndqi;
+  Ptr<NetDeviceQueueInterface> ndqi = ndi->m_ndqi;
   if (ndqi)
     {
       // remove configured callbacks, if any
@@ -262,10 +354,10 @@ TrafficControlLayer::DeleteRootQueueDiscOnDevice (Ptr<NetDevice> device)
           ndqi->GetTxQueue (i)->SetWakeCallback (MakeNullCallback <void> ());
         }
     }
-  else
+  else if (!m_otherNetDevices.erase (device))
     {
       // remove the empty entry
-      m_netDevices.erase (ndi);
+      *ndi = NetDeviceInfo ();
     }
 }
 
@@ -340,11 +432,11 @@ TrafficControlLayer::Send (Ptr<NetDevice> device, Ptr<QueueDiscItem> item)
                 item->GetProtocol ());
 
   Ptr<NetDeviceQueueInterface> devQueueIface;
-  std::map<Ptr<NetDevice>, NetDeviceInfo>::iterator ndi = m_netDevices.find (device);
+  NetDeviceInfo* ndi = GetNetDeviceInfo (device);
 
-  if (ndi != m_netDevices.end ())
+  if (ndi)
     {
-      devQueueIface = ndi->second.m_ndqi;
+      devQueueIface = ndi->m_ndqi;
     }
 
   // determine the transmission queue of the device where the packet will be enqueued
@@ -352,17 +444,16 @@ TrafficControlLayer::Send (Ptr<NetDevice> device, Ptr<QueueDiscItem> item)
   if (devQueueIface && devQueueIface->GetNTxQueues () > 1)
     {
       txq = devQueueIface->GetSelectQueueCallback () (item);
-      // otherwise, Linux determines the queue index by using a hash function
-      // and associates such index to the socket which the packet belongs to,
-      // so that subsequent packets of the same socket will be mapped to the
-      // same tx queue (__netdev_pick_tx function in net/core/dev.c). It is
-      // pointless to implement this in ns-3 because currently the multi-queue
-      // devices provide a select queue callback
+      // Linux determines the queue index by using a hash function (__netdev_pick_tx
+      // function in net/core/dev.c) when the device does not provide a select queue
+      // callback. In ns-3, such a hash based selection can be obtained by setting
+      // the callback returned by DRRQueueDisc::MakeFlowHashSelectQueueCallback,
+      // e.g., through TrafficControlHelper::SetFlowHashTxQueueSelection
     }
 
   NS_ASSERT (!devQueueIface || txq < devQueueIface->GetNTxQueues ());
 
-  if (ndi == m_netDevices.end () || ndi->second.m_rootQueueDisc == 0)
+  if (!ndi || ndi->m_rootQueueDisc == 0)
     {
       // The device has no attached queue disc, thus add the header to the packet and
       // send it directly to the device if the selected queue is not stopped
@@ -382,12 +473,13 @@ TrafficControlLayer::Send (Ptr<NetDevice> device, Ptr<QueueDiscItem> item)
     {
       // Enqueue the packet in the queue disc associated with the netdevice queue
       // selected for the packet and try to dequeue packets from such queue disc
+      // (possibly through a single run for all the packets enqueued at this time)
       item->SetTxQueueIndex (txq);
 
-      Ptr<QueueDisc> qDisc = ndi->second.m_queueDiscsToWake[txq];
+      Ptr<QueueDisc> qDisc = ndi->m_queueDiscsToWake[txq];
       NS_ASSERT (qDisc);
       qDisc->Enqueue (item);
-      qDisc->Run ();
+      qDisc->ScheduleRun ();
     }
 }
 
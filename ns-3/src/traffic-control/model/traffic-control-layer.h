@@ -85,6 +85,10 @@ class NetDeviceQueueInterface;
  * Discrimination through callbacks (in other words: what is the right upper-layer
  * callback for this packet?) is done through checks over the device and the
  * protocol number.
+ *
+ * The information about each device (root queue disc, NetDeviceQueueInterface
+ * and queue discs to wake) is stored in a vector indexed by the interface
+ * index of the device, so that sending a packet does not require any lookup.
  */
 class TrafficControlLayer : public Object
 {
@@ -229,6 +233,7 @@ private:
    */
   struct NetDeviceInfo
   {
+    Ptr<NetDevice> m_device;              //!< the device (null if the entry is unused)
     Ptr<QueueDisc> m_rootQueueDisc;       //!< the root queue disc on the device
     Ptr<NetDeviceQueueInterface> m_ndqi;  //!< the netdevice queue interface
     QueueDiscVector m_queueDiscsToWake;   //!< the vector of queue discs to wake
@@ -249,10 +254,41 @@ private:
    */
   Ptr<QueueDisc> GetRootQueueDiscOnDeviceByIndex (uint32_t index) const;
 
+  /**
+   * \brief Check whether the information for a device is stored at the
+   *        interface index of the device
+   * \param device the device
+   * \return true if the device has been added to the node at its interface index
+   */
+  bool IsIndexed (Ptr<NetDevice> device) const;
+
+  /**
+   * \brief Get the information stored for a device
+   * \param device the device
+   * \return the information stored for the device, or null if there is none
+   */
+  NetDeviceInfo* GetNetDeviceInfo (Ptr<NetDevice> device);
+
+  /**
+   * \brief Get the information stored for a device
+   * \param device the device
+   * \return the information stored for the device, or null if there is none
+   */
+  const NetDeviceInfo* GetNetDeviceInfo (Ptr<NetDevice> device) const;
+
+  /**
+   * \brief Create the entry storing the information for a device
+   * \param device the device
+   * \return the (empty) information stored for the device
+   */
+  NetDeviceInfo* AddNetDeviceInfo (Ptr<NetDevice> device);
+
   /// The node this TrafficControlLayer object is aggregated to
   Ptr<Node> m_node;
-  /// Map storing the required information for each device with a queue disc installed
-  std::map<Ptr<NetDevice>, NetDeviceInfo> m_netDevices;
+  /// Information stored for each device, indexed by the interface index of the device
+  std::vector<NetDeviceInfo> m_netDevices;
+  /// Information stored for the devices not (yet) added to the node
+  std::map<Ptr<NetDevice>, NetDeviceInfo> m_otherNetDevices;
   ProtocolHandlerList m_handlers;  //!< List of upper-layer handlers
 };
 
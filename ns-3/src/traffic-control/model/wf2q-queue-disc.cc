@@ -0,0 +1,463 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/ipv4-packet-filter.h"
+#include "ns3/ipv6-packet-filter.h"
+#include "wf2q-queue-disc.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("WF2QQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED (WF2QQueueDisc);
+
+TypeId WF2QQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::WF2QQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<WF2QQueueDisc> ()
+    .AddAttribute ("MaxSize",
+                   "The maximum number of packets accepted by this queue disc",
+                   QueueSizeValue (QueueSize ("1000p")),
+                   MakeQueueSizeAccessor (&QueueDisc::SetMaxSize,
+                                          &QueueDisc::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Flows",
+                   "The number of queues into which the incoming packets are classified",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&WF2QQueueDisc::m_flows),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Scheduler",
+                   "The scheduler selecting the next packet",
+                   EnumValue (WF2Q_PLUS),
+                   MakeEnumAccessor (&WF2QQueueDisc::m_scheduler),
+                   MakeEnumChecker (WF2Q_PLUS, "Wf2qPlus",
+                                    STFQ, "Stfq"))
+    .AddAttribute ("WeightKey",
+                   "The key used to look up the weight of a flow in the Weights map",
+                   EnumValue (DRRQueueDisc::WEIGHT_NONE),
+                   MakeEnumAccessor (&WF2QQueueDisc::m_weightKey),
+                   MakeEnumChecker (DRRQueueDisc::WEIGHT_NONE, "None",
+                                    DRRQueueDisc::WEIGHT_BY_CLASS, "Class",
+                                    DRRQueueDisc::WEIGHT_BY_FLOW_TYPE, "FlowType",
+                                    DRRQueueDisc::WEIGHT_BY_DSCP, "Dscp"))
+    .AddAttribute ("Weights",
+                   "The weights of the flows, as a list of key:weight pairs. "
+                   "A flow of weight w gets w times the service of a flow of weight 1.",
+                   DRRWeightMapValue (DRRWeightMap ()),
+                   MakeDRRWeightMapAccessor (&WF2QQueueDisc::m_weights),
+                   MakeDRRWeightMapChecker ())
+  ;
+  return tid;
+}
+
+WF2QQueueDisc::WF2QQueueDisc ()
+  : QueueDisc (QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::PACKETS),
+    m_flows (1024),
+    m_scheduler (WF2Q_PLUS),
+    m_weightKey (DRRQueueDisc::WEIGHT_NONE),
+    m_virtualTime (0),
+    m_weightSum (0),
+    m_maxFinish (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+WF2QQueueDisc::~WF2QQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+WF2QQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_flowTable.clear ();
+  m_eligible.clear ();
+  m_pending.clear ();
+  m_backlog.clear ();
+  QueueDisc::DoDispose ();
+}
+
+uint32_t
+WF2QQueueDisc::GetNBackloggedFlows (void) const
+{
+  return m_eligible.size () + m_pending.size ();
+}
+
+uint32_t
+WF2QQueueDisc::GetFlowNPackets (uint32_t index) const
+{
+  NS_ASSERT (index < m_flowTable.size ());
+  return m_flowTable[index].packets.size ();
+}
+
+uint64_t
+WF2QQueueDisc::GetVirtualTime (void) const
+{
+  return m_virtualTime;
+}
+
+uint64_t
+WF2QQueueDisc::Cost (uint32_t size, uint64_t weight)
+{
+  return size * WF2Q_SCALE / weight;
+}
+
+bool
+WF2QQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+
+  int32_t ret = Classify (item);
+  uint32_t h;
+
+  if (ret == PacketFilter::PF_NO_MATCH)
+    {
+      NS_LOG_WARN ("No filter has been able to classify this packet.");
+      h = m_flows; // place all unfiltered packets into a separate flow queue
+    }
+  else
+    {
+      h = ret % m_flows;
+    }
+
+  while (GetCurrentSize () + item > GetMaxSize ())
+    {
+      // make room by dropping from the tail of the longest flow, unless it is
+      // the flow of the packet or dropping would leave it empty
+      uint32_t x = m_backlog.empty () ? h : m_backlog.front ();
+      Flow &longest = m_flowTable[x];
+      if (x == h || longest.packets.size () < 2
+          || longest.bytes <= m_flowTable[h].bytes + item->GetSize ())
+        {
+          NS_LOG_LOGIC ("Queue disc limit exceeded -- dropping packet");
+          DropBeforeEnqueue (item, LIMIT_EXCEEDED_DROP);
+          return false;
+        }
+      Ptr<QueueDiscItem> victim = longest.packets.back ();
+      longest.packets.pop_back ();
+      longest.bytes -= victim->GetSize ();
+      UpdateBacklog (x, false);
+      NS_LOG_LOGIC ("Queue disc limit exceeded -- dropping packet of flow " << x);
+      PacketDequeued (victim);
+      DropAfterDequeue (victim, OVERLIMIT_DROP);
+    }
+
+  Flow &flow = m_flowTable[h];
+  flow.packets.push_back (item);
+  flow.bytes += item->GetSize ();
+  UpdateBacklog (h, true);
+  PacketEnqueued (item);
+
+  if (flow.packets.size () == 1)
+    {
+      // the flow becomes backlogged: its start time is the virtual time,
+      // unless its last packet has not finished yet in virtual time
+      flow.weight = std::max<uint32_t> (DRRQueueDisc::GetWeight (m_weights, m_weightKey, item, h), 1);
+      flow.start = std::max (m_virtualTime, flow.finish);
+      flow.finish = flow.start + Cost (item->GetSize (), flow.weight);
+      m_weightSum += flow.weight;
+      NS_LOG_DEBUG ("Flow " << h << " backlogged, start " << flow.start << " finish " << flow.finish);
+      Schedule (h);
+    }
+
+  return true;
+}
+
+Ptr<QueueDiscItem>
+WF2QQueueDisc::DoDequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_eligible.empty () && m_pending.empty ())
+    {
+      NS_LOG_LOGIC ("Queue empty");
+      return 0;
+    }
+
+  uint32_t x;
+  if (m_scheduler == WF2Q_PLUS)
+    {
+      // no packet is eligible: the virtual time jumps to the smallest start time
+      if (m_eligible.empty () && m_flowTable[m_pending.front ()].start > m_virtualTime)
+        {
+          m_virtualTime = m_flowTable[m_pending.front ()].start;
+        }
+      while (!m_pending.empty () && m_flowTable[m_pending.front ()].start <= m_virtualTime)
+        {
+          HeapPush (m_eligible, true, HeapPop (m_pending, false));
+        }
+      x = HeapPop (m_eligible, true);
+    }
+  else
+    {
+      x = HeapPop (m_pending, false);
+      m_virtualTime = m_flowTable[x].start;
+      m_maxFinish = std::max (m_maxFinish, m_flowTable[x].finish);
+    }
+
+  Flow &flow = m_flowTable[x];
+  Ptr<QueueDiscItem> item = flow.packets.front ();
+  flow.packets.pop_front ();
+  flow.bytes -= item->GetSize ();
+  UpdateBacklog (x, false);
+  PacketDequeued (item);
+
+  if (m_scheduler == WF2Q_PLUS)
+    {
+      m_virtualTime += Cost (item->GetSize (), m_weightSum);
+    }
+
+  if (!flow.packets.empty ())
+    {
+      flow.start = flow.finish;
+      flow.finish = flow.start + Cost (flow.packets.front ()->GetSize (), flow.weight);
+      Schedule (x);
+    }
+  else
+    {
+      m_weightSum -= flow.weight;
+      if (m_scheduler == STFQ && GetNPackets () == 0)
+        {
+          // the server is idle: the virtual time is the largest finish time
+          m_virtualTime = m_maxFinish;
+        }
+    }
+
+  return item;
+}
+
+void
+WF2QQueueDisc::Schedule (uint32_t x)
+{
+  if (m_scheduler == WF2Q_PLUS && m_flowTable[x].start <= m_virtualTime)
+    {
+      HeapPush (m_eligible, true, x);
+    }
+  else
+    {
+      HeapPush (m_pending, false, x);
+    }
+}
+
+uint64_t
+WF2QQueueDisc::Key (uint32_t x, bool byFinish) const
+{
+  return byFinish ? m_flowTable[x].finish : m_flowTable[x].start;
+}
+
+void
+WF2QQueueDisc::HeapPush (std::vector<uint32_t> &heap, bool byFinish, uint32_t x)
+{
+  m_flowTable[x].heapPos = heap.size ();
+  heap.push_back (x);
+  HeapSiftUp (heap, byFinish, heap.size () - 1);
+}
+
+uint32_t
+WF2QQueueDisc::HeapPop (std::vector<uint32_t> &heap, bool byFinish)
+{
+  NS_ASSERT (!heap.empty ());
+  uint32_t x = heap.front ();
+  heap.front () = heap.back ();
+  m_flowTable[heap.front ()].heapPos = 0;
+  heap.pop_back ();
+  if (!heap.empty ())
+    {
+      HeapSiftDown (heap, byFinish, 0);
+    }
+  return x;
+}
+
+void
+WF2QQueueDisc::HeapSiftUp (std::vector<uint32_t> &heap, bool byFinish, uint32_t position)
+{
+  uint32_t x = heap[position];
+  uint64_t key = Key (x, byFinish);
+  while (position > 0)
+    {
+      uint32_t parent = (position - 1) / 2;
+      if (Key (heap[parent], byFinish) <= key)
+        {
+          break;
+        }
+      heap[position] = heap[parent];
+      m_flowTable[heap[position]].heapPos = position;
+      position = parent;
+    }
+  heap[position] = x;
+  m_flowTable[x].heapPos = position;
+}
+
+void
+WF2QQueueDisc::HeapSiftDown (std::vector<uint32_t> &heap, bool byFinish, uint32_t position)
+{
+  uint32_t size = heap.size ();
+  uint32_t x = heap[position];
+  uint64_t key = Key (x, byFinish);
+  while (true)
+    {
+      uint32_t smallest = 2 * position + 1;
+      if (smallest >= size)
+        {
+          break;
+        }
+      if (smallest + 1 < size && Key (heap[smallest + 1], byFinish) < Key (heap[smallest], byFinish))
+        {
+          smallest++;
+        }
+      if (key <= Key (heap[smallest], byFinish))
+        {
+          break;
+        }
+      heap[position] = heap[smallest];
+      m_flowTable[heap[position]].heapPos = position;
+      position = smallest;
+    }
+  heap[position] = x;
+  m_flowTable[x].heapPos = position;
+}
+
+void
+WF2QQueueDisc::UpdateBacklog (uint32_t x, bool grown)
+{
+  Flow &flow = m_flowTable[x];
+  if (grown && flow.packets.size () == 1)
+    {
+      flow.backlogPos = m_backlog.size ();
+      m_backlog.push_back (x);
+      BacklogSiftUp (flow.backlogPos);
+    }
+  else if (grown)
+    {
+      BacklogSiftUp (flow.backlogPos);
+    }
+  else if (flow.packets.empty ())
+    {
+      uint32_t position = flow.backlogPos;
+      BacklogSwap (position, m_backlog.size () - 1);
+      m_backlog.pop_back ();
+      if (position < m_backlog.size ())
+        {
+          BacklogSiftUp (position);
+          BacklogSiftDown (position);
+        }
+    }
+  else
+    {
+      BacklogSiftDown (flow.backlogPos);
+    }
+}
+
+void
+WF2QQueueDisc::BacklogSiftUp (uint32_t position)
+{
+  while (position > 0)
+    {
+      uint32_t parent = (position - 1) / 2;
+      if (m_flowTable[m_backlog[parent]].bytes >= m_flowTable[m_backlog[position]].bytes)
+        {
+          break;
+        }
+      BacklogSwap (parent, position);
+      position = parent;
+    }
+}
+
+void
+WF2QQueueDisc::BacklogSiftDown (uint32_t position)
+{
+  uint32_t size = m_backlog.size ();
+  while (true)
+    {
+      uint32_t largest = position;
+      uint32_t left = 2 * position + 1;
+      uint32_t right = left + 1;
+      if (left < size && m_flowTable[m_backlog[left]].bytes > m_flowTable[m_backlog[largest]].bytes)
+        {
+          largest = left;
+        }
+      if (right < size && m_flowTable[m_backlog[right]].bytes > m_flowTable[m_backlog[largest]].bytes)
+        {
+          largest = right;
+        }
+      if (largest == position)
+        {
+          break;
+        }
+      BacklogSwap (position, largest);
+      position = largest;
+    }
+}
+
+void
+WF2QQueueDisc::BacklogSwap (uint32_t i, uint32_t j)
+{
+  std::swap (m_backlog[i], m_backlog[j]);
+  m_flowTable[m_backlog[i]].backlogPos = i;
+  m_flowTable[m_backlog[j]].backlogPos = j;
+}
+
+bool
+WF2QQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (GetNQueueDiscClasses () > 0)
+    {
+      NS_LOG_ERROR ("WF2QQueueDisc cannot have classes");
+      return false;
+    }
+
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("WF2QQueueDisc cannot have internal queues");
+      return false;
+    }
+
+  if (GetNPacketFilters () == 0)
+    {
+      AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRIpv6PacketFilter> ());
+      AddPacketFilter (CreateObject<DRRNonIpPacketFilter> ());
+    }
+
+  return true;
+}
+
+void
+WF2QQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Flow flow;
+  flow.start = 0;
+  flow.finish = 0;
+  flow.weight = 1;
+  flow.heapPos = 0;
+  flow.bytes = 0;
+  flow.backlogPos = 0;
+  m_flowTable.assign (m_flows + 1, flow);
+  m_eligible.reserve (m_flows + 1);
+  m_pending.reserve (m_flows + 1);
+  m_backlog.reserve (m_flows + 1);
+}
+
+} // namespace ns3
@@ -0,0 +1,231 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef WF2Q_QUEUE_DISC
+#define WF2Q_QUEUE_DISC
+
+#include "ns3/queue-disc.h"
+#include "ns3/drr-queue-disc.h"
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief A virtual time fair queueing packet queue disc (WF2Q+ or STFQ)
+ *
+ * The packet filters (by default, the DRR filters) select one of Flows flow
+ * queues, exactly as in DRRQueueDisc, and the WeightKey and Weights
+ * attributes give each flow a weight as in DRRQueueDisc. Instead of serving
+ * the flows in round robin order, the queue disc stamps the packet at the
+ * head of each backlogged flow with a virtual start time and a virtual finish
+ * time (the start time plus the size of the packet divided by the weight of
+ * the flow), and keeps the flows in binary heaps ordered by these times, so
+ * that an enqueue and a dequeue take O(log n) steps for n backlogged flows.
+ *
+ * With the Wf2qPlus scheduler, the packet with the smallest finish time among
+ * the packets whose start time is not later than the virtual time is sent
+ * (WF2Q+), and the virtual time advances by the size of the packet divided by
+ * the sum of the weights of the backlogged flows, jumping to the smallest
+ * start time when no packet is eligible. With the Stfq scheduler, the packet
+ * with the smallest start time is sent and the virtual time is its start time
+ * (Start-time Fair Queueing). In both cases, the delay of a packet of a flow
+ * that has just become active does not grow with the number of active flows
+ * times the quantum, as it does with DRR.
+ *
+ * When a packet would exceed MaxSize, packets are dropped from the tail of the
+ * flow holding the most bytes, found in constant time through a heap of the
+ * backlogs, unless it is the flow of the packet, so that the bulk flows do
+ * not fill the queue disc at the expense of the light flows.
+ */
+class WF2QQueueDisc : public QueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief WF2QQueueDisc constructor
+   */
+  WF2QQueueDisc ();
+
+  virtual ~WF2QQueueDisc ();
+
+  /**
+   * \brief The scheduler selecting the next packet
+   */
+  enum Scheduler
+  {
+    WF2Q_PLUS,   //!< Smallest finish time among the eligible packets
+    STFQ         //!< Smallest start time
+  };
+
+  /**
+   * \brief Get the number of backlogged flows
+   * \return the number of flows holding packets
+   */
+  uint32_t GetNBackloggedFlows (void) const;
+
+  /**
+   * \brief Get the number of packets of a flow queue
+   * \param index the index of the flow queue
+   * \return the number of packets
+   */
+  uint32_t GetFlowNPackets (uint32_t index) const;
+
+  /**
+   * \brief Get the virtual time, in bytes scaled by WF2Q_SCALE
+   * \return the virtual time
+   */
+  uint64_t GetVirtualTime (void) const;
+
+  /// Fixed point scale of the virtual times
+  static const uint64_t WF2Q_SCALE = 1 << 16;
+
+  // Reasons for dropping packets
+  static constexpr const char* LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded";  //!< Packet dropped due to queue disc limit exceeded
+  static constexpr const char* OVERLIMIT_DROP = "Overlimit drop";  //!< Packet dropped from the longest flow to make room for another flow
+
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
+
+private:
+  /// A flow queue and its virtual times
+  struct Flow
+  {
+    std::deque<Ptr<QueueDiscItem> > packets;  //!< The packets
+    uint64_t start;     //!< Virtual start time of the head packet
+    uint64_t finish;    //!< Virtual finish time of the head packet (or of the last packet sent)
+    uint32_t weight;    //!< Weight, looked up from the packet that made the flow backlogged
+    uint32_t heapPos;   //!< Position in the heap holding the flow
+    uint32_t bytes;     //!< Number of bytes of the packets
+    uint32_t backlogPos;  //!< Position in the heap of the backlogs
+  };
+
+  virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual bool CheckConfig (void);
+  virtual void InitializeParams (void);
+
+  /**
+   * \brief Compute the virtual time taken by a packet
+   * \param size the size of the packet
+   * \param weight the weight of the flow (or the sum of the weights)
+   * \return the virtual time
+   */
+  static uint64_t Cost (uint32_t size, uint64_t weight);
+
+  /**
+   * \brief Insert a flow whose head packet has been stamped in the eligible
+   *        heap (WF2Q+ only, if its start time is not later than the virtual
+   *        time) or in the pending heap
+   * \param x the flow
+   */
+  void Schedule (uint32_t x);
+
+  /**
+   * \brief Get the key of a flow in a heap
+   * \param x the flow
+   * \param byFinish whether the heap is ordered by finish time
+   * \return the key
+   */
+  uint64_t Key (uint32_t x, bool byFinish) const;
+
+  /**
+   * \brief Insert a flow in a heap
+   * \param heap the heap
+   * \param byFinish whether the heap is ordered by finish time
+   * \param x the flow
+   */
+  void HeapPush (std::vector<uint32_t> &heap, bool byFinish, uint32_t x);
+
+  /**
+   * \brief Remove the flow at the top of a heap
+   * \param heap the heap
+   * \param byFinish whether the heap is ordered by finish time
+   * \return the flow
+   */
+  uint32_t HeapPop (std::vector<uint32_t> &heap, bool byFinish);
+
+  /**
+   * \brief Move an element of a heap towards the top
+   * \param heap the heap
+   * \param byFinish whether the heap is ordered by finish time
+   * \param position the position of the element
+   */
+  void HeapSiftUp (std::vector<uint32_t> &heap, bool byFinish, uint32_t position);
+
+  /**
+   * \brief Move an element of a heap towards the bottom
+   * \param heap the heap
+   * \param byFinish whether the heap is ordered by finish time
+   * \param position the position of the element
+   */
+  void HeapSiftDown (std::vector<uint32_t> &heap, bool byFinish, uint32_t position);
+
+  /**
+   * \brief Update the position of a flow in the heap of the backlogs after
+   *        its number of bytes has changed, inserting or removing it if it
+   *        has become backlogged or empty
+   * \param x the flow
+   * \param grown whether the number of bytes has increased
+   */
+  void UpdateBacklog (uint32_t x, bool grown);
+
+  /**
+   * \brief Move an element of the heap of the backlogs towards the top
+   * \param position the position of the element
+   */
+  void BacklogSiftUp (uint32_t position);
+
+  /**
+   * \brief Move an element of the heap of the backlogs towards the bottom
+   * \param position the position of the element
+   */
+  void BacklogSiftDown (uint32_t position);
+
+  /**
+   * \brief Swap two elements of the heap of the backlogs
+   * \param i the position of the first element
+   * \param j the position of the second element
+   */
+  void BacklogSwap (uint32_t i, uint32_t j);
+
+  uint32_t m_flows;                 //!< Number of flow queues
+  Scheduler m_scheduler;            //!< The scheduler
+  DRRQueueDisc::WeightKey m_weightKey;  //!< Key of the weight of a flow
+  DRRWeightMap m_weights;           //!< Weights of the flows
+
+  std::vector<Flow> m_flowTable;    //!< The flow queues (plus one for unclassified packets)
+  std::vector<uint32_t> m_eligible; //!< Heap of the eligible flows, by finish time (WF2Q+)
+  std::vector<uint32_t> m_pending;  //!< Heap of the other backlogged flows, by start time
+  std::vector<uint32_t> m_backlog;  //!< Heap of the backlogged flows, by number of bytes (largest first)
+  uint64_t m_virtualTime;           //!< The virtual time
+  uint64_t m_weightSum;             //!< Sum of the weights of the backlogged flows
+  uint64_t m_maxFinish;             //!< Largest finish time of the packets sent (STFQ)
+};
+
+} // namespace ns3
+
+#endif /* WF2Q_QUEUE_DISC */
@@ -0,0 +1,683 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 NITK Surathkal
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/drr-queue-disc.h"
+#include "ns3/wf2q-queue-disc.h"
+#include "ns3/packet-filter.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv4-packet-filter.h"
+#include "ns3/tcp-header.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace ns3;
+
+/**
+ * Packet filter returning a value set by the benchmark, so that the
+ * benchmarks control exactly how many flows are created and which flow
+ * each packet is enqueued into.
+ */
+class DRRBenchmarkPacketFilter : public PacketFilter
+{
+public:
+  DRRBenchmarkPacketFilter ();
+  virtual ~DRRBenchmarkPacketFilter ();
+
+  /**
+   * \brief Set the value returned when classifying the next packets
+   * \param value the value returned by the filter
+   */
+  void SetValue (int32_t value);
+
+private:
+  virtual bool CheckProtocol (Ptr<QueueDiscItem> item) const;
+  virtual int32_t DoClassify (Ptr<QueueDiscItem> item) const;
+
+  int32_t m_value; //!< the value returned by the filter
+};
+
+DRRBenchmarkPacketFilter::DRRBenchmarkPacketFilter ()
+  : m_value (0)
+{
+}
+
+DRRBenchmarkPacketFilter::~DRRBenchmarkPacketFilter ()
+{
+}
+
+void
+DRRBenchmarkPacketFilter::SetValue (int32_t value)
+{
+  m_value = value;
+}
+
+bool
+DRRBenchmarkPacketFilter::CheckProtocol (Ptr<QueueDiscItem> item) const
+{
+  return true;
+}
+
+int32_t
+DRRBenchmarkPacketFilter::DoClassify (Ptr<QueueDiscItem> item) const
+{
+  return m_value;
+}
+
+/**
+ * This class measures the cost of the packet stealing drop performed by
+ * the DRR queue disc when the byte limit is exceeded, for an increasing
+ * number of flows. The cost per drop is expected to stay (nearly) flat.
+ */
+class DRRQueueDiscDropCostBenchmark : public TestCase
+{
+public:
+  DRRQueueDiscDropCostBenchmark ();
+  virtual ~DRRQueueDiscDropCostBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the average time to enqueue a packet that causes a drop
+   * \param nFlows the number of backlogged flows
+   * \return the average time (in nanoseconds) per enqueue and drop
+   */
+  double MeasureDropCost (uint32_t nFlows);
+
+  enum { PACKET_SIZE = 500, DROPS = 50000 };
+};
+
+DRRQueueDiscDropCostBenchmark::DRRQueueDiscDropCostBenchmark ()
+  : TestCase ("Measure the cost of dropping packets from the fat flow")
+{
+}
+
+DRRQueueDiscDropCostBenchmark::~DRRQueueDiscDropCostBenchmark ()
+{
+}
+
+double
+DRRQueueDiscDropCostBenchmark::MeasureDropCost (uint32_t nFlows)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (PACKET_SIZE);
+  uint32_t itemSize = PACKET_SIZE + hdr.GetSerializedSize ();
+
+  // the queue disc holds exactly one packet per flow plus one extra packet
+  // for the first flow, so that every subsequent enqueue causes a drop
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue ((nFlows + 1) * itemSize),
+                                                                          "Flows", UintegerValue (nFlows));
+  Ptr<DRRBenchmarkPacketFilter> filter = CreateObject<DRRBenchmarkPacketFilter> ();
+  queueDisc->AddPacketFilter (filter);
+  queueDisc->Initialize ();
+
+  Address dest;
+  for (uint32_t i = 0; i <= nFlows; i++)
+    {
+      filter->SetValue (i % nFlows);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+    }
+
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 0; i < DROPS; i++)
+    {
+      filter->SetValue ((i * 7919) % nFlows);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+    }
+  std::clock_t stop = std::clock ();
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (DRRQueueDisc::OVERLIMIT_DROP), DROPS,
+                         "every enqueue should have caused a drop");
+  queueDisc->Dispose ();
+
+  return 1e9 * double (stop - start) / (double (DROPS) * CLOCKS_PER_SEC);
+}
+
+void
+DRRQueueDiscDropCostBenchmark::DoRun (void)
+{
+  for (uint32_t nFlows = 16; nFlows <= 65536; nFlows *= 4)
+    {
+      std::cout << "DRR drop cost: flows " << nFlows << "\tper: " << MeasureDropCost (nFlows)
+                << " ns/drop" << std::endl;
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class compares the flow lookup of the DRR queue disc through a
+ * std::map from the hash bucket to the index of the flow class (as formerly
+ * done by the DRR queue disc) with the lookup in the flat flow table, and
+ * measures the number of packets per second the DRR queue disc classifies,
+ * enqueues and dequeues.
+ */
+class DRRQueueDiscClassificationBenchmark : public TestCase
+{
+public:
+  DRRQueueDiscClassificationBenchmark ();
+  virtual ~DRRQueueDiscClassificationBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the cost of the two flow lookups and the packet rate
+   * \param nFlows the number of flows
+   */
+  void Measure (uint32_t nFlows);
+
+  enum { LOOKUPS = 10000000, PACKETS = 200000, PACKET_SIZE = 500 };
+};
+
+DRRQueueDiscClassificationBenchmark::DRRQueueDiscClassificationBenchmark ()
+  : TestCase ("Measure the flow lookup and the classification rate")
+{
+}
+
+DRRQueueDiscClassificationBenchmark::~DRRQueueDiscClassificationBenchmark ()
+{
+}
+
+void
+DRRQueueDiscClassificationBenchmark::Measure (uint32_t nFlows)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (nFlows * 2 * PACKET_SIZE),
+                                                                          "Flows", UintegerValue (nFlows));
+  Ptr<DRRBenchmarkPacketFilter> filter = CreateObject<DRRBenchmarkPacketFilter> ();
+  queueDisc->AddPacketFilter (filter);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (PACKET_SIZE);
+  Address dest;
+
+  // the first packet of each hash bucket creates its flow, which is the
+  // class of the same index
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      filter->SetValue (i);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+    }
+  while (queueDisc->Dequeue ())
+    {
+    }
+
+  std::map<uint32_t, uint32_t> flowsIndices;
+  std::vector<Ptr<DRRFlow> > flowTable (nFlows + 1);
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      flowsIndices[i] = i;
+      flowTable[i] = StaticCast<DRRFlow> (queueDisc->GetQueueDiscClass (i));
+    }
+
+  // the map was looked up with find and then with operator[], and the flow
+  // was the queue disc class of the index found
+  uint64_t mapSum = 0;
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 0; i < LOOKUPS; i++)
+    {
+      uint32_t h = (i * 7919) % nFlows;
+      if (flowsIndices.find (h) != flowsIndices.end ())
+        {
+          Ptr<DRRFlow> flow = StaticCast<DRRFlow> (queueDisc->GetQueueDiscClass (flowsIndices[h]));
+          mapSum += flow->GetIndex ();
+        }
+    }
+  std::clock_t mapTicks = std::clock () - start;
+
+  uint64_t tableSum = 0;
+  start = std::clock ();
+  for (uint32_t i = 0; i < LOOKUPS; i++)
+    {
+      Ptr<DRRFlow> flow = flowTable[(i * 7919) % nFlows];
+      if (flow)
+        {
+          tableSum += flow->GetIndex ();
+        }
+    }
+  std::clock_t tableTicks = std::clock () - start;
+
+  NS_TEST_EXPECT_MSG_EQ (mapSum, tableSum, "the two lookups should find the same flows");
+  std::cout << "Flow lookup: flows " << nFlows << "\tmap: "
+            << 1e9 * double (mapTicks) / (double (LOOKUPS) * CLOCKS_PER_SEC) << " ns/lookup\ttable: "
+            << 1e9 * double (tableTicks) / (double (LOOKUPS) * CLOCKS_PER_SEC) << " ns/lookup" << std::endl;
+
+  start = std::clock ();
+  for (uint32_t i = 0; i < PACKETS; i++)
+    {
+      filter->SetValue ((i * 7919) % nFlows);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+      if (i % 8 == 7)
+        {
+          while (queueDisc->Dequeue ())
+            {
+            }
+        }
+    }
+  std::clock_t ticks = std::clock () - start;
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().nTotalDequeuedPackets, nFlows + PACKETS,
+                         "all the packets should have been dequeued");
+  std::cout << "DRR enqueue/dequeue: flows " << nFlows << "\trate: "
+            << double (PACKETS) * CLOCKS_PER_SEC / double (ticks) << " packets/s" << std::endl;
+  queueDisc->Dispose ();
+}
+
+void
+DRRQueueDiscClassificationBenchmark::DoRun (void)
+{
+  for (uint32_t nFlows = 1024; nFlows <= 16384; nFlows *= 4)
+    {
+      Measure (nFlows);
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class compares the memory used by each flow and the enqueue latency
+ * of flows with a child CoDel queue disc and of flows with an inline FIFO
+ * and embedded CoDel state.
+ */
+class DRRQueueDiscFlowMemoryBenchmark : public TestCase
+{
+public:
+  DRRQueueDiscFlowMemoryBenchmark ();
+  virtual ~DRRQueueDiscFlowMemoryBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the memory per flow and the enqueue latency
+   * \param inlineFlows whether the flows use inline FIFOs
+   * \return the memory (in bytes) used by each idle flow
+   */
+  double Measure (bool inlineFlows);
+
+  enum { FLOWS = 16384, PACKET_SIZE = 500 };
+};
+
+DRRQueueDiscFlowMemoryBenchmark::DRRQueueDiscFlowMemoryBenchmark ()
+  : TestCase ("Measure the memory per flow and the enqueue latency")
+{
+}
+
+DRRQueueDiscFlowMemoryBenchmark::~DRRQueueDiscFlowMemoryBenchmark ()
+{
+}
+
+/**
+ * \return the number of bytes allocated on the heap, or 0 if unknown
+ */
+static std::size_t
+HeapInUse (void)
+{
+#if defined (__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2 ().uordblks;
+#else
+  return 0;
+#endif
+}
+
+double
+DRRQueueDiscFlowMemoryBenchmark::Measure (bool inlineFlows)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (FLOWS * 2 * PACKET_SIZE),
+                                                                          "Flows", UintegerValue (FLOWS),
+                                                                          "InlineFlows", BooleanValue (inlineFlows));
+  Ptr<DRRBenchmarkPacketFilter> filter = CreateObject<DRRBenchmarkPacketFilter> ();
+  queueDisc->AddPacketFilter (filter);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (PACKET_SIZE);
+  Address dest;
+  std::vector<Ptr<Ipv4QueueDiscItem> > items;
+  for (uint32_t i = 0; i < FLOWS; i++)
+    {
+      items.push_back (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+    }
+
+  // the first packet of each flow creates the flow
+  std::size_t heap = HeapInUse ();
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 0; i < FLOWS; i++)
+    {
+      filter->SetValue (i);
+      queueDisc->Enqueue (items[i]);
+    }
+  std::clock_t createTicks = std::clock () - start;
+  while (queueDisc->Dequeue ())
+    {
+    }
+  double memory = (double (HeapInUse ()) - double (heap)) / FLOWS;
+
+  start = std::clock ();
+  for (uint32_t i = 0; i < FLOWS; i++)
+    {
+      filter->SetValue (i);
+      queueDisc->Enqueue (items[i]);
+    }
+  std::clock_t enqueueTicks = std::clock () - start;
+
+  std::cout << "DRR " << (inlineFlows ? "inline FIFO" : "child CoDel") << " flows: "
+            << memory << " bytes/flow\tflow creation: "
+            << 1e9 * double (createTicks) / (double (FLOWS) * CLOCKS_PER_SEC) << " ns/packet\tenqueue: "
+            << 1e9 * double (enqueueTicks) / (double (FLOWS) * CLOCKS_PER_SEC) << " ns/packet" << std::endl;
+  queueDisc->Dispose ();
+
+  return memory;
+}
+
+void
+DRRQueueDiscFlowMemoryBenchmark::DoRun (void)
+{
+  double childMemory = Measure (false);
+  double inlineMemory = Measure (true);
+
+  if (HeapInUse () > 0)
+    {
+      NS_TEST_EXPECT_MSG_LT (inlineMemory, childMemory, "inline flows should use less memory");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class measures the heap growth of a DRR queue disc that sees a long
+ * stream of short flows, with and without a bound on the memory of the flows
+ */
+class DRRQueueDiscFlowChurnBenchmark : public TestCase
+{
+public:
+  DRRQueueDiscFlowChurnBenchmark ();
+  virtual ~DRRQueueDiscFlowChurnBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the heap growth over a stream of one-packet flows
+   * \param maxFlows the maximum number of flows (0 means unbounded)
+   * \return the heap growth (in bytes) over the second half of the stream
+   */
+  double Measure (uint32_t maxFlows);
+
+  enum { FLOWS = 200000, MAX_FLOWS = 1024, PACKET_SIZE = 500 };
+};
+
+DRRQueueDiscFlowChurnBenchmark::DRRQueueDiscFlowChurnBenchmark ()
+  : TestCase ("Measure the heap growth with a stream of short flows")
+{
+}
+
+DRRQueueDiscFlowChurnBenchmark::~DRRQueueDiscFlowChurnBenchmark ()
+{
+}
+
+double
+DRRQueueDiscFlowChurnBenchmark::Measure (uint32_t maxFlows)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("Flows", UintegerValue (FLOWS),
+                                                                          "InlineFlows", BooleanValue (true));
+  Ptr<DRRBenchmarkPacketFilter> filter = CreateObject<DRRBenchmarkPacketFilter> ();
+  queueDisc->AddPacketFilter (filter);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (PACKET_SIZE);
+  Address dest;
+  Ptr<Ipv4QueueDiscItem> item = Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr);
+
+  // the footprint of a flow is only known once a flow exists
+  filter->SetValue (0);
+  queueDisc->Enqueue (item);
+  queueDisc->Dequeue ();
+  queueDisc->SetAttribute ("MaxFlowMemory", UintegerValue (maxFlows * queueDisc->GetFlowMemory ()));
+
+  std::size_t heap = 0;
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 1; i < FLOWS; i++)
+    {
+      if (i == FLOWS / 2)
+        {
+          heap = HeapInUse ();
+        }
+      filter->SetValue (i);
+      queueDisc->Enqueue (item);
+      queueDisc->Dequeue ();
+    }
+  std::clock_t ticks = std::clock () - start;
+  double growth = double (HeapInUse ()) - double (heap);
+
+  std::cout << "DRR " << (maxFlows ? "bounded" : "unbounded") << " flow memory: "
+            << growth / 1024 << " KiB heap growth over " << FLOWS / 2 << " flows\t"
+            << queueDisc->GetFlowMemory () / 1024 << " KiB of flows\tenqueue+dequeue: "
+            << 1e9 * double (ticks) / (double (FLOWS) * CLOCKS_PER_SEC) << " ns/packet" << std::endl;
+  queueDisc->Dispose ();
+
+  return growth;
+}
+
+void
+DRRQueueDiscFlowChurnBenchmark::DoRun (void)
+{
+  double unbounded = Measure (0);
+  double bounded = Measure (MAX_FLOWS);
+
+  if (HeapInUse () > 0)
+    {
+      NS_TEST_EXPECT_MSG_LT (bounded, unbounded, "bounding the flow memory should stop the heap growth");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class measures the cost of the classification of a TCP packet by the
+ * DRR filter at the first hop, where the 5-tuple is parsed and hashed, and at
+ * the next hops, where the hash carried by the packet is reused.
+ */
+class DRRIpv4FilterHashCacheBenchmark : public TestCase
+{
+public:
+  DRRIpv4FilterHashCacheBenchmark ();
+  virtual ~DRRIpv4FilterHashCacheBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the classification cost
+   * \param firstHop whether the header changes at every classification, so
+   *        that the hash carried by the packet is never reused
+   */
+  void Measure (bool firstHop);
+
+  enum { PACKETS = 200000 };
+};
+
+DRRIpv4FilterHashCacheBenchmark::DRRIpv4FilterHashCacheBenchmark ()
+  : TestCase ("Measure the classification cost with and without the cached flow hash")
+{
+}
+
+DRRIpv4FilterHashCacheBenchmark::~DRRIpv4FilterHashCacheBenchmark ()
+{
+}
+
+void
+DRRIpv4FilterHashCacheBenchmark::Measure (bool firstHop)
+{
+  Ptr<DRRIpv4PacketFilter> filter = CreateObject<DRRIpv4PacketFilter> ();
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (7);
+  tcpHdr.SetDestinationPort (27);
+  Ptr<Packet> p = Create<Packet> (500);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetProtocol (6);
+  Address addr;
+
+  // every hop creates a new item for the packet
+  int64_t sum = 0;
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 0; i < PACKETS; i++)
+    {
+      hdr.SetDestination (Ipv4Address (0x0a0a0100 + (firstHop ? i % 2 : 0)));
+      sum += filter->Classify (Create<Ipv4QueueDiscItem> (p, addr, 0, hdr));
+    }
+  std::clock_t ticks = std::clock () - start;
+  NS_TEST_EXPECT_MSG_NE (sum, 0, "the packets should have been classified");
+
+  std::cout << "DRR IPv4 filter: " << (firstHop ? "first hop (hash computed)" : "next hops (hash reused)")
+            << "\tper: " << 1e9 * double (ticks) / (double (PACKETS) * CLOCKS_PER_SEC) << " ns/packet" << std::endl;
+}
+
+void
+DRRIpv4FilterHashCacheBenchmark::DoRun (void)
+{
+  Measure (true);
+  Measure (false);
+}
+
+/**
+ * This class reports the cost of a steady-state enqueue and dequeue of the
+ * DRR queue disc, whose round robin takes constant time, and of the WF2Q+
+ * and STFQ schedulers of the WF2Q queue disc, whose heaps take a time
+ * logarithmic in the number of backlogged flows. The fixed costs per packet
+ * (the packet filters, the child queue discs of DRR) may well outweigh the
+ * scheduler, hence neither is expected to be the cheaper one.
+ */
+class DRRQueueDiscSchedulerCostBenchmark : public TestCase
+{
+public:
+  DRRQueueDiscSchedulerCostBenchmark ();
+  virtual ~DRRQueueDiscSchedulerCostBenchmark ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * \brief Measure the cost of an enqueue and a dequeue
+   * \param queueDisc the queue disc, created with nFlows flows
+   * \param nFlows the number of backlogged flows
+   * \return the cost, in ns per packet
+   */
+  double Measure (Ptr<QueueDisc> queueDisc, uint32_t nFlows);
+
+  enum { PACKETS = 50000, PACKET_SIZE = 500 };
+};
+
+DRRQueueDiscSchedulerCostBenchmark::DRRQueueDiscSchedulerCostBenchmark ()
+  : TestCase ("Measure the scheduler cost of DRR, WF2Q+ and STFQ")
+{
+}
+
+DRRQueueDiscSchedulerCostBenchmark::~DRRQueueDiscSchedulerCostBenchmark ()
+{
+}
+
+double
+DRRQueueDiscSchedulerCostBenchmark::Measure (Ptr<QueueDisc> queueDisc, uint32_t nFlows)
+{
+  Ptr<DRRBenchmarkPacketFilter> filter = CreateObject<DRRBenchmarkPacketFilter> ();
+  queueDisc->AddPacketFilter (filter);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (PACKET_SIZE);
+  Address dest;
+
+  // every flow holds two packets, so that all the flows stay backlogged
+  for (uint32_t i = 0; i < 2 * nFlows; i++)
+    {
+      filter->SetValue (i % nFlows);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+    }
+
+  std::clock_t start = std::clock ();
+  for (uint32_t i = 0; i < PACKETS; i++)
+    {
+      filter->SetValue ((i * 7919) % nFlows);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (PACKET_SIZE), dest, 0, hdr));
+      queueDisc->Dequeue ();
+    }
+  std::clock_t ticks = std::clock () - start;
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().nTotalDroppedPackets, 0, "no packet should have been dropped");
+  queueDisc->Dispose ();
+
+  return 1e9 * double (ticks) / (double (PACKETS) * CLOCKS_PER_SEC);
+}
+
+void
+DRRQueueDiscSchedulerCostBenchmark::DoRun (void)
+{
+  for (uint32_t nFlows = 16; nFlows <= 16384; nFlows *= 8)
+    {
+      uint32_t limit = 4 * nFlows;
+      double drr = Measure (CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (limit * (PACKET_SIZE + 20)),
+                                                                       "Flows", UintegerValue (nFlows)),
+                            nFlows);
+      double wf2q = Measure (CreateObjectWithAttributes<WF2QQueueDisc> ("MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, limit)),
+                                                                         "Flows", UintegerValue (nFlows)),
+                             nFlows);
+      double stfq = Measure (CreateObjectWithAttributes<WF2QQueueDisc> ("MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, limit)),
+                                                                         "Flows", UintegerValue (nFlows),
+                                                                         "Scheduler", StringValue ("Stfq")),
+                             nFlows);
+      std::cout << "Scheduler cost: flows " << nFlows << "\tDRR: " << drr << "\tWF2Q+: " << wf2q
+                << "\tSTFQ: " << stfq << " ns/packet" << std::endl;
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * The benchmarks only report their measurements, since wall-clock times
+ * depend on the load of the machine. They take about a minute, hence they
+ * only run with the TAKES_FOREVER fullness.
+ */
+class DRRQueueDiscPerfTestSuite : public TestSuite
+{
+public:
+  DRRQueueDiscPerfTestSuite ();
+};
+
+DRRQueueDiscPerfTestSuite::DRRQueueDiscPerfTestSuite ()
+  : TestSuite ("drr-queue-disc-perf", PERFORMANCE)
+{
+  AddTestCase (new DRRQueueDiscDropCostBenchmark, TestCase::TAKES_FOREVER);
+  AddTestCase (new DRRQueueDiscClassificationBenchmark, TestCase::TAKES_FOREVER);
+  AddTestCase (new DRRQueueDiscFlowMemoryBenchmark, TestCase::TAKES_FOREVER);
+  AddTestCase (new DRRQueueDiscFlowChurnBenchmark, TestCase::TAKES_FOREVER);
+  AddTestCase (new DRRIpv4FilterHashCacheBenchmark, TestCase::TAKES_FOREVER);
+  AddTestCase (new DRRQueueDiscSchedulerCostBenchmark, TestCase::TAKES_FOREVER);
+}
+
+static DRRQueueDiscPerfTestSuite DRRQueueDiscPerfTestSuite;
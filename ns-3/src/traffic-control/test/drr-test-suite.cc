@@ -23,6 +23,8 @@
 #include "ns3/test.h"
 #include "ns3/simulator.h"
 #include "ns3/drr-queue-disc.h"
+#include "ns3/bfdrr-queue-disc.h"
+#include "ns3/codel-queue-disc.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4-packet-filter.h"
 #include "ns3/ipv4-queue-disc-item.h"
@@ -30,10 +32,32 @@
 #include "ns3/ipv6-header.h"
 #include "ns3/ipv6-packet-filter.h"
 #include "ns3/ipv6-queue-disc-item.h"
+#include "ns3/arp-queue-disc-item.h"
+#include "ns3/arp-header.h"
+#include "ns3/mac48-address.h"
 #include "ns3/tcp-header.h"
 #include "ns3/udp-header.h"
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/flow-tag.h"
+#include "ns3/flow-hash-tag.h"
+#include "ns3/data-rate.h"
+#include "ns3/node.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/traffic-control-layer.h"
+#include "ns3/traffic-control-helper.h"
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
 
 using namespace ns3;
 
@@ -571,6 +595,2269 @@ DRRQueueDiscDeficitVariableSizeDifferentFlow::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * This class tests that packets much larger than the quantum are served in
+ * the same order and leave the same deficits as with one quantum per round
+ */
+class DRRQueueDiscDeficitJumboPackets : public TestCase
+{
+public:
+  DRRQueueDiscDeficitJumboPackets ();
+  virtual ~DRRQueueDiscDeficitJumboPackets ();
+
+private:
+  virtual void DoRun (void);
+  void AddPacket (Ptr<DRRQueueDisc> queue, Ipv4Header hdr, uint32_t size);
+};
+
+DRRQueueDiscDeficitJumboPackets::DRRQueueDiscDeficitJumboPackets ()
+  : TestCase ("Test credits of packets larger than the quantum")
+{
+}
+
+DRRQueueDiscDeficitJumboPackets::~DRRQueueDiscDeficitJumboPackets ()
+{
+}
+
+void
+DRRQueueDiscDeficitJumboPackets::AddPacket (Ptr<DRRQueueDisc> queue, Ipv4Header hdr, uint32_t size)
+{
+  Ptr<Packet> p = Create<Packet> (size);
+  Address dest;
+  Ptr<Ipv4QueueDiscItem> item = Create<Ipv4QueueDiscItem> (p, dest, 0, hdr);
+  queue->Enqueue (item);
+}
+
+void
+DRRQueueDiscDeficitJumboPackets::DoRun (void)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (100000));
+  Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
+  queueDisc->AddPacketFilter (ipv4Filter);
+
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetProtocol (7);
+
+  // First flow: a 9020 byte packet followed by a 1020 byte packet
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  AddPacket (queueDisc, hdr, 9000);
+  AddPacket (queueDisc, hdr, 1000);
+  // Second flow: a 3020 byte packet
+  hdr.SetDestination (Ipv4Address ("10.10.1.3"));
+  AddPacket (queueDisc, hdr, 3000);
+  // Third flow: a 6020 byte packet
+  hdr.SetDestination (Ipv4Address ("10.10.1.4"));
+  AddPacket (queueDisc, hdr, 6000);
+
+  NS_TEST_ASSERT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 3, "unexpected number of flows");
+  Ptr<DRRFlow> flow1 = StaticCast<DRRFlow> (queueDisc->GetQueueDiscClass (0));
+  Ptr<DRRFlow> flow2 = StaticCast<DRRFlow> (queueDisc->GetQueueDiscClass (1));
+  Ptr<DRRFlow> flow3 = StaticCast<DRRFlow> (queueDisc->GetQueueDiscClass (2));
+
+  // The second flow is served in the sixth round (6 * 600 = 3600 >= 3020),
+  // after the first flow has been visited six times and the third flow five
+  Ptr<QueueDiscItem> item = queueDisc->Dequeue ();
+  NS_TEST_ASSERT_MSG_EQ (item->GetSize (), 3020, "the packet of the second flow should have been dequeued");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetDeficit (), 3600, "unexpected deficit for the first flow");
+  NS_TEST_ASSERT_MSG_EQ (flow2->GetDeficit (), 0, "unexpected deficit for the second flow");
+  NS_TEST_ASSERT_MSG_EQ (flow2->GetStatus (), DRRFlow::INACTIVE, "the second flow must be inactive");
+  NS_TEST_ASSERT_MSG_EQ (flow3->GetDeficit (), 3000, "unexpected deficit for the third flow");
+
+  // The third flow comes next in the round robin order and needs six more
+  // visits (3000 + 6 * 600 = 6600 >= 6020); the first flow gets five visits
+  item = queueDisc->Dequeue ();
+  NS_TEST_ASSERT_MSG_EQ (item->GetSize (), 6020, "the packet of the third flow should have been dequeued");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetDeficit (), 6600, "unexpected deficit for the first flow");
+  NS_TEST_ASSERT_MSG_EQ (flow3->GetDeficit (), 0, "unexpected deficit for the third flow");
+  NS_TEST_ASSERT_MSG_EQ (flow3->GetStatus (), DRRFlow::INACTIVE, "the third flow must be inactive");
+
+  // The first flow needs five more visits (6600 + 5 * 600 = 9600 >= 9020)
+  // and keeps the remaining 580 bytes of deficit
+  item = queueDisc->Dequeue ();
+  NS_TEST_ASSERT_MSG_EQ (item->GetSize (), 9020, "the jumbo packet of the first flow should have been dequeued");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetDeficit (), 580, "unexpected deficit for the first flow");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetStatus (), DRRFlow::ACTIVE, "the first flow must still be active");
+
+  // 580 + 600 = 1180 >= 1020
+  item = queueDisc->Dequeue ();
+  NS_TEST_ASSERT_MSG_EQ (item->GetSize (), 1020, "the last packet of the first flow should have been dequeued");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetDeficit (), 0, "unexpected deficit for the first flow");
+  NS_TEST_ASSERT_MSG_EQ (flow1->GetStatus (), DRRFlow::INACTIVE, "the first flow must be inactive");
+  NS_TEST_ASSERT_MSG_EQ (queueDisc->QueueDisc::GetNPackets (), 0, "unexpected number of packets in the queue disc");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that the throughput of backlogged flows of a weighted DRR
+ * queue disc is proportional to their weights
+ */
+class DRRQueueDiscWeightedFlows : public TestCase
+{
+public:
+  DRRQueueDiscWeightedFlows ();
+  virtual ~DRRQueueDiscWeightedFlows ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue packets of two flows, dequeue part of them and return the ratio
+   * between the bytes dequeued from the first flow and from the second flow
+   * \param weightKey the key used to look up the weights
+   * \param weights the weights of the flows
+   * \return the ratio between the throughput of the two flows
+   */
+  double MeasureRatio (std::string weightKey, std::string weights);
+
+  enum { PACKETS = 200, DEQUEUES = 200 };
+};
+
+DRRQueueDiscWeightedFlows::DRRQueueDiscWeightedFlows ()
+  : TestCase ("Test the throughput ratio of weighted flows")
+{
+}
+
+DRRQueueDiscWeightedFlows::~DRRQueueDiscWeightedFlows ()
+{
+}
+
+double
+DRRQueueDiscWeightedFlows::MeasureRatio (std::string weightKey, std::string weights)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (1000000),
+                                                                          "WeightKey", StringValue (weightKey),
+                                                                          "Weights", StringValue (weights));
+  Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
+  queueDisc->AddPacketFilter (ipv4Filter);
+
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetProtocol (7);
+  Address dest;
+
+  // The first flow has DSCP AF11 and the LIGHT flow type, the second flow
+  // DSCP 0 and the HEAVY flow type
+  for (uint32_t i = 0; i < PACKETS; i++)
+    {
+      for (uint32_t f = 0; f < 2; f++)
+        {
+          hdr.SetDestination (f == 0 ? Ipv4Address ("10.10.1.2") : Ipv4Address ("10.10.1.3"));
+          hdr.SetTos (f == 0 ? 0x28 : 0);
+          Ptr<Packet> p = Create<Packet> (500);
+          FlowTag tag;
+          tag.SetFlowType (f == 0 ? FlowType::LIGHT : FlowType::HEAVY);
+          p->AddPacketTag (tag);
+          queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+        }
+    }
+
+  uint32_t bytes[2] = {0, 0};
+  for (uint32_t i = 0; i < DEQUEUES; i++)
+    {
+      Ptr<QueueDiscItem> item = queueDisc->Dequeue ();
+      uint8_t tos;
+      NS_TEST_EXPECT_MSG_EQ (item->GetUint8Value (QueueItem::IP_DSFIELD, tos), true, "the ToS should be available");
+      bytes[tos == 0 ? 1 : 0] += item->GetSize ();
+    }
+  queueDisc->Dispose ();
+
+  return double (bytes[0]) / bytes[1];
+}
+
+void
+DRRQueueDiscWeightedFlows::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ_TOL (MeasureRatio ("None", ""), 1, 0.05, "unweighted flows should get the same throughput");
+  NS_TEST_EXPECT_MSG_EQ_TOL (MeasureRatio ("Dscp", "10:3"), 3, 0.15, "unexpected throughput ratio with DSCP weights");
+  NS_TEST_EXPECT_MSG_EQ_TOL (MeasureRatio ("FlowType", "0:1 1:2"), 2, 0.1, "unexpected throughput ratio with flow type weights");
+  NS_TEST_EXPECT_MSG_EQ_TOL (MeasureRatio ("Dscp", "10:2 0:5"), 0.4, 0.02, "unexpected throughput ratio with DSCP weights");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that flows storing their packets in an inline FIFO with
+ * embedded CoDel behave as flows with a child CoDel queue disc
+ */
+class DRRQueueDiscInlineFlows : public TestCase
+{
+public:
+  DRRQueueDiscInlineFlows ();
+  virtual ~DRRQueueDiscInlineFlows ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue packets of variable size into three flows and dequeue them all
+   * \param inlineFlows whether the flows use inline FIFOs
+   * \return the sizes of the dequeued packets, in dequeue order
+   */
+  std::vector<uint32_t> DequeueOrder (bool inlineFlows);
+  /**
+   * Enqueue a burst of packets into a flow and dequeue them slowly, so that
+   * CoDel drops packets
+   * \param inlineFlows whether the flows use inline FIFOs
+   * \param reason the reason of the CoDel drops in the DRR queue disc statistics
+   * \return the number of packets dropped by CoDel
+   */
+  uint32_t CoDelDrops (bool inlineFlows, std::string reason);
+  /**
+   * Dequeue a packet
+   * \param queueDisc the queue disc
+   */
+  void Dequeue (Ptr<DRRQueueDisc> queueDisc);
+};
+
+DRRQueueDiscInlineFlows::DRRQueueDiscInlineFlows ()
+  : TestCase ("Test flows with an inline FIFO and CoDel")
+{
+}
+
+DRRQueueDiscInlineFlows::~DRRQueueDiscInlineFlows ()
+{
+}
+
+std::vector<uint32_t>
+DRRQueueDiscInlineFlows::DequeueOrder (bool inlineFlows)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (20000),
+                                                                          "InlineFlows", BooleanValue (inlineFlows));
+  Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
+  queueDisc->AddPacketFilter (ipv4Filter);
+
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetProtocol (7);
+  Address dest;
+
+  // 30 packets per flow, more than the byte limit so that packets are dropped
+  for (uint32_t i = 0; i < 90; i++)
+    {
+      hdr.SetDestination (Ipv4Address (0x0a0a0102 + i % 3));
+      uint32_t size = 100 + (i * 397) % 1400;
+      hdr.SetPayloadSize (size);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (size), dest, 0, hdr));
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), (inlineFlows ? 0 : 3), "unexpected number of classes");
+
+  std::vector<uint32_t> sizes;
+  Ptr<QueueDiscItem> item;
+  while ((item = queueDisc->Dequeue ()))
+    {
+      sizes.push_back (item->GetSize ());
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNBytes (), 0, "all the packets should have been dequeued");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().nTotalDroppedPackets + sizes.size (), 90, "every packet should have been dequeued or dropped");
+  queueDisc->Dispose ();
+  return sizes;
+}
+
+void
+DRRQueueDiscInlineFlows::Dequeue (Ptr<DRRQueueDisc> queueDisc)
+{
+  queueDisc->Dequeue ();
+}
+
+uint32_t
+DRRQueueDiscInlineFlows::CoDelDrops (bool inlineFlows, std::string reason)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("ByteLimit", UintegerValue (1000000),
+                                                                          "InlineFlows", BooleanValue (inlineFlows));
+  Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
+  queueDisc->AddPacketFilter (ipv4Filter);
+
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Ipv4Header hdr;
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (7);
+  hdr.SetPayloadSize (1000);
+  Address dest;
+
+  for (uint32_t i = 0; i < 300; i++)
+    {
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (1000), dest, 0, hdr));
+    }
+  for (uint32_t i = 0; i < 300; i++)
+    {
+      Simulator::Schedule (MilliSeconds (2 * i), &DRRQueueDiscInlineFlows::Dequeue, this, queueDisc);
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 0, "all the packets should have been dequeued or dropped");
+  uint32_t drops = queueDisc->GetStats ().GetNDroppedPackets (reason);
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+  return drops;
+}
+
+void
+DRRQueueDiscInlineFlows::DoRun (void)
+{
+  std::vector<uint32_t> childOrder = DequeueOrder (false);
+  std::vector<uint32_t> inlineOrder = DequeueOrder (true);
+  NS_TEST_EXPECT_MSG_EQ (childOrder.size (), inlineOrder.size (), "unexpected number of dequeued packets");
+  NS_TEST_EXPECT_MSG_EQ ((childOrder == inlineOrder), true, "packets should be dequeued in the same order");
+
+  uint32_t childDrops = CoDelDrops (false, std::string (QueueDisc::CHILD_QUEUE_DISC_DROP) + CoDelQueueDisc::TARGET_EXCEEDED_DROP);
+  uint32_t inlineDrops = CoDelDrops (true, DRRQueueDisc::TARGET_EXCEEDED_DROP);
+  NS_TEST_EXPECT_MSG_GT (childDrops, 0, "CoDel should have dropped packets");
+  NS_TEST_EXPECT_MSG_EQ (inlineDrops, childDrops, "the inline CoDel should drop as many packets as the CoDel queue disc");
+}
+
+/**
+ * This class tests the type of the flow queue discs, the pool of
+ * pre-initialized flows and the recycling of idle flows
+ */
+class DRRQueueDiscFlowPool : public TestCase
+{
+public:
+  DRRQueueDiscFlowPool ();
+  virtual ~DRRQueueDiscFlowPool ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a packet
+   * \param queueDisc the queue disc
+   * \param dest the destination address of the packet
+   */
+  void Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest);
+  /**
+   * Dequeue a packet
+   * \param queueDisc the queue disc
+   */
+  void Dequeue (Ptr<DRRQueueDisc> queueDisc);
+  /**
+   * Check the number of flows created by the queue disc
+   * \param queueDisc the queue disc
+   * \param nFlows the expected number of flows
+   */
+  void CheckFlows (Ptr<DRRQueueDisc> queueDisc, uint32_t nFlows);
+};
+
+DRRQueueDiscFlowPool::DRRQueueDiscFlowPool ()
+  : TestCase ("Test the flow queue disc type and the recycling of flows")
+{
+}
+
+DRRQueueDiscFlowPool::~DRRQueueDiscFlowPool ()
+{
+}
+
+void
+DRRQueueDiscFlowPool::Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (7);
+  Address addr;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (500), addr, 0, hdr));
+}
+
+void
+DRRQueueDiscFlowPool::Dequeue (Ptr<DRRQueueDisc> queueDisc)
+{
+  NS_TEST_EXPECT_MSG_NE (queueDisc->Dequeue (), 0, "a packet should have been dequeued");
+}
+
+void
+DRRQueueDiscFlowPool::CheckFlows (Ptr<DRRQueueDisc> queueDisc, uint32_t nFlows)
+{
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), nFlows, "unexpected number of flows at " << Simulator::Now ().GetSeconds () << "s");
+}
+
+void
+DRRQueueDiscFlowPool::DoRun (void)
+{
+  // the flows are created at initialization time with the configured type
+  std::string types[] = {"Fifo", "CoDel", "Pie", "Red"};
+  std::string typeIds[] = {"ns3::FifoQueueDisc", "ns3::CoDelQueueDisc", "ns3::PieQueueDisc", "ns3::RedQueueDisc"};
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("FlowQueueDiscType", StringValue (types[i]),
+                                                                              "FlowPoolSize", UintegerValue (3));
+      queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+      queueDisc->SetQuantum (600);
+      queueDisc->Initialize ();
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 3, "the pool should hold 3 flows");
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (0)->GetQueueDisc ()->GetInstanceTypeId ().GetName (),
+                             typeIds[i], "unexpected flow queue disc type");
+
+      // the first two flows come from the pool, the fourth is created
+      Enqueue (queueDisc, Ipv4Address ("10.10.1.2"));
+      Enqueue (queueDisc, Ipv4Address ("10.10.1.3"));
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 3, "the flows should have been taken from the pool");
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (0)->GetQueueDisc ()->GetNPackets (), 1, "the first pool flow should be used first");
+      Enqueue (queueDisc, Ipv4Address ("10.10.1.4"));
+      Enqueue (queueDisc, Ipv4Address ("10.10.1.5"));
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 4, "a flow should have been created");
+      for (uint32_t p = 0; p < 4; p++)
+        {
+          Dequeue (queueDisc);
+        }
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 0, "all the packets should have been dequeued");
+      queueDisc->Dispose ();
+    }
+
+  // flows idle for more than one second are recycled
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("FlowIdleTimeout", TimeValue (Seconds (1)));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.2"));
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.3"));
+  Simulator::Schedule (Seconds (0.1), &DRRQueueDiscFlowPool::Dequeue, this, queueDisc);
+  // the second flow becomes idle at 1.5s
+  Simulator::Schedule (Seconds (1.5), &DRRQueueDiscFlowPool::Dequeue, this, queueDisc);
+  // the first flow has been idle for more than one second, it is recycled
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.4"));
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowPool::CheckFlows, this, queueDisc, 2);
+  // the second flow has not been idle long enough
+  Simulator::Schedule (Seconds (2.2), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.5"));
+  Simulator::Schedule (Seconds (2.2), &DRRQueueDiscFlowPool::CheckFlows, this, queueDisc, 3);
+  // a flow that receives a packet is not idle anymore
+  Simulator::Schedule (Seconds (2.3), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.3"));
+  Simulator::Schedule (Seconds (5), &DRRQueueDiscFlowPool::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.6"));
+  Simulator::Schedule (Seconds (5), &DRRQueueDiscFlowPool::CheckFlows, this, queueDisc, 4);
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 4, "unexpected number of packets in the queue disc");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that the queue disc of a reused flow starts from its
+ * initial state and that the periodic events of the queue discs of the
+ * pooled flows do not run
+ */
+class DRRQueueDiscFlowReuse : public TestCase
+{
+public:
+  DRRQueueDiscFlowReuse ();
+  virtual ~DRRQueueDiscFlowReuse ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue packets
+   * \param queueDisc the queue disc
+   * \param dest the destination address of the packets
+   * \param n the number of packets
+   */
+  void Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest, uint32_t n);
+  /**
+   * Dequeue packets
+   * \param queueDisc the queue disc
+   * \param n the maximum number of packets
+   */
+  void Dequeue (Ptr<DRRQueueDisc> queueDisc, uint32_t n);
+  /**
+   * Check the CoDel state of the queue disc of the first flow
+   * \param queueDisc the queue disc
+   * \param reset whether the state should be the initial one
+   */
+  void CheckCoDelState (Ptr<DRRQueueDisc> queueDisc, bool reset);
+};
+
+DRRQueueDiscFlowReuse::DRRQueueDiscFlowReuse ()
+  : TestCase ("Test the reset of the queue disc of reused flows")
+{
+}
+
+DRRQueueDiscFlowReuse::~DRRQueueDiscFlowReuse ()
+{
+}
+
+void
+DRRQueueDiscFlowReuse::Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest, uint32_t n)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (7);
+  Address addr;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (500), addr, 0, hdr));
+    }
+}
+
+void
+DRRQueueDiscFlowReuse::Dequeue (Ptr<DRRQueueDisc> queueDisc, uint32_t n)
+{
+  for (uint32_t i = 0; i < n && queueDisc->Dequeue (); i++)
+    {
+    }
+}
+
+void
+DRRQueueDiscFlowReuse::CheckCoDelState (Ptr<DRRQueueDisc> queueDisc, bool reset)
+{
+  Ptr<CoDelQueueDisc> codel = DynamicCast<CoDelQueueDisc> (queueDisc->GetQueueDiscClass (0)->GetQueueDisc ());
+  NS_TEST_ASSERT_MSG_NE (codel, 0, "the flows should have a CoDel queue disc");
+  if (reset)
+    {
+      NS_TEST_EXPECT_MSG_EQ (codel->GetDropNext (), 0, "the CoDel state of a reused flow should be reset");
+    }
+  else
+    {
+      NS_TEST_EXPECT_MSG_NE (codel->GetDropNext (), 0, "CoDel should have entered the dropping state");
+    }
+}
+
+void
+DRRQueueDiscFlowReuse::DoRun (void)
+{
+  // the update timer of the PIE queue discs of the pooled flows is cancelled
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("FlowQueueDiscType", StringValue ("Pie"),
+                                                                          "FlowPoolSize", UintegerValue (3));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->Initialize ();
+  uint64_t events = Simulator::GetEventCount ();
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  // the cancelled events and the stop event are counted, the timer of a PIE
+  // queue disc would have run about 60 times
+  NS_TEST_EXPECT_MSG_LT (Simulator::GetEventCount () - events, 10, "the pooled PIE queue discs should not run their timer");
+
+  // the timer of the PIE queue disc of a flow taken from the pool runs again
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.2"), 1);
+  events = Simulator::GetEventCount ();
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_GT (Simulator::GetEventCount () - events, 10, "the PIE queue disc of an active flow should run its timer");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+
+  // a flow whose CoDel queue disc entered the dropping state is idle for more
+  // than one second and is recycled for another flow
+  queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("FlowIdleTimeout", TimeValue (Seconds (1)));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscFlowReuse::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.2"), 20);
+  Simulator::Schedule (Seconds (0.2), &DRRQueueDiscFlowReuse::Dequeue, this, queueDisc, 1);
+  Simulator::Schedule (Seconds (0.4), &DRRQueueDiscFlowReuse::Dequeue, this, queueDisc, 20);
+  Simulator::Schedule (Seconds (0.5), &DRRQueueDiscFlowReuse::CheckCoDelState, this, queueDisc, false);
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowReuse::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.3"), 1);
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowReuse::CheckCoDelState, this, queueDisc, true);
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 1, "the flow should have been recycled");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the release of idle flows to the free list on dequeue
+ * and the bound on the memory of the flows
+ */
+class DRRQueueDiscFlowReclamation : public TestCase
+{
+public:
+  DRRQueueDiscFlowReclamation ();
+  virtual ~DRRQueueDiscFlowReclamation ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a packet
+   * \param queueDisc the queue disc
+   * \param dest the destination address of the packet
+   */
+  void Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest);
+  /**
+   * Dequeue a packet, if any
+   * \param queueDisc the queue disc
+   */
+  void Dequeue (Ptr<DRRQueueDisc> queueDisc);
+  /**
+   * Trace sink for the FlowCreated trace source
+   * \param index the index of the flow
+   * \param bucket the hash bucket of the flow
+   */
+  void FlowCreated (uint32_t index, uint32_t bucket);
+  /**
+   * Trace sink for the FlowReclaimed trace source
+   * \param index the index of the flow
+   * \param bucket the hash bucket of the flow
+   */
+  void FlowReclaimed (uint32_t index, uint32_t bucket);
+  uint32_t m_created;   //!< Number of flows created
+  uint32_t m_reclaimed; //!< Number of flows reclaimed
+};
+
+DRRQueueDiscFlowReclamation::DRRQueueDiscFlowReclamation ()
+  : TestCase ("Test the reclamation of idle flows and the flow memory limit"),
+    m_created (0),
+    m_reclaimed (0)
+{
+}
+
+DRRQueueDiscFlowReclamation::~DRRQueueDiscFlowReclamation ()
+{
+}
+
+void
+DRRQueueDiscFlowReclamation::Enqueue (Ptr<DRRQueueDisc> queueDisc, Ipv4Address dest)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (7);
+  Address addr;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (500), addr, 0, hdr));
+}
+
+void
+DRRQueueDiscFlowReclamation::Dequeue (Ptr<DRRQueueDisc> queueDisc)
+{
+  queueDisc->Dequeue ();
+}
+
+void
+DRRQueueDiscFlowReclamation::FlowCreated (uint32_t index, uint32_t bucket)
+{
+  m_created++;
+}
+
+void
+DRRQueueDiscFlowReclamation::FlowReclaimed (uint32_t index, uint32_t bucket)
+{
+  m_reclaimed++;
+}
+
+void
+DRRQueueDiscFlowReclamation::DoRun (void)
+{
+  // the memory of the flows is bounded to two flows
+  Ptr<DRRQueueDisc> queueDisc = CreateObject<DRRQueueDisc> ();
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->TraceConnectWithoutContext ("FlowCreated", MakeCallback (&DRRQueueDiscFlowReclamation::FlowCreated, this));
+  queueDisc->TraceConnectWithoutContext ("FlowReclaimed", MakeCallback (&DRRQueueDiscFlowReclamation::FlowReclaimed, this));
+  queueDisc->Initialize ();
+
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.2"));
+  uint64_t flowMemory = queueDisc->GetFlowMemory ();
+  NS_TEST_EXPECT_MSG_GT (flowMemory, 0, "the memory of a flow should be accounted");
+  queueDisc->SetAttribute ("MaxFlowMemory", UintegerValue (2 * flowMemory));
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.3"));
+  NS_TEST_EXPECT_MSG_EQ (m_created, 2, "two flows should have been created");
+  Dequeue (queueDisc);
+  Dequeue (queueDisc);
+
+  // the idle flows are recycled, oldest first, rather than creating new ones
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.4"));
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.5"));
+  NS_TEST_EXPECT_MSG_EQ (m_created, 2, "no flow should have been created");
+  NS_TEST_EXPECT_MSG_EQ (m_reclaimed, 2, "the two idle flows should have been recycled");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetFlowMemory (), 2 * flowMemory, "the memory of the flows should not grow");
+
+  // no flow is idle, so a packet of a new flow is dropped
+  Enqueue (queueDisc, Ipv4Address ("10.10.1.6"));
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (DRRQueueDisc::FLOW_MEMORY_DROP), 1,
+                         "the packet of a new flow should have been dropped");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 2, "unexpected number of packets in the queue disc");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 2, "unexpected number of flows");
+  queueDisc->Dispose ();
+
+  // flows idle for more than one second are released on dequeue, one at a time
+  m_created = 0;
+  m_reclaimed = 0;
+  queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("FlowIdleTimeout", TimeValue (Seconds (1)),
+                                                        "InlineFlows", BooleanValue (true));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->TraceConnectWithoutContext ("FlowCreated", MakeCallback (&DRRQueueDiscFlowReclamation::FlowCreated, this));
+  queueDisc->TraceConnectWithoutContext ("FlowReclaimed", MakeCallback (&DRRQueueDiscFlowReclamation::FlowReclaimed, this));
+  queueDisc->Initialize ();
+
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscFlowReclamation::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.2"));
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscFlowReclamation::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.3"));
+  Simulator::Schedule (Seconds (0.1), &DRRQueueDiscFlowReclamation::Dequeue, this, queueDisc);
+  Simulator::Schedule (Seconds (0.1), &DRRQueueDiscFlowReclamation::Dequeue, this, queueDisc);
+  Simulator::Schedule (Seconds (1.5), &DRRQueueDiscFlowReclamation::Dequeue, this, queueDisc);
+  Simulator::Schedule (Seconds (1.6), &DRRQueueDiscFlowReclamation::Dequeue, this, queueDisc);
+  // the new flows are taken from the free list
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowReclamation::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.4"));
+  Simulator::Schedule (Seconds (2), &DRRQueueDiscFlowReclamation::Enqueue, this, queueDisc, Ipv4Address ("10.10.1.5"));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_created, 2, "no flow should have been created after the first two");
+  NS_TEST_EXPECT_MSG_EQ (m_reclaimed, 2, "the two idle flows should have been released");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 2, "unexpected number of packets in the queue disc");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that a batch dequeue extracts the same packets, in the
+ * same order, as single dequeues, within the given packet and byte limits
+ */
+class DRRQueueDiscBatchDequeue : public TestCase
+{
+public:
+  DRRQueueDiscBatchDequeue ();
+  virtual ~DRRQueueDiscBatchDequeue ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Create a queue disc and enqueue packets of various sizes into a few flows
+   * \param inlineFlows whether the flows use inline FIFOs
+   * \return the queue disc
+   */
+  Ptr<DRRQueueDisc> CreateQueueDisc (bool inlineFlows);
+};
+
+DRRQueueDiscBatchDequeue::DRRQueueDiscBatchDequeue ()
+  : TestCase ("Test that batch dequeues match single dequeues")
+{
+}
+
+DRRQueueDiscBatchDequeue::~DRRQueueDiscBatchDequeue ()
+{
+}
+
+Ptr<DRRQueueDisc>
+DRRQueueDiscBatchDequeue::CreateQueueDisc (bool inlineFlows)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("InlineFlows", BooleanValue (inlineFlows),
+                                                                          "InlineCoDel", BooleanValue (false),
+                                                                          "FlowQueueDiscType", StringValue ("Fifo"));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  Address addr;
+  for (uint32_t i = 0; i < 30; i++)
+    {
+      Ipv4Header hdr;
+      uint32_t size = 100 + (i * 137) % 900;
+      hdr.SetPayloadSize (size);
+      hdr.SetSource (Ipv4Address ("10.10.1.1"));
+      hdr.SetDestination (Ipv4Address (0x0a0a0102 + i % 3));
+      hdr.SetProtocol (7);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (size), addr, 0, hdr));
+    }
+  return queueDisc;
+}
+
+void
+DRRQueueDiscBatchDequeue::DoRun (void)
+{
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<DRRQueueDisc> single = CreateQueueDisc (i == 1);
+      Ptr<DRRQueueDisc> batch = CreateQueueDisc (i == 1);
+      std::vector<Ptr<QueueDiscItem> > items;
+
+      // a peeked packet is extracted first
+      Ptr<const QueueDiscItem> peeked = batch->Peek ();
+      NS_TEST_EXPECT_MSG_EQ (batch->DequeueBatch (4, 100000, items), 4, "four packets should have been dequeued");
+      NS_TEST_EXPECT_MSG_EQ (items[0], peeked, "the peeked packet should be dequeued first");
+
+      // the batch stops once the byte limit is reached
+      NS_TEST_EXPECT_MSG_EQ (batch->DequeueBatch (100, 1, items), 1, "a byte limit of one byte should let one packet out");
+      uint32_t n = batch->DequeueBatch (100, 2000, items);
+      uint32_t bytes = 0;
+      for (uint32_t j = items.size () - n; j < items.size (); j++)
+        {
+          bytes += items[j]->GetSize ();
+        }
+      NS_TEST_EXPECT_MSG_GT_OR_EQ (bytes, 2000, "the batch should stop after reaching the byte limit");
+      NS_TEST_EXPECT_MSG_LT (bytes - items.back ()->GetSize (), 2000, "the batch should stop as soon as the byte limit is reached");
+
+      while (batch->DequeueBatch (7, 100000, items) > 0)
+        {
+        }
+      NS_TEST_EXPECT_MSG_EQ (items.size (), 30, "all the packets should have been dequeued");
+      NS_TEST_EXPECT_MSG_EQ (batch->GetStats ().nTotalDequeuedPackets, 30, "the dequeued packets should be counted");
+
+      for (uint32_t j = 0; j < items.size (); j++)
+        {
+          // packet sizes are all distinct
+          Ptr<QueueDiscItem> item = single->Dequeue ();
+          NS_TEST_EXPECT_MSG_EQ ((item != 0), true, "packet " << j << " should have been dequeued");
+          NS_TEST_EXPECT_MSG_EQ (items[j]->GetSize (), (item ? item->GetSize () : 0), "packet " << j << " should match the single dequeue order");
+        }
+      single->Dispose ();
+      batch->Dispose ();
+    }
+}
+
+/**
+ * This class tests that packets handed over by a producer thread through
+ * the enqueue ring are classified and enqueued by the simulator thread
+ */
+class DRRQueueDiscEnqueueRing : public TestCase
+{
+public:
+  DRRQueueDiscEnqueueRing ();
+  virtual ~DRRQueueDiscEnqueueRing ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Push packets of four flows into the enqueue ring, retrying while the ring is full
+   * \param queueDisc the queue disc
+   * \param nPackets the number of packets
+   */
+  static void Produce (Ptr<DRRQueueDisc> queueDisc, uint32_t nPackets);
+  /**
+   * Push the given packets into the enqueue ring, retrying while the ring is
+   * full, while the simulator is running. The queue disc is passed as a plain
+   * pointer as the reference counts must not be changed by this thread.
+   * \param queueDisc the queue disc
+   * \param items the packets, created by the simulator thread
+   */
+  static void ProduceConcurrently (DRRQueueDisc *queueDisc, std::vector<Ptr<QueueDiscItem> > *items);
+  /**
+   * Dequeue all the packets in the queue disc and reschedule until the given
+   * number of packets has been dequeued
+   * \param queueDisc the queue disc
+   * \param nPackets the number of packets to dequeue
+   */
+  void Consume (Ptr<DRRQueueDisc> queueDisc, uint32_t nPackets);
+  uint32_t m_dequeued;                   //!< Number of packets dequeued
+  std::map<Ipv4Address, uint32_t> m_dequeuedPerFlow;  //!< Number of packets dequeued per destination
+};
+
+DRRQueueDiscEnqueueRing::DRRQueueDiscEnqueueRing ()
+  : TestCase ("Test the lock-free enqueue ring fed by another thread"),
+    m_dequeued (0)
+{
+}
+
+DRRQueueDiscEnqueueRing::~DRRQueueDiscEnqueueRing ()
+{
+}
+
+void
+DRRQueueDiscEnqueueRing::Produce (Ptr<DRRQueueDisc> queueDisc, uint32_t nPackets)
+{
+  Address addr;
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Ipv4Header hdr;
+      hdr.SetPayloadSize (100);
+      hdr.SetSource (Ipv4Address ("10.10.1.1"));
+      hdr.SetDestination (Ipv4Address (0x0a0a0102 + i % 4));
+      hdr.SetProtocol (7);
+      Ptr<QueueDiscItem> item = Create<Ipv4QueueDiscItem> (Create<Packet> (100), addr, 0, hdr);
+      while (!queueDisc->ProducerEnqueue (item))
+        {
+          std::this_thread::yield ();
+        }
+    }
+}
+
+void
+DRRQueueDiscEnqueueRing::ProduceConcurrently (DRRQueueDisc *queueDisc, std::vector<Ptr<QueueDiscItem> > *items)
+{
+  for (std::vector<Ptr<QueueDiscItem> >::iterator it = items->begin (); it != items->end (); it++)
+    {
+      while (!queueDisc->ProducerEnqueue (*it))
+        {
+          std::this_thread::yield ();
+        }
+    }
+}
+
+void
+DRRQueueDiscEnqueueRing::Consume (Ptr<DRRQueueDisc> queueDisc, uint32_t nPackets)
+{
+  Ptr<QueueDiscItem> item;
+  while ((item = queueDisc->Dequeue ()))
+    {
+      m_dequeued++;
+      m_dequeuedPerFlow[DynamicCast<Ipv4QueueDiscItem> (item)->GetHeader ().GetDestination ()]++;
+    }
+  if (m_dequeued < nPackets)
+    {
+      Simulator::Schedule (MicroSeconds (10), &DRRQueueDiscEnqueueRing::Consume, this, queueDisc, nPackets);
+    }
+}
+
+void
+DRRQueueDiscEnqueueRing::DoRun (void)
+{
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("EnqueueRingSize", UintegerValue (512));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (600);
+  queueDisc->Initialize ();
+
+  // the producer fills the ring while the simulator is not running, so the
+  // whole ring is drained by a single event
+  std::thread producer (&DRRQueueDiscEnqueueRing::Produce, queueDisc, 400);
+  producer.join ();
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 0, "the packets should still be in the enqueue ring");
+
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 400, "all the packets should have been enqueued");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 4, "the packets should have been classified into four flows");
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (i)->GetQueueDisc ()->GetNPackets (), 100,
+                             "flow " << i << " should hold a quarter of the packets");
+    }
+
+  // packets pushed after a drain schedule another drain
+  std::thread second (&DRRQueueDiscEnqueueRing::Produce, queueDisc, 8);
+  second.join ();
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 408, "the packets pushed after the drain should have been enqueued");
+
+  // the flow hash is computed by the producer and stored in the item before
+  // the ring is drained, and it is the hash computed by the filter
+  UdpHeader udpHdr;
+  udpHdr.SetSourcePort (1000);
+  udpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (udpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (17);
+  Ptr<QueueDiscItem> item = Create<Ipv4QueueDiscItem> (p->Copy (), Address (), 0, hdr);
+  QueueDiscItem *raw = PeekPointer (item);
+  uint32_t hash;
+  NS_TEST_EXPECT_MSG_EQ (raw->GetFlowHash (hash), false, "the item should not have a flow hash yet");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->ProducerEnqueue (item), true, "the packet should have been pushed into the ring");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 408, "the ring should not have been drained yet");
+  NS_TEST_EXPECT_MSG_EQ (raw->GetFlowHash (hash), true, "the producer should have stored the flow hash in the item");
+  Ptr<QueueDiscItem> reference = Create<Ipv4QueueDiscItem> (p->Copy (), Address (), 0, hdr);
+  NS_TEST_EXPECT_MSG_EQ (hash, static_cast<uint32_t> (CreateObject<DRRIpv4PacketFilter> ()->Classify (reference)),
+                         "the producer should have computed the hash of the filter");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 409, "the hashed packet should have been enqueued");
+
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+
+  // the producer pushes into a small ring while the simulator drains it and
+  // dequeues the packets, so that the packets are handed over, classified and
+  // released concurrently with the pushes. The packets are created upfront, as
+  // creating packets is not thread safe either
+  queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("EnqueueRingSize", UintegerValue (16));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->Initialize ();
+
+  uint32_t nPackets = 2000;
+  std::vector<Ptr<QueueDiscItem> > items;
+  Address addr;
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Ipv4Header hdr;
+      hdr.SetPayloadSize (100);
+      hdr.SetSource (Ipv4Address ("10.10.1.1"));
+      hdr.SetDestination (Ipv4Address (0x0a0a0102 + i % 4));
+      hdr.SetProtocol (7);
+      items.push_back (Create<Ipv4QueueDiscItem> (Create<Packet> (100), addr, 0, hdr));
+    }
+
+  Simulator::Schedule (Seconds (0), &DRRQueueDiscEnqueueRing::Consume, this, queueDisc, nPackets);
+  std::thread concurrent (&DRRQueueDiscEnqueueRing::ProduceConcurrently, PeekPointer (queueDisc), &items);
+  Simulator::Run ();
+  concurrent.join ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_dequeued, nPackets, "all the packets should have been dequeued");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().nTotalReceivedPackets, nPackets, "all the packets should have been enqueued");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 4, "the packets should have been classified into four flows");
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_dequeuedPerFlow[Ipv4Address (0x0a0a0102 + i)], nPackets / 4,
+                             "flow " << i << " should have received a quarter of the packets");
+    }
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (items[i], 0, "the ring should have taken the reference to the packet");
+    }
+
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that the flow hash computed by the DRR filter is cached
+ * in the item and in the packet, and only reused while the header matches
+ */
+class DRRQueueDiscFlowHashCache : public TestCase
+{
+public:
+  DRRQueueDiscFlowHashCache ();
+  virtual ~DRRQueueDiscFlowHashCache ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Create an item carrying a TCP segment
+   * \param p the packet, carrying the TCP header
+   * \param dest the destination address
+   * \return the item
+   */
+  Ptr<Ipv4QueueDiscItem> CreateItem (Ptr<Packet> p, Ipv4Address dest);
+};
+
+DRRQueueDiscFlowHashCache::DRRQueueDiscFlowHashCache ()
+  : TestCase ("Test the caching of the flow hash")
+{
+}
+
+DRRQueueDiscFlowHashCache::~DRRQueueDiscFlowHashCache ()
+{
+}
+
+Ptr<Ipv4QueueDiscItem>
+DRRQueueDiscFlowHashCache::CreateItem (Ptr<Packet> p, Ipv4Address dest)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (6);
+  Address addr;
+  return Create<Ipv4QueueDiscItem> (p, addr, 0, hdr);
+}
+
+void
+DRRQueueDiscFlowHashCache::DoRun (void)
+{
+  Ptr<DRRIpv4PacketFilter> filter = CreateObject<DRRIpv4PacketFilter> ();
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (7);
+  tcpHdr.SetDestinationPort (27);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (tcpHdr);
+
+  // the first classification stores the hash in the item and in the packet
+  Ptr<Ipv4QueueDiscItem> item = CreateItem (p, Ipv4Address ("10.10.1.2"));
+  int32_t hash = filter->Classify (item);
+  uint32_t cached;
+  NS_TEST_EXPECT_MSG_EQ (item->GetFlowHash (cached), true, "the hash should be cached in the item");
+  NS_TEST_EXPECT_MSG_EQ (cached, uint32_t (hash), "the item should cache the computed hash");
+  FlowHashTag tag;
+  NS_TEST_EXPECT_MSG_EQ (p->PeekPacketTag (tag), true, "the hash should be cached in the packet");
+  NS_TEST_EXPECT_MSG_EQ (tag.GetHash (), uint32_t (hash), "the packet should carry the computed hash");
+
+  // the BFDRR filter hashes the same fields
+  Ptr<BFDRRIpv4PacketFilter> bfdrrFilter = CreateObject<BFDRRIpv4PacketFilter> ();
+  NS_TEST_EXPECT_MSG_EQ (bfdrrFilter->Classify (CreateItem (Create<Packet> (*p), Ipv4Address ("10.10.1.2"))), hash,
+                         "the BFDRR filter should compute the same hash");
+
+  // the next hop reuses the hash carried by the packet (altered here to tell
+  // whether it is recomputed)
+  tag.SetHash (12345);
+  p->ReplacePacketTag (tag);
+  NS_TEST_EXPECT_MSG_EQ (filter->Classify (CreateItem (p, Ipv4Address ("10.10.1.2"))), 12345,
+                         "the hash carried by the packet should be reused");
+
+  // a different destination invalidates the hash carried by the packet
+  Ptr<Packet> fresh = Create<Packet> (100);
+  fresh->AddHeader (tcpHdr);
+  int32_t other = filter->Classify (CreateItem (fresh, Ipv4Address ("10.10.1.3")));
+  NS_TEST_EXPECT_MSG_EQ (filter->Classify (CreateItem (p, Ipv4Address ("10.10.1.3"))), other,
+                         "the hash should be recomputed for a different header");
+  NS_TEST_EXPECT_MSG_NE (other, hash, "distinct flows should have distinct hashes");
+
+  // rewritten ports (e.g., by a NAT) invalidate the hash carried by the packet
+  Ptr<Packet> natted = p->Copy ();
+  natted->RemoveHeader (tcpHdr);
+  tcpHdr.SetSourcePort (4007);
+  natted->AddHeader (tcpHdr);
+  fresh = Create<Packet> (100);
+  fresh->AddHeader (tcpHdr);
+  other = filter->Classify (CreateItem (fresh, Ipv4Address ("10.10.1.2")));
+  NS_TEST_EXPECT_MSG_EQ (filter->Classify (CreateItem (natted, Ipv4Address ("10.10.1.2"))), other,
+                         "the hash should be recomputed for different ports");
+}
+
+/**
+ * This class tests that IPv6 and non-IP packets are classified by the
+ * default filters of the DRR queue disc
+ */
+class DRRQueueDiscIpv6AndNonIpFlows : public TestCase
+{
+public:
+  DRRQueueDiscIpv6AndNonIpFlows ();
+  virtual ~DRRQueueDiscIpv6AndNonIpFlows ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a UDP datagram carried by an IPv6 packet
+   * \param queueDisc the queue disc
+   * \param srcPort the source port
+   * \param flowLabel the flow label
+   */
+  void AddIpv6Packet (Ptr<DRRQueueDisc> queueDisc, uint16_t srcPort, uint32_t flowLabel);
+};
+
+DRRQueueDiscIpv6AndNonIpFlows::DRRQueueDiscIpv6AndNonIpFlows ()
+  : TestCase ("Test the classification of IPv6 and non-IP packets")
+{
+}
+
+DRRQueueDiscIpv6AndNonIpFlows::~DRRQueueDiscIpv6AndNonIpFlows ()
+{
+}
+
+void
+DRRQueueDiscIpv6AndNonIpFlows::AddIpv6Packet (Ptr<DRRQueueDisc> queueDisc, uint16_t srcPort, uint32_t flowLabel)
+{
+  UdpHeader udpHdr;
+  udpHdr.SetSourcePort (srcPort);
+  udpHdr.SetDestinationPort (9);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (udpHdr);
+  Ipv6Header hdr;
+  hdr.SetPayloadLength (p->GetSize ());
+  hdr.SetSourceAddress (Ipv6Address ("2001:db8::1"));
+  hdr.SetDestinationAddress (Ipv6Address ("2001:db8::2"));
+  hdr.SetNextHeader (17);
+  hdr.SetFlowLabel (flowLabel);
+  Address dest;
+  queueDisc->Enqueue (Create<Ipv6QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+DRRQueueDiscIpv6AndNonIpFlows::DoRun (void)
+{
+  // no filter is added, hence the queue disc installs the default ones
+  Ptr<DRRQueueDisc> queueDisc = CreateObject<DRRQueueDisc> ();
+  queueDisc->Initialize ();
+  NS_TEST_ASSERT_MSG_EQ (queueDisc->GetNPacketFilters (), 3, "The IPv4, IPv6 and non-IP filters should be installed");
+
+  AddIpv6Packet (queueDisc, 7, 0);
+  AddIpv6Packet (queueDisc, 7, 0);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 1, "The packets of an IPv6 flow should share a flow queue");
+  AddIpv6Packet (queueDisc, 8, 0);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 2, "The ports should separate IPv6 flows");
+  AddIpv6Packet (queueDisc, 7, 0x12345);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 3, "The flow label should separate IPv6 flows");
+
+  // ARP packets are classified by their destination
+  ArpHeader arpHdr;
+  arpHdr.SetRequest (Mac48Address ("00:00:00:00:00:03"), Ipv4Address ("10.0.0.3"),
+                     Mac48Address::GetBroadcast (), Ipv4Address ("10.0.0.1"));
+  queueDisc->Enqueue (Create<ArpQueueDiscItem> (Create<Packet> (28), Mac48Address ("00:00:00:00:00:01"), 0x0806, arpHdr));
+  queueDisc->Enqueue (Create<ArpQueueDiscItem> (Create<Packet> (28), Mac48Address ("00:00:00:00:00:01"), 0x0806, arpHdr));
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 4, "The ARP packets to a host should share a flow queue");
+  queueDisc->Enqueue (Create<ArpQueueDiscItem> (Create<Packet> (28), Mac48Address ("00:00:00:00:00:02"), 0x0806, arpHdr));
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 5, "The ARP packets to distinct hosts should be separated");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 7, "All the packets should have been enqueued");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the hash engines of the DRR filters and the collision
+ * statistics
+ */
+class DRRQueueDiscHashEngines : public TestCase
+{
+public:
+  DRRQueueDiscHashEngines ();
+  virtual ~DRRQueueDiscHashEngines ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Create an IPv4 item carrying a TCP segment
+   * \param src the source address
+   * \param srcPort the source port
+   * \param dest the destination address
+   * \param destPort the destination port
+   * \return the item
+   */
+  Ptr<Ipv4QueueDiscItem> CreateIpv4Item (Ipv4Address src, uint16_t srcPort, Ipv4Address dest, uint16_t destPort);
+};
+
+DRRQueueDiscHashEngines::DRRQueueDiscHashEngines ()
+  : TestCase ("Test the hash engines of the filters and the collision statistics")
+{
+}
+
+DRRQueueDiscHashEngines::~DRRQueueDiscHashEngines ()
+{
+}
+
+Ptr<Ipv4QueueDiscItem>
+DRRQueueDiscHashEngines::CreateIpv4Item (Ipv4Address src, uint16_t srcPort, Ipv4Address dest, uint16_t destPort)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (destPort);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (src);
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (6);
+  Address addr;
+  return Create<Ipv4QueueDiscItem> (p, addr, 0, hdr);
+}
+
+void
+DRRQueueDiscHashEngines::DoRun (void)
+{
+  // SipHash-2-4 reference vector (key 00..0f, message 00..0e)
+  uint8_t msg[15];
+  for (uint8_t i = 0; i < 15; i++)
+    {
+      msg[i] = i;
+    }
+  NS_TEST_EXPECT_MSG_EQ (FlowHasher::SipHash24 (msg, 15, 0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL),
+                         0xa129ca6149be45e5ULL, "Unexpected SipHash-2-4 value");
+
+  // Toeplitz reference vectors of the RSS specification
+  Ptr<DRRIpv4PacketFilter> ipv4Filter = CreateObject<DRRIpv4PacketFilter> ();
+  ipv4Filter->GetFlowHasher ()->SetAttribute ("Engine", EnumValue (FlowHasher::TOEPLITZ));
+  NS_TEST_EXPECT_MSG_EQ (uint32_t (ipv4Filter->Classify (CreateIpv4Item (Ipv4Address ("66.9.149.187"), 2794,
+                                                                         Ipv4Address ("161.142.100.80"), 1766))),
+                         0x51ccc178, "Unexpected Toeplitz hash of an IPv4 packet");
+
+  Ptr<DRRIpv6PacketFilter> ipv6Filter = CreateObject<DRRIpv6PacketFilter> ();
+  ipv6Filter->GetFlowHasher ()->SetAttribute ("Engine", EnumValue (FlowHasher::TOEPLITZ));
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (2794);
+  tcpHdr.SetDestinationPort (1766);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (tcpHdr);
+  Ipv6Header ipv6Hdr;
+  ipv6Hdr.SetSourceAddress (Ipv6Address ("3ffe:2501:200:1fff::7"));
+  ipv6Hdr.SetDestinationAddress (Ipv6Address ("3ffe:2501:200:3::1"));
+  ipv6Hdr.SetNextHeader (6);
+  ipv6Hdr.SetFlowLabel (0x54321);
+  Address addr;
+  NS_TEST_EXPECT_MSG_EQ (uint32_t (ipv6Filter->Classify (Create<Ipv6QueueDiscItem> (p, addr, 0, ipv6Hdr))),
+                         0x40207d3d, "Unexpected Toeplitz hash of an IPv6 packet");
+
+  // a hash cached by a filter is not reused by a filter with another engine
+  Ptr<DRRIpv4PacketFilter> murmurFilter = CreateObject<DRRIpv4PacketFilter> ();
+  Ptr<DRRIpv4PacketFilter> fnvFilter = CreateObject<DRRIpv4PacketFilter> ();
+  fnvFilter->GetFlowHasher ()->SetAttribute ("Engine", EnumValue (FlowHasher::FNV1A));
+  Ptr<Ipv4QueueDiscItem> item = CreateIpv4Item (Ipv4Address ("10.0.0.1"), 1, Ipv4Address ("10.0.0.2"), 2);
+  int32_t murmur = murmurFilter->Classify (item);
+  int32_t fnv = fnvFilter->Classify (item);
+  NS_TEST_EXPECT_MSG_NE (fnv, murmur, "The FNV-1a engine should compute its own hash");
+  NS_TEST_EXPECT_MSG_EQ (fnvFilter->Classify (CreateIpv4Item (Ipv4Address ("10.0.0.1"), 1, Ipv4Address ("10.0.0.2"), 2)),
+                         fnv, "The FNV-1a hash should not depend on the cache");
+  NS_TEST_EXPECT_MSG_EQ (murmurFilter->Classify (CreateIpv4Item (Ipv4Address ("10.0.0.1"), 1, Ipv4Address ("10.0.0.2"), 2)),
+                         murmur, "The murmur3 hash should not depend on the cache");
+
+  // the keyed engine depends on the key
+  Ptr<DRRIpv4PacketFilter> sipFilter = CreateObject<DRRIpv4PacketFilter> ();
+  sipFilter->GetFlowHasher ()->SetAttribute ("Engine", EnumValue (FlowHasher::SIPHASH));
+  int32_t sip = sipFilter->Classify (CreateIpv4Item (Ipv4Address ("10.0.0.1"), 1, Ipv4Address ("10.0.0.2"), 2));
+  sipFilter->GetFlowHasher ()->SetAttribute ("Key", UintegerValue (0x1234567890ULL));
+  NS_TEST_EXPECT_MSG_NE (sipFilter->Classify (CreateIpv4Item (Ipv4Address ("10.0.0.1"), 1, Ipv4Address ("10.0.0.2"), 2)),
+                         sip, "The SipHash hash should depend on the key");
+
+  // collision statistics
+  Ptr<DRRIpv4PacketFilter> statsFilter = CreateObject<DRRIpv4PacketFilter> ();
+  Ptr<FlowHasher> hasher = statsFilter->GetFlowHasher ();
+  hasher->SetAttribute ("TrackCollisions", BooleanValue (true));
+  for (uint32_t rep = 0; rep < 2; rep++)
+    {
+      for (uint16_t port = 1; port <= 200; port++)
+        {
+          statsFilter->Classify (CreateIpv4Item (Ipv4Address ("10.0.0.1"), port, Ipv4Address ("10.0.0.2"), 80));
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (hasher->GetNTrackedFlows (), 200, "Every distinct flow should be tracked once");
+  NS_TEST_EXPECT_MSG_EQ (hasher->GetNCollisions (1), 199, "All the flows but one should collide in a single bucket");
+  NS_TEST_EXPECT_MSG_LT (hasher->GetCollisionRate (1024), 0.2, "The collision rate with 1024 buckets should be low");
+  NS_TEST_EXPECT_MSG_LT (hasher->GetCollisionRate (1 << 20), hasher->GetCollisionRate (16),
+                         "The collision rate should decrease with the number of buckets");
+  hasher->ResetCollisionStats ();
+  NS_TEST_EXPECT_MSG_EQ (hasher->GetNTrackedFlows (), 0, "The tracked flows should have been forgotten");
+}
+
+/**
+ * This class tests the set-associative flow table
+ */
+class DRRQueueDiscSetAssociativeFlowTable : public TestCase
+{
+public:
+  DRRQueueDiscSetAssociativeFlowTable ();
+  virtual ~DRRQueueDiscSetAssociativeFlowTable ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a TCP segment
+   * \param queueDisc the queue disc
+   * \param srcPort the source port, which identifies the flow
+   */
+  void AddPacket (Ptr<DRRQueueDisc> queueDisc, uint16_t srcPort);
+};
+
+DRRQueueDiscSetAssociativeFlowTable::DRRQueueDiscSetAssociativeFlowTable ()
+  : TestCase ("Test the set-associative flow table")
+{
+}
+
+DRRQueueDiscSetAssociativeFlowTable::~DRRQueueDiscSetAssociativeFlowTable ()
+{
+}
+
+void
+DRRQueueDiscSetAssociativeFlowTable::AddPacket (Ptr<DRRQueueDisc> queueDisc, uint16_t srcPort)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (6);
+  Address dest;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+DRRQueueDiscSetAssociativeFlowTable::DoRun (void)
+{
+  // a single set of 8 ways: every flow maps to the same set
+  Ptr<DRRQueueDisc> queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("Flows", UintegerValue (8),
+                                                                          "FlowTableWays", UintegerValue (8));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (1500);
+  queueDisc->Initialize ();
+
+  for (uint16_t port = 1; port <= 8; port++)
+    {
+      AddPacket (queueDisc, port);
+      AddPacket (queueDisc, port);
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 8, "Each flow should have its own queue");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNCollisionsAvoided (), 7, "The flows after the first one should have avoided a collision");
+  for (uint32_t i = 0; i < queueDisc->GetNQueueDiscClasses (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (i)->GetQueueDisc ()->GetNPackets (), 2,
+                             "Each queue should hold the packets of one flow");
+    }
+
+  // all the ways are backlogged, hence a ninth flow shares a queue
+  AddPacket (queueDisc, 9);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 8, "No queue should have been created");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowMerges (), 1, "The ninth flow should share a queue");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 0, "No flow should have been evicted");
+
+  // the merged flow keeps the shared way while the way is backlogged, even
+  // after another way has become inactive
+  uint32_t shared = 8;
+  for (uint32_t i = 0; i < queueDisc->GetNQueueDiscClasses (); i++)
+    {
+      if (queueDisc->GetQueueDiscClass (i)->GetQueueDisc ()->GetNPackets () == 3)
+        {
+          shared = i;
+        }
+    }
+  NS_TEST_ASSERT_MSG_LT (shared, 8, "The ninth flow should be in one of the queues");
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      AddPacket (queueDisc, 9);
+    }
+  bool idleWay = false;
+  while (!idleWay)
+    {
+      queueDisc->Dequeue ();
+      for (uint32_t i = 0; i < queueDisc->GetNQueueDiscClasses (); i++)
+        {
+          idleWay |= (i != shared && queueDisc->GetQueueDiscClass (i)->GetQueueDisc ()->GetNPackets () == 0);
+        }
+    }
+  uint32_t nShared = queueDisc->GetQueueDiscClass (shared)->GetQueueDisc ()->GetNPackets ();
+  NS_TEST_ASSERT_MSG_GT (nShared, 0, "The shared queue should still be backlogged");
+  AddPacket (queueDisc, 9);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 0, "The merged flow should not take the inactive way");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (shared)->GetQueueDisc ()->GetNPackets (), nShared + 1,
+                         "The merged flow should stay in the shared queue");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowMerges (), 1, "The merged flow should not be merged again");
+
+  // once the flows are inactive, a new flow takes over the way of one of them
+  while (queueDisc->GetNPackets () > 0)
+    {
+      queueDisc->Dequeue ();
+    }
+  AddPacket (queueDisc, 10);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 1, "An inactive flow should have been evicted");
+  AddPacket (queueDisc, 10);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 1, "The new flow should keep its way");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNQueueDiscClasses (), 8, "No queue should have been created");
+
+  // the shared way has drained, hence the merged flow takes a way of its own
+  AddPacket (queueDisc, 9);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 2, "The formerly merged flow should have taken its own way");
+  AddPacket (queueDisc, 9);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNFlowEvictions (), 2, "The formerly merged flow should keep its way");
+
+  // with the Class weight key, the weight of a flow is looked up with its
+  // class (the packet filter result modulo the number of flows) rather than
+  // with the way it takes
+  queueDisc = CreateObjectWithAttributes<DRRQueueDisc> ("Flows", UintegerValue (8),
+                                                        "FlowTableWays", UintegerValue (8),
+                                                        "WeightKey", StringValue ("Class"),
+                                                        "Weights", StringValue ("0:1 1:2 2:3 3:4 4:5 5:6 6:7 7:8"));
+  queueDisc->AddPacketFilter (CreateObject<DRRIpv4PacketFilter> ());
+  queueDisc->SetQuantum (1500);
+  queueDisc->Initialize ();
+
+  for (uint16_t port = 1; port <= 8; port++)
+    {
+      AddPacket (queueDisc, port);
+    }
+  bool otherWay = false;
+  for (uint32_t i = 0; i < queueDisc->GetNQueueDiscClasses (); i++)
+    {
+      Ptr<DRRFlow> flow = DynamicCast<DRRFlow> (queueDisc->GetQueueDiscClass (i));
+      uint32_t hash;
+      NS_TEST_ASSERT_MSG_EQ (flow->GetQueueDisc ()->Peek ()->GetFlowHash (hash), true, "The filter should have stored the hash");
+      NS_TEST_EXPECT_MSG_EQ (flow->GetQuantum (), 1500 * (hash % 8 + 1), "The weight of the class of the flow should be used");
+      otherWay |= (flow->GetBucket () != hash % 8);
+    }
+  NS_TEST_EXPECT_MSG_EQ (otherWay, true, "Some flows should have taken a way other than their class");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the adaptive limit of the bursty flows of BFDRR
+ */
+class BFDRRQueueDiscAdaptiveLimit : public TestCase
+{
+public:
+  BFDRRQueueDiscAdaptiveLimit ();
+  virtual ~BFDRRQueueDiscAdaptiveLimit ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a burst of packets of a bursty flow
+   * \param queueDisc the queue disc
+   * \param nPackets the number of packets of the burst
+   */
+  void AddBurst (Ptr<BFDRRQueueDisc> queueDisc, uint32_t nPackets);
+  /**
+   * Dequeue a packet, if any
+   * \param queueDisc the queue disc
+   */
+  void Dequeue (Ptr<BFDRRQueueDisc> queueDisc);
+  /**
+   * Trace sink for the BurstyLimit trace source
+   * \param oldValue the previous limit
+   * \param newValue the new limit
+   */
+  void BurstyLimit (uint32_t oldValue, uint32_t newValue);
+  uint32_t m_limitUpdates; //!< Number of updates of the limit
+};
+
+BFDRRQueueDiscAdaptiveLimit::BFDRRQueueDiscAdaptiveLimit ()
+  : TestCase ("Test the adaptive limit of the bursty flows of BFDRR"),
+    m_limitUpdates (0)
+{
+}
+
+BFDRRQueueDiscAdaptiveLimit::~BFDRRQueueDiscAdaptiveLimit ()
+{
+}
+
+void
+BFDRRQueueDiscAdaptiveLimit::AddBurst (Ptr<BFDRRQueueDisc> queueDisc, uint32_t nPackets)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (7);
+  Address dest;
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (500);
+      FlowTag tag;
+      tag.SetFlowType (FlowType::BURSTY);
+      p->AddPacketTag (tag);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+    }
+}
+
+void
+BFDRRQueueDiscAdaptiveLimit::Dequeue (Ptr<BFDRRQueueDisc> queueDisc)
+{
+  queueDisc->Dequeue ();
+}
+
+void
+BFDRRQueueDiscAdaptiveLimit::BurstyLimit (uint32_t oldValue, uint32_t newValue)
+{
+  m_limitUpdates++;
+}
+
+void
+BFDRRQueueDiscAdaptiveLimit::DoRun (void)
+{
+  // the drain rate is never sampled, the limit follows the size of the bursts
+  Ptr<BFDRRQueueDisc> queueDisc = CreateObjectWithAttributes<BFDRRQueueDisc> ("SoftLimit", QueueSizeValue (QueueSize ("10p")),
+                                                                              "HardLimit", QueueSizeValue (QueueSize ("20p")),
+                                                                              "AdaptiveLimit", BooleanValue (true),
+                                                                              "MaxBurstDelay", TimeValue (Seconds (100)));
+  queueDisc->SetQuantum (1500);
+  queueDisc->TraceConnectWithoutContext ("BurstyLimit", MakeCallback (&BFDRRQueueDiscAdaptiveLimit::BurstyLimit, this));
+  queueDisc->Initialize ();
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetBurstyLimit (), QueueSize ("20p"), "The limit should start from the hard limit");
+
+  // the first burst is cut at the hard limit, the dropped packets do not make
+  // the limit grow past it
+  AddBurst (queueDisc, 40);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 20, "The burst should have been cut at the hard limit");
+  while (queueDisc->GetNPackets () > 0)
+    {
+      queueDisc->Dequeue ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetBurstyLimit (), QueueSize ("20p"), "The limit should be capped by the hard limit");
+  AddBurst (queueDisc, 27);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 20, "The burst should have been cut at the hard limit");
+  while (queueDisc->GetNPackets () > 0)
+    {
+      queueDisc->Dequeue ();
+    }
+
+  // small bursts shrink the limit down to the soft limit
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      AddBurst (queueDisc, 5);
+      while (queueDisc->GetNPackets () > 0)
+        {
+          queueDisc->Dequeue ();
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetBurstyLimit (), QueueSize ("10p"), "The limit should have shrunk to the soft limit");
+  NS_TEST_EXPECT_MSG_GT (m_limitUpdates, 2, "The updates of the limit should have been traced");
+
+  // large bursts make the limit grow back, up to the hard limit
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      AddBurst (queueDisc, 40);
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (queueDisc->GetNPackets (), 20, "No burst should exceed the hard limit");
+      while (queueDisc->GetNPackets () > 0)
+        {
+          queueDisc->Dequeue ();
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetBurstyLimit (), QueueSize ("20p"), "The limit should have grown back to the hard limit");
+  queueDisc->Dispose ();
+
+  // a link draining 10 packets per second bounds the limit to 15 packets
+  // within a delay of 1.5 seconds
+  queueDisc = CreateObjectWithAttributes<BFDRRQueueDisc> ("SoftLimit", QueueSizeValue (QueueSize ("10p")),
+                                                          "HardLimit", QueueSizeValue (QueueSize ("20p")),
+                                                          "AdaptiveLimit", BooleanValue (true),
+                                                          "MaxBurstDelay", TimeValue (Seconds (1.5)));
+  queueDisc->SetQuantum (1500);
+  queueDisc->Initialize ();
+
+  Simulator::Schedule (Seconds (0), &BFDRRQueueDiscAdaptiveLimit::AddBurst, this, queueDisc, 20);
+  for (uint32_t i = 1; i <= 15; i++)
+    {
+      Simulator::Schedule (Seconds (0.1 * i), &BFDRRQueueDiscAdaptiveLimit::Dequeue, this, queueDisc);
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetBurstyLimit (), QueueSize ("15p"), "The limit should be bound by the drain rate");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the accounting of the backlog of the bursty flows of
+ * BFDRR above the soft limit and its global bound
+ */
+class BFDRRQueueDiscOverflowLimit : public TestCase
+{
+public:
+  BFDRRQueueDiscOverflowLimit ();
+  virtual ~BFDRRQueueDiscOverflowLimit ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a burst of packets of a bursty flow
+   * \param queueDisc the queue disc
+   * \param dest the destination address of the packets, which identifies the flow
+   * \param nPackets the number of packets of the burst
+   */
+  void AddBurst (Ptr<BFDRRQueueDisc> queueDisc, Ipv4Address dest, uint32_t nPackets);
+};
+
+BFDRRQueueDiscOverflowLimit::BFDRRQueueDiscOverflowLimit ()
+  : TestCase ("Test the overflow accounting and limit of the bursty flows of BFDRR")
+{
+}
+
+BFDRRQueueDiscOverflowLimit::~BFDRRQueueDiscOverflowLimit ()
+{
+}
+
+void
+BFDRRQueueDiscOverflowLimit::AddBurst (Ptr<BFDRRQueueDisc> queueDisc, Ipv4Address dest, uint32_t nPackets)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (7);
+  Address addr;
+  for (uint32_t i = 0; i < nPackets; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (500);
+      FlowTag tag;
+      tag.SetFlowType (FlowType::BURSTY);
+      p->AddPacketTag (tag);
+      queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, addr, 0, hdr));
+    }
+}
+
+void
+BFDRRQueueDiscOverflowLimit::DoRun (void)
+{
+  // without a bound, a flow above the soft limit is accounted once
+  Ptr<BFDRRQueueDisc> queueDisc = CreateObjectWithAttributes<BFDRRQueueDisc> ("SoftLimit", QueueSizeValue (QueueSize ("5p")),
+                                                                              "HardLimit", QueueSizeValue (QueueSize ("20p")));
+  queueDisc->SetQuantum (1500);
+  queueDisc->Initialize ();
+
+  AddBurst (queueDisc, Ipv4Address ("10.10.1.2"), 30);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 20, "The burst should have been cut at the hard limit");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetOverflowBacklog (), QueueSize ("15p"), "The backlog above the soft limit should be 15 packets");
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      queueDisc->Dequeue ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetOverflowBacklog (), QueueSize ("5p"), "The backlog above the soft limit should be 5 packets");
+  while (queueDisc->GetNPackets () > 0)
+    {
+      queueDisc->Dequeue ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetOverflowBacklog (), QueueSize ("0p"), "No flow should be overflowing");
+  queueDisc->Dispose ();
+
+  // the bursty flows share an allowance of 10 packets above the soft limit
+  queueDisc = CreateObjectWithAttributes<BFDRRQueueDisc> ("SoftLimit", QueueSizeValue (QueueSize ("5p")),
+                                                          "HardLimit", QueueSizeValue (QueueSize ("20p")),
+                                                          "MaxOverflow", UintegerValue (10));
+  queueDisc->SetQuantum (1500);
+  queueDisc->Initialize ();
+
+  AddBurst (queueDisc, Ipv4Address ("10.10.1.2"), 15);
+  AddBurst (queueDisc, Ipv4Address ("10.10.1.3"), 15);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 20, "The second burst should have been cut at the soft limit");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (BFDRRQueueDisc::OVERFLOW_LIMIT_DROP), 10,
+                         "The packets above the allowance should have been dropped");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetOverflowBacklog (), QueueSize ("10p"), "The allowance should be exhausted");
+
+  // the allowance released by the first flow is taken by the second one
+  queueDisc->Dequeue ();
+  queueDisc->Dequeue ();
+  AddBurst (queueDisc, Ipv4Address ("10.10.1.3"), 3);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (BFDRRQueueDisc::OVERFLOW_LIMIT_DROP), 11,
+                         "Two packets should have been admitted within the allowance");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetOverflowBacklog (), QueueSize ("10p"), "The allowance should be exhausted");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the detection of the type of the flows of BFDRR from
+ * the arrivals of their packets
+ */
+class BFDRRQueueDiscBurstDetection : public TestCase
+{
+public:
+  BFDRRQueueDiscBurstDetection ();
+  virtual ~BFDRRQueueDiscBurstDetection ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a packet
+   * \param queueDisc the queue disc
+   * \param dest the destination address of the packet, which identifies the flow
+   */
+  void AddPacket (Ptr<BFDRRQueueDisc> queueDisc, Ipv4Address dest);
+  /**
+   * Dequeue all the packets
+   * \param queueDisc the queue disc
+   */
+  void Drain (Ptr<BFDRRQueueDisc> queueDisc);
+  /**
+   * Trace sink for the FlowTypeChanged trace source
+   * \param index the index of the flow
+   * \param bucket the hash bucket of the flow
+   * \param oldType the previous type of the flow
+   * \param newType the new type of the flow
+   */
+  void FlowTypeChanged (uint32_t index, uint32_t bucket, FlowType oldType, FlowType newType);
+  std::vector<FlowType> m_types; //!< The types the flow has changed to
+  uint32_t m_burstBacklog;       //!< The backlog at the end of the last burst
+};
+
+BFDRRQueueDiscBurstDetection::BFDRRQueueDiscBurstDetection ()
+  : TestCase ("Test the detection of the type of the flows of BFDRR"),
+    m_burstBacklog (0)
+{
+}
+
+BFDRRQueueDiscBurstDetection::~BFDRRQueueDiscBurstDetection ()
+{
+}
+
+void
+BFDRRQueueDiscBurstDetection::AddPacket (Ptr<BFDRRQueueDisc> queueDisc, Ipv4Address dest)
+{
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (500);
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (dest);
+  hdr.SetProtocol (7);
+  Address addr;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (500), addr, 0, hdr));
+  m_burstBacklog = queueDisc->GetNPackets ();
+}
+
+void
+BFDRRQueueDiscBurstDetection::Drain (Ptr<BFDRRQueueDisc> queueDisc)
+{
+  while (queueDisc->GetNPackets () > 0)
+    {
+      queueDisc->Dequeue ();
+    }
+}
+
+void
+BFDRRQueueDiscBurstDetection::FlowTypeChanged (uint32_t index, uint32_t bucket, FlowType oldType, FlowType newType)
+{
+  m_types.push_back (newType);
+}
+
+void
+BFDRRQueueDiscBurstDetection::DoRun (void)
+{
+  Ptr<BFDRRQueueDisc> queueDisc = CreateObjectWithAttributes<BFDRRQueueDisc> ("SoftLimit", QueueSizeValue (QueueSize ("5p")),
+                                                                              "HardLimit", QueueSizeValue (QueueSize ("30p")),
+                                                                              "BurstDetection", BooleanValue (true));
+  queueDisc->SetQuantum (1500);
+  queueDisc->TraceConnectWithoutContext ("FlowTypeChanged", MakeCallback (&BFDRRQueueDiscBurstDetection::FlowTypeChanged, this));
+  queueDisc->Initialize ();
+
+  // bursts of 20 back-to-back packets every 100 ms: after the third burst
+  // the burst score (0.25, 0.44, 0.58) makes the flow bursty
+  for (uint32_t b = 0; b < 4; b++)
+    {
+      for (uint32_t i = 0; i < 20; i++)
+        {
+          Simulator::Schedule (MilliSeconds (100 * b) + MicroSeconds (10 * i),
+                               &BFDRRQueueDiscBurstDetection::AddPacket, this, queueDisc, Ipv4Address ("10.10.1.2"));
+        }
+      Simulator::Schedule (MilliSeconds (100 * b + 50), &BFDRRQueueDiscBurstDetection::Drain, this, queueDisc);
+    }
+  Simulator::Stop (MilliSeconds (340));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_types.size (), 2, "The flow should have changed type twice");
+  NS_TEST_EXPECT_MSG_EQ (m_types[0], FlowType::LIGHT, "A flow with small scores should be light");
+  NS_TEST_EXPECT_MSG_EQ (m_types[1], FlowType::BURSTY, "A flow with large bursts should be bursty");
+  NS_TEST_EXPECT_MSG_EQ (m_burstBacklog, 20, "The last burst should have been admitted up to the hard limit");
+
+  // a packet every 500 us for 200 ms is a stream
+  m_types.clear ();
+  for (uint32_t i = 0; i < 400; i++)
+    {
+      Simulator::Schedule (MicroSeconds (500 * i), &BFDRRQueueDiscBurstDetection::AddPacket, this, queueDisc, Ipv4Address ("10.10.1.2"));
+    }
+  Simulator::Schedule (MilliSeconds (150), &BFDRRQueueDiscBurstDetection::Drain, this, queueDisc);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_types.size (), 1, "The flow should have changed type once");
+  NS_TEST_EXPECT_MSG_EQ (m_types[0], FlowType::HEAVY, "A streaming flow should be heavy");
+  NS_TEST_EXPECT_MSG_EQ (m_burstBacklog, 5, "Once heavy, the stream should have been cut at the soft limit");
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the token bucket of DRR
+ */
+class DRRQueueDiscShaping : public TestCase
+{
+public:
+  DRRQueueDiscShaping ();
+  virtual ~DRRQueueDiscShaping ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a TCP segment of 1020 bytes, headers included
+   * \param queueDisc the queue disc
+   * \param srcPort the source port, which identifies the flow
+   */
+  void AddPacket (Ptr<QueueDisc> queueDisc, uint16_t srcPort);
+  /**
+   * Record the time a packet is sent and its flow
+   * \param item the packet
+   */
+  void Send (Ptr<QueueDiscItem> item);
+  /**
+   * Send the packets of two backlogged flows through a queue disc
+   * \param queueDisc the queue disc
+   * \return the number of events executed
+   */
+  uint64_t Shape (Ptr<QueueDisc> queueDisc);
+
+  std::vector<Time> m_txTimes;      //!< Time each packet was sent
+  std::vector<uint16_t> m_txFlows;  //!< Source port of each packet sent
+};
+
+DRRQueueDiscShaping::DRRQueueDiscShaping ()
+  : TestCase ("Test the token bucket of DRR")
+{
+}
+
+DRRQueueDiscShaping::~DRRQueueDiscShaping ()
+{
+}
+
+void
+DRRQueueDiscShaping::AddPacket (Ptr<QueueDisc> queueDisc, uint16_t srcPort)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (980);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (6);
+  Address dest;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+DRRQueueDiscShaping::Send (Ptr<QueueDiscItem> item)
+{
+  // the queue disc added the IPv4 header back to the packet
+  Ptr<Packet> p = item->GetPacket ()->Copy ();
+  Ipv4Header ipHdr;
+  p->RemoveHeader (ipHdr);
+  TcpHeader tcpHdr;
+  p->PeekHeader (tcpHdr);
+  m_txTimes.push_back (Simulator::Now ());
+  m_txFlows.push_back (tcpHdr.GetSourcePort ());
+}
+
+uint64_t
+DRRQueueDiscShaping::Shape (Ptr<QueueDisc> queueDisc)
+{
+  m_txTimes.clear ();
+  m_txFlows.clear ();
+  queueDisc->SetSendCallback (std::bind (&DRRQueueDiscShaping::Send, this, std::placeholders::_1));
+  queueDisc->Initialize ();
+
+  // the queue disc is run after every enqueue, as the traffic control layer
+  // does, and sends the packets the bucket allows
+  uint64_t events = Simulator::GetEventCount ();
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      AddPacket (queueDisc, 1);
+      queueDisc->Run ();
+      AddPacket (queueDisc, 2);
+      queueDisc->Run ();
+    }
+  Simulator::Run ();
+  events = Simulator::GetEventCount () - events;
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+  return events;
+}
+
+void
+DRRQueueDiscShaping::DoRun (void)
+{
+  // 1 Mbps: a packet of 1020 bytes every 8.16 ms, after a burst of two packets
+  Ptr<DRRQueueDisc> drr = CreateObjectWithAttributes<DRRQueueDisc> ("FlowQueueDiscType", EnumValue (DRRQueueDisc::FLOW_FIFO),
+                                                                    "Rate", DataRateValue (DataRate ("1Mbps")),
+                                                                    "Burst", UintegerValue (3000));
+  drr->SetQuantum (1020);
+  uint64_t drrEvents = Shape (drr);
+
+  NS_TEST_ASSERT_MSG_EQ (m_txTimes.size (), 20, "All the packets should have been sent");
+  NS_TEST_EXPECT_MSG_EQ (m_txTimes[1], Seconds (0), "The second packet should have been sent with the burst");
+  Time txTime = DataRate ("1Mbps").CalculateBytesTxTime (1020);
+  for (uint32_t i = 2; i < 20; i++)
+    {
+      // the third packet is sent once the 960 tokens left grow to 1020
+      Time expected = DataRate ("1Mbps").CalculateBytesTxTime (1020 - 960) + (i - 2) * txTime;
+      NS_TEST_EXPECT_MSG_EQ_TOL (m_txTimes[i], expected, MicroSeconds (1), "Unexpected transmission time of packet " << i);
+    }
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_txFlows[i], 1 + i % 2, "The flows should alternate");
+    }
+
+  // the packets enqueued while the first packet is blocked find the wake
+  // event pending, and the wake events are the only events
+  NS_TEST_EXPECT_MSG_EQ (drr->GetNWakeEvents (), 18, "A single wake event per blocked packet should be scheduled");
+  NS_TEST_EXPECT_MSG_EQ (drrEvents, 18, "No other event should have been scheduled");
+}
+
+/**
+ * This class tests the flow hash selection of the transmission queue of a
+ * multi-queue device with an mq queue disc having DRR child queue discs
+ */
+class DRRQueueDiscTxQueueSteering : public TestCase
+{
+public:
+  DRRQueueDiscTxQueueSteering ();
+  virtual ~DRRQueueDiscTxQueueSteering ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send a TCP segment through the traffic control layer
+   * \param tc the traffic control layer
+   * \param dev the device
+   * \param srcPort the source port, which identifies the flow
+   */
+  void SendPacket (Ptr<TrafficControlLayer> tc, Ptr<NetDevice> dev, uint16_t srcPort);
+  /**
+   * Record the transmission queue selected for a packet enqueued in a child queue disc
+   * \param item the packet
+   */
+  void Enqueued (Ptr<const QueueDiscItem> item);
+
+  std::map<uint16_t, std::set<uint8_t> > m_txQueues;  //!< Transmission queues selected for each flow
+  std::map<uint8_t, uint32_t> m_nPackets;             //!< Number of packets enqueued for each transmission queue
+};
+
+DRRQueueDiscTxQueueSteering::DRRQueueDiscTxQueueSteering ()
+  : TestCase ("Test the flow hash selection of the transmission queue")
+{
+}
+
+DRRQueueDiscTxQueueSteering::~DRRQueueDiscTxQueueSteering ()
+{
+}
+
+void
+DRRQueueDiscTxQueueSteering::SendPacket (Ptr<TrafficControlLayer> tc, Ptr<NetDevice> dev, uint16_t srcPort)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (6);
+  Address dest;
+  tc->Send (dev, Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+DRRQueueDiscTxQueueSteering::Enqueued (Ptr<const QueueDiscItem> item)
+{
+  TcpHeader tcpHdr;
+  item->GetPacket ()->PeekHeader (tcpHdr);
+  m_txQueues[tcpHdr.GetSourcePort ()].insert (item->GetTxQueueIndex ());
+  m_nPackets[item->GetTxQueueIndex ()]++;
+}
+
+void
+DRRQueueDiscTxQueueSteering::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice> ();
+  node->AddDevice (dev);
+  dev->SetChannel (CreateObject<SimpleChannel> ());
+  dev->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+  Ptr<NetDeviceQueueInterface> ndqi = CreateObjectWithAttributes<NetDeviceQueueInterface> ("NTxQueues", UintegerValue (4));
+  dev->AggregateObject (ndqi);
+  Ptr<TrafficControlLayer> tc = CreateObject<TrafficControlLayer> ();
+  node->AggregateObject (tc);
+
+  TrafficControlHelper tch;
+  uint16_t handle = tch.SetRootQueueDisc ("ns3::MqQueueDisc");
+  TrafficControlHelper::ClassIdList cls = tch.AddQueueDiscClasses (handle, 4, "ns3::QueueDiscClass");
+  tch.AddChildQueueDiscs (handle, cls, "ns3::DRRQueueDisc");
+  tch.SetFlowHashTxQueueSelection ();
+  tch.Install (dev);
+  node->Initialize ();
+
+  Ptr<QueueDisc> root = tc->GetRootQueueDiscOnDevice (dev);
+  NS_TEST_ASSERT_MSG_EQ (root->GetNQueueDiscClasses (), 4, "There should be a child queue disc per transmission queue");
+  for (uint8_t i = 0; i < 4; i++)
+    {
+      root->GetQueueDiscClass (i)->GetQueueDisc ()->TraceConnectWithoutContext ("Enqueue",
+                                                                                MakeCallback (&DRRQueueDiscTxQueueSteering::Enqueued, this));
+      // keep the packets in the queue discs
+      ndqi->GetTxQueue (i)->Stop ();
+    }
+
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      for (uint16_t port = 1; port <= 64; port++)
+        {
+          SendPacket (tc, dev, port);
+        }
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (m_txQueues.size (), 64, "The packets of every flow should have been enqueued");
+  for (auto& flow : m_txQueues)
+    {
+      NS_TEST_EXPECT_MSG_EQ (flow.second.size (), 1, "The packets of a flow should be sent to the same transmission queue");
+    }
+  for (uint8_t i = 0; i < 4; i++)
+    {
+      Ptr<QueueDisc> child = root->GetQueueDiscClass (i)->GetQueueDisc ();
+      NS_TEST_EXPECT_MSG_EQ (child->GetStats ().nTotalEnqueuedPackets, m_nPackets[i],
+                             "The packets should be enqueued in the child queue disc of their transmission queue");
+      NS_TEST_EXPECT_MSG_GT (m_nPackets[i], 0, "The flows should be spread over all the transmission queues");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the installation of DRR queue discs on devices that are
+ * not yet added to the node of the traffic control layer, whose interface
+ * index is not meaningful
+ */
+class DRRQueueDiscDeviceNotOnNode : public TestCase
+{
+public:
+  DRRQueueDiscDeviceNotOnNode ();
+  virtual ~DRRQueueDiscDeviceNotOnNode ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Create a device with a transmission queue and a channel
+   * \return the device
+   */
+  Ptr<SimpleNetDevice> CreateDevice (void);
+};
+
+DRRQueueDiscDeviceNotOnNode::DRRQueueDiscDeviceNotOnNode ()
+  : TestCase ("Test the installation of a queue disc on a device not added to a node")
+{
+}
+
+DRRQueueDiscDeviceNotOnNode::~DRRQueueDiscDeviceNotOnNode ()
+{
+}
+
+Ptr<SimpleNetDevice>
+DRRQueueDiscDeviceNotOnNode::CreateDevice (void)
+{
+  Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice> ();
+  dev->SetChannel (CreateObject<SimpleChannel> ());
+  dev->SetQueue (CreateObject<DropTailQueue<Packet> > ());
+  return dev;
+}
+
+void
+DRRQueueDiscDeviceNotOnNode::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<TrafficControlLayer> tc = CreateObject<TrafficControlLayer> ();
+  node->AggregateObject (tc);
+
+  // a device not added to the node has the default interface index, i.e., the
+  // interface index of the first device of the node
+  Ptr<SimpleNetDevice> detached = CreateDevice ();
+  Ptr<QueueDisc> detachedQd = CreateObject<DRRQueueDisc> ();
+  tc->SetRootQueueDiscOnDevice (detached, detachedQd);
+
+  Ptr<SimpleNetDevice> first = CreateDevice ();
+  node->AddDevice (first);
+  Ptr<QueueDisc> firstQd = CreateObject<DRRQueueDisc> ();
+  tc->SetRootQueueDiscOnDevice (first, firstQd);
+  NS_TEST_EXPECT_MSG_EQ (first->GetIfIndex (), detached->GetIfIndex (), "The devices should have the same interface index");
+  NS_TEST_EXPECT_MSG_EQ (tc->GetRootQueueDiscOnDevice (first), firstQd, "Verify the queue disc of the first device");
+  NS_TEST_EXPECT_MSG_EQ (tc->GetRootQueueDiscOnDevice (detached), detachedQd, "Verify the queue disc of the device not added to the node");
+
+  // a queue disc can be deleted from a device not added to the node
+  Ptr<SimpleNetDevice> other = CreateDevice ();
+  tc->SetRootQueueDiscOnDevice (other, CreateObject<DRRQueueDisc> ());
+  tc->DeleteRootQueueDiscOnDevice (other);
+  NS_TEST_EXPECT_MSG_EQ (tc->GetRootQueueDiscOnDevice (other), 0, "The queue disc should have been deleted");
+
+  // the queue disc follows the device once it is added to the node
+  node->AddDevice (detached);
+  NS_TEST_EXPECT_MSG_EQ (tc->GetRootQueueDiscOnDevice (detached), detachedQd, "Verify the queue disc of the device added to the node");
+  NS_TEST_EXPECT_MSG_EQ (tc->GetRootQueueDiscOnDevice (first), firstQd, "Verify the queue disc of the first device");
+  node->Initialize ();
+
+  UdpHeader udpHdr;
+  udpHdr.SetSourcePort (1000);
+  udpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (udpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (17);
+  tc->Send (detached, Create<Ipv4QueueDiscItem> (p, Mac48Address ("00:00:00:00:00:02"), 0x0800, hdr));
+  NS_TEST_EXPECT_MSG_EQ (detachedQd->GetStats ().nTotalSentPackets, 1, "The packet should have gone through the queue disc of its device");
+  NS_TEST_EXPECT_MSG_EQ (firstQd->GetStats ().nTotalReceivedPackets, 0, "The packet should not have gone through the queue disc of the first device");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that a qdisc run extracts the packets of a DRR root queue
+ * disc in batches of BulkDequeue packets before transmitting them
+ */
+class DRRQueueDiscBulkTransmit : public TestCase
+{
+public:
+  DRRQueueDiscBulkTransmit ();
+  virtual ~DRRQueueDiscBulkTransmit ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send six UDP packets through a DRR root queue disc while the transmission
+   * queue of the device is stopped and wake the transmission queue
+   * \param bulk the value of the BulkDequeue attribute
+   * \return the sequence of the dequeue ('D') and transmit ('T') events
+   */
+  std::string Transmit (uint32_t bulk);
+  /**
+   * Record a packet dequeued from the root queue disc
+   * \param item the packet
+   */
+  void Dequeued (Ptr<const QueueDiscItem> item);
+  /**
+   * Record a packet handed to the device
+   * \param p the packet
+   */
+  void Transmitted (Ptr<const Packet> p);
+
+  std::string m_events;  //!< Sequence of the dequeue and transmit events
+};
+
+DRRQueueDiscBulkTransmit::DRRQueueDiscBulkTransmit ()
+  : TestCase ("Test the bulk dequeue of a DRR root queue disc by a qdisc run")
+{
+}
+
+DRRQueueDiscBulkTransmit::~DRRQueueDiscBulkTransmit ()
+{
+}
+
+void
+DRRQueueDiscBulkTransmit::Dequeued (Ptr<const QueueDiscItem> item)
+{
+  m_events += 'D';
+}
+
+void
+DRRQueueDiscBulkTransmit::Transmitted (Ptr<const Packet> p)
+{
+  m_events += 'T';
+}
+
+std::string
+DRRQueueDiscBulkTransmit::Transmit (uint32_t bulk)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice> ();
+  node->AddDevice (dev);
+  dev->SetChannel (CreateObject<SimpleChannel> ());
+  Ptr<DropTailQueue<Packet> > devQueue = CreateObject<DropTailQueue<Packet> > ();
+  dev->SetQueue (devQueue);
+  Ptr<NetDeviceQueueInterface> ndqi = CreateObject<NetDeviceQueueInterface> ();
+  dev->AggregateObject (ndqi);
+  Ptr<TrafficControlLayer> tc = CreateObject<TrafficControlLayer> ();
+  node->AggregateObject (tc);
+
+  Ptr<DRRQueueDisc> root = CreateObjectWithAttributes<DRRQueueDisc> ("BulkDequeue", UintegerValue (bulk));
+  tc->SetRootQueueDiscOnDevice (dev, root);
+  node->Initialize ();
+
+  m_events.clear ();
+  root->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DRRQueueDiscBulkTransmit::Dequeued, this));
+  devQueue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DRRQueueDiscBulkTransmit::Transmitted, this));
+
+  // keep the packets in the queue disc until the transmission queue is woken
+  ndqi->GetTxQueue (0)->Stop ();
+  for (uint16_t port = 1; port <= 6; port++)
+    {
+      UdpHeader udpHdr;
+      udpHdr.SetSourcePort (port);
+      udpHdr.SetDestinationPort (80);
+      Ptr<Packet> p = Create<Packet> (100);
+      p->AddHeader (udpHdr);
+      Ipv4Header hdr;
+      hdr.SetPayloadSize (p->GetSize ());
+      hdr.SetSource (Ipv4Address ("10.10.1.1"));
+      hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+      hdr.SetProtocol (17);
+      tc->Send (dev, Create<Ipv4QueueDiscItem> (p, Mac48Address ("00:00:00:00:00:02"), 0x0800, hdr));
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_events, "", "No packet should leave the queue disc while the transmission queue is stopped");
+  // the queue disc is run by an event scheduled when the transmission queue is woken
+  ndqi->GetTxQueue (0)->Wake ();
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (root->GetStats ().nTotalSentPackets, 6, "All the packets should have been sent");
+  NS_TEST_EXPECT_MSG_EQ (root->GetNPackets (), 0, "The queue disc should be empty");
+  Simulator::Destroy ();
+  return m_events;
+}
+
+void
+DRRQueueDiscBulkTransmit::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (Transmit (1), "DTDTDTDTDTDT", "Each packet should be transmitted as soon as it is dequeued");
+  NS_TEST_EXPECT_MSG_EQ (Transmit (4), "DDDDTTTTDDTT", "The packets should be dequeued in batches of four");
+}
+
 class DRRQueueDiscTestSuite : public TestSuite
 {
 public:
@@ -586,6 +2873,25 @@ DRRQueueDiscTestSuite::DRRQueueDiscTestSuite ()
   AddTestCase (new DRRQueueDiscUDPFlowsSeparation, TestCase::QUICK);
   AddTestCase (new DRRQueueDiscDeficitVariableSizeSameFlow, TestCase::QUICK);
   AddTestCase (new DRRQueueDiscDeficitVariableSizeDifferentFlow, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscDeficitJumboPackets, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscWeightedFlows, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscInlineFlows, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscFlowPool, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscFlowReuse, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscFlowReclamation, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscBatchDequeue, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscEnqueueRing, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscFlowHashCache, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscIpv6AndNonIpFlows, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscHashEngines, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscSetAssociativeFlowTable, TestCase::QUICK);
+  AddTestCase (new BFDRRQueueDiscAdaptiveLimit, TestCase::QUICK);
+  AddTestCase (new BFDRRQueueDiscOverflowLimit, TestCase::QUICK);
+  AddTestCase (new BFDRRQueueDiscBurstDetection, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscShaping, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscTxQueueSteering, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscDeviceNotOnNode, TestCase::QUICK);
+  AddTestCase (new DRRQueueDiscBulkTransmit, TestCase::QUICK);
 
 
 }
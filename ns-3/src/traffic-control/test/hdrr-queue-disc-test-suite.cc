@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/hdrr-queue-disc.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/tcp-header.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include <map>
+#include <string>
+
+using namespace ns3;
+
+/**
+ * This class tests the tenant and flow levels of HDRR
+ */
+class HDRRQueueDiscTenantsAndFlows : public TestCase
+{
+public:
+  HDRRQueueDiscTenantsAndFlows ();
+  virtual ~HDRRQueueDiscTenantsAndFlows ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a TCP segment of 1020 bytes, headers included
+   * \param queueDisc the queue disc
+   * \param src the source address, whose prefix identifies the tenant
+   * \param srcPort the source port, which identifies the flow within the tenant
+   */
+  void AddPacket (Ptr<HDRRQueueDisc> queueDisc, Ipv4Address src, uint16_t srcPort);
+};
+
+HDRRQueueDiscTenantsAndFlows::HDRRQueueDiscTenantsAndFlows ()
+  : TestCase ("Test the tenant and flow levels of HDRR")
+{
+}
+
+HDRRQueueDiscTenantsAndFlows::~HDRRQueueDiscTenantsAndFlows ()
+{
+}
+
+void
+HDRRQueueDiscTenantsAndFlows::AddPacket (Ptr<HDRRQueueDisc> queueDisc, Ipv4Address src, uint16_t srcPort)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (980);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (src);
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (6);
+  Address dest;
+  queueDisc->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+HDRRQueueDiscTenantsAndFlows::DoRun (void)
+{
+  // room for 30 packets, at most 12 per tenant
+  Ptr<HDRRQueueDisc> queueDisc = CreateObjectWithAttributes<HDRRQueueDisc> ("MaxSize", QueueSizeValue (QueueSize ("30600B")),
+                                                                            "TenantShare", DoubleValue (0.4),
+                                                                            "TenantQuantum", UintegerValue (1020),
+                                                                            "FlowQuantum", UintegerValue (1020));
+  queueDisc->Initialize ();
+
+  // tenant A has a single flow, tenant B three flows and tenant C two flows
+  Ipv4Address a ("10.1.1.1");
+  Ipv4Address b ("10.1.2.1");
+  Ipv4Address c ("10.1.3.1");
+  for (uint32_t i = 0; i < 12; i++)
+    {
+      AddPacket (queueDisc, a, 1);
+      AddPacket (queueDisc, b, 1 + i % 3);
+    }
+
+  // a tenant cannot exceed its share, even if the queue disc has room
+  Ptr<DRRFlow> tenantA = queueDisc->GetQueueDiscClass (0)->GetObject<DRRFlow> ();
+  AddPacket (queueDisc, a, 1);
+  NS_TEST_EXPECT_MSG_EQ (tenantA->GetQueueDisc ()->GetNPackets (), 12, "The child of the tenant should have dropped a packet");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (std::string (QueueDisc::CHILD_QUEUE_DISC_DROP)
+                                                                    + DRRQueueDisc::OVERLIMIT_DROP), 1,
+                         "The drop should have been accounted to the child");
+
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      AddPacket (queueDisc, c, 1 + i % 2);
+    }
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNTenants (), 3, "Each prefix should have its own tenant");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 30, "All the packets should have been enqueued");
+
+  // the queue disc is full
+  AddPacket (queueDisc, c, 1);
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetStats ().GetNDroppedPackets (HDRRQueueDisc::LIMIT_EXCEEDED_DROP), 1,
+                         "The packet should have been dropped for exceeding the limit");
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetNPackets (), 30, "No packet should have been enqueued");
+
+  // the tenants share the link equally, regardless of their number of flows,
+  // and so do the flows of a tenant
+  std::map<uint32_t, uint32_t> tenantPackets;
+  std::map<uint16_t, uint32_t> flowPacketsOfB;
+  for (uint32_t i = 0; i < 18; i++)
+    {
+      Ptr<Ipv4QueueDiscItem> item = DynamicCast<Ipv4QueueDiscItem> (queueDisc->Dequeue ());
+      NS_TEST_ASSERT_MSG_NE (item, 0, "A packet should have been dequeued");
+      uint32_t tenant = item->GetHeader ().GetSource ().Get ();
+      tenantPackets[tenant]++;
+      if (item->GetHeader ().GetSource () == b)
+        {
+          TcpHeader tcpHdr;
+          item->GetPacket ()->PeekHeader (tcpHdr);
+          flowPacketsOfB[tcpHdr.GetSourcePort ()]++;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (tenantPackets[a.Get ()], 6, "Unexpected share of tenant A");
+  NS_TEST_EXPECT_MSG_EQ (tenantPackets[b.Get ()], 6, "Unexpected share of tenant B");
+  NS_TEST_EXPECT_MSG_EQ (tenantPackets[c.Get ()], 6, "Unexpected share of tenant C");
+  for (uint16_t port = 1; port <= 3; port++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (flowPacketsOfB[port], 2, "Unexpected share of a flow of tenant B");
+    }
+
+  // tenant C is now empty and left the ring of active tenants
+  NS_TEST_EXPECT_MSG_EQ (queueDisc->GetQueueDiscClass (2)->GetObject<DRRFlow> ()->GetStatus (), DRRFlow::INACTIVE,
+                         "The empty tenant should be inactive");
+  uint32_t dequeued = 0;
+  while (queueDisc->Dequeue ())
+    {
+      dequeued++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (dequeued, 12, "The remaining packets should have been dequeued");
+
+  queueDisc->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * HDRR queue disc test suite
+ */
+class HDRRQueueDiscTestSuite : public TestSuite
+{
+public:
+  HDRRQueueDiscTestSuite ();
+};
+
+HDRRQueueDiscTestSuite::HDRRQueueDiscTestSuite ()
+  : TestSuite ("hdrr-queue-disc", UNIT)
+{
+  AddTestCase (new HDRRQueueDiscTenantsAndFlows, TestCase::QUICK);
+}
+
+static HDRRQueueDiscTestSuite g_hdrrQueueDiscTestSuite; //!< Static variable for test initialization
@@ -24,6 +24,8 @@
 #include "ns3/drop-tail-queue.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include <cstring>
 #include <map>
 
 using namespace ns3;
@@ -305,6 +307,17 @@ TestCounter::ConnectTraces (Ptr<QueueDisc> qd)
   qd->TraceConnectWithoutContext ("DropAfterDequeue", MakeCallback (&TestCounter::PacketDad, this));
 }
 
+/**
+ * Count the sojourn times provided by a queue disc
+ * \param count the number of sojourn times
+ * \param sojourn the sojourn time
+ */
+static void
+CountSojournTime (uint32_t *count, Time sojourn)
+{
+  (*count)++;
+}
+
 
 /**
  * \ingroup traffic-control-test
@@ -555,6 +568,81 @@ QueueDiscTracesTestCase::DoRun (void)
   CheckDroppedBeforeEnqueue (child, 1, pktSizeUnit * 5);
   CheckDroppedAfterDequeue (child, 2, pktSizeUnit * 3);
 
+  // the drops are counted for each reason, prefixed by the parent
+  std::string childDrop (QueueDisc::CHILD_QUEUE_DISC_DROP);
+  NS_TEST_EXPECT_MSG_EQ (child->GetStats ().GetNDroppedPackets (TestChildQueueDisc::BEFORE_ENQUEUE), 1,
+                         "Verify the number of packets dropped before enqueue by the child");
+  NS_TEST_EXPECT_MSG_EQ (child->GetStats ().GetNDroppedBytes (TestChildQueueDisc::AFTER_DEQUEUE), pktSizeUnit * 3,
+                         "Verify the number of bytes dropped after dequeue by the child");
+  NS_TEST_EXPECT_MSG_EQ (root->GetStats ().GetNDroppedPackets (childDrop + TestChildQueueDisc::BEFORE_ENQUEUE), 1,
+                         "Verify the number of packets dropped before enqueue by the child, seen by the parent");
+  NS_TEST_EXPECT_MSG_EQ (root->GetStats ().GetNDroppedPackets (childDrop + TestChildQueueDisc::AFTER_DEQUEUE), 2,
+                         "Verify the number of packets dropped after dequeue by the child, seen by the parent");
+  NS_TEST_EXPECT_MSG_EQ (root->GetStats ().nDroppedPacketsAfterDequeue.size (), 1,
+                         "Verify that the parent only counted the reason of the child");
+
+  // a reason is identified by its contents, not by the address of its string
+  char reason[32];
+  std::strcpy (reason, TestChildQueueDisc::BEFORE_ENQUEUE);
+  NS_TEST_EXPECT_MSG_EQ (QueueDisc::GetReasonId (reason), QueueDisc::GetReasonId (TestChildQueueDisc::BEFORE_ENQUEUE),
+                         "Verify that a copy of a reason has the same identifier");
+  std::strcpy (reason, TestChildQueueDisc::AFTER_DEQUEUE);
+  NS_TEST_EXPECT_MSG_EQ (QueueDisc::GetReasonId (reason), QueueDisc::GetReasonId (TestChildQueueDisc::AFTER_DEQUEUE),
+                         "Verify that a reused buffer gets the identifier of its new contents");
+  NS_TEST_EXPECT_MSG_EQ (QueueDisc::GetReasonName (QueueDisc::GetReasonId (reason)), TestChildQueueDisc::AFTER_DEQUEUE,
+                         "Verify the name of a reason");
+
+  // in lightweight mode, only the packet counters are kept and the SojournTime
+  // trace is not fired; the received counters are derived from the other counters
+  Ptr<QueueDisc> lightRoot = CreateObject<TestParentQueueDisc> ();
+  lightRoot->SetAttribute ("Lightweight", BooleanValue (true));
+  lightRoot->Initialize ();
+  Ptr<QueueDisc> lightChild = lightRoot->GetQueueDiscClass (0)->GetQueueDisc ();
+  lightChild->SetAttribute ("Lightweight", BooleanValue (true));
+  TestCounter lightCounter;
+  lightCounter.ConnectTraces (lightRoot);
+  uint32_t nSojournTimes = 0;
+  lightRoot->TraceConnectWithoutContext ("SojournTime", MakeBoundCallback (&CountSojournTime, &nSojournTimes));
+  for (uint16_t i = 1; i <= 5; i++)
+    {
+      lightRoot->Enqueue (Create<qdTestItem> (Create<Packet>(pktSizeUnit * i), dest));
+    }
+  lightRoot->Dequeue ();
+
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalReceivedPackets, 5,
+                         "Verify the number of packets received in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalReceivedBytes, 0,
+                         "Verify that no byte is counted in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalDroppedPacketsBeforeEnqueue, 1,
+                         "Verify that the parent saw the drop of the child in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nDroppedPacketsBeforeEnqueue.size (), 0,
+                         "Verify that no drop is counted per reason in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightChild->GetStats ().nTotalReceivedPackets, 5,
+                         "Verify the number of packets received by the child in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetNPackets (), lightChild->GetNPackets (),
+                         "Verify that the parent saw the dequeue of the child in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightCounter.m_nPackets, lightRoot->GetNPackets (),
+                         "Verify that the Enqueue and Dequeue traces are fired in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightCounter.m_nDbePackets, 1,
+                         "Verify that the DropBeforeEnqueue trace is fired in lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (nSojournTimes, 0,
+                         "Verify that the SojournTime trace is not fired in lightweight mode");
+
+  // leaving the lightweight mode brings the received counters up to date and
+  // lines the byte counters up with the backlog
+  lightRoot->SetAttribute ("Lightweight", BooleanValue (false));
+  lightRoot->Enqueue (Create<qdTestItem> (Create<Packet>(pktSizeUnit), dest));
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalReceivedPackets, 6,
+                         "Verify the number of packets received after leaving the lightweight mode");
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalEnqueuedBytes - lightRoot->GetStats ().nTotalDequeuedBytes,
+                         lightRoot->GetNBytes (),
+                         "Verify the byte counters after leaving the lightweight mode");
+  while (lightRoot->Dequeue ())
+    {
+    }
+  NS_TEST_EXPECT_MSG_EQ (lightRoot->GetStats ().nTotalEnqueuedBytes, lightRoot->GetStats ().nTotalDequeuedBytes,
+                         "Verify the byte counters after draining the queue disc");
+
   Simulator::Destroy ();
 }
 
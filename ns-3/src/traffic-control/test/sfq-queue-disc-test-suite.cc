@@ -0,0 +1,273 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/sfq-queue-disc.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "tcp-segment-test-helper.h"
+
+using namespace ns3;
+
+/**
+ * This class tests that the flows are stored in distinct slots and served
+ * in round robin order
+ */
+class SFQQueueDiscRoundRobin : public TestCase
+{
+public:
+  SFQQueueDiscRoundRobin ();
+  virtual ~SFQQueueDiscRoundRobin ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SFQQueueDiscRoundRobin::SFQQueueDiscRoundRobin ()
+  : TestCase ("Test the round robin service of the slots")
+{
+}
+
+SFQQueueDiscRoundRobin::~SFQQueueDiscRoundRobin ()
+{
+}
+
+void
+SFQQueueDiscRoundRobin::DoRun (void)
+{
+  // packets of 1000 bytes (headers included) and a quantum of one packet
+  Ptr<SFQQueueDisc> queue = CreateObjectWithAttributes<SFQQueueDisc> ("Quantum", UintegerValue (1000),
+                                                                      "PerturbPeriod", TimeValue (Seconds (0)));
+  queue->Initialize ();
+
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      EnqueueTcpSegment (queue, 1, 960 + i);
+    }
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      EnqueueTcpSegment (queue, 2, 960 + i);
+      EnqueueTcpSegment (queue, 3, 960 + i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 8, "All the packets should have been enqueued");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNActiveSlots (), 3, "Each flow should have its own slot");
+
+  uint16_t expectedPorts[] = {1, 2, 3, 1, 2, 3, 1, 1};
+  uint32_t expectedSizes[] = {960, 960, 960, 961, 961, 961, 962, 963};
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      Ptr<QueueDiscItem> item = queue->Dequeue ();
+      NS_TEST_ASSERT_MSG_NE (item, 0, "A packet should have been dequeued");
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      NS_TEST_EXPECT_MSG_EQ (port, expectedPorts[i], "Unexpected flow of packet " << i);
+      NS_TEST_EXPECT_MSG_EQ (size, expectedSizes[i], "Unexpected packet " << i << " of its flow");
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->Dequeue (), 0, "The queue disc should be empty");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNActiveSlots (), 0, "No slot should be active");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the drops when the queue disc or a slot is full
+ */
+class SFQQueueDiscDrops : public TestCase
+{
+public:
+  SFQQueueDiscDrops ();
+  virtual ~SFQQueueDiscDrops ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SFQQueueDiscDrops::SFQQueueDiscDrops ()
+  : TestCase ("Test the drops from the longest slot and the depth limit")
+{
+}
+
+SFQQueueDiscDrops::~SFQQueueDiscDrops ()
+{
+}
+
+void
+SFQQueueDiscDrops::DoRun (void)
+{
+  Ptr<SFQQueueDisc> queue = CreateObjectWithAttributes<SFQQueueDisc> ("MaxSize", QueueSizeValue (QueueSize ("10p")),
+                                                                      "Depth", UintegerValue (8),
+                                                                      "PerturbPeriod", TimeValue (Seconds (0)));
+  queue->Initialize ();
+
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      EnqueueTcpSegment (queue, 1, 100 + i);
+    }
+  EnqueueTcpSegment (queue, 1, 108);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetStats ().GetNDroppedPackets (SFQQueueDisc::DEPTH_EXCEEDED_DROP), 1,
+                         "The packet beyond the depth of the slot should have been dropped");
+
+  EnqueueTcpSegment (queue, 2, 200);
+  EnqueueTcpSegment (queue, 2, 201);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 10, "The queue disc should be full");
+  EnqueueTcpSegment (queue, 2, 202);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetStats ().GetNDroppedPackets (SFQQueueDisc::OVERLIMIT_DROP), 1,
+                         "A packet should have been dropped when the queue disc overflowed");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 10, "The queue disc should still be full");
+
+  // the tail of the longest slot has been dropped
+  uint32_t flowPackets[3] = {0, 0, 0};
+  uint32_t lastSize[3] = {0, 0, 0};
+  Ptr<QueueDiscItem> item;
+  while ((item = queue->Dequeue ()))
+    {
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      flowPackets[port]++;
+      lastSize[port] = size;
+    }
+  NS_TEST_EXPECT_MSG_EQ (flowPackets[1], 7, "The longest slot should have lost a packet");
+  NS_TEST_EXPECT_MSG_EQ (lastSize[1], 106, "The tail of the longest slot should have been dropped");
+  NS_TEST_EXPECT_MSG_EQ (flowPackets[2], 3, "The shorter slot should have kept its packets");
+
+  // when every slot holds a single packet, the next slot to serve loses it
+  queue = CreateObjectWithAttributes<SFQQueueDisc> ("MaxSize", QueueSizeValue (QueueSize ("2p")),
+                                                    "PerturbPeriod", TimeValue (Seconds (0)));
+  queue->Initialize ();
+  EnqueueTcpSegment (queue, 1, 100);
+  EnqueueTcpSegment (queue, 2, 100);
+  EnqueueTcpSegment (queue, 3, 100);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNActiveSlots (), 2, "The slot that lost its packet should be free");
+  item = queue->Dequeue ();
+  NS_TEST_ASSERT_MSG_NE (item, 0, "A packet should have been dequeued");
+  uint16_t port;
+  uint32_t size;
+  ParseTcpSegment (item, port, size);
+  NS_TEST_EXPECT_MSG_EQ (port, 2, "The packet of the first flow should have been dropped");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests the perturbation of the hash
+ */
+class SFQQueueDiscPerturbation : public TestCase
+{
+public:
+  SFQQueueDiscPerturbation ();
+  virtual ~SFQQueueDiscPerturbation ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Enqueue a packet of each flow and check whether the flows share a slot
+   * \param queue the queue disc
+   * \param size the size of the payload of the packets
+   */
+  void EnqueueAndCheck (Ptr<SFQQueueDisc> queue, uint32_t size);
+
+  uint32_t m_collisions;  //!< Number of enqueues in which the flows shared a slot
+  uint32_t m_checks;      //!< Number of enqueues checked
+};
+
+SFQQueueDiscPerturbation::SFQQueueDiscPerturbation ()
+  : TestCase ("Test the perturbation of the hash"),
+    m_collisions (0),
+    m_checks (0)
+{
+}
+
+SFQQueueDiscPerturbation::~SFQQueueDiscPerturbation ()
+{
+}
+
+void
+SFQQueueDiscPerturbation::EnqueueAndCheck (Ptr<SFQQueueDisc> queue, uint32_t size)
+{
+  EnqueueTcpSegment (queue, 1, size);
+  EnqueueTcpSegment (queue, 2, size);
+  m_checks++;
+  if (queue->GetNActiveSlots () == 1)
+    {
+      m_collisions++;
+    }
+}
+
+void
+SFQQueueDiscPerturbation::DoRun (void)
+{
+  // with two hash buckets, two flows collide half of the time
+  Ptr<SFQQueueDisc> queue = CreateObjectWithAttributes<SFQQueueDisc> ("Divisor", UintegerValue (2),
+                                                                      "PerturbPeriod", TimeValue (Seconds (1)));
+  queue->AssignStreams (1);
+  queue->Initialize ();
+
+  // the packets stored when the seed changes are moved to their new slot
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      EnqueueTcpSegment (queue, 1, 100 + i);
+      EnqueueTcpSegment (queue, 2, 100 + i);
+    }
+  for (uint32_t i = 1; i <= 32; i++)
+    {
+      Simulator::Schedule (Seconds (i), &SFQQueueDiscPerturbation::EnqueueAndCheck, this, queue, 100 + i + 2);
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPerturbations (), 32, "The seed should have been replaced every period");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 70, "No packet should have been lost by the perturbations");
+  NS_TEST_EXPECT_MSG_GT (m_collisions, 0, "The flows should have collided with some seeds");
+  NS_TEST_EXPECT_MSG_LT (m_collisions, m_checks, "The flows should have been separated with some seeds");
+
+  // the packets of each flow are still in order
+  uint32_t lastSize[3] = {0, 0, 0};
+  Ptr<QueueDiscItem> item;
+  uint32_t dequeued = 0;
+  while ((item = queue->Dequeue ()))
+    {
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      NS_TEST_EXPECT_MSG_GT (size, lastSize[port], "The packets of a flow should not have been reordered");
+      lastSize[port] = size;
+      dequeued++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (dequeued, 70, "All the packets should have been dequeued");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * SFQ queue disc test suite
+ */
+class SFQQueueDiscTestSuite : public TestSuite
+{
+public:
+  SFQQueueDiscTestSuite ();
+};
+
+SFQQueueDiscTestSuite::SFQQueueDiscTestSuite ()
+  : TestSuite ("sfq-queue-disc", UNIT)
+{
+  AddTestCase (new SFQQueueDiscRoundRobin, TestCase::QUICK);
+  AddTestCase (new SFQQueueDiscDrops, TestCase::QUICK);
+  AddTestCase (new SFQQueueDiscPerturbation, TestCase::QUICK);
+}
+
+static SFQQueueDiscTestSuite g_sfqQueueDiscTestSuite; //!< Static variable for test initialization
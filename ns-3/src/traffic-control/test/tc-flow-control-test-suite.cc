@@ -34,6 +34,7 @@
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/queue.h"
 #include "ns3/config.h"
+#include "ns3/boolean.h"
 
 using namespace ns3;
 
@@ -103,8 +104,9 @@ public:
    * Constructor
    *
    * \param tt the test type
+   * \param deferredRun whether the queue disc runs in deferred run mode
    */
-  TcFlowControlTestCase (QueueSizeUnit tt);
+  TcFlowControlTestCase (QueueSizeUnit tt, bool deferredRun);
   virtual ~TcFlowControlTestCase ();
 private:
   virtual void DoRun (void);
@@ -135,12 +137,22 @@ private:
    * \param msg the message to print if a different number of packets are stored
    */
   void CheckPacketsInQueueDisc (Ptr<NetDevice> dev, uint16_t nPackets, const char* msg);
+  /**
+   * Check if the queue disc saved the expected number of runs
+   * \param dev the device the queue disc is installed on
+   * \param nRuns the expected number of runs saved
+   * \param msg the message to print if a different number of runs were saved
+   */
+  void CheckRunsSaved (Ptr<NetDevice> dev, uint32_t nRuns, const char* msg);
   QueueSizeUnit m_type;       //!< the test type
+  bool m_deferredRun;         //!< whether the queue disc runs in deferred run mode
 };
 
-TcFlowControlTestCase::TcFlowControlTestCase (QueueSizeUnit tt)
-  : TestCase ("Test the operation of the flow control mechanism"),
-    m_type (tt)
+TcFlowControlTestCase::TcFlowControlTestCase (QueueSizeUnit tt, bool deferredRun)
+  : TestCase (deferredRun ? "Test the operation of the flow control mechanism with deferred runs"
+                          : "Test the operation of the flow control mechanism"),
+    m_type (tt),
+    m_deferredRun (deferredRun)
 {
 }
 
@@ -183,6 +195,14 @@ TcFlowControlTestCase::CheckPacketsInQueueDisc (Ptr<NetDevice> dev, uint16_t nPa
   NS_TEST_EXPECT_MSG_EQ (qdisc->GetNPackets (), nPackets, msg);
 }
 
+void
+TcFlowControlTestCase::CheckRunsSaved (Ptr<NetDevice> dev, uint32_t nRuns, const char* msg)
+{
+  Ptr<TrafficControlLayer> tc = dev->GetNode ()->GetObject<TrafficControlLayer> ();
+  Ptr<QueueDisc> qdisc = tc->GetRootQueueDiscOnDevice (dev);
+  NS_TEST_EXPECT_MSG_EQ (qdisc->GetNRunsSaved (), nRuns, msg);
+}
+
 
 void
 TcFlowControlTestCase::DoRun (void)
@@ -206,12 +226,21 @@ TcFlowControlTestCase::DoRun (void)
   txDev->SetMtu (2500);
 
   TrafficControlHelper tch = TrafficControlHelper::Default ();
-  tch.Install (txDev);
+  QueueDiscContainer qdiscs = tch.Install (txDev);
+  qdiscs.Get (0)->SetAttribute ("DeferredRun", BooleanValue (m_deferredRun));
 
   // transmit 10 packets at time 0
   Simulator::Schedule (Time (Seconds (0)), &TcFlowControlTestCase::SendPackets,
                       this, n.Get (0), 10);
 
+  // With deferred runs, the packets are dequeued by the run scheduled by the
+  // first packet, which leads to the same state of the queues as running
+  // the queue disc after each packet
+  Simulator::Schedule (Time (MilliSeconds (1)), &TcFlowControlTestCase::CheckRunsSaved,
+                      this, txDev, m_deferredRun ? 9 : 0,
+                      m_deferredRun ? "The runs of the last 9 packets must have been saved"
+                                    : "No run must have been saved without deferred runs");
+
   if (m_type == QueueSizeUnit::PACKETS)
     {
       /*
@@ -375,7 +404,9 @@ public:
   TcFlowControlTestSuite ()
     : TestSuite ("tc-flow-control", UNIT)
   {
-    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::PACKETS), TestCase::QUICK);
-    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::BYTES), TestCase::QUICK);
+    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::PACKETS, false), TestCase::QUICK);
+    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::BYTES, false), TestCase::QUICK);
+    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::PACKETS, true), TestCase::QUICK);
+    AddTestCase (new TcFlowControlTestCase (QueueSizeUnit::BYTES, true), TestCase::QUICK);
   }
 } g_tcFlowControlTestSuite; ///< the test suite
@@ -0,0 +1,52 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tcp-segment-test-helper.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/tcp-header.h"
+
+namespace ns3 {
+
+void
+EnqueueTcpSegment (Ptr<QueueDisc> queue, uint16_t srcPort, uint32_t size, uint8_t dscp)
+{
+  TcpHeader tcpHdr;
+  tcpHdr.SetSourcePort (srcPort);
+  tcpHdr.SetDestinationPort (80);
+  Ptr<Packet> p = Create<Packet> (size);
+  p->AddHeader (tcpHdr);
+  Ipv4Header hdr;
+  hdr.SetPayloadSize (p->GetSize ());
+  hdr.SetSource (Ipv4Address ("10.10.1.1"));
+  hdr.SetDestination (Ipv4Address ("10.10.1.2"));
+  hdr.SetProtocol (6);
+  hdr.SetTos (dscp << 2);
+  Address dest;
+  queue->Enqueue (Create<Ipv4QueueDiscItem> (p, dest, 0, hdr));
+}
+
+void
+ParseTcpSegment (Ptr<const QueueDiscItem> item, uint16_t &srcPort, uint32_t &size)
+{
+  TcpHeader tcpHdr;
+  item->GetPacket ()->PeekHeader (tcpHdr);
+  srcPort = tcpHdr.GetSourcePort ();
+  size = item->GetPacket ()->GetSize () - tcpHdr.GetSerializedSize ();
+}
+
+} // namespace ns3
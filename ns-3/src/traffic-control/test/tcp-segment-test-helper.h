@@ -0,0 +1,49 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_SEGMENT_TEST_HELPER_H
+#define TCP_SEGMENT_TEST_HELPER_H
+
+#include "ns3/queue-disc.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control-test
+ *
+ * Enqueue a TCP segment of a flow identified by its source port into a
+ * queue disc, as done by the tests of the flow queueing disciplines
+ * \param queue the queue disc
+ * \param srcPort the source port, which identifies the flow
+ * \param size the size of the payload, which identifies the packet
+ * \param dscp the DSCP of the packet
+ */
+void EnqueueTcpSegment (Ptr<QueueDisc> queue, uint16_t srcPort, uint32_t size, uint8_t dscp = 0);
+
+/**
+ * \ingroup traffic-control-test
+ *
+ * Get the source port and the payload size of a TCP segment enqueued by
+ * EnqueueTcpSegment
+ * \param item the dequeued packet
+ * \param srcPort the source port
+ * \param size the size of the payload
+ */
+void ParseTcpSegment (Ptr<const QueueDiscItem> item, uint16_t &srcPort, uint32_t &size);
+
+} // namespace ns3
+
+#endif /* TCP_SEGMENT_TEST_HELPER_H */
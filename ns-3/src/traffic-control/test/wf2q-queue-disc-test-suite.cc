@@ -0,0 +1,299 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/wf2q-queue-disc.h"
+#include "ns3/enum.h"
+#include "ns3/string.h"
+#include "tcp-segment-test-helper.h"
+#include <map>
+
+using namespace ns3;
+
+/**
+ * This class tests that a packet of a flow that becomes active while many
+ * flows are backlogged is sent after a small number of packets, and that
+ * the packets of each flow are sent in order
+ */
+class WF2QQueueDiscLatency : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param scheduler the scheduler, Wf2qPlus or Stfq
+   */
+  WF2QQueueDiscLatency (std::string scheduler);
+  virtual ~WF2QQueueDiscLatency ();
+
+private:
+  virtual void DoRun (void);
+
+  std::string m_scheduler; //!< the scheduler
+};
+
+WF2QQueueDiscLatency::WF2QQueueDiscLatency (std::string scheduler)
+  : TestCase ("Test the delay of a newly active flow with the " + scheduler + " scheduler"),
+    m_scheduler (scheduler)
+{
+}
+
+WF2QQueueDiscLatency::~WF2QQueueDiscLatency ()
+{
+}
+
+void
+WF2QQueueDiscLatency::DoRun (void)
+{
+  Ptr<WF2QQueueDisc> queue = CreateObjectWithAttributes<WF2QQueueDisc> ("Scheduler", StringValue (m_scheduler));
+  queue->Initialize ();
+
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      for (uint16_t port = 1; port <= 8; port++)
+        {
+          EnqueueTcpSegment (queue, port, 960 + i);
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBackloggedFlows (), 8, "Each flow should have its own queue");
+
+  std::map<uint16_t, uint32_t> next;
+  for (uint16_t port = 1; port <= 8; port++)
+    {
+      next[port] = 960;
+    }
+  next[100] = 60;
+
+  uint32_t n = 0;
+  uint32_t lightPosition = 0;
+  Ptr<QueueDiscItem> item;
+  while ((item = queue->Dequeue ()))
+    {
+      n++;
+      if (n == 20)
+        {
+          EnqueueTcpSegment (queue, 100, 60);
+          NS_TEST_EXPECT_MSG_EQ (queue->GetNBackloggedFlows (), 9, "The light flow should have its own queue");
+        }
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      NS_TEST_EXPECT_MSG_EQ (next.count (port), 1, "Unexpected flow " << port);
+      NS_TEST_EXPECT_MSG_EQ (size, next[port], "Packet " << n << " of flow " << port << " out of order");
+      next[port] = size + 1;
+      if (port == 100)
+        {
+          lightPosition = n - 20;
+        }
+    }
+
+  NS_TEST_EXPECT_MSG_EQ (n, 81, "All the packets should have been dequeued");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBackloggedFlows (), 0, "No flow should be backlogged");
+  if (m_scheduler == "Wf2qPlus")
+    {
+      // its finish time is smaller than that of any eligible packet
+      NS_TEST_EXPECT_MSG_EQ (lightPosition, 1, "The light packet should be sent first");
+    }
+  else
+    {
+      // its start time is the one of the packet in service, so at most the
+      // heads of the other flows with the same start time go first
+      NS_TEST_EXPECT_MSG_GT (lightPosition, 0, "The light packet should have been sent");
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (lightPosition, 9, "The light packet should be sent within a round");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that the flows are served in proportion to their weight
+ */
+class WF2QQueueDiscWeights : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param scheduler the scheduler, Wf2qPlus or Stfq
+   */
+  WF2QQueueDiscWeights (std::string scheduler);
+  virtual ~WF2QQueueDiscWeights ();
+
+private:
+  virtual void DoRun (void);
+
+  std::string m_scheduler; //!< the scheduler
+};
+
+WF2QQueueDiscWeights::WF2QQueueDiscWeights (std::string scheduler)
+  : TestCase ("Test the weighted service of the flows with the " + scheduler + " scheduler"),
+    m_scheduler (scheduler)
+{
+}
+
+WF2QQueueDiscWeights::~WF2QQueueDiscWeights ()
+{
+}
+
+void
+WF2QQueueDiscWeights::DoRun (void)
+{
+  Ptr<WF2QQueueDisc> queue = CreateObjectWithAttributes<WF2QQueueDisc> ("Scheduler", StringValue (m_scheduler),
+                                                                        "WeightKey", StringValue ("Dscp"),
+                                                                        "Weights", StringValue ("10:3"));
+  queue->Initialize ();
+
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      EnqueueTcpSegment (queue, 1, 960, 10);
+      EnqueueTcpSegment (queue, 2, 960);
+    }
+
+  uint32_t heavy = 0;
+  for (uint32_t i = 0; i < 40; i++)
+    {
+      Ptr<QueueDiscItem> item = queue->Dequeue ();
+      NS_TEST_ASSERT_MSG_NE (item, 0, "A packet should have been dequeued");
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      heavy += (port == 1);
+    }
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (heavy, 29, "The flow of weight 3 should get three quarters of the packets");
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (heavy, 31, "The flow of weight 3 should get three quarters of the packets");
+
+  // interleaved enqueues and dequeues over many flows keep each flow in order
+  while (queue->Dequeue ())
+    {
+    }
+  std::map<uint16_t, uint32_t> next;
+  uint32_t sent = 0;
+  for (uint32_t i = 0; i < 1500; i++)
+    {
+      uint16_t port = 1 + (i * 7919) % 64;
+      EnqueueTcpSegment (queue, port, 100 + next[port]++);
+      if (i % 2 == 1)
+        {
+          sent += (queue->Dequeue () != 0);
+        }
+    }
+  next.clear ();
+  Ptr<QueueDiscItem> item;
+  while ((item = queue->Dequeue ()))
+    {
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      NS_TEST_EXPECT_MSG_GT_OR_EQ (size, 100 + next[port], "Packet of flow " << port << " out of order");
+      next[port] = size - 99;
+      sent++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (sent, 1500, "All the packets should have been dequeued");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBackloggedFlows (), 0, "No flow should be backlogged");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * This class tests that the packets in excess of MaxSize are dropped from
+ * the longest flow
+ */
+class WF2QQueueDiscLimit : public TestCase
+{
+public:
+  WF2QQueueDiscLimit ();
+  virtual ~WF2QQueueDiscLimit ();
+
+private:
+  virtual void DoRun (void);
+};
+
+WF2QQueueDiscLimit::WF2QQueueDiscLimit ()
+  : TestCase ("Test the drops when the queue disc is full")
+{
+}
+
+WF2QQueueDiscLimit::~WF2QQueueDiscLimit ()
+{
+}
+
+void
+WF2QQueueDiscLimit::DoRun (void)
+{
+  Ptr<WF2QQueueDisc> queue = CreateObjectWithAttributes<WF2QQueueDisc> ("MaxSize", StringValue ("4p"));
+  queue->Initialize ();
+
+  for (uint16_t port = 1; port <= 5; port++)
+    {
+      EnqueueTcpSegment (queue, port, 960);
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 4, "The queue disc should hold 4 packets");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetStats ().GetNDroppedPackets (WF2QQueueDisc::LIMIT_EXCEEDED_DROP), 1,
+                         "The last packet should have been dropped");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNBackloggedFlows (), 4, "The dropped packet should not make its flow backlogged");
+
+  // a flow filling the queue disc makes room for the packets of other flows
+  while (queue->Dequeue ())
+    {
+    }
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      EnqueueTcpSegment (queue, 1, 960 + i);
+    }
+  EnqueueTcpSegment (queue, 2, 960);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetStats ().GetNDroppedPackets (WF2QQueueDisc::OVERLIMIT_DROP), 1,
+                         "A packet of the longest flow should have been dropped");
+  EnqueueTcpSegment (queue, 1, 964);
+  NS_TEST_EXPECT_MSG_EQ (queue->GetStats ().GetNDroppedPackets (WF2QQueueDisc::LIMIT_EXCEEDED_DROP), 2,
+                         "The packet of the longest flow should have been dropped");
+  NS_TEST_EXPECT_MSG_EQ (queue->GetNPackets (), 4, "The queue disc should hold 4 packets");
+
+  // the packets at the tail of the longest flow were dropped
+  uint32_t expectedSizes[] = {960, 960, 961, 962};
+  uint16_t expectedPorts[] = {1, 2, 1, 1};
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ptr<QueueDiscItem> item = queue->Dequeue ();
+      NS_TEST_ASSERT_MSG_NE (item, 0, "A packet should have been dequeued");
+      uint16_t port;
+      uint32_t size;
+      ParseTcpSegment (item, port, size);
+      NS_TEST_EXPECT_MSG_EQ (port, expectedPorts[i], "Unexpected flow of packet " << i);
+      NS_TEST_EXPECT_MSG_EQ (size, expectedSizes[i], "Unexpected packet " << i << " of its flow");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * WF2Q+ queue disc test suite
+ */
+class WF2QQueueDiscTestSuite : public TestSuite
+{
+public:
+  WF2QQueueDiscTestSuite ();
+};
+
+WF2QQueueDiscTestSuite::WF2QQueueDiscTestSuite ()
+  : TestSuite ("wf2q-queue-disc", UNIT)
+{
+  AddTestCase (new WF2QQueueDiscLatency ("Wf2qPlus"), TestCase::QUICK);
+  AddTestCase (new WF2QQueueDiscLatency ("Stfq"), TestCase::QUICK);
+  AddTestCase (new WF2QQueueDiscWeights ("Wf2qPlus"), TestCase::QUICK);
+  AddTestCase (new WF2QQueueDiscWeights ("Stfq"), TestCase::QUICK);
+  AddTestCase (new WF2QQueueDiscLimit, TestCase::QUICK);
+}
+
+static WF2QQueueDiscTestSuite g_wf2qQueueDiscTestSuite; //!< Static variable for test initialization